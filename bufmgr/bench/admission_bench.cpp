@@ -0,0 +1,112 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Hit ratio of a skewed lookup workload that is interleaved with ad-hoc reads
+ * of pages that are never read again, with the TinyLFU admission filter off
+ * and on.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const std::uint32_t POOL_FRAMES = 128;
+const PageId HOT_PAGES = 256;
+const PageId ADHOC_PAGES = 800;
+const int LOOKUPS = 24000;
+const int LOOKUPS_PER_ADHOC_READ = 3;
+
+void createFile(const std::string& filename, const PageId pages)
+{
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	File file = File::create(filename);
+	BufMgr bufMgr(POOL_FRAMES);
+	BufferAccessStrategy strategy(BufferAccessStrategy::BULKWRITE);
+	for (PageId i = 0; i < pages; i++)
+	{
+		PageId pageNo;
+		Page* page;
+		bufMgr.allocPage(&file, pageNo, page, &strategy);
+		page->insertRecord("benchmark record");
+		bufMgr.unPinPage(&file, pageNo, true);
+	}
+	bufMgr.flushFile(&file);
+}
+
+void run(File* hotFile, File* adhocFile, const bool filter)
+{
+	BufMgr bufMgr(POOL_FRAMES);
+	bufMgr.setAdmissionFilter(filter);
+	Page* page;
+	int lookupMisses = 0;
+	PageId adhocPage = 1;
+
+	srandom(564);
+	for (int i = 0; i < LOOKUPS; i++)
+	{
+		// skewed towards low page numbers: a quarter of the pages get about
+		// half of the lookups
+		const long r = random() % HOT_PAGES;
+		const PageId pageNo = 1 + r * r / HOT_PAGES;
+		const int diskreads = bufMgr.getBufStats().diskreads;
+		bufMgr.readPage(hotFile, pageNo, page);
+		bufMgr.unPinPage(hotFile, pageNo, false);
+		if (bufMgr.getBufStats().diskreads != diskreads)
+			lookupMisses++;
+
+		if (i % LOOKUPS_PER_ADHOC_READ == 0)
+		{
+			bufMgr.readPage(adhocFile, adhocPage, page);
+			bufMgr.unPinPage(adhocFile, adhocPage, false);
+			adhocPage = adhocPage % ADHOC_PAGES + 1;
+		}
+	}
+
+	const BufStats& stats = bufMgr.getBufStats();
+	printf("%-14s lookup hit ratio %7.4f   accesses %6d diskreads %6d admitted %6d rejected %6d\n",
+			filter ? "TinyLFU" : "clock only",
+			1.0 - (double) lookupMisses / LOOKUPS,
+			stats.accesses.load(), stats.diskreads.load(), stats.admitted.load(), stats.rejected.load());
+}
+
+int main()
+{
+	const std::string hotName = "bench.hot";
+	const std::string adhocName = "bench.adhoc";
+
+	createFile(hotName, HOT_PAGES);
+	createFile(adhocName, ADHOC_PAGES);
+
+	{
+		File hotFile = File::open(hotName);
+		File adhocFile = File::open(adhocName);
+
+		std::cout << "pool " << POOL_FRAMES << " frames, skewed lookups over "
+				<< HOT_PAGES << " pages, one ad-hoc page read every "
+				<< LOOKUPS_PER_ADHOC_READ << " lookups\n";
+		run(&hotFile, &adhocFile, false);
+		run(&hotFile, &adhocFile, true);
+	}
+
+	File::remove(hotName);
+	File::remove(adhocName);
+	return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Latency of BufMgr::allocPage when the pool has free frames: right after
+ * startup, and after a file that held every second frame was flushed out.
+ * Both take their frames from the free list.  Besides the time, which
+ * includes extending the file on disk, the BufStats counters show the work
+ * left to the clock: the bitmap words it examined per allocation, and the
+ * resident pages whose reference bit it cleared.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const std::uint32_t POOL_FRAMES = 16384;
+
+/**
+ * Files whose pages stay resident, get dropped, and are loaded afterwards.
+ */
+File* residentFile;
+File* droppedFile;
+File* newFile;
+
+/**
+ * Allocates the given number of pages of <file> and returns the mean time of
+ * one allocation in nanoseconds.
+ */
+double allocate(BufMgr& bufMgr, File* file, const std::uint32_t pages)
+{
+	std::chrono::steady_clock::duration allocating(0);
+	for (std::uint32_t i = 0; i < pages; i++)
+	{
+		PageId pageNo;
+		Page* page;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bufMgr.allocPage(file, pageNo, page);
+		allocating += std::chrono::steady_clock::now() - start;
+		bufMgr.unPinPage(file, pageNo, false);
+	}
+	std::chrono::duration<double, std::nano> perAlloc = allocating / pages;
+	return perAlloc.count();
+}
+
+void report(const char* scenario, BufMgr& bufMgr, const double ns)
+{
+	const BufStats& stats = bufMgr.getBufStats();
+	printf("%-12s %10.1f %14.2f %14llu\n", scenario, ns,
+			static_cast<double>(stats.clockWords) / (POOL_FRAMES / 2),
+			static_cast<unsigned long long>(stats.refBitsCleared));
+}
+
+void startup()
+{
+	BufMgr bufMgr(POOL_FRAMES);
+
+	// half of the pool gets filled, then the other half
+	allocate(bufMgr, residentFile, POOL_FRAMES / 2);
+	bufMgr.clearBufStats();
+	const double ns = allocate(bufMgr, newFile, POOL_FRAMES / 2);
+	report("startup", bufMgr, ns);
+}
+
+void afterDrop()
+{
+	BufMgr bufMgr(POOL_FRAMES);
+
+	// every second frame belongs to the file that gets dropped
+	for (std::uint32_t i = 0; i < POOL_FRAMES; i++)
+		allocate(bufMgr, i % 2 == 0 ? residentFile : droppedFile, 1);
+	bufMgr.flushFile(droppedFile);
+	bufMgr.clearBufStats();
+
+	const double ns = allocate(bufMgr, newFile, POOL_FRAMES / 2);
+	report("after drop", bufMgr, ns);
+}
+
+File createFile(const std::string& filename)
+{
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	return File::create(filename);
+}
+
+int main()
+{
+	const std::string names[3] = {"bench.resident", "bench.dropped", "bench.new"};
+	{
+		File files[3] = {createFile(names[0]), createFile(names[1]), createFile(names[2])};
+		residentFile = &files[0];
+		droppedFile = &files[1];
+		newFile = &files[2];
+
+		printf("pool %u frames, %u allocations per run\n", POOL_FRAMES, POOL_FRAMES / 2);
+		printf("%-12s %10s %14s %14s\n", "scenario", "ns/alloc", "words/alloc", "refbits lost");
+		startup();
+		afterDrop();
+	}
+
+	for (int i = 0; i < 3; i++)
+		File::remove(names[i]);
+	return 0;
+}
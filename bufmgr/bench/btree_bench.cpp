@@ -0,0 +1,149 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Throughput of a B+tree index over integer keys.  One index is bulk loaded
+ * with KEYS sorted keys, another gets the same keys inserted in random
+ * order; then both serve random point lookups from several threads, and
+ * short range scans.  The buffer pool is large enough to hold both trees,
+ * so the numbers show the cost of the tree itself, not of the disk.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ * The number of keys may be given as the first argument.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "btree.h"
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const std::uint32_t POOL_FRAMES = 131072;
+const std::size_t DEFAULT_KEYS = 10000000;
+const std::size_t LOOKUPS = 2000000;
+const std::size_t SCANS = 100000;
+const std::int64_t SCAN_KEYS = 100;
+const unsigned int THREAD_COUNTS[] = {1, 4};
+
+File createFile(const std::string& filename)
+{
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	return File::create(filename);
+}
+
+double seconds(const std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+/**
+ * Looks up LOOKUPS random keys spread over the given threads and returns the
+ * lookups per second.
+ */
+double lookups(BTreeIndex& index, const std::size_t keys, const unsigned int threads)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([&index, keys, threads, t]() {
+			std::mt19937_64 random(t);
+			RecordId rid;
+			for (std::size_t i = 0; i < LOOKUPS / threads; i++)
+			{
+				if (!index.lookup(random() % keys, rid))
+				{
+					fprintf(stderr, "key missing\n");
+					exit(1);
+				}
+			}
+		}));
+	}
+	for (std::thread& worker : workers)
+		worker.join();
+	return LOOKUPS / seconds(start);
+}
+
+/**
+ * Scans SCANS ranges of SCAN_KEYS keys and returns the entries per second.
+ */
+double scans(BTreeIndex& index, const std::size_t keys)
+{
+	std::mt19937_64 random(7);
+	std::uint64_t visited = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < SCANS; i++)
+	{
+		const std::int64_t low = random() % (keys - SCAN_KEYS);
+		visited += index.scan(low, low + SCAN_KEYS - 1, [](std::int64_t, const RecordId&) { return true; });
+	}
+	return visited / seconds(start);
+}
+
+int main(int argc, char* argv[])
+{
+	const std::size_t keys = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_KEYS;
+	std::vector<std::pair<std::int64_t, RecordId> > entries(keys);
+	for (std::size_t i = 0; i < keys; i++)
+		entries[i] = std::make_pair(static_cast<std::int64_t>(i), RecordId{static_cast<PageId>(i / 100 + 1), static_cast<SlotId>(i % 100)});
+	std::vector<std::size_t> order(keys);
+	for (std::size_t i = 0; i < keys; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+
+	{
+		BufMgr bufMgr(POOL_FRAMES);
+		File loadedFile = createFile("bench.btree.load");
+		File insertedFile = createFile("bench.btree.insert");
+		{
+			BTreeIndex loaded(&bufMgr, &loadedFile, BTreeIndex::INTEGER_KEY);
+			BTreeIndex inserted(&bufMgr, &insertedFile, BTreeIndex::INTEGER_KEY);
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			loaded.bulkLoad(entries);
+			const double loadSeconds = seconds(start);
+
+			start = std::chrono::steady_clock::now();
+			for (std::size_t i : order)
+				inserted.insert(entries[i].first, entries[i].second);
+			const double insertSeconds = seconds(start);
+
+			printf("%zu integer keys, %u cores\n", keys, std::thread::hardware_concurrency());
+			printf("%-24s %14s %14s\n", "", "bulk loaded", "inserted");
+			printf("%-24s %14d %14d\n", "height", loaded.height(), inserted.height());
+			printf("%-24s %14.0f %14.0f\n", "build keys/s", keys / loadSeconds, keys / insertSeconds);
+			for (unsigned int threads : THREAD_COUNTS)
+			{
+				char label[32];
+				snprintf(label, sizeof(label), "lookups/s, %u threads", threads);
+				printf("%-24s %14.0f %14.0f\n", label, lookups(loaded, keys, threads), lookups(inserted, keys, threads));
+			}
+			printf("%-24s %14.0f %14.0f\n", "scanned entries/s", scans(loaded, keys), scans(inserted, keys));
+		}
+		bufMgr.invalidateFile(&loadedFile);
+		bufMgr.invalidateFile(&insertedFile);
+	}
+	File::remove("bench.btree.load");
+	File::remove("bench.btree.insert");
+	return 0;
+}
@@ -0,0 +1,83 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Pages per second when bulk loading an empty file: allocating and writing
+ * every page.  The file grows one page at a time, by extents of
+ * File::DEFAULT_EXTENT_PAGES pages, or by extents with the pages allocated in
+ * runs by File::allocatePages().
+ *
+ * Run from a scratch directory on the device to be measured; the benchmark
+ * creates and removes its file.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "file.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const char* const FILE_NAME = "bench.bulk";
+const PageId LOAD_PAGES = 8192;
+const PageId RUN_PAGES = 64;
+
+File createFile()
+{
+	try
+	{
+		File::remove(FILE_NAME);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	return File::create(FILE_NAME);
+}
+
+/**
+ * Loads LOAD_PAGES pages, <run> at a time, into a new file growing by
+ * <extent> pages, and returns the pages loaded per second.
+ */
+double load(const PageId extent, const PageId run)
+{
+	double seconds;
+	{
+		File file = createFile();
+		file.setExtentSize(extent);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (PageId loaded = 0; loaded < LOAD_PAGES; loaded += run)
+		{
+			std::vector<Page> pages;
+			if (run == 1)
+				pages.push_back(file.allocatePage());
+			else
+				pages = file.allocatePages(run);
+			for (Page& page : pages)
+			{
+				page.insertRecord("bulk");
+				file.writePage(page);
+			}
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		seconds = elapsed.count();
+	}
+	File::remove(FILE_NAME);
+	return LOAD_PAGES / seconds;
+}
+
+int main()
+{
+	printf("%u pages loaded into an empty file\n", LOAD_PAGES);
+	printf("%-8s %-8s %12s\n", "extent", "run", "pages/s");
+	printf("%-8u %-8u %12.0f\n", 1, 1, load(1, 1));
+	printf("%-8u %-8u %12.0f\n", File::DEFAULT_EXTENT_PAGES, 1, load(File::DEFAULT_EXTENT_PAGES, 1));
+	printf("%-8u %-8u %12.0f\n", File::DEFAULT_EXTENT_PAGES, RUN_PAGES,
+			load(File::DEFAULT_EXTENT_PAGES, RUN_PAGES));
+	return 0;
+}
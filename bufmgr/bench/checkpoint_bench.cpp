@@ -0,0 +1,157 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Foreground latency while checkpoints write back dirty pages.  One thread
+ * updates a record on random pages of a file that fits the buffer pool,
+ * logging each update and committing every ten, for a fixed time.  A
+ * background checkpointer runs every 200 ms, either writing its pages at
+ * full speed or limited to a number of pages per second; the first row has
+ * no checkpointer.  The columns are percentiles of the latency of one
+ * update (pin, change, log, unpin, and the commit where there is one), the
+ * checkpoints taken and the pages they wrote.
+ *
+ * Run from a scratch directory on the device to be measured; the benchmark
+ * creates and removes its files.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "checkpointer.h"
+#include "log_manager.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const char* const FILE_NAME = "bench.checkpoint.db";
+const char* const LOG_NAME = "bench.checkpoint.wal";
+const std::uint32_t POOL_FRAMES = 4096;
+const PageId FILE_PAGES = 4000;
+const std::size_t RECORD_BYTES = 100;
+const int UPDATES_PER_TXN = 10;
+const std::chrono::milliseconds RUN_TIME(3000);
+const unsigned int CHECKPOINT_INTERVAL_MS = 200;
+
+/**
+ * Checkpointer settings of a row: interval 0 for none, rate 0 for no limit.
+ */
+struct Setting
+{
+	const char* name;
+	unsigned int intervalMs;
+	unsigned int pagesPerSecond;
+};
+
+const Setting SETTINGS[] = {
+	{"none", 0, 0},
+	{"unlimited", CHECKPOINT_INTERVAL_MS, 0},
+	{"20000/s", CHECKPOINT_INTERVAL_MS, 20000},
+	{"5000/s", CHECKPOINT_INTERVAL_MS, 5000},
+};
+
+double percentile(const std::vector<double>& sorted, const double p)
+{
+	return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * sorted.size()))];
+}
+
+void run(const Setting& setting)
+{
+	try
+	{
+		File::remove(FILE_NAME);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	std::remove(LOG_NAME);
+
+	std::vector<double> latencies;
+	std::uint64_t checkpoints;
+	std::uint64_t pagesWritten;
+	{
+		File file = File::create(FILE_NAME);
+		std::vector<PageId> pageNos;
+		for (PageId i = 0; i < FILE_PAGES; i++)
+		{
+			Page page = file.allocatePage();
+			page.insertRecord(std::string(RECORD_BYTES, 'a'));
+			file.writePage(page);
+			pageNos.push_back(page.page_number());
+		}
+
+		LogManager log(LOG_NAME);
+		BufMgr bufMgr(POOL_FRAMES);
+		bufMgr.setLogManager(&log);
+		for (PageId i = 0; i < FILE_PAGES; i++)
+		{
+			Page* page;
+			bufMgr.readPage(&file, pageNos[i], page);
+			bufMgr.unPinPage(&file, pageNos[i], false);
+		}
+
+		{
+			Checkpointer checkpointer(&bufMgr, &log, setting.intervalMs, setting.pagesPerSecond);
+			std::mt19937 random(1);
+			std::string record(RECORD_BYTES, 'a');
+			TxnId txn = log.begin();
+			const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + RUN_TIME;
+			for (unsigned int i = 0; ; i++)
+			{
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				if (start >= end)
+				{
+					break;
+				}
+				const PageId pageNo = pageNos[random() % FILE_PAGES];
+				const RecordId rid = {pageNo, 1};
+				record[i % RECORD_BYTES] = 'a' + random() % 26;
+				Page* page;
+				bufMgr.readPage(&file, pageNo, page);
+				const Page before = *page;
+				page->updateRecord(rid, record);
+				log.logUpdate(txn, &file, before, page);
+				bufMgr.unPinPage(&file, pageNo, true);
+				if ((i + 1) % UPDATES_PER_TXN == 0)
+				{
+					log.commit(txn);
+					txn = log.begin();
+				}
+				std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+				latencies.push_back(elapsed.count());
+			}
+			log.commit(txn);
+			checkpoints = checkpointer.checkpoints();
+			pagesWritten = checkpointer.pagesWritten();
+		}
+		bufMgr.flushFile(&file);
+		bufMgr.setLogManager(NULL);
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	printf("%10s %9zu %9.1f %9.1f %9.1f %9.1f %6llu %9llu\n", setting.name, latencies.size(),
+			percentile(latencies, 0.5), percentile(latencies, 0.99), percentile(latencies, 0.999),
+			latencies.back(), static_cast<unsigned long long>(checkpoints),
+			static_cast<unsigned long long>(pagesWritten));
+}
+
+int main()
+{
+	printf("%10s %9s %9s %9s %9s %9s %6s %9s\n", "ckpt", "updates", "p50 us", "p99 us", "p99.9 us", "max us",
+			"ckpts", "written");
+	for (const Setting& setting : SETTINGS)
+	{
+		run(setting);
+	}
+	File::remove(FILE_NAME);
+	std::remove(LOG_NAME);
+	return 0;
+}
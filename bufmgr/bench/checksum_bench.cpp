@@ -0,0 +1,175 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Cost of page checksums.  The first table is the time to checksum one page
+ * with the CRC instructions of the processor and with the table-driven
+ * fallback.  The second compares it to page I/O: reading a page with
+ * File::readPage(), which verifies it, against File::readPageUnverified(),
+ * from the page cache and from the device (the file is dropped from the page
+ * cache with posix_fadvise() first), and writing a page, which computes the
+ * checksum.  The last table reads the file through a cold buffer pool with
+ * the checksum verified while the mapping latch is held and lazily on first
+ * access.
+ *
+ * Run from a scratch directory on the device to be measured; the benchmark
+ * creates and removes its files.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "buffer.h"
+#include "crc32c.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const char* const FILE_NAME = "bench.checksum.db";
+const PageId FILE_PAGES = 4096;
+const int CRC_ROUNDS = 100000;
+
+/**
+ * Keeps the checksums from being optimized away.
+ */
+volatile std::uint32_t sink;
+
+double seconds(const std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+/**
+ * Drops the file from the page cache, so that the next reads go to the device.
+ */
+void dropCache()
+{
+	const int fd = ::open(FILE_NAME, O_RDONLY);
+	::fdatasync(fd);
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	::close(fd);
+}
+
+/**
+ * Returns the microseconds per page of reading every page of the file.
+ */
+double readPages(File& file, const std::vector<PageId>& pageNos, const bool verify)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::uint64_t sum = 0;
+	for (std::size_t i = 0; i < pageNos.size(); i++)
+	{
+		Page page = verify ? file.readPage(pageNos[i]) : file.readPageUnverified(pageNos[i]);
+		sum += page.getFreeSpace();
+	}
+	const double elapsed = seconds(start);
+	sink = sum;
+	return elapsed * 1e6 / pageNos.size();
+}
+
+/**
+ * Returns the microseconds per page of reading every page through a cold buffer pool.
+ */
+double readPool(File& file, const std::vector<PageId>& pageNos, const bool lazy)
+{
+	BufMgr bufMgr(pageNos.size());
+	bufMgr.setLazyChecksums(lazy);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < pageNos.size(); i++)
+	{
+		Page* page;
+		bufMgr.readPage(&file, pageNos[i], page);
+		bufMgr.unPinPage(&file, pageNos[i], false);
+	}
+	return seconds(start) * 1e6 / pageNos.size();
+}
+
+int main()
+{
+	std::mt19937 random(1);
+	std::vector<char> bytes(Page::SIZE);
+	for (std::size_t i = 0; i < bytes.size(); i++)
+		bytes[i] = 'a' + random() % 26;
+
+	printf("crc32c of one %zu-byte page (hardware: %s)\n", Page::SIZE, Crc32c::hardware() ? "yes" : "no");
+	printf("%10s %10s %10s\n", "version", "ns/page", "GB/s");
+	for (int software = 0; software < 2; software++)
+	{
+		std::uint32_t crc = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < CRC_ROUNDS; i++)
+			crc = software ? Crc32c::extendSoftware(crc, &bytes[0], bytes.size())
+					: Crc32c::extend(crc, &bytes[0], bytes.size());
+		const double elapsed = seconds(start);
+		sink = crc;
+		printf("%10s %10.0f %10.2f\n", software ? "table" : "default", elapsed * 1e9 / CRC_ROUNDS,
+				CRC_ROUNDS * bytes.size() / elapsed / 1e9);
+	}
+
+	try
+	{
+		File::remove(FILE_NAME);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		File file = File::create(FILE_NAME);
+		std::vector<PageId> pageNos;
+		std::vector<Page> pages;
+		for (PageId i = 0; i < FILE_PAGES; i++)
+		{
+			Page page = file.allocatePage();
+			for (int r = 0; r < 60; r++)
+				page.insertRecord(std::string(&bytes[(r * 131) % 4000], 100));
+			pages.push_back(page);
+			pageNos.push_back(page.page_number());
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (PageId i = 0; i < FILE_PAGES; i++)
+			file.writePage(pages[i]);
+		const double writeUs = seconds(start) * 1e6 / FILE_PAGES;
+
+		printf("\nFile I/O per page, %u pages\n", FILE_PAGES);
+		printf("%12s %12s %12s %10s\n", "source", "verified us", "unverif. us", "overhead");
+		// warm-up, so that both runs find the file in the page cache
+		readPages(file, pageNos, false);
+		const double hotVerified = readPages(file, pageNos, true);
+		const double hotUnverified = readPages(file, pageNos, false);
+		printf("%12s %12.2f %12.2f %9.1f%%\n", "page cache", hotVerified, hotUnverified,
+				100 * (hotVerified - hotUnverified) / hotUnverified);
+		dropCache();
+		const double coldVerified = readPages(file, pageNos, true);
+		dropCache();
+		const double coldUnverified = readPages(file, pageNos, false);
+		printf("%12s %12.2f %12.2f %9.1f%%\n", "device", coldVerified, coldUnverified,
+				100 * (coldVerified - coldUnverified) / coldUnverified);
+		printf("writePage with checksum: %.2f us/page\n", writeUs);
+
+		printf("\nBufMgr misses per page\n");
+		printf("%12s %12s %12s\n", "source", "eager us", "lazy us");
+		const double hotEager = readPool(file, pageNos, false);
+		const double hotLazy = readPool(file, pageNos, true);
+		printf("%12s %12.2f %12.2f\n", "page cache", hotEager, hotLazy);
+		dropCache();
+		const double coldEager = readPool(file, pageNos, false);
+		dropCache();
+		const double coldLazy = readPool(file, pageNos, true);
+		printf("%12s %12.2f %12.2f\n", "device", coldEager, coldLazy);
+	}
+
+	File::remove(FILE_NAME);
+	return 0;
+}
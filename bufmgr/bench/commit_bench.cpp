@@ -0,0 +1,133 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Commits per second by durability mode.  Each thread writes a page of its
+ * own to a shared file and commits, over and over, for a fixed time.  The
+ * "own sync" rows make every commit call fdatasync() itself, the way a
+ * committer without group commit would; the "commit" rows use
+ * GroupSync::COMMIT, where concurrent committers share one fdatasync().
+ * The last column is the number of fdatasync() calls per commit.
+ *
+ * Run from a scratch directory on the device to be measured; the benchmark
+ * creates and removes its file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "file.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const char* const FILE_NAME = "bench.commit";
+const std::chrono::milliseconds RUN_TIME(1000);
+const int THREAD_COUNTS[] = {1, 2, 4, 8};
+
+/**
+ * Ways to commit a write.
+ */
+enum Scheme { NO_SYNC, BATCHED, OWN_SYNC, GROUP_COMMIT };
+
+const char* schemeName(const Scheme scheme)
+{
+	switch (scheme)
+	{
+		case NO_SYNC: return "none";
+		case BATCHED: return "batched";
+		case OWN_SYNC: return "own sync";
+		default: return "commit";
+	}
+}
+
+/**
+ * Writes the page and commits it until <stop> is set, counting commits and,
+ * for OWN_SYNC, fdatasync() calls.
+ */
+void committer(File file, Page page, const Scheme scheme, const std::atomic<bool>* stop,
+		std::atomic<std::uint64_t>* commits, std::atomic<std::uint64_t>* ownSyncs)
+{
+	// own descriptor, so that the fdatasync() calls do not go through GroupSync
+	const int fd = scheme == OWN_SYNC ? ::open(FILE_NAME, O_RDWR) : -1;
+	std::uint64_t count = 0;
+	while (!stop->load(std::memory_order_relaxed))
+	{
+		file.writePage(page);
+		if (scheme == OWN_SYNC)
+			::fdatasync(fd);
+		else
+			file.commit();
+		count++;
+	}
+	if (fd >= 0)
+	{
+		::close(fd);
+		ownSyncs->fetch_add(count);
+	}
+	commits->fetch_add(count);
+}
+
+void run(File& file, const std::vector<Page>& pages, const Scheme scheme, const int threads)
+{
+	file.setDurability(scheme == BATCHED ? GroupSync::BATCHED
+			: scheme == GROUP_COMMIT ? GroupSync::COMMIT : GroupSync::NONE);
+	const std::uint64_t syncsBefore = file.syncCount();
+
+	std::atomic<bool> stop(false);
+	std::atomic<std::uint64_t> commits(0);
+	std::atomic<std::uint64_t> ownSyncs(0);
+	std::vector<std::thread> workers;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < threads; i++)
+		workers.push_back(std::thread(committer, file, pages[i], scheme, &stop, &commits, &ownSyncs));
+	std::this_thread::sleep_for(RUN_TIME);
+	stop = true;
+	for (std::thread& worker : workers)
+		worker.join();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	const std::uint64_t syncs = file.syncCount() - syncsBefore + ownSyncs.load();
+	printf("%-10s %8d %14.0f %14.3f\n", schemeName(scheme), threads,
+			commits.load() / elapsed.count(), static_cast<double>(syncs) / commits.load());
+	file.setDurability(GroupSync::NONE);
+}
+
+int main()
+{
+	try
+	{
+		File::remove(FILE_NAME);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		File file = File::create(FILE_NAME);
+		std::vector<Page> pages;
+		for (int i = 0; i < THREAD_COUNTS[3]; i++)
+		{
+			pages.push_back(file.allocatePage());
+			pages.back().insertRecord("commit");
+		}
+
+		printf("%-10s %8s %14s %14s\n", "mode", "threads", "commits/s", "syncs/commit");
+		const Scheme schemes[] = {NO_SYNC, BATCHED, OWN_SYNC, GROUP_COMMIT};
+		for (Scheme scheme : schemes)
+			for (int threads : THREAD_COUNTS)
+				run(file, pages, scheme, threads);
+	}
+
+	File::remove(FILE_NAME);
+	return 0;
+}
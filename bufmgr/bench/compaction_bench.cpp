@@ -0,0 +1,93 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Disk usage and scan time of a table that shrank.  The file is loaded with
+ * LOAD_PAGES pages, then three out of four pages are deleted, once without
+ * and once with hole punching, and finally the file is compacted.  Each row
+ * shows the file size, the disk space allocated to it, and the time of a
+ * scan of the used pages through FileIterator.
+ *
+ * Run from a scratch directory on the device to be measured; the benchmark
+ * creates and removes its file.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "file.h"
+#include "file_iterator.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const char* const FILE_NAME = "bench.compact";
+const PageId LOAD_PAGES = 2048;
+
+/**
+ * Loads the file and deletes three out of four pages.
+ */
+File churnedFile(const bool punchHoles)
+{
+	try
+	{
+		File::remove(FILE_NAME);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	File file = File::create(FILE_NAME);
+	file.setPunchHoles(punchHoles);
+	std::vector<Page> pages = file.allocatePages(LOAD_PAGES);
+	for (Page& page : pages)
+	{
+		page.insertRecord("churned");
+		file.writePage(page);
+	}
+	for (PageId i = 0; i < LOAD_PAGES; i++)
+		if (i % 4 != 0)
+			file.deletePage(pages[i].page_number());
+	return file;
+}
+
+void report(File& file, const char* state)
+{
+	struct stat status;
+	stat(FILE_NAME, &status);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	PageId pages = 0;
+	for (FileIterator iter = file.begin(); iter != file.end(); ++iter)
+	{
+		Page page = *iter;
+		pages += page.page_number() != Page::INVALID_NUMBER;
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	printf("%-20s %10.1f %10.1f %8u %10.1f\n", state, status.st_size / 1048576.0,
+			status.st_blocks * 512 / 1048576.0, pages, elapsed.count());
+}
+
+int main()
+{
+	printf("%u pages loaded, 3 of 4 deleted\n", LOAD_PAGES);
+	printf("%-20s %10s %10s %8s %10s\n", "state", "size MB", "disk MB", "pages", "scan ms");
+	{
+		File file = churnedFile(false);
+		report(file, "deleted");
+	}
+	{
+		File file = churnedFile(true);
+		report(file, "deleted, punched");
+		file.compact();
+		report(file, "compacted");
+	}
+	File::remove(FILE_NAME);
+	return 0;
+}
@@ -0,0 +1,192 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Cost and benefit of compressed files on a text-heavy table: rows of
+ * names, cities and free-text notes.  The first table is the speed of
+ * LzCodec on one page of the table.  Then the same pages are loaded into a
+ * plain and a compressed file with File::writePage(), and both are scanned
+ * with FileScan, warm (from the page cache) and cold (dropped from it with
+ * posix_fadvise() first).  Throughput counts the uncompressed bytes of the
+ * pages; the compression ratio is that of their bytes to the size of the
+ * file.
+ *
+ * Run from a scratch directory on the device to be measured; the benchmark
+ * creates and removes its files.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "file.h"
+#include "file_scan.h"
+#include "lz_codec.h"
+#include "page_iterator.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const PageId LOAD_PAGES = 8192;
+const int CODEC_ROUNDS = 20000;
+
+const char* const FIRST_NAMES[] = {"Alice", "Bob", "Carol", "David", "Erin", "Frank", "Grace", "Heidi",
+		"Ivan", "Judy", "Mallory", "Niaj", "Olivia", "Peggy", "Rupert", "Sybil"};
+const char* const LAST_NAMES[] = {"Smith", "Johnson", "Williams", "Brown", "Jones", "Miller", "Davis",
+		"Garcia", "Rodriguez", "Wilson", "Martinez", "Anderson", "Taylor", "Thomas", "Moore", "Jackson"};
+const char* const CITIES[] = {"Madison", "Milwaukee", "Green Bay", "Kenosha", "Racine", "Appleton",
+		"Waukesha", "Eau Claire", "Oshkosh", "Janesville"};
+const char* const WORDS[] = {"customer", "order", "shipped", "delayed", "returned", "requested", "refund",
+		"invoice", "package", "damaged", "delivery", "address", "changed", "called", "support", "again",
+		"please", "contact", "before", "after", "weekend", "morning", "urgent", "priority", "standard",
+		"warehouse", "backorder", "confirmed", "payment", "received", "pending", "review"};
+
+template <typename T, std::size_t N>
+const char* pick(std::mt19937& random, T (&words)[N])
+{
+	return words[random() % N];
+}
+
+/**
+ * Returns a row of the table.
+ */
+std::string makeRow(std::mt19937& random, const int id)
+{
+	std::string row = "id=" + std::to_string(id) + ";name=" + pick(random, FIRST_NAMES) + " "
+			+ pick(random, LAST_NAMES) + ";city=" + pick(random, CITIES) + ";note=";
+	const int words = 6 + random() % 10;
+	for (int i = 0; i < words; i++)
+	{
+		row += pick(random, WORDS);
+		row += i + 1 < words ? " " : ".";
+	}
+	return row;
+}
+
+double seconds(const std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+/**
+ * Drops the file from the page cache, so that the next reads go to the device.
+ */
+void dropCache(const std::string& name)
+{
+	const int fd = ::open(name.c_str(), O_RDONLY);
+	::fdatasync(fd);
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	::close(fd);
+}
+
+/**
+ * Fills the pages with rows, the same ones on every call; returns the number
+ * of rows.
+ */
+int fill(std::vector<Page>& pages)
+{
+	std::mt19937 random(1);
+	int id = 0;
+	for (std::size_t i = 0; i < pages.size(); i++)
+	{
+		std::string row = makeRow(random, id);
+		while (pages[i].hasSpaceForRecord(row))
+		{
+			pages[i].insertRecord(row);
+			row = makeRow(random, ++id);
+		}
+	}
+	return id;
+}
+
+/**
+ * Returns the MB/s of scanning the file with FileScan.
+ */
+double scan(File& file, const bool cold)
+{
+	if (cold)
+		dropCache(file.filename());
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long records = 0;
+	FileScan fileScan(&file);
+	while (Page* page = fileScan.next())
+		for (PageIterator iter = page->begin(); iter != page->end(); ++iter)
+			records++;
+	const double elapsed = seconds(start);
+	if (records == 0)
+		printf("no records scanned\n");
+	return LOAD_PAGES * Page::SIZE / elapsed / 1e6;
+}
+
+int main()
+{
+	{
+		std::mt19937 random(1);
+		std::string page;
+		for (int id = 0; page.size() < Page::SIZE; id++)
+			page += makeRow(random, id);
+		page.resize(Page::SIZE);
+		std::vector<char> packed(LzCodec::maxCompressedLength(Page::SIZE));
+		std::size_t packedLength = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < CODEC_ROUNDS; i++)
+			packedLength = LzCodec::compress(page.data(), page.size(), &packed[0], packed.size());
+		const double compressSeconds = seconds(start);
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < CODEC_ROUNDS; i++)
+			LzCodec::decompress(&packed[0], packedLength, &page[0], page.size());
+		const double decompressSeconds = seconds(start);
+		printf("LzCodec on one page of rows\n");
+		printf("%12s %14s %16s\n", "ratio", "compress MB/s", "decompress MB/s");
+		printf("%12.2f %14.0f %16.0f\n\n", static_cast<double>(Page::SIZE) / packedLength,
+				CODEC_ROUNDS * Page::SIZE / compressSeconds / 1e6,
+				CODEC_ROUNDS * Page::SIZE / decompressSeconds / 1e6);
+	}
+
+	for (int compressed = 0; compressed < 2; compressed++)
+	{
+		const std::string name = compressed ? "bench.compressed" : "bench.plain";
+		try
+		{
+			File::remove(name);
+		}
+		catch(FileNotFoundException e)
+		{
+		}
+
+		{
+			File file = File::create(name, compressed != 0);
+			std::vector<Page> pages = file.allocatePages(LOAD_PAGES);
+			const int rows = fill(pages);
+			if (compressed == 0)
+			{
+				printf("%u pages of %d rows\n", LOAD_PAGES, rows);
+				printf("%12s %10s %10s %12s %12s %12s\n", "file", "ratio", "size MB", "write MB/s",
+						"warm MB/s", "cold MB/s");
+			}
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (PageId i = 0; i < LOAD_PAGES; i++)
+				file.writePage(pages[i]);
+			const double writeRate = LOAD_PAGES * Page::SIZE / seconds(start) / 1e6;
+
+			struct stat status;
+			::stat(name.c_str(), &status);
+			const double warmRate = scan(file, false);
+			const double coldRate = scan(file, true);
+			printf("%12s %10.2f %10.1f %12.0f %12.0f %12.0f\n", compressed ? "compressed" : "plain",
+					static_cast<double>(LOAD_PAGES) * Page::SIZE / status.st_size, status.st_size / 1e6,
+					writeRate, warmRate, coldRate);
+		}
+		File::remove(name);
+	}
+	return 0;
+}
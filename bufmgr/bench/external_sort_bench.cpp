@@ -0,0 +1,131 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Throughput of an ExternalSort of 100-byte records with random 10-byte keys
+ * at the front, for inputs of 1, 10 and 100 times its memory budget.  The
+ * first fits and is sorted in memory; the others form runs and merge them,
+ * the last through more runs than the budget merges at once.  Each size is
+ * sorted with one and with several threads forming the runs.  Record order
+ * is checked on the way.
+ *
+ * The input files are written directly, and the page cache is not dropped,
+ * so the numbers show the CPU cost of sorting and the cost of the extra
+ * passes, not of the disk.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ * The budget in frames may be given as the first argument.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "buffer.h"
+#include "external_sort.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const std::uint32_t POOL_FRAMES = 16384;
+const std::uint32_t DEFAULT_BUDGET_FRAMES = 256;
+const std::size_t RECORD_BYTES = 100;
+const std::size_t KEY_BYTES = 10;
+const unsigned int MULTIPLES[] = {1, 10, 100};
+const unsigned int THREAD_COUNTS[] = {1, 4};
+
+File createFile(const std::string& filename)
+{
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	return File::create(filename);
+}
+
+double seconds(const std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+/**
+ * Writes random records to <pages> pages of a file and returns the number of
+ * records.
+ */
+std::size_t fill(File& file, const PageId pages)
+{
+	std::mt19937_64 random(pages);
+	std::string record(RECORD_BYTES, '.');
+	std::size_t records = 0;
+	for (PageId i = 0; i < pages; i++)
+	{
+		Page page = file.allocatePage();
+		for (;;)
+		{
+			for (std::size_t j = 0; j < KEY_BYTES; j++)
+				record[j] = 'a' + random() % 26;
+			if (!page.hasSpaceForRecord(record))
+				break;
+			page.insertRecord(record);
+			records++;
+		}
+		file.writePage(page);
+	}
+	return records;
+}
+
+int main(int argc, char* argv[])
+{
+	const std::uint32_t budget = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_BUDGET_FRAMES;
+	printf("budget %u frames (%.0f MB), %u cores\n", budget,
+			budget * static_cast<double>(Page::SIZE) / (1 << 20), std::thread::hardware_concurrency());
+	printf("%-8s %10s %8s %6s %7s %12s %10s %10s\n", "input", "records", "threads", "runs", "merges",
+			"pages spilt", "seconds", "records/s");
+
+	BufMgr bufMgr(POOL_FRAMES);
+	for (unsigned int multiple : MULTIPLES)
+	{
+		File input = createFile("bench.sort.input");
+		const std::size_t records = fill(input, multiple * budget);
+		for (unsigned int threads : THREAD_COUNTS)
+		{
+			ExternalSort sorter(&bufMgr, budget, threads);
+			std::size_t sorted = 0;
+			std::string last;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			sorter.sort(&input, [&sorted, &last](const std::string& record) {
+				if (record.compare(0, KEY_BYTES, last, 0, KEY_BYTES) < 0)
+				{
+					fprintf(stderr, "records out of order\n");
+					exit(1);
+				}
+				last = record;
+				sorted++;
+			});
+			const double elapsed = seconds(start);
+			if (sorted != records)
+			{
+				fprintf(stderr, "records lost\n");
+				exit(1);
+			}
+			char label[16];
+			snprintf(label, sizeof(label), "%ux", multiple);
+			printf("%-8s %10zu %8u %6u %7u %12llu %10.2f %10.0f\n", label, records, threads, sorter.runs(),
+					sorter.merges(), static_cast<unsigned long long>(sorter.pagesWritten()), elapsed, records / elapsed);
+		}
+	}
+	File::remove("bench.sort.input");
+	return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Time to flush one small file out of a large, full buffer pool.  One big
+ * file holds most of the pool and many small files share the rest.  The first
+ * column scans every frame descriptor for the small file's pages, the way
+ * flushFile() worked before it had per-file frame lists; the second calls
+ * BufMgr::flushFile(), which only walks the frames of that file.
+ *
+ * The pool is filled through BufMgr::readPage(); the pages are clean, so
+ * flushing writes nothing.  Run from a scratch directory; the benchmark
+ * creates and removes its files.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const std::uint32_t POOL_FRAMES = 16384;
+const int SMALL_FILES = 64;
+const PageId SMALL_FILE_PAGES = 16;
+
+/**
+ * The big file first, then the small ones.
+ */
+std::vector<File> files;
+
+File* fileOf(const int i)
+{
+	return &files[i];
+}
+
+std::string fileName(const int i)
+{
+	std::ostringstream name;
+	name << "bench.flush." << i;
+	return name.str();
+}
+
+/**
+ * Frame descriptor of the per-descriptor scan, one cache line per frame.
+ */
+struct alignas(CACHE_LINE_SIZE) LegacyDesc
+{
+	File* file;
+	PageId pageNo;
+	bool valid;
+};
+
+/**
+ * Gives every frame a page: each small file gets SMALL_FILE_PAGES pages
+ * spread over the pool, the big file (number 0) gets the rest.
+ */
+std::vector<int> layout()
+{
+	std::vector<int> owner(POOL_FRAMES, 0);
+	const std::uint32_t stride = POOL_FRAMES / (SMALL_FILES * SMALL_FILE_PAGES);
+	for (std::uint32_t slot = 0; slot < SMALL_FILES * SMALL_FILE_PAGES; slot++)
+		owner[slot * stride] = 1 + slot % SMALL_FILES;
+	return owner;
+}
+
+double runScan(const std::vector<int>& owner)
+{
+	std::vector<LegacyDesc> descs(POOL_FRAMES);
+	for (FrameId i = 0; i < POOL_FRAMES; i++)
+	{
+		descs[i].file = fileOf(owner[i]);
+		descs[i].pageNo = i;
+		descs[i].valid = true;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int f = 1; f <= SMALL_FILES; f++)
+	{
+		const File* file = fileOf(f);
+		for (FrameId i = 0; i < POOL_FRAMES; i++)
+		{
+			if (descs[i].valid && descs[i].file == file)
+			{
+				descs[i].file = NULL;
+				descs[i].valid = false;
+			}
+		}
+	}
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / SMALL_FILES;
+}
+
+double runLists(const std::vector<int>& owner)
+{
+	BufMgr bufMgr(POOL_FRAMES);
+	std::vector<PageId> nextPage(SMALL_FILES + 1, 1);
+	Page* page;
+	for (FrameId i = 0; i < POOL_FRAMES; i++)
+	{
+		const PageId pageNo = nextPage[owner[i]]++;
+		bufMgr.readPage(fileOf(owner[i]), pageNo, page);
+		bufMgr.unPinPage(fileOf(owner[i]), pageNo, false);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int f = 1; f <= SMALL_FILES; f++)
+		bufMgr.flushFile(fileOf(f));
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / SMALL_FILES;
+}
+
+int main()
+{
+	files.reserve(SMALL_FILES + 1);
+	for (int i = 0; i <= SMALL_FILES; i++)
+	{
+		try
+		{
+			File::remove(fileName(i));
+		}
+		catch(FileNotFoundException e)
+		{
+		}
+		files.push_back(File::create(fileName(i)));
+	}
+
+	const std::vector<int> owner = layout();
+	std::vector<PageId> pages(SMALL_FILES + 1, 0);
+	for (FrameId i = 0; i < POOL_FRAMES; i++)
+		pages[owner[i]]++;
+	for (int i = 0; i <= SMALL_FILES; i++)
+		files[i].allocatePages(pages[i]);
+
+	const double scan = runScan(owner);
+	const double lists = runLists(owner);
+
+	printf("pool %u frames, %d small files of %u pages, microseconds per flushFile\n",
+			POOL_FRAMES, SMALL_FILES, SMALL_FILE_PAGES);
+	printf("%14s %14s %10s\n", "scan pool", "file list", "speedup");
+	printf("%14.2f %14.2f %9.1fx\n", scan, lists, scan / lists);
+
+	files.clear();
+	for (int i = 0; i <= SMALL_FILES; i++)
+		File::remove(fileName(i));
+	return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Point lookups of integer keys through a HashIndex, compared with a
+ * BTreeIndex over the same keys, binary search in a sorted in-memory array,
+ * and a full scan of a heap file holding the keys.  Keys are inserted into
+ * both indexes in random order; lookups ask for random keys, half of which
+ * are not present.  The buffer pool holds every page, and the page column
+ * counts buffer pool accesses per lookup.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ * The number of keys may be given as the first argument.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "btree.h"
+#include "buffer.h"
+#include "file_scan.h"
+#include "hash_index.h"
+#include "heap_file.h"
+#include "page_iterator.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const std::uint32_t POOL_FRAMES = 65536;
+const std::size_t DEFAULT_KEYS = 2000000;
+const std::size_t LOOKUPS = 1000000;
+const std::size_t SCAN_LOOKUPS = 5;
+
+File createFile(const std::string& filename)
+{
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	return File::create(filename);
+}
+
+double seconds(const std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+/**
+ * Runs <count> lookups of random keys in [0, 2 * keys) and prints their rate
+ * and buffer pool accesses per lookup.
+ */
+template <class Lookup>
+void run(const char* name, BufMgr& bufMgr, const std::size_t keys, const std::size_t count, Lookup lookup)
+{
+	std::mt19937_64 random(1);
+	std::size_t found = 0;
+	bufMgr.clearBufStats();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < count; i++)
+		found += lookup(static_cast<std::int64_t>(random() % (2 * keys)));
+	const double elapsed = seconds(start);
+	printf("%-14s %14.0f %10.2f %10.2f\n", name, count / elapsed,
+			static_cast<double>(bufMgr.getBufStats().accesses) / count,
+			static_cast<double>(found) / count);
+}
+
+int main(int argc, char* argv[])
+{
+	const std::size_t keys = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_KEYS;
+	std::vector<std::int64_t> order(keys);
+	for (std::size_t i = 0; i < keys; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+
+	{
+		BufMgr bufMgr(POOL_FRAMES);
+		File hashFile = createFile("bench.hash.index");
+		File treeFile = createFile("bench.hash.tree");
+		File heapFile = createFile("bench.hash.heap");
+		{
+			HashIndex hashIndex(&bufMgr, &hashFile, HashIndex::INTEGER_KEY);
+			BTreeIndex treeIndex(&bufMgr, &treeFile, BTreeIndex::INTEGER_KEY);
+			std::vector<std::int64_t> sorted;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (std::int64_t key : order)
+				hashIndex.insert(key, {static_cast<PageId>(key + 1), 0});
+			const double hashSeconds = seconds(start);
+			start = std::chrono::steady_clock::now();
+			for (std::int64_t key : order)
+				treeIndex.insert(key, {static_cast<PageId>(key + 1), 0});
+			const double treeSeconds = seconds(start);
+			start = std::chrono::steady_clock::now();
+			sorted = order;
+			std::sort(sorted.begin(), sorted.end());
+			const double sortSeconds = seconds(start);
+			{
+				HeapFile heap(&bufMgr, &heapFile);
+				for (std::int64_t key : order)
+					heap.insert(std::string(reinterpret_cast<const char*>(&key), sizeof(key)));
+			}
+			bufMgr.flushFile(&heapFile);
+
+			printf("%zu integer keys; hash index: %u buckets, global depth %d; B+tree height %d\n",
+					keys, hashIndex.buckets(), hashIndex.globalDepth(), treeIndex.height());
+			printf("%-14s %14.0f\n%-14s %14.0f\n%-14s %14.0f\n\n", "hash ins/s", keys / hashSeconds,
+					"B+tree ins/s", keys / treeSeconds, "sort keys/s", keys / sortSeconds);
+			printf("%-14s %14s %10s %10s\n", "lookup", "lookups/s", "pages", "hit rate");
+
+			RecordId rid;
+			run("hash index", bufMgr, keys, LOOKUPS, [&hashIndex, &rid](std::int64_t key) {
+				return hashIndex.lookup(key, rid);
+			});
+			run("B+tree", bufMgr, keys, LOOKUPS, [&treeIndex, &rid](std::int64_t key) {
+				return treeIndex.lookup(key, rid);
+			});
+			run("sorted array", bufMgr, keys, LOOKUPS, [&sorted](std::int64_t key) {
+				return std::binary_search(sorted.begin(), sorted.end(), key);
+			});
+			run("full scan", bufMgr, keys, SCAN_LOOKUPS, [&heapFile](std::int64_t key) {
+				FileScan scan(&heapFile);
+				bool found = false;
+				while (Page* page = scan.next())
+				{
+					for (PageIterator iter = page->begin(); iter != page->end(); ++iter)
+						found |= std::memcmp((*iter).data(), &key, sizeof(key)) == 0;
+				}
+				return found;
+			});
+		}
+		bufMgr.invalidateFile(&hashFile);
+		bufMgr.invalidateFile(&treeFile);
+		bufMgr.invalidateFile(&heapFile);
+	}
+	File::remove("bench.hash.index");
+	File::remove("bench.hash.tree");
+	File::remove("bench.hash.heap");
+	return 0;
+}
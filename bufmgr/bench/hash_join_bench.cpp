@@ -0,0 +1,139 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Throughput of a HashJoin of 64-byte records with 8-byte integer keys, for
+ * build sides of 1/2 to 64 times its memory budget.  The build side holds
+ * each key once, in random order; the probe side is twice as large and
+ * draws its keys at random from twice the build keys, so half of its
+ * records find a match.  Build sides that fit are joined in memory, larger
+ * ones through partitions.  The number of pairs is checked against the
+ * expected count.
+ *
+ * The input files are written directly, and the page cache is not dropped,
+ * so the numbers show the CPU cost of the join and the cost of the extra
+ * pass over partitions, not of the disk.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ * The budget in frames may be given as the first argument.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "hash_join.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const std::uint32_t POOL_FRAMES = 16384;
+const std::uint32_t DEFAULT_BUDGET_FRAMES = 256;
+const std::size_t RECORD_BYTES = 64;
+const double BUILD_MULTIPLES[] = {0.5, 1, 4, 16, 64};
+
+File createFile(const std::string& filename)
+{
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	return File::create(filename);
+}
+
+double seconds(const std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+/**
+ * Writes the records with the given keys to a file, filling its pages.
+ */
+void fill(File& file, const std::vector<std::int64_t>& keys)
+{
+	std::string record(RECORD_BYTES, '.');
+	Page page = file.allocatePage();
+	for (std::int64_t key : keys)
+	{
+		std::memcpy(&record[0], &key, sizeof(key));
+		if (!page.hasSpaceForRecord(record))
+		{
+			file.writePage(page);
+			page = file.allocatePage();
+		}
+		page.insertRecord(record);
+	}
+	file.writePage(page);
+}
+
+int main(int argc, char* argv[])
+{
+	const std::uint32_t budget = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_BUDGET_FRAMES;
+	const std::size_t recordsPerPage = (Page::DATA_SIZE - 16) / (RECORD_BYTES + 8);
+	printf("budget %u frames (%.0f MB)\n", budget, budget * static_cast<double>(Page::SIZE) / (1 << 20));
+	printf("%-8s %10s %10s %10s %11s %7s %12s %9s %14s\n", "build", "build recs", "probe recs", "pairs",
+			"partitions", "chunks", "pages spilt", "seconds", "probe recs/s");
+
+	BufMgr bufMgr(POOL_FRAMES);
+	for (double multiple : BUILD_MULTIPLES)
+	{
+		const std::size_t buildRecords = static_cast<std::size_t>(multiple * budget * recordsPerPage);
+		const std::size_t probeRecords = 2 * buildRecords;
+		std::mt19937_64 random(buildRecords);
+		std::vector<std::int64_t> keys(buildRecords);
+		for (std::size_t i = 0; i < buildRecords; i++)
+			keys[i] = i;
+		std::shuffle(keys.begin(), keys.end(), random);
+		std::size_t expected = 0;
+		{
+			File build = createFile("bench.join.build");
+			fill(build, keys);
+		}
+		keys.resize(probeRecords);
+		for (std::size_t i = 0; i < probeRecords; i++)
+		{
+			keys[i] = random() % (2 * buildRecords);
+			expected += keys[i] < static_cast<std::int64_t>(buildRecords);
+		}
+		{
+			File probe = createFile("bench.join.probe");
+			fill(probe, keys);
+		}
+
+		File build = File::open("bench.join.build");
+		File probe = File::open("bench.join.probe");
+		const HashJoin::Input buildInput = {&build, 0, sizeof(std::int64_t), HashJoin::PageFilter()};
+		const HashJoin::Input probeInput = {&probe, 0, sizeof(std::int64_t), HashJoin::PageFilter()};
+		HashJoin join(&bufMgr, budget);
+		std::size_t pairs = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		join.join(buildInput, probeInput, [&pairs](const std::string&, const std::string&) { pairs++; });
+		const double elapsed = seconds(start);
+		if (pairs != expected)
+		{
+			fprintf(stderr, "%zu pairs, expected %zu\n", pairs, expected);
+			exit(1);
+		}
+		char label[16];
+		snprintf(label, sizeof(label), "%gx", multiple);
+		printf("%-8s %10zu %10zu %10zu %11u %7u %12llu %9.2f %14.0f\n", label, buildRecords, probeRecords, pairs,
+				join.partitions(), join.buildChunks(), static_cast<unsigned long long>(join.pagesWritten()),
+				elapsed, probeRecords / elapsed);
+	}
+	File::remove("bench.join.build");
+	File::remove("bench.join.probe");
+	return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Insert throughput as a table grows.  Records of RECORD_BYTES bytes are
+ * inserted in batches, and every batch also erases a tenth of the records
+ * inserted before, so that there is free space scattered over the table.
+ * The first columns find a page with room through the free-space map of
+ * HeapFile; the last ones by scanning the pages from the start through the
+ * buffer manager, which is stopped once a batch takes too long.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "heap_file.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const std::uint32_t POOL_FRAMES = 32768;
+const int BATCHES = 10;
+const int BATCH_RECORDS = 100000;
+const std::size_t RECORD_BYTES = 100;
+const double SCAN_LIMIT_SECONDS = 5;
+
+File createFile(const std::string& filename)
+{
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	return File::create(filename);
+}
+
+/**
+ * Inserts into the first page with room, scanning from the first page.
+ */
+class ScanInserter
+{
+ public:
+	ScanInserter(BufMgr* bufMgr, File* file) : bufMgr(bufMgr), file(file) {}
+
+	RecordId insert(const std::string& record)
+	{
+		for (PageId pageNo : pages)
+		{
+			Page* page;
+			bufMgr->readPage(file, pageNo, page);
+			if (page->hasSpaceForRecord(record))
+			{
+				const RecordId rid = page->insertRecord(record);
+				bufMgr->unPinPage(file, pageNo, true);
+				return rid;
+			}
+			bufMgr->unPinPage(file, pageNo, false);
+		}
+		PageId pageNo;
+		Page* page;
+		bufMgr->allocPage(file, pageNo, page);
+		pages.push_back(pageNo);
+		const RecordId rid = page->insertRecord(record);
+		bufMgr->unPinPage(file, pageNo, true);
+		return rid;
+	}
+
+	void erase(const RecordId& rid)
+	{
+		Page* page;
+		bufMgr->readPage(file, rid.page_number, page);
+		page->deleteRecord(rid);
+		bufMgr->unPinPage(file, rid.page_number, true);
+	}
+
+ private:
+	BufMgr* bufMgr;
+	File* file;
+	std::vector<PageId> pages;
+};
+
+/**
+ * Runs the batches and returns the inserts per second of each, stopping
+ * after the first batch that takes longer than <limit> seconds.
+ */
+template <class Inserter>
+std::vector<double> run(Inserter& inserter, const double limit)
+{
+	std::mt19937 random(42);
+	const std::string record(RECORD_BYTES, 'r');
+	std::vector<RecordId> rids;
+	std::vector<double> rates;
+	for (int batch = 0; batch < BATCHES; batch++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < BATCH_RECORDS; i++)
+		{
+			rids.push_back(inserter.insert(record));
+			if (i % 10 == 0 && rids.size() > 1)
+			{
+				const std::size_t victim = random() % (rids.size() - 1);
+				inserter.erase(rids[victim]);
+				rids[victim] = rids.back();
+				rids.pop_back();
+			}
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		rates.push_back(BATCH_RECORDS / elapsed.count());
+		if (elapsed.count() > limit)
+			break;
+	}
+	return rates;
+}
+
+int main()
+{
+	std::vector<double> fsmRates;
+	std::vector<double> scanRates;
+	PageId dataPages;
+	{
+		BufMgr bufMgr(POOL_FRAMES);
+		File fsmFile = createFile("bench.heap.fsm");
+		File scanFile = createFile("bench.heap.scan");
+		{
+			HeapFile heapFile(&bufMgr, &fsmFile);
+			fsmRates = run(heapFile, 1e9);
+			dataPages = heapFile.dataPages();
+		}
+		ScanInserter scanInserter(&bufMgr, &scanFile);
+		scanRates = run(scanInserter, SCAN_LIMIT_SECONDS);
+		bufMgr.invalidateFile(&fsmFile);
+		bufMgr.invalidateFile(&scanFile);
+	}
+	File::remove("bench.heap.fsm");
+	File::remove("bench.heap.scan");
+
+	printf("batches of %d inserts of %zu bytes, 1 in 10 followed by an erase; %u data pages at the end\n",
+			BATCH_RECORDS, RECORD_BYTES, dataPages);
+	printf("%8s %14s %14s\n", "batch", "FSM ins/s", "scan ins/s");
+	for (int batch = 0; batch < BATCHES; batch++)
+	{
+		printf("%8d %14.0f", batch + 1, fsmRates[batch]);
+		if (batch < static_cast<int>(scanRates.size()))
+			printf(" %14.0f\n", scanRates[batch]);
+		else
+			printf(" %14s\n", "-");
+	}
+	return 0;
+}
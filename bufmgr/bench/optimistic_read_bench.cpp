@@ -0,0 +1,149 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Many readers of a single hot page, like the root of an index: every thread
+ * repeatedly reads a key from the page.  The columns read it with a raw pin
+ * (readPage() and unPinPage()), with a read guard (pin and shared frame
+ * latch), and optimistically (readPageOptimistic() and validatePage()),
+ * which writes no shared cache line while the page stays in its frame.  The
+ * last column is the optimistic rate while one more thread rewrites the
+ * page through a write guard a thousand times a second.
+ *
+ * The gap grows with the number of cores, since the pin and the latch move
+ * the cache lines of the frame between them on every read.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "buffer.h"
+#include "page_guard.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const int OPS_PER_THREAD = 1000000;
+const int KEY_OFFSET = 64;
+
+enum Mode { PIN, GUARD, OPTIMISTIC };
+
+/**
+ * Reads the key of the page OPS_PER_THREAD times; returns their sum so that
+ * the reads are not optimized away.
+ */
+std::uint64_t reader(BufMgr* bufMgr, File* file, const PageId pageNo, const Mode mode)
+{
+	std::uint64_t sum = 0;
+	PageVersion version;
+	for (int i = 0; i < OPS_PER_THREAD; i++)
+	{
+		std::uint64_t key;
+		if (mode == PIN)
+		{
+			Page* page;
+			bufMgr->readPage(file, pageNo, page);
+			std::memcpy(&key, reinterpret_cast<const char*>(page) + KEY_OFFSET, sizeof(key));
+			bufMgr->unPinPage(file, pageNo, false);
+		}
+		else if (mode == GUARD)
+		{
+			ReadPageGuard guard = bufMgr->readPageShared(file, pageNo);
+			std::memcpy(&key, reinterpret_cast<const char*>(guard.page()) + KEY_OFFSET, sizeof(key));
+		}
+		else
+		{
+			do
+			{
+				const Page* page = bufMgr->readPageOptimistic(file, pageNo, version);
+				std::memcpy(&key, reinterpret_cast<const char*>(page) + KEY_OFFSET, sizeof(key));
+			} while (!bufMgr->validatePage(version));
+		}
+		sum += key;
+	}
+	return sum;
+}
+
+/**
+ * Rewrites the key of the page every millisecond until <stop> is set.
+ */
+void writer(BufMgr* bufMgr, File* file, const PageId pageNo, const std::atomic<bool>* stop)
+{
+	for (std::uint64_t key = 0; !stop->load(); key++)
+	{
+		{
+			WritePageGuard guard = bufMgr->readPageExclusive(file, pageNo);
+			std::memcpy(reinterpret_cast<char*>(guard.page()) + KEY_OFFSET, &key, sizeof(key));
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+double run(BufMgr* bufMgr, File* file, const PageId pageNo, const int threads, const Mode mode,
+		const bool writing)
+{
+	std::atomic<bool> stop(false);
+	std::thread updater;
+	if (writing)
+		updater = std::thread(writer, bufMgr, file, pageNo, &stop);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	std::atomic<std::uint64_t> sum(0);
+	for (int t = 0; t < threads; t++)
+		workers.push_back(std::thread([&]() { sum += reader(bufMgr, file, pageNo, mode); }));
+	for (int t = 0; t < threads; t++)
+		workers[t].join();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	stop = true;
+	if (writing)
+		updater.join();
+
+	// million reads per second
+	return threads * OPS_PER_THREAD / elapsed.count() / 1e6;
+}
+
+int main()
+{
+	const std::string filename = "bench.optimistic";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		File file = File::create(filename);
+		BufMgr bufMgr(64);
+		PageId pageNo;
+		{
+			WritePageGuard guard = bufMgr.allocPageExclusive(&file, pageNo);
+		}
+
+		printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+		printf("%8s %12s %12s %14s %16s\n", "threads", "pin Mops/s", "guard Mops/s", "optim. Mops/s",
+				"+writer Mops/s");
+		for (int threads = 1; threads <= 16; threads *= 2)
+		{
+			const double pinRate = run(&bufMgr, &file, pageNo, threads, PIN, false);
+			const double guardRate = run(&bufMgr, &file, pageNo, threads, GUARD, false);
+			const double optimisticRate = run(&bufMgr, &file, pageNo, threads, OPTIMISTIC, false);
+			const double writingRate = run(&bufMgr, &file, pageNo, threads, OPTIMISTIC, true);
+			printf("%8d %12.2f %12.2f %14.2f %16.2f\n", threads, pinRate, guardRate, optimisticRate, writingRate);
+		}
+		bufMgr.flushFile(&file);
+	}
+
+	File::remove(filename);
+	return 0;
+}
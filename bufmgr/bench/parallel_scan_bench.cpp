@@ -0,0 +1,87 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Time of a ParallelScan counting matching records, by number of threads.
+ * Records in the first eighth of the file are made expensive to evaluate,
+ * so that the workers starting there fall behind and the others have to
+ * steal their ranges.  The file is in the page cache; the speedup is bounded
+ * by the number of cores of the machine.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its file.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "file.h"
+#include "parallel_scan.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const char* const FILE_NAME = "bench.parallel";
+const PageId LOAD_PAGES = 8192;
+const int RECORDS_PER_PAGE = 32;
+const int THREAD_COUNTS[] = {1, 2, 4, 8};
+
+/**
+ * Matches records that start with 's'; "slow" records take a while.
+ */
+bool predicate(const std::string& record)
+{
+	if (record[1] == 'l')
+	{
+		volatile unsigned int hash = 0;
+		for (int i = 0; i < 2000; i++)
+			hash = hash * 31 + record[i % record.size()];
+	}
+	return record[0] == 's';
+}
+
+int main()
+{
+	try
+	{
+		File::remove(FILE_NAME);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		File file = File::create(FILE_NAME);
+		std::vector<Page> pages = file.allocatePages(LOAD_PAGES);
+		for (PageId i = 0; i < LOAD_PAGES; i++)
+		{
+			for (int j = 0; j < RECORDS_PER_PAGE; j++)
+				pages[i].insertRecord(i < LOAD_PAGES / 8 ? "slow record" : "fast record");
+			file.writePage(pages[i]);
+		}
+
+		printf("%u pages of %d records, %u cores\n", LOAD_PAGES, RECORDS_PER_PAGE,
+				std::thread::hardware_concurrency());
+		printf("%8s %10s %10s %8s %10s\n", "threads", "ms", "speedup", "steals", "matches");
+		double single = 0;
+		for (int threads : THREAD_COUNTS)
+		{
+			ParallelScan scan(NULL, &file, threads);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			const std::uint64_t matches = scan.countIf(predicate);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			if (threads == 1)
+				single = elapsed.count();
+			printf("%8d %10.1f %9.2fx %8lu %10lu\n", threads, elapsed.count(), single / elapsed.count(),
+					static_cast<unsigned long>(scan.steals()), static_cast<unsigned long>(matches));
+		}
+	}
+
+	File::remove(FILE_NAME);
+	return 0;
+}
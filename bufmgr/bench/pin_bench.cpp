@@ -0,0 +1,96 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Contended pin/unpin of a single resident page: every thread repeatedly
+ * calls readPage() and unPinPage() on the same page.  The second column runs
+ * the same loop with a global mutex around each call, which is what a
+ * concurrent BufMgr needed before frames had an atomic state word.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const int OPS_PER_THREAD = 1000000;
+
+std::mutex globalLock;
+
+void worker(BufMgr* bufMgr, File* file, const PageId pageNo, const bool locked)
+{
+	Page* page;
+	for (int i = 0; i < OPS_PER_THREAD; i++)
+	{
+		if (locked)
+		{
+			std::lock_guard<std::mutex> guard(globalLock);
+			bufMgr->readPage(file, pageNo, page);
+			bufMgr->unPinPage(file, pageNo, false);
+		}
+		else
+		{
+			bufMgr->readPage(file, pageNo, page);
+			bufMgr->unPinPage(file, pageNo, false);
+		}
+	}
+}
+
+double run(BufMgr* bufMgr, File* file, const PageId pageNo, const int threads, const bool locked)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++)
+		workers.push_back(std::thread(worker, bufMgr, file, pageNo, locked));
+	for (int t = 0; t < threads; t++)
+		workers[t].join();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	// million pin/unpin pairs per second
+	return threads * OPS_PER_THREAD / elapsed.count() / 1e6;
+}
+
+int main()
+{
+	const std::string filename = "bench.pin";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		File file = File::create(filename);
+		BufMgr bufMgr(64);
+		PageId pageNo;
+		Page* page;
+		bufMgr.allocPage(&file, pageNo, page);
+		bufMgr.unPinPage(&file, pageNo, true);
+
+		printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+		printf("%8s %16s %16s\n", "threads", "atomic Mops/s", "mutex Mops/s");
+		for (int threads = 1; threads <= 8; threads *= 2)
+		{
+			const double atomicRate = run(&bufMgr, &file, pageNo, threads, false);
+			const double mutexRate = run(&bufMgr, &file, pageNo, threads, true);
+			printf("%8d %16.2f %16.2f\n", threads, atomicRate, mutexRate);
+		}
+		bufMgr.flushFile(&file);
+	}
+
+	File::remove(filename);
+	return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Recovery time against log size.  A workload updates a 100-byte record on
+ * random pages of a file larger than the buffer pool, ten updates per
+ * transaction, and then "crashes": the pool drops its dirty pages and the
+ * last transaction is left uncommitted.  The crashed files are saved, and
+ * recovered once per number of redo threads from the same state.  Each log
+ * size is run without checkpoints and with a background checkpoint every
+ * 100 ms, which bounds the log that recovery reads.
+ *
+ * The page cache is not dropped between runs, so the numbers show the CPU
+ * cost of recovery and its writes, not the cost of reading a cold disk.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "checkpointer.h"
+#include "log_manager.h"
+#include "recovery.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const char* const FILE_NAME = "bench.recovery.db";
+const char* const LOG_NAME = "bench.recovery.wal";
+const std::uint32_t POOL_FRAMES = 1024;
+const PageId FILE_PAGES = 4096;
+const std::size_t RECORD_BYTES = 100;
+const int UPDATES_PER_TXN = 10;
+const unsigned int UPDATE_COUNTS[] = {10000, 100000, 400000};
+const unsigned int THREAD_COUNTS[] = {1, 4};
+const unsigned int CHECKPOINT_INTERVAL_MS = 100;
+
+double seconds(const std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+void copyFile(const std::string& from, const std::string& to)
+{
+	std::ifstream in(from.c_str(), std::ios::binary);
+	std::ofstream out(to.c_str(), std::ios::binary | std::ios::trunc);
+	out << in.rdbuf();
+}
+
+/**
+ * Creates the file and a fresh log, runs the workload and leaves the files
+ * as a crash would.  Returns the size of the log in bytes.
+ */
+Lsn crash(const unsigned int updates, const bool checkpoints)
+{
+	try
+	{
+		File::remove(FILE_NAME);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	std::remove(LOG_NAME);
+
+	File file = File::create(FILE_NAME);
+	std::vector<PageId> pageNos;
+	for (PageId i = 0; i < FILE_PAGES; i++)
+	{
+		Page page = file.allocatePage();
+		page.insertRecord(std::string(RECORD_BYTES, 'a'));
+		file.writePage(page);
+		pageNos.push_back(page.page_number());
+	}
+
+	LogManager log(LOG_NAME);
+	Lsn end;
+	{
+		BufMgr bufMgr(POOL_FRAMES);
+		bufMgr.setLogManager(&log);
+		Checkpointer checkpointer(&bufMgr, &log, checkpoints ? CHECKPOINT_INTERVAL_MS : 0);
+		std::mt19937 random(updates);
+		std::string record(RECORD_BYTES, 'a');
+		TxnId txn = log.begin();
+		for (unsigned int i = 0; i < updates; i++)
+		{
+			const PageId pageNo = pageNos[random() % FILE_PAGES];
+			const RecordId rid = {pageNo, 1};
+			record[i % RECORD_BYTES] = 'a' + random() % 26;
+			Page* page;
+			bufMgr.readPage(&file, pageNo, page);
+			const Page before = *page;
+			page->updateRecord(rid, record);
+			log.logUpdate(txn, &file, before, page);
+			bufMgr.unPinPage(&file, pageNo, true);
+			if ((i + 1) % UPDATES_PER_TXN == 0 && i + 1 < updates)
+			{
+				log.commit(txn);
+				txn = log.begin();
+			}
+		}
+		log.flush(log.nextLsn() - 1);
+		end = log.nextLsn();
+		bufMgr.invalidateFile(&file);
+		bufMgr.setLogManager(NULL);
+	}
+	return end;
+}
+
+int main()
+{
+	printf("%9s %8s %6s %8s %10s %8s %8s %8s %9s\n", "updates", "log MB", "ckpt", "threads", "analyzed",
+			"redone", "undone", "seconds", "log MB/s");
+	for (unsigned int updates : UPDATE_COUNTS)
+	{
+		for (int checkpoints = 0; checkpoints < 2; checkpoints++)
+		{
+			const double logMb = crash(updates, checkpoints != 0) / static_cast<double>(1 << 20);
+			copyFile(FILE_NAME, std::string(FILE_NAME) + ".crashed");
+			copyFile(LOG_NAME, std::string(LOG_NAME) + ".crashed");
+			for (unsigned int threads : THREAD_COUNTS)
+			{
+				copyFile(std::string(FILE_NAME) + ".crashed", FILE_NAME);
+				copyFile(std::string(LOG_NAME) + ".crashed", LOG_NAME);
+				BufMgr bufMgr(POOL_FRAMES);
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				LogManager log(LOG_NAME);
+				Recovery recovery(&bufMgr, &log, threads);
+				recovery.recover();
+				const double elapsed = seconds(start);
+				bufMgr.setLogManager(NULL);
+				printf("%9u %8.1f %6s %8u %10llu %8llu %8llu %8.3f %9.1f\n", updates, logMb,
+						checkpoints ? "yes" : "no", threads,
+						static_cast<unsigned long long>(recovery.analyzedRecords()),
+						static_cast<unsigned long long>(recovery.redoneRecords()),
+						static_cast<unsigned long long>(recovery.undoneRecords()), elapsed, logMb / elapsed);
+			}
+		}
+	}
+	File::remove(FILE_NAME);
+	std::remove(LOG_NAME);
+	std::remove((std::string(FILE_NAME) + ".crashed").c_str());
+	std::remove((std::string(LOG_NAME) + ".crashed").c_str());
+	return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Time to scan every used page of a file: page by page with FileIterator,
+ * and in blocks with FileScan.  Each scan runs once with the file dropped
+ * from the page cache beforehand (cold) and once right after (warm), and
+ * counts the records it finds.
+ *
+ * Run from a scratch directory on the device to be measured; the benchmark
+ * creates and removes its file.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "file.h"
+#include "file_iterator.h"
+#include "file_scan.h"
+#include "page_iterator.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const char* const FILE_NAME = "bench.scan";
+const PageId LOAD_PAGES = 8192;
+const int RECORDS_PER_PAGE = 32;
+
+/**
+ * Drops the pages of the file from the page cache.
+ */
+void dropCache()
+{
+	const int fd = ::open(FILE_NAME, O_RDONLY);
+	::fdatasync(fd);
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	::close(fd);
+}
+
+int countRecords(Page& page)
+{
+	int records = 0;
+	for (PageIterator iter = page.begin(); iter != page.end(); ++iter)
+		records++;
+	return records;
+}
+
+/**
+ * Scans the file with FileIterator, or with FileScan if <blockBytes> is not
+ * 0, and prints the time taken.
+ */
+void scan(File& file, const std::size_t blockBytes, const bool cold)
+{
+	if (cold)
+		dropCache();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long records = 0;
+	if (blockBytes == 0)
+	{
+		for (FileIterator iter = file.begin(); iter != file.end(); ++iter)
+		{
+			Page page = *iter;
+			records += countRecords(page);
+		}
+	}
+	else
+	{
+		FileScan fileScan(&file, blockBytes);
+		while (Page* page = fileScan.next())
+			records += countRecords(*page);
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	char method[32];
+	if (blockBytes == 0)
+		snprintf(method, sizeof(method), "FileIterator");
+	else
+		snprintf(method, sizeof(method), "FileScan %zu KB", blockBytes / 1024);
+	printf("%-18s %-6s %10.1f %10ld\n", method, cold ? "cold" : "warm", elapsed.count(), records);
+}
+
+int main()
+{
+	try
+	{
+		File::remove(FILE_NAME);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		File file = File::create(FILE_NAME);
+		std::vector<Page> pages = file.allocatePages(LOAD_PAGES);
+		for (Page& page : pages)
+		{
+			for (int i = 0; i < RECORDS_PER_PAGE; i++)
+				page.insertRecord("a record of some two dozen bytes");
+			file.writePage(page);
+		}
+
+		printf("%u pages of %d records\n", LOAD_PAGES, RECORDS_PER_PAGE);
+		printf("%-18s %-6s %10s %10s\n", "method", "cache", "ms", "records");
+		const std::size_t blockBytes[] = {0, 1 << 20, 4 << 20};
+		for (std::size_t bytes : blockBytes)
+		{
+			scan(file, bytes, true);
+			scan(file, bytes, false);
+		}
+	}
+
+	File::remove(FILE_NAME);
+	return 0;
+}
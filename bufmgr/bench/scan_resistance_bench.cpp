@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Hit ratio of a point-lookup workload over a small hot table while a large
+ * table is scanned through the same buffer pool, with and without a BULKREAD
+ * access strategy for the scan.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const std::uint32_t POOL_FRAMES = 128;
+const PageId HOT_PAGES = 96;
+const PageId SCAN_PAGES = 640;
+const int LOOKUPS = 40000;
+const int LOOKUPS_PER_SCAN_PAGE = 4;
+
+void createFile(const std::string& filename, const PageId pages)
+{
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	File file = File::create(filename);
+	BufMgr bufMgr(POOL_FRAMES);
+	BufferAccessStrategy strategy(BufferAccessStrategy::BULKWRITE);
+	for (PageId i = 0; i < pages; i++)
+	{
+		PageId pageNo;
+		Page* page;
+		bufMgr.allocPage(&file, pageNo, page, &strategy);
+		page->insertRecord("benchmark record");
+		bufMgr.unPinPage(&file, pageNo, true);
+	}
+	bufMgr.flushFile(&file);
+}
+
+/**
+ * Runs the lookup workload and returns the hit ratio of the lookups.
+ *
+ * @param withScan      Whether a scan runs next to the lookups
+ * @param withStrategy  Whether the scan uses a BULKREAD strategy
+ */
+double run(File* hotFile, File* scanFile, const bool withScan, const bool withStrategy)
+{
+	BufMgr bufMgr(POOL_FRAMES);
+	BufferAccessStrategy strategy(BufferAccessStrategy::BULKREAD);
+	Page* page;
+	int lookupMisses = 0;
+	PageId scanPage = 1;
+
+	srandom(564);
+	for (int i = 0; i < LOOKUPS; i++)
+	{
+		const PageId pageNo = 1 + random() % HOT_PAGES;
+		const int diskreads = bufMgr.getBufStats().diskreads;
+		bufMgr.readPage(hotFile, pageNo, page);
+		bufMgr.unPinPage(hotFile, pageNo, false);
+		if (bufMgr.getBufStats().diskreads != diskreads)
+			lookupMisses++;
+
+		if (withScan && i % LOOKUPS_PER_SCAN_PAGE == 0)
+		{
+			bufMgr.readPage(scanFile, scanPage, page, withStrategy ? &strategy : NULL);
+			bufMgr.unPinPage(scanFile, scanPage, false);
+			scanPage = scanPage % SCAN_PAGES + 1;
+		}
+	}
+
+	return 1.0 - (double) lookupMisses / LOOKUPS;
+}
+
+int main()
+{
+	const std::string hotName = "bench.hot";
+	const std::string scanName = "bench.scan";
+
+	createFile(hotName, HOT_PAGES);
+	createFile(scanName, SCAN_PAGES);
+
+	{
+		File hotFile = File::open(hotName);
+		File scanFile = File::open(scanName);
+
+		std::cout << "pool " << POOL_FRAMES << " frames, hot set " << HOT_PAGES
+				<< " pages, scanned table " << SCAN_PAGES << " pages\n";
+		printf("%-32s %8.4f\n", "lookups only",
+				run(&hotFile, &scanFile, false, false));
+		printf("%-32s %8.4f\n", "lookups + scan (clock)",
+				run(&hotFile, &scanFile, true, false));
+		printf("%-32s %8.4f\n", "lookups + scan (BULKREAD ring)",
+				run(&hotFile, &scanFile, true, true));
+	}
+
+	File::remove(hotName);
+	File::remove(scanName);
+	return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Disk reads of skewed lookups over a text-heavy table that is several times
+ * larger than the buffer pool, with the victim cache off and on.  Pools with
+ * and without the cache are compared at the same memory: frames plus the
+ * bytes of the cache.  The time per lookup is with the file in the page
+ * cache, so it shows the cost of compression more than the disk reads it
+ * saves.
+ *
+ * Run from a scratch directory; the benchmark creates and removes its files.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const PageId TABLE_PAGES = 1024;
+const int LOOKUPS = 200000;
+
+const char* const NAMES[] = {"Alice", "Bob", "Carol", "David", "Erin", "Frank", "Grace", "Heidi"};
+const char* const CITIES[] = {"Madison", "Milwaukee", "Green Bay", "Kenosha", "Racine", "Appleton"};
+const char* const WORDS[] = {"customer", "order", "shipped", "delayed", "returned", "refund", "invoice",
+		"package", "delivery", "address", "support", "payment", "received", "pending", "review", "urgent"};
+
+template <typename T, std::size_t N>
+const char* pick(std::mt19937& random, T (&words)[N])
+{
+	return words[random() % N];
+}
+
+/**
+ * Returns a row of the table.
+ */
+std::string makeRow(std::mt19937& random, const int id)
+{
+	std::string row = "id=" + std::to_string(id) + ";name=" + pick(random, NAMES) + ";city="
+			+ pick(random, CITIES) + ";note=";
+	for (int i = 6 + random() % 10; i > 0; i--)
+	{
+		row += pick(random, WORDS);
+		row += i > 1 ? " " : ".";
+	}
+	return row;
+}
+
+void createFile(const std::string& filename)
+{
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	File file = File::create(filename);
+	BufMgr bufMgr(128);
+	BufferAccessStrategy strategy(BufferAccessStrategy::BULKWRITE);
+	std::mt19937 random(1);
+	int id = 0;
+	for (PageId i = 0; i < TABLE_PAGES; i++)
+	{
+		PageId pageNo;
+		Page* page;
+		bufMgr.allocPage(&file, pageNo, page, &strategy);
+		for (std::string row = makeRow(random, id); page->hasSpaceForRecord(row); row = makeRow(random, ++id))
+			page->insertRecord(row);
+		bufMgr.unPinPage(&file, pageNo, true);
+	}
+	bufMgr.flushFile(&file);
+}
+
+void run(File* file, const std::uint32_t frames, const std::size_t cacheBytes)
+{
+	BufMgr bufMgr(frames);
+	bufMgr.setVictimCache(cacheBytes);
+	Page* page;
+
+	srandom(564);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < LOOKUPS; i++)
+	{
+		// skewed towards low page numbers: a quarter of the pages get about
+		// half of the lookups
+		const long r = random() % TABLE_PAGES;
+		const PageId pageNo = 1 + r * r / TABLE_PAGES;
+		bufMgr.readPage(file, pageNo, page);
+		bufMgr.unPinPage(file, pageNo, false);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	const BufStats& stats = bufMgr.getBufStats();
+	printf("%8u %10.2f %10.2f %10d %12d %10.2f %10.2f\n", frames, cacheBytes / 1048576.0,
+			(frames * static_cast<double>(Page::SIZE) + cacheBytes) / 1048576.0, stats.diskreads.load(),
+			stats.victimHits.load(), stats.victimCompressionRatio(), elapsed.count() * 1e6 / LOOKUPS);
+}
+
+int main()
+{
+	const std::string name = "bench.victim";
+	createFile(name);
+
+	{
+		File file = File::open(name);
+		printf("skewed lookups over %u pages of rows\n", TABLE_PAGES);
+		printf("%8s %10s %10s %10s %12s %10s %10s\n", "frames", "cache MB", "total MB", "diskreads",
+				"victim hits", "ratio", "us/lookup");
+		run(&file, 128, 0);
+		run(&file, 64, 64 * Page::SIZE);
+		run(&file, 256, 0);
+		run(&file, 128, 128 * Page::SIZE);
+		run(&file, 512, 0);
+		run(&file, 256, 256 * Page::SIZE);
+	}
+
+	File::remove(name);
+	return 0;
+}
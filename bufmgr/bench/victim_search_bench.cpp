@@ -0,0 +1,246 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Cost of one victim search in a full buffer pool where most frames are
+ * pinned.  Each step searches for a victim, pins it as a new page would be,
+ * and unpins a random pinned frame, so the pin ratio stays constant.  The
+ * first columns run the clock the way it worked before the sweep state moved
+ * into bitmaps, reading the cache-line sized descriptor of one frame after
+ * the other; only the search is timed.  The last columns read a page that is
+ * not resident through BufMgr::readPage, whose miss runs findVictim over the
+ * frame bitmaps; the time includes evicting the victim and reading the page
+ * from the page cache, the BufStats counters count the bitmap words examined.
+ *
+ * Run from a scratch directory; the benchmark creates and removes a file of
+ * POOL_FRAMES + SEARCHES pages.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const std::uint32_t POOL_FRAMES = 16384;
+const int SEARCHES = 20000;
+
+/**
+ * File the pages of the pool are read from.
+ */
+File* benchFile;
+
+/**
+ * Frame descriptor as it was before the sweep state moved into bitmaps: pin
+ * count, reference bit and flags in one atomic word per cache line.
+ */
+struct alignas(CACHE_LINE_SIZE) LegacyDesc
+{
+	static const std::uint64_t PIN_MASK = 0xffffffffULL;
+	static const std::uint64_t REF = 1ULL << 32;
+	static const std::uint64_t VALID = 1ULL << 40;
+
+	File* file;
+	PageId pageNo;
+	FrameId frameNo;
+	std::atomic<std::uint64_t> state;
+};
+
+/**
+ * The original clock over an array of descriptors.
+ */
+struct LegacyClock
+{
+	std::vector<LegacyDesc> descs;
+	FrameId clockHand;
+	std::uint64_t visited;
+
+	bool findVictim(FrameId & frame)
+	{
+		unsigned int counter = 0;
+		while (counter <= descs.size())
+		{
+			visited++;
+			LegacyDesc& desc = descs[clockHand];
+			const std::uint64_t state = desc.state.load(std::memory_order_acquire);
+			if ((state & LegacyDesc::VALID) && (state & LegacyDesc::REF))
+			{
+				desc.state.fetch_and(~LegacyDesc::REF, std::memory_order_relaxed);
+			}
+			else if ((state & LegacyDesc::VALID) && (state & LegacyDesc::PIN_MASK) != 0)
+			{
+				counter++;
+			}
+			else
+			{
+				frame = clockHand;
+				return true;
+			}
+			clockHand = (clockHand + 1) % descs.size();
+		}
+		return false;
+	}
+};
+
+/**
+ * Time the clock takes to read itself, measured once and subtracted from every search.
+ */
+std::chrono::steady_clock::duration timerOverhead;
+
+void calibrate()
+{
+	std::chrono::steady_clock::duration total(0);
+	for (int i = 0; i < SEARCHES; i++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		total += std::chrono::steady_clock::now() - start;
+	}
+	timerOverhead = total / SEARCHES;
+}
+
+double nanosPerSearch(const std::chrono::steady_clock::duration searching)
+{
+	std::chrono::duration<double, std::nano> perSearch = searching / SEARCHES - timerOverhead;
+	return perSearch.count();
+}
+
+/**
+ * Picks which frames start out pinned, and the frames to unpin at each step.
+ */
+void layout(const double pinRatio, std::vector<bool>& pinned, std::vector<FrameId>& pinnedFrames)
+{
+	srandom(529);
+	pinned.assign(POOL_FRAMES, false);
+	pinnedFrames.clear();
+	for (FrameId i = 0; i < POOL_FRAMES; i++)
+	{
+		if (random() % 10000 < pinRatio * 10000)
+		{
+			pinned[i] = true;
+			pinnedFrames.push_back(i);
+		}
+	}
+}
+
+/**
+ * Runs the legacy clock, returns the mean time of one search in nanoseconds
+ * and the descriptors it read per search via <steps>.
+ */
+double runLegacy(const double pinRatio, double& steps)
+{
+	std::vector<bool> pinned;
+	std::vector<FrameId> pinnedFrames;
+	layout(pinRatio, pinned, pinnedFrames);
+
+	LegacyClock clock;
+	clock.descs = std::vector<LegacyDesc>(POOL_FRAMES);
+	clock.clockHand = 0;
+	clock.visited = 0;
+	for (FrameId i = 0; i < POOL_FRAMES; i++)
+	{
+		clock.descs[i].file = NULL;
+		clock.descs[i].pageNo = i;
+		clock.descs[i].frameNo = i;
+		clock.descs[i].state.store(LegacyDesc::VALID | LegacyDesc::REF | (pinned[i] ? 1 : 0));
+	}
+
+	srandom(5);
+	std::chrono::steady_clock::duration searching(0);
+	for (int i = 0; i < SEARCHES; i++)
+	{
+		FrameId victim = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		clock.findVictim(victim);
+		searching += std::chrono::steady_clock::now() - start;
+		clock.descs[victim].state.fetch_add(1 | LegacyDesc::REF);
+
+		// swap the victim in for a random pinned frame, which gets unpinned
+		const std::size_t slot = random() % pinnedFrames.size();
+		clock.descs[pinnedFrames[slot]].state.fetch_sub(1);
+		pinnedFrames[slot] = victim;
+	}
+	steps = static_cast<double>(clock.visited) / SEARCHES;
+	return nanosPerSearch(searching);
+}
+
+/**
+ * Runs misses through BufMgr, returns the mean time of one miss in
+ * nanoseconds and the bitmap words examined per search via <steps>.
+ */
+double runBitmap(const double pinRatio, double& steps)
+{
+	std::vector<bool> pinned;
+	std::vector<FrameId> pinnedFrames;
+	layout(pinRatio, pinned, pinnedFrames);
+
+	// frame i of the layout is the page read i-th, so pinnedFrames holds page numbers - 1
+	BufMgr bufMgr(POOL_FRAMES);
+	Page* page;
+	for (FrameId i = 0; i < POOL_FRAMES; i++)
+	{
+		bufMgr.readPage(benchFile, i + 1, page);
+		if (!pinned[i])
+			bufMgr.unPinPage(benchFile, i + 1, false);
+	}
+	bufMgr.clearBufStats();
+
+	srandom(5);
+	std::chrono::steady_clock::duration searching(0);
+	for (int i = 0; i < SEARCHES; i++)
+	{
+		const PageId pageNo = POOL_FRAMES + i + 1;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bufMgr.readPage(benchFile, pageNo, page);
+		searching += std::chrono::steady_clock::now() - start;
+
+		const std::size_t slot = random() % pinnedFrames.size();
+		bufMgr.unPinPage(benchFile, pinnedFrames[slot] + 1, false);
+		pinnedFrames[slot] = pageNo - 1;
+	}
+	for (std::size_t i = 0; i < pinnedFrames.size(); i++)
+		bufMgr.unPinPage(benchFile, pinnedFrames[i] + 1, false);
+	steps = static_cast<double>(bufMgr.getBufStats().clockWords) / bufMgr.getBufStats().victimSearches;
+	return nanosPerSearch(searching);
+}
+
+int main()
+{
+	const std::string filename = "bench.victim";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	{
+		File file = File::create(filename);
+		file.allocatePages(POOL_FRAMES + SEARCHES);
+		benchFile = &file;
+
+		const double pinRatios[] = {0.5, 0.9, 0.99, 0.999};
+		calibrate();
+
+		printf("pool %u frames, %d victim searches per run\n", POOL_FRAMES, SEARCHES);
+		printf("%-10s %14s %14s %14s %14s\n", "pinned", "legacy ns", "descriptors", "readPage ns", "bitmap words");
+		for (int i = 0; i < 4; i++)
+		{
+			double descriptors;
+			double words;
+			const double legacy = runLegacy(pinRatios[i], descriptors);
+			const double bitmap = runBitmap(pinRatios[i], words);
+			printf("%-10.3f %14.1f %14.1f %14.1f %14.1f\n", pinRatios[i], legacy, descriptors, bitmap, words);
+		}
+	}
+
+	File::remove(filename);
+	return 0;
+}
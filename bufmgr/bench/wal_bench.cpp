@@ -0,0 +1,142 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Durable commits per second with and without the write-ahead log.  Each
+ * thread updates a record on a page of its own and commits, over and over,
+ * for a fixed time.  The "in place" rows make a commit durable the way the
+ * tree did without a log: the page is written to its file, which is then
+ * synced by the committer itself.  The "wal" rows log the update, leave the
+ * page dirty in the buffer pool and commit through LogManager, where
+ * concurrent committers share the log write and its fdatasync().  The last
+ * columns are the mean commit latency and the fdatasync() calls per commit.
+ *
+ * Run from a scratch directory on the device to be measured; the benchmark
+ * creates and removes its files.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "buffer.h"
+#include "log_manager.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+const char* const FILE_NAME = "bench.wal.db";
+const char* const LOG_NAME = "bench.wal";
+const std::chrono::milliseconds RUN_TIME(1000);
+const int THREAD_COUNTS[] = {1, 4, 16};
+const std::uint32_t POOL_FRAMES = 64;
+
+/**
+ * Updates the record of a page and commits until <stop> is set.
+ */
+void committer(BufMgr* bufMgr, File* file, LogManager* log, const PageId pageNo, const std::atomic<bool>* stop,
+		std::atomic<std::uint64_t>* commits, std::atomic<std::uint64_t>* ownSyncs)
+{
+	// own descriptor, so that the in-place syncs are counted per committer
+	const int fd = log == NULL ? ::open(FILE_NAME, O_RDWR) : -1;
+	const RecordId rid = {pageNo, 1};
+	std::string record(100, 'a');
+	std::uint64_t count = 0;
+	while (!stop->load(std::memory_order_relaxed))
+	{
+		record[count % record.size()]++;
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		if (log == NULL)
+		{
+			page->updateRecord(rid, record);
+			file->writePage(*page);
+			bufMgr->unPinPage(file, pageNo, false);
+			::fdatasync(fd);
+		}
+		else
+		{
+			const TxnId txn = log->begin();
+			const Page before = *page;
+			page->updateRecord(rid, record);
+			log->logUpdate(txn, file, before, page);
+			bufMgr->unPinPage(file, pageNo, true);
+			log->commit(txn);
+		}
+		count++;
+	}
+	if (fd >= 0)
+	{
+		::close(fd);
+		ownSyncs->fetch_add(count);
+	}
+	commits->fetch_add(count);
+}
+
+void run(BufMgr* bufMgr, File* file, LogManager* log, const std::vector<PageId>& pages, const int threads)
+{
+	const std::uint64_t syncsBefore = log == NULL ? 0 : log->syncCount();
+	std::atomic<bool> stop(false);
+	std::atomic<std::uint64_t> commits(0);
+	std::atomic<std::uint64_t> ownSyncs(0);
+	std::vector<std::thread> workers;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < threads; i++)
+		workers.push_back(std::thread(committer, bufMgr, file, log, pages[i], &stop, &commits, &ownSyncs));
+	std::this_thread::sleep_for(RUN_TIME);
+	stop = true;
+	for (std::thread& worker : workers)
+		worker.join();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	const std::uint64_t syncs = (log == NULL ? 0 : log->syncCount() - syncsBefore) + ownSyncs.load();
+	printf("%-10s %8d %12.0f %14.1f %14.3f\n", log == NULL ? "in place" : "wal", threads,
+			commits.load() / elapsed.count(), elapsed.count() * threads / commits.load() * 1e6,
+			static_cast<double>(syncs) / commits.load());
+}
+
+int main()
+{
+	try
+	{
+		File::remove(FILE_NAME);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	std::remove(LOG_NAME);
+
+	{
+		LogManager log(LOG_NAME);
+		File file = File::create(FILE_NAME);
+		BufMgr bufMgr(POOL_FRAMES);
+		std::vector<PageId> pages;
+		for (int i = 0; i < THREAD_COUNTS[2]; i++)
+		{
+			Page page = file.allocatePage();
+			page.insertRecord(std::string(100, 'a'));
+			file.writePage(page);
+			pages.push_back(page.page_number());
+		}
+
+		printf("%-10s %8s %12s %14s %14s\n", "mode", "threads", "commits/s", "latency (us)", "syncs/commit");
+		for (int threads : THREAD_COUNTS)
+			run(&bufMgr, &file, NULL, pages, threads);
+		bufMgr.setLogManager(&log);
+		for (int threads : THREAD_COUNTS)
+			run(&bufMgr, &file, &log, pages, threads);
+		bufMgr.flushFile(&file);
+	}
+
+	File::remove(FILE_NAME);
+	std::remove(LOG_NAME);
+	return 0;
+}
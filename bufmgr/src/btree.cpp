@@ -0,0 +1,728 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "btree.h"
+
+#include <algorithm>
+#include <cstring>
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Metadata stored at the start of the metadata page.
+ */
+struct IndexMeta {
+  std::uint32_t magic;
+  std::uint16_t key_type;
+  std::uint16_t key_size;
+  PageId root;
+  std::uint16_t root_level;
+};
+
+const std::uint32_t INDEX_MAGIC = 0x42547265;
+
+}
+
+const std::size_t BTreeIndex::DEFAULT_STRING_KEY_SIZE;
+const std::size_t BTreeIndex::MAX_STRING_KEY_SIZE;
+const int BTreeIndex::BULK_LOAD_FILL_PERCENT;
+const PageId BTreeIndex::META_PAGE;
+const std::size_t BTreeIndex::RECORD_ID_BYTES;
+const PageId BTreeIndex::LATCH_CHUNK_PAGES;
+const std::size_t BTreeIndex::LATCH_CHUNKS;
+
+BTreeIndex::BTreeIndex(BufMgr* buf_mgr, File* file, const KeyType key_type,
+                       const std::size_t string_key_size)
+    : buf_mgr_(buf_mgr),
+      file_(file),
+      key_type_(key_type),
+      key_size_(key_type == INTEGER_KEY ? sizeof(std::int64_t)
+                                        : string_key_size),
+      entry_size_(key_size_ + RECORD_ID_BYTES),
+      leaf_capacity_((Page::DATA_SIZE - sizeof(NodeHeader)) / entry_size_),
+      inner_capacity_((Page::DATA_SIZE - sizeof(NodeHeader) - sizeof(PageId)) /
+                      (entry_size_ + sizeof(PageId))),
+      root_(Page::INVALID_NUMBER),
+      root_level_(0),
+      latch_chunks_(new std::atomic<RWLatch*>[LATCH_CHUNKS]()) {
+  if (key_size_ == 0 || key_size_ > MAX_STRING_KEY_SIZE) {
+    throw BadIndexInfoException("string key size out of range");
+  }
+  open();
+}
+
+BTreeIndex::~BTreeIndex() {
+  for (std::size_t i = 0; i < LATCH_CHUNKS; ++i) {
+    delete[] latch_chunks_[i].load();
+  }
+}
+
+bool BTreeIndex::insert(const std::int64_t key, const RecordId& record_id) {
+  return insertEntry(makeEntry(encode(key), record_id));
+}
+
+bool BTreeIndex::insert(const std::string& key, const RecordId& record_id) {
+  return insertEntry(makeEntry(encode(key), record_id));
+}
+
+bool BTreeIndex::lookup(const std::int64_t key, RecordId& record_id) {
+  const std::string encoded = encode(key);
+  bool found = false;
+  scanEntries(makeEntry(encoded, {0, 0}), encoded,
+              [this, &record_id, &found](const char* entry) {
+    record_id = recordIdOf(entry);
+    found = true;
+    return false;
+  });
+  return found;
+}
+
+bool BTreeIndex::lookup(const std::string& key, RecordId& record_id) {
+  const std::string encoded = encode(key);
+  bool found = false;
+  scanEntries(makeEntry(encoded, {0, 0}), encoded,
+              [this, &record_id, &found](const char* entry) {
+    record_id = recordIdOf(entry);
+    found = true;
+    return false;
+  });
+  return found;
+}
+
+bool BTreeIndex::erase(const std::int64_t key, const RecordId& record_id) {
+  return eraseEntry(makeEntry(encode(key), record_id));
+}
+
+bool BTreeIndex::erase(const std::string& key, const RecordId& record_id) {
+  return eraseEntry(makeEntry(encode(key), record_id));
+}
+
+std::uint64_t BTreeIndex::scan(const std::int64_t low, const std::int64_t high,
+                               const IntegerVisitor& visit) {
+  const std::string encoded_low = encode(low);
+  const std::string encoded_high = encode(high);
+  if (low > high) {
+    return 0;
+  }
+  return scanEntries(makeEntry(encoded_low, {0, 0}), encoded_high,
+                     [this, &visit](const char* entry) {
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i < sizeof(bits); ++i) {
+      bits = bits << 8 | static_cast<unsigned char>(entry[i]);
+    }
+    return visit(static_cast<std::int64_t>(bits ^ 1ULL << 63),
+                 recordIdOf(entry));
+  });
+}
+
+std::uint64_t BTreeIndex::scan(const std::string& low, const std::string& high,
+                               const StringVisitor& visit) {
+  const std::string encoded_low = encode(low);
+  const std::string encoded_high = encode(high);
+  if (encoded_low > encoded_high) {
+    return 0;
+  }
+  return scanEntries(makeEntry(encoded_low, {0, 0}), encoded_high,
+                     [this, &visit](const char* entry) {
+    std::size_t length = key_size_;
+    while (length > 0 && entry[length - 1] == '\0') {
+      --length;
+    }
+    return visit(std::string(entry, length), recordIdOf(entry));
+  });
+}
+
+void BTreeIndex::bulkLoad(
+    const std::vector<std::pair<std::int64_t, RecordId> >& entries) {
+  encode(std::int64_t());
+  bulkLoad(entries.size(), [this, &entries](std::size_t i) {
+    return makeEntry(encode(entries[i].first), entries[i].second);
+  });
+}
+
+void BTreeIndex::bulkLoad(
+    const std::vector<std::pair<std::string, RecordId> >& entries) {
+  encode(std::string());
+  bulkLoad(entries.size(), [this, &entries](std::size_t i) {
+    return makeEntry(encode(entries[i].first), entries[i].second);
+  });
+}
+
+PageId BTreeIndex::child(Page* page, const int i) const {
+  PageId page_number;
+  std::memcpy(&page_number, data(page) + sizeof(NodeHeader) +
+              i * (entry_size_ + sizeof(PageId)), sizeof(PageId));
+  return page_number;
+}
+
+void BTreeIndex::setChild(Page* page, const int i,
+                          const PageId page_number) const {
+  std::memcpy(data(page) + sizeof(NodeHeader) +
+              i * (entry_size_ + sizeof(PageId)), &page_number, sizeof(PageId));
+}
+
+RWLatch& BTreeIndex::latch(const PageId page_number) {
+  std::atomic<RWLatch*>& chunk = latch_chunks_[page_number / LATCH_CHUNK_PAGES];
+  RWLatch* latches = chunk.load(std::memory_order_acquire);
+  if (latches == NULL) {
+    RWLatch* fresh = new RWLatch[LATCH_CHUNK_PAGES];
+    if (chunk.compare_exchange_strong(latches, fresh,
+                                      std::memory_order_acq_rel)) {
+      latches = fresh;
+    } else {
+      // Another thread installed its chunk first.
+      delete[] fresh;
+    }
+  }
+  return latches[page_number % LATCH_CHUNK_PAGES];
+}
+
+BTreeIndex::Held BTreeIndex::acquire(const PageId page_number,
+                                     const bool exclusive) {
+  Held held = {page_number, NULL, exclusive, false};
+  buf_mgr_->readPage(file_, page_number, held.page);
+  if (exclusive) {
+    latch(page_number).lockExclusive();
+  } else {
+    latch(page_number).lockShared();
+  }
+  return held;
+}
+
+void BTreeIndex::release(const Held& held) {
+  if (held.exclusive) {
+    latch(held.page_number).unlockExclusive();
+  } else {
+    latch(held.page_number).unlockShared();
+  }
+  buf_mgr_->unPinPage(file_, held.page_number, held.dirty);
+}
+
+BTreeIndex::Held BTreeIndex::allocate() {
+  Held held = {Page::INVALID_NUMBER, NULL, true, true};
+  buf_mgr_->allocPage(file_, held.page_number, held.page);
+  latch(held.page_number).lockExclusive();
+  return held;
+}
+
+void BTreeIndex::open() {
+  Page* page;
+  try {
+    buf_mgr_->readPage(file_, META_PAGE, page);
+  } catch (const InvalidPageException&) {
+    PageId page_number;
+    buf_mgr_->allocPage(file_, page_number, page);
+    buf_mgr_->unPinPage(file_, page_number, true);
+    if (page_number != META_PAGE) {
+      throw BadIndexInfoException("file does not hold a B+tree index");
+    }
+    Held root = allocate();
+    NodeHeader* node = header(root.page);
+    node->level = 0;
+    node->count = 0;
+    node->next = Page::INVALID_NUMBER;
+    release(root);
+    root_ = root.page_number;
+    root_level_ = 0;
+    writeMeta();
+    return;
+  }
+
+  IndexMeta meta;
+  std::memcpy(&meta, data(page), sizeof(meta));
+  buf_mgr_->unPinPage(file_, META_PAGE, false);
+  if (meta.magic != INDEX_MAGIC) {
+    throw BadIndexInfoException("file does not hold a B+tree index");
+  }
+  if (meta.key_type != key_type_ || meta.key_size != key_size_) {
+    throw BadIndexInfoException("index was built with other keys");
+  }
+  root_ = meta.root;
+  root_level_ = meta.root_level;
+}
+
+void BTreeIndex::writeMeta() {
+  IndexMeta meta;
+  std::memset(&meta, 0, sizeof(meta));
+  meta.magic = INDEX_MAGIC;
+  meta.key_type = key_type_;
+  meta.key_size = key_size_;
+  meta.root = root_;
+  meta.root_level = root_level_;
+
+  Page* page;
+  buf_mgr_->readPage(file_, META_PAGE, page);
+  std::memcpy(data(page), &meta, sizeof(meta));
+  buf_mgr_->unPinPage(file_, META_PAGE, true);
+}
+
+std::string BTreeIndex::encode(const std::int64_t key) const {
+  if (key_type_ != INTEGER_KEY) {
+    throw BadIndexInfoException("index has string keys");
+  }
+  // Flipping the sign bit orders negative keys before positive ones.
+  const std::uint64_t bits = static_cast<std::uint64_t>(key) ^ 1ULL << 63;
+  std::string encoded(sizeof(bits), '\0');
+  for (std::size_t i = 0; i < sizeof(bits); ++i) {
+    encoded[i] = static_cast<char>(bits >> (8 * (sizeof(bits) - 1 - i)));
+  }
+  return encoded;
+}
+
+std::string BTreeIndex::encode(const std::string& key) const {
+  if (key_type_ != STRING_KEY) {
+    throw BadIndexInfoException("index has integer keys");
+  }
+  if (key.length() > key_size_) {
+    throw BadIndexInfoException("string key longer than the key size");
+  }
+  std::string encoded(key);
+  encoded.resize(key_size_, '\0');
+  return encoded;
+}
+
+std::string BTreeIndex::makeEntry(const std::string& key,
+                                  const RecordId& record_id) const {
+  // Big-endian, so that entries of equal keys are ordered by record id.
+  std::string entry(key);
+  entry.push_back(static_cast<char>(record_id.page_number >> 24));
+  entry.push_back(static_cast<char>(record_id.page_number >> 16));
+  entry.push_back(static_cast<char>(record_id.page_number >> 8));
+  entry.push_back(static_cast<char>(record_id.page_number));
+  entry.push_back(static_cast<char>(record_id.slot_number >> 8));
+  entry.push_back(static_cast<char>(record_id.slot_number));
+  return entry;
+}
+
+RecordId BTreeIndex::recordIdOf(const char* entry) const {
+  const unsigned char* bytes =
+      reinterpret_cast<const unsigned char*>(entry + key_size_);
+  RecordId record_id;
+  record_id.page_number = static_cast<PageId>(bytes[0]) << 24 |
+      static_cast<PageId>(bytes[1]) << 16 |
+      static_cast<PageId>(bytes[2]) << 8 | bytes[3];
+  record_id.slot_number = static_cast<SlotId>(bytes[4] << 8 | bytes[5]);
+  return record_id;
+}
+
+int BTreeIndex::compare(const char* a, const char* b) const {
+  return std::memcmp(a, b, entry_size_);
+}
+
+int BTreeIndex::lowerBound(Page* page, const char* entry) const {
+  int low = 0;
+  int high = header(page)->count;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (compare(leafEntry(page, middle), entry) < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+int BTreeIndex::childIndex(Page* page, const char* entry) const {
+  // Child i holds the entries from key i - 1 up to key i.
+  int low = 0;
+  int high = header(page)->count;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (compare(innerKey(page, middle), entry) <= 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool BTreeIndex::isSafe(Page* page) const {
+  const NodeHeader* node = header(page);
+  return node->count < (node->level == 0 ? leaf_capacity_ : inner_capacity_);
+}
+
+BTreeIndex::Held BTreeIndex::acquireRoot(const bool exclusive_leaf) {
+  // The root latch keeps the root from moving until its node is latched.
+  root_latch_.lockShared();
+  Held root;
+  try {
+    root = acquire(root_, exclusive_leaf && root_level_ == 0);
+  } catch (...) {
+    root_latch_.unlockShared();
+    throw;
+  }
+  root_latch_.unlockShared();
+  return root;
+}
+
+BTreeIndex::Held BTreeIndex::findLeaf(const char* entry, const bool exclusive) {
+  Held node = acquireRoot(exclusive);
+  try {
+    while (header(node.page)->level > 0) {
+      const bool leaf_below = header(node.page)->level == 1;
+      const Held next = acquire(child(node.page, childIndex(node.page, entry)),
+                                exclusive && leaf_below);
+      release(node);
+      node = next;
+    }
+  } catch (...) {
+    release(node);
+    throw;
+  }
+  return node;
+}
+
+bool BTreeIndex::insertEntry(const std::string& entry) {
+  Held leaf = findLeaf(entry.data(), true);
+  const int position = lowerBound(leaf.page, entry.data());
+  if (position < header(leaf.page)->count &&
+      compare(leafEntry(leaf.page, position), entry.data()) == 0) {
+    release(leaf);
+    return false;
+  }
+  if (isSafe(leaf.page)) {
+    insertIntoLeaf(leaf.page, position, entry.data());
+    leaf.dirty = true;
+    release(leaf);
+    return true;
+  }
+  // The leaf has to split, which changes its ancestors too.
+  release(leaf);
+  return insertPessimistic(entry);
+}
+
+bool BTreeIndex::insertPessimistic(const std::string& entry) {
+  std::vector<Held> path;
+  bool root_latched = true;
+  root_latch_.lockExclusive();
+  try {
+    path.push_back(acquire(root_, true));
+    if (isSafe(path.back().page)) {
+      root_latch_.unlockExclusive();
+      root_latched = false;
+    }
+    while (header(path.back().page)->level > 0) {
+      Page* page = path.back().page;
+      const Held next = acquire(child(page, childIndex(page, entry.data())),
+                                true);
+      if (isSafe(next.page)) {
+        // No split can reach above this node.
+        for (const Held& held : path) {
+          release(held);
+        }
+        path.clear();
+        if (root_latched) {
+          root_latch_.unlockExclusive();
+          root_latched = false;
+        }
+      }
+      path.push_back(next);
+    }
+
+    Page* leaf = path.back().page;
+    const int position = lowerBound(leaf, entry.data());
+    bool inserted = false;
+    if (position == header(leaf)->count ||
+        compare(leafEntry(leaf, position), entry.data()) != 0) {
+      std::string key = entry;
+      PageId right_child = Page::INVALID_NUMBER;
+      for (std::size_t i = path.size(); i-- > 0; ) {
+        Held& node = path[i];
+        node.dirty = true;
+        if (isSafe(node.page)) {
+          if (header(node.page)->level == 0) {
+            insertIntoLeaf(node.page, lowerBound(node.page, key.data()),
+                           key.data());
+          } else {
+            insertIntoInner(node.page, childIndex(node.page, key.data()),
+                            key.data(), right_child);
+          }
+          right_child = Page::INVALID_NUMBER;
+          break;
+        }
+        std::string separator;
+        const Held sibling = split(node, key, right_child, separator);
+        release(sibling);
+        key = separator;
+        right_child = sibling.page_number;
+      }
+      if (right_child != Page::INVALID_NUMBER) {
+        growRoot(key, right_child);
+      }
+      inserted = true;
+    }
+
+    for (const Held& held : path) {
+      release(held);
+    }
+    if (root_latched) {
+      root_latch_.unlockExclusive();
+    }
+    return inserted;
+  } catch (...) {
+    for (const Held& held : path) {
+      release(held);
+    }
+    if (root_latched) {
+      root_latch_.unlockExclusive();
+    }
+    throw;
+  }
+}
+
+void BTreeIndex::insertIntoLeaf(Page* page, const int position,
+                                const char* entry) {
+  NodeHeader* node = header(page);
+  char* at = leafEntry(page, position);
+  std::memmove(at + entry_size_, at, (node->count - position) * entry_size_);
+  std::memcpy(at, entry, entry_size_);
+  ++node->count;
+}
+
+void BTreeIndex::insertIntoInner(Page* page, const int position,
+                                 const char* key, const PageId right_child) {
+  // Key i is followed by child i + 1, so both move together.
+  NodeHeader* node = header(page);
+  const std::size_t pair_size = entry_size_ + sizeof(PageId);
+  char* at = innerKey(page, position);
+  std::memmove(at + pair_size, at, (node->count - position) * pair_size);
+  std::memcpy(at, key, entry_size_);
+  std::memcpy(at + entry_size_, &right_child, sizeof(PageId));
+  ++node->count;
+}
+
+BTreeIndex::Held BTreeIndex::split(const Held& node, const std::string& entry,
+                                   const PageId right_child,
+                                   std::string& separator) {
+  NodeHeader* left = header(node.page);
+  Held sibling = allocate();
+  NodeHeader* right = header(sibling.page);
+  right->level = left->level;
+  right->next = Page::INVALID_NUMBER;
+
+  if (left->level == 0) {
+    // Merge the new entry into a copy of the entries and halve it.
+    const int count = left->count + 1;
+    const int position = lowerBound(node.page, entry.data());
+    std::vector<char> entries(count * entry_size_);
+    char* first = leafEntry(node.page, 0);
+    std::memcpy(&entries[0], first, position * entry_size_);
+    std::memcpy(&entries[position * entry_size_], entry.data(), entry_size_);
+    std::memcpy(&entries[(position + 1) * entry_size_],
+                first + position * entry_size_,
+                (count - 1 - position) * entry_size_);
+
+    const int left_count = count / 2;
+    std::memcpy(first, &entries[0], left_count * entry_size_);
+    std::memcpy(leafEntry(sibling.page, 0), &entries[left_count * entry_size_],
+                (count - left_count) * entry_size_);
+    left->count = left_count;
+    right->count = count - left_count;
+    right->next = left->next;
+    left->next = sibling.page_number;
+    separator.assign(leafEntry(sibling.page, 0), entry_size_);
+    return sibling;
+  }
+
+  // Copy child 0 and the (key, child) pairs with the new pair in place; the
+  // middle key moves up to the parent.
+  const std::size_t pair_size = entry_size_ + sizeof(PageId);
+  const int count = left->count + 1;
+  const int position = childIndex(node.page, entry.data());
+  std::vector<char> pairs(sizeof(PageId) + count * pair_size);
+  char* first = data(node.page) + sizeof(NodeHeader);
+  const std::size_t before = sizeof(PageId) + position * pair_size;
+  std::memcpy(&pairs[0], first, before);
+  std::memcpy(&pairs[before], entry.data(), entry_size_);
+  std::memcpy(&pairs[before + entry_size_], &right_child, sizeof(PageId));
+  std::memcpy(&pairs[before + pair_size], first + before,
+              (count - 1 - position) * pair_size);
+
+  const int middle = count / 2;
+  const std::size_t middle_offset = sizeof(PageId) + middle * pair_size;
+  separator.assign(&pairs[middle_offset], entry_size_);
+  std::memcpy(first, &pairs[0], middle_offset);
+  std::memcpy(data(sibling.page) + sizeof(NodeHeader),
+              &pairs[middle_offset + entry_size_],
+              sizeof(PageId) + (count - 1 - middle) * pair_size);
+  left->count = middle;
+  right->count = count - 1 - middle;
+  return sibling;
+}
+
+void BTreeIndex::growRoot(const std::string& separator,
+                          const PageId right_child) {
+  Held root = allocate();
+  NodeHeader* node = header(root.page);
+  node->level = root_level_ + 1;
+  node->count = 0;
+  node->next = Page::INVALID_NUMBER;
+  setChild(root.page, 0, root_);
+  insertIntoInner(root.page, 0, separator.data(), right_child);
+  release(root);
+
+  root_ = root.page_number;
+  root_level_ = node->level;
+  writeMeta();
+}
+
+bool BTreeIndex::eraseEntry(const std::string& entry) {
+  Held leaf = findLeaf(entry.data(), true);
+  NodeHeader* node = header(leaf.page);
+  const int position = lowerBound(leaf.page, entry.data());
+  const bool found = position < node->count &&
+      compare(leafEntry(leaf.page, position), entry.data()) == 0;
+  if (found) {
+    char* at = leafEntry(leaf.page, position);
+    std::memmove(at, at + entry_size_,
+                 (node->count - position - 1) * entry_size_);
+    --node->count;
+    leaf.dirty = true;
+  }
+  release(leaf);
+  return found;
+}
+
+std::uint64_t BTreeIndex::scanEntries(
+    const std::string& low, const std::string& high,
+    const std::function<bool(const char*)>& visit) {
+  std::uint64_t visited = 0;
+  std::string from = low;
+  bool after_from = false;
+  std::vector<char> batch;
+  Held leaf = findLeaf(low.data(), false);
+  for (;;) {
+    // Copy the entries of the leaf in range, so that the visitor runs with no
+    // latch held.
+    const NodeHeader* node = header(leaf.page);
+    int position = lowerBound(leaf.page, from.data());
+    if (after_from && position < node->count &&
+        compare(leafEntry(leaf.page, position), from.data()) == 0) {
+      ++position;
+    }
+    bool done = node->next == Page::INVALID_NUMBER;
+    batch.clear();
+    for (; position < node->count; ++position) {
+      const char* entry = leafEntry(leaf.page, position);
+      if (std::memcmp(entry, high.data(), key_size_) > 0) {
+        done = true;
+        break;
+      }
+      batch.insert(batch.end(), entry, entry + entry_size_);
+    }
+    const PageId next = node->next;
+    release(leaf);
+
+    for (std::size_t offset = 0; offset < batch.size(); offset += entry_size_) {
+      ++visited;
+      if (!visit(&batch[offset])) {
+        return visited;
+      }
+    }
+    if (done) {
+      return visited;
+    }
+    if (!batch.empty()) {
+      // The next leaf may have split since; skip what was visited already.
+      from.assign(&batch[batch.size() - entry_size_], entry_size_);
+      after_from = true;
+    }
+    leaf = acquire(next, false);
+  }
+}
+
+void BTreeIndex::bulkLoad(
+    const std::size_t count,
+    const std::function<std::string(std::size_t)>& entry) {
+  std::string previous;
+  for (std::size_t i = 0; i < count; ++i) {
+    const std::string current = entry(i);
+    if (i > 0 && compare(previous.data(), current.data()) >= 0) {
+      throw BadIndexInfoException("bulk load entries are not sorted");
+    }
+    previous = current;
+  }
+
+  Held leaf = acquire(root_, true);
+  if (header(leaf.page)->level != 0 || header(leaf.page)->count != 0) {
+    release(leaf);
+    throw BadIndexInfoException("bulk load into an index that is not empty");
+  }
+  if (count == 0) {
+    release(leaf);
+    return;
+  }
+
+  const int leaf_fill =
+      std::max(1, leaf_capacity_ * BULK_LOAD_FILL_PERCENT / 100);
+  std::vector<std::pair<std::string, PageId> > nodes;
+  try {
+    for (std::size_t i = 0; i < count; ++i) {
+      const std::string current = entry(i);
+      NodeHeader* node = header(leaf.page);
+      if (i == 0) {
+        nodes.push_back(std::make_pair(current, leaf.page_number));
+      } else if (node->count == leaf_fill) {
+        Held next = allocate();
+        NodeHeader* next_node = header(next.page);
+        next_node->level = 0;
+        next_node->count = 0;
+        next_node->next = Page::INVALID_NUMBER;
+        node->next = next.page_number;
+        release(leaf);
+        leaf = next;
+        nodes.push_back(std::make_pair(current, leaf.page_number));
+      }
+      insertIntoLeaf(leaf.page, header(leaf.page)->count, current.data());
+      leaf.dirty = true;
+    }
+  } catch (...) {
+    release(leaf);
+    throw;
+  }
+  release(leaf);
+
+  int level = 0;
+  while (nodes.size() > 1) {
+    nodes = buildLevel(nodes, ++level);
+  }
+  root_ = nodes[0].second;
+  root_level_ = level;
+  writeMeta();
+}
+
+std::vector<std::pair<std::string, PageId> > BTreeIndex::buildLevel(
+    const std::vector<std::pair<std::string, PageId> >& nodes,
+    const int level) {
+  const std::size_t fanout =
+      std::max(2, inner_capacity_ * BULK_LOAD_FILL_PERCENT / 100 + 1);
+  std::vector<std::pair<std::string, PageId> > parents;
+  for (std::size_t first = 0; first < nodes.size(); first += fanout) {
+    const std::size_t last = std::min(first + fanout, nodes.size());
+    Held parent = allocate();
+    NodeHeader* node = header(parent.page);
+    node->level = level;
+    node->count = 0;
+    node->next = Page::INVALID_NUMBER;
+    setChild(parent.page, 0, nodes[first].second);
+    for (std::size_t i = first + 1; i < last; ++i) {
+      insertIntoInner(parent.page, node->count, nodes[i].first.data(),
+                      nodes[i].second);
+    }
+    parents.push_back(std::make_pair(nodes[first].first, parent.page_number));
+    release(parent);
+  }
+  return parents;
+}
+
+}
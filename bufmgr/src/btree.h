@@ -0,0 +1,559 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "buffer.h"
+#include "file.h"
+#include "latch.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief B+tree index mapping integer or string keys to record ids.
+ *
+ * The nodes of the tree are pages of a file, read and written through the
+ * given buffer manager.  Page 1 of the file holds the index metadata: the
+ * key type and size and the number of the root page.
+ *
+ * Keys are stored with a fixed size: integer keys take 8 bytes, string keys
+ * the size given when the index is created, padded with NUL bytes, so
+ * trailing NUL bytes of a string key are not significant.  Both are encoded
+ * so that comparing their bytes orders them like the keys.  A key may map to
+ * several record ids: the entries of the tree are (key, record id) pairs,
+ * ordered by key and then by record id, so duplicate keys need no special
+ * handling.
+ *
+ * Any number of threads may use an index at the same time.  Each node has a
+ * shared/exclusive latch, and operations descend with latch coupling: the
+ * latch of a child is taken before the latch of its parent is released.
+ * Lookups take shared latches only.  Scans copy the matching entries of one
+ * leaf at a time and visit them without holding any latch, then continue at
+ * the right sibling of the leaf; since nodes only ever split to the right,
+ * the sibling chain still leads to all later entries.  Inserts first descend
+ * with shared latches and latch the leaf exclusively; only if the leaf is
+ * full do they descend again, holding exclusive latches on the nodes that
+ * may split.
+ *
+ * Erasing an entry removes it from its leaf but never merges nodes, so
+ * leaves may stay sparse or empty after many erases; bulkLoad() into a new
+ * index rebuilds a compact tree.
+ */
+class BTreeIndex {
+ public:
+  /**
+   * Type of the keys of an index.
+   */
+  enum KeyType {
+    INTEGER_KEY = 1,
+    STRING_KEY = 2
+  };
+
+  /**
+   * Visits an entry of an integer index during a scan; returns false to stop
+   * the scan.
+   */
+  typedef std::function<bool(std::int64_t, const RecordId&)> IntegerVisitor;
+
+  /**
+   * Visits an entry of a string index during a scan; returns false to stop
+   * the scan.
+   */
+  typedef std::function<bool(const std::string&, const RecordId&)>
+      StringVisitor;
+
+  /**
+   * Size of string keys if none is given.
+   */
+  static const std::size_t DEFAULT_STRING_KEY_SIZE = 32;
+
+  /**
+   * Largest size of string keys.
+   */
+  static const std::size_t MAX_STRING_KEY_SIZE = 255;
+
+  /**
+   * Percentage of each node filled by bulkLoad().  The rest is left free so
+   * that inserts after the load do not split every node they reach.
+   */
+  static const int BULK_LOAD_FILL_PERCENT = 90;
+
+  /**
+   * Opens the index stored in the given file, or creates an empty index if
+   * the file has no pages.
+   *
+   * @param buf_mgr         Buffer manager to read and write nodes through.
+   * @param file            File holding the index.
+   * @param key_type        Type of the keys.
+   * @param string_key_size Size of string keys in bytes; ignored for integer
+   *                        keys.
+   * @throws  BadIndexInfoException If the file holds something else than an
+   *                                index with these keys.
+   */
+  BTreeIndex(BufMgr* buf_mgr, File* file, const KeyType key_type,
+             const std::size_t string_key_size = DEFAULT_STRING_KEY_SIZE);
+
+  /**
+   * Releases the latches of the nodes.  The nodes themselves stay in the
+   * buffer pool until it writes them back.
+   */
+  ~BTreeIndex();
+
+  /**
+   * Inserts an entry.
+   *
+   * @param key       Key of the entry.
+   * @param record_id Record id the key maps to.
+   * @return  False if the index already held this key and record id.
+   * @throws  BadIndexInfoException If the index does not have integer keys.
+   */
+  bool insert(const std::int64_t key, const RecordId& record_id);
+
+  /**
+   * Inserts an entry.
+   *
+   * @param key       Key of the entry.
+   * @param record_id Record id the key maps to.
+   * @return  False if the index already held this key and record id.
+   * @throws  BadIndexInfoException If the index does not have string keys, or
+   *                                the key is longer than the key size.
+   */
+  bool insert(const std::string& key, const RecordId& record_id);
+
+  /**
+   * Finds the entry with the smallest record id among those with the given
+   * key.
+   *
+   * @param key       Key to look up.
+   * @param record_id The record id is returned via this reference.
+   * @return  False if there is no entry with this key.
+   * @throws  BadIndexInfoException If the index does not have integer keys.
+   */
+  bool lookup(const std::int64_t key, RecordId& record_id);
+
+  /**
+   * Finds the entry with the smallest record id among those with the given
+   * key.
+   *
+   * @param key       Key to look up.
+   * @param record_id The record id is returned via this reference.
+   * @return  False if there is no entry with this key.
+   * @throws  BadIndexInfoException If the index does not have string keys, or
+   *                                the key is longer than the key size.
+   */
+  bool lookup(const std::string& key, RecordId& record_id);
+
+  /**
+   * Erases an entry.
+   *
+   * @param key       Key of the entry.
+   * @param record_id Record id of the entry.
+   * @return  False if there was no such entry.
+   * @throws  BadIndexInfoException If the index does not have integer keys.
+   */
+  bool erase(const std::int64_t key, const RecordId& record_id);
+
+  /**
+   * Erases an entry.
+   *
+   * @param key       Key of the entry.
+   * @param record_id Record id of the entry.
+   * @return  False if there was no such entry.
+   * @throws  BadIndexInfoException If the index does not have string keys, or
+   *                                the key is longer than the key size.
+   */
+  bool erase(const std::string& key, const RecordId& record_id);
+
+  /**
+   * Visits the entries with keys in [low, high] in order.
+   *
+   * @param low   Smallest key to visit.
+   * @param high  Largest key to visit.
+   * @param visit Called for each entry until it returns false.
+   * @return  Number of entries visited.
+   * @throws  BadIndexInfoException If the index does not have integer keys.
+   */
+  std::uint64_t scan(const std::int64_t low, const std::int64_t high,
+                     const IntegerVisitor& visit);
+
+  /**
+   * Visits the entries with keys in [low, high] in order.
+   *
+   * @param low   Smallest key to visit.
+   * @param high  Largest key to visit.
+   * @param visit Called for each entry until it returns false.
+   * @return  Number of entries visited.
+   * @throws  BadIndexInfoException If the index does not have string keys, or
+   *                                a key is longer than the key size.
+   */
+  std::uint64_t scan(const std::string& low, const std::string& high,
+                     const StringVisitor& visit);
+
+  /**
+   * Builds the tree bottom-up from entries sorted by key and record id,
+   * which is much faster than inserting them one by one.  The index must be
+   * empty, and no other thread may use it during the load.
+   *
+   * @param entries Entries to load, in order.
+   * @throws  BadIndexInfoException If the index does not have integer keys,
+   *                                is not empty, or the entries are not
+   *                                sorted.
+   */
+  void bulkLoad(const std::vector<std::pair<std::int64_t, RecordId> >& entries);
+
+  /**
+   * Builds the tree bottom-up from entries sorted by key and record id,
+   * which is much faster than inserting them one by one.  The index must be
+   * empty, and no other thread may use it during the load.
+   *
+   * @param entries Entries to load, in order.
+   * @throws  BadIndexInfoException If the index does not have string keys,
+   *                                is not empty, the entries are not sorted,
+   *                                or a key is longer than the key size.
+   */
+  void bulkLoad(const std::vector<std::pair<std::string, RecordId> >& entries);
+
+  /**
+   * Returns the type of the keys.
+   */
+  KeyType keyType() const { return key_type_; }
+
+  /**
+   * Returns the size of the stored keys in bytes.
+   */
+  std::size_t keySize() const { return key_size_; }
+
+  /**
+   * Returns the number of levels of the tree; 1 while the root is a leaf.
+   */
+  int height() const { return root_level_.load() + 1; }
+
+ private:
+  BTreeIndex(const BTreeIndex&);
+  BTreeIndex& operator=(const BTreeIndex&);
+
+  /**
+   * A node page pinned in the buffer pool and latched.
+   */
+  struct Held {
+    PageId page_number;
+    Page* page;
+    bool exclusive;
+    bool dirty;
+  };
+
+  /**
+   * Header at the start of the data of each node.
+   */
+  struct NodeHeader {
+    /**
+     * Level of the node; leaves are at level 0.
+     */
+    std::uint16_t level;
+
+    /**
+     * Number of entries of a leaf, or of keys of an inner node.
+     */
+    std::uint16_t count;
+
+    /**
+     * Right sibling of a leaf, or Page::INVALID_NUMBER.
+     */
+    PageId next;
+  };
+
+  /**
+   * Number of the page holding the index metadata.
+   */
+  static const PageId META_PAGE = 1;
+
+  /**
+   * Bytes of a record id at the end of each entry.
+   */
+  static const std::size_t RECORD_ID_BYTES = sizeof(PageId) + sizeof(SlotId);
+
+  /**
+   * Node latches are allocated in chunks of this many pages.
+   */
+  static const PageId LATCH_CHUNK_PAGES = 65536;
+
+  /**
+   * Number of latch chunks that cover all page numbers.
+   */
+  static const std::size_t LATCH_CHUNKS =
+      (static_cast<std::uint64_t>(1) << 32) / LATCH_CHUNK_PAGES;
+
+  /**
+   * Returns the data bytes of a node page.
+   */
+  static char* data(Page* page) { return page->data(); }
+
+  /**
+   * Returns the header of a node page.
+   */
+  static NodeHeader* header(Page* page) {
+    return reinterpret_cast<NodeHeader*>(data(page));
+  }
+
+  /**
+   * Returns the i-th entry of a leaf.
+   */
+  char* leafEntry(Page* page, const int i) const {
+    return data(page) + sizeof(NodeHeader) + i * entry_size_;
+  }
+
+  /**
+   * Returns the i-th key of an inner node; it is followed by the number of
+   * the child holding the entries from this key up to the next key.
+   */
+  char* innerKey(Page* page, const int i) const {
+    return data(page) + sizeof(NodeHeader) + sizeof(PageId) +
+        i * (entry_size_ + sizeof(PageId));
+  }
+
+  /**
+   * Returns the number of the i-th child of an inner node; child 0 holds the
+   * entries smaller than key 0.
+   */
+  PageId child(Page* page, const int i) const;
+
+  /**
+   * Sets the number of the i-th child of an inner node.
+   */
+  void setChild(Page* page, const int i, const PageId page_number) const;
+
+  /**
+   * Returns the latch of a node.
+   */
+  RWLatch& latch(const PageId page_number);
+
+  /**
+   * Pins and latches a node.
+   */
+  Held acquire(const PageId page_number, const bool exclusive);
+
+  /**
+   * Unlatches and unpins a node.
+   */
+  void release(const Held& held);
+
+  /**
+   * Allocates a page for a new node and latches it exclusively.
+   */
+  Held allocate();
+
+  /**
+   * Reads the metadata page, or creates it and an empty root if the file has
+   * no pages.
+   */
+  void open();
+
+  /**
+   * Writes the root and its level to the metadata page.
+   */
+  void writeMeta();
+
+  /**
+   * Encodes an integer key, checking the key type.
+   */
+  std::string encode(const std::int64_t key) const;
+
+  /**
+   * Encodes a string key, checking the key type and size.
+   */
+  std::string encode(const std::string& key) const;
+
+  /**
+   * Returns the entry made of an encoded key and a record id.
+   */
+  std::string makeEntry(const std::string& key, const RecordId& record_id) const;
+
+  /**
+   * Returns the record id of an entry.
+   */
+  RecordId recordIdOf(const char* entry) const;
+
+  /**
+   * Compares two entries like memcmp.
+   */
+  int compare(const char* a, const char* b) const;
+
+  /**
+   * Returns the position of the first entry of a leaf not smaller than the
+   * given one.
+   */
+  int lowerBound(Page* page, const char* entry) const;
+
+  /**
+   * Returns the position of the child of an inner node to descend to for the
+   * given entry.
+   */
+  int childIndex(Page* page, const char* entry) const;
+
+  /**
+   * Returns true if an insert into the node cannot split it.
+   */
+  bool isSafe(Page* page) const;
+
+  /**
+   * Latches the root, shared if the root is an inner node and in the given
+   * mode if it is a leaf.
+   */
+  Held acquireRoot(const bool exclusive_leaf);
+
+  /**
+   * Descends with shared latch coupling to the leaf that would hold the given
+   * entry, and returns it latched in the given mode.
+   */
+  Held findLeaf(const char* entry, const bool exclusive);
+
+  /**
+   * Inserts an entry; returns false if it was already present.
+   */
+  bool insertEntry(const std::string& entry);
+
+  /**
+   * Inserts an entry holding exclusive latches on the nodes that may split.
+   */
+  bool insertPessimistic(const std::string& entry);
+
+  /**
+   * Inserts an entry into a leaf that has room for it.
+   */
+  void insertIntoLeaf(Page* page, const int position, const char* entry);
+
+  /**
+   * Inserts a key and the child to its right into an inner node that has
+   * room for them.
+   */
+  void insertIntoInner(Page* page, const int position, const char* key,
+                       const PageId right_child);
+
+  /**
+   * Splits a full node while inserting into it.  Returns the new right
+   * sibling, pinned, and the first key of its subtree via <separator>.
+   *
+   * @param node        Node to split.
+   * @param entry       Entry (leaf) or key (inner node) to insert.
+   * @param right_child Child to the right of <entry> in an inner node.
+   * @param separator   Key to insert into the parent is returned via this
+   *                    reference.
+   */
+  Held split(const Held& node, const std::string& entry,
+             const PageId right_child, std::string& separator);
+
+  /**
+   * Makes a new root above the current one and the given new sibling of it.
+   */
+  void growRoot(const std::string& separator, const PageId right_child);
+
+  /**
+   * Erases an entry; returns false if it was not present.
+   */
+  bool eraseEntry(const std::string& entry);
+
+  /**
+   * Visits the entries from the given one on while their keys are at most
+   * <high>.
+   *
+   * @param low   Entry to start at.
+   * @param high  Largest encoded key to visit.
+   * @param visit Called for each entry until it returns false.
+   * @return  Number of entries visited.
+   */
+  std::uint64_t scanEntries(const std::string& low, const std::string& high,
+                            const std::function<bool(const char*)>& visit);
+
+  /**
+   * Builds the tree from encoded entries in order.
+   *
+   * @param count Number of entries.
+   * @param entry Returns the i-th entry.
+   */
+  void bulkLoad(const std::size_t count,
+                const std::function<std::string(std::size_t)>& entry);
+
+  /**
+   * Builds the inner levels above a level of nodes during a bulk load.
+   *
+   * @param nodes First key and page of each node of the level below.
+   * @param level Level of the nodes to build.
+   * @return  First key and page of each new node.
+   */
+  std::vector<std::pair<std::string, PageId> > buildLevel(
+      const std::vector<std::pair<std::string, PageId> >& nodes,
+      const int level);
+
+  /**
+   * Buffer manager the nodes are read through.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * File holding the index.
+   */
+  File* file_;
+
+  /**
+   * Type of the keys.
+   */
+  KeyType key_type_;
+
+  /**
+   * Size of the encoded keys in bytes.
+   */
+  std::size_t key_size_;
+
+  /**
+   * Size of an entry: encoded key and record id.
+   */
+  std::size_t entry_size_;
+
+  /**
+   * Most entries a leaf holds.
+   */
+  int leaf_capacity_;
+
+  /**
+   * Most keys an inner node holds.
+   */
+  int inner_capacity_;
+
+  /**
+   * Protects root_ and root_level_.  Held shared while latching the root,
+   * and exclusively by inserts that may split the root.
+   */
+  RWLatch root_latch_;
+
+  /**
+   * Number of the root page.
+   */
+  std::atomic<PageId> root_;
+
+  /**
+   * Level of the root.
+   */
+  std::atomic<int> root_level_;
+
+  /**
+   * Chunks of node latches, indexed by page number / LATCH_CHUNK_PAGES and
+   * allocated when first needed.
+   */
+  std::unique_ptr<std::atomic<RWLatch*>[]> latch_chunks_;
+};
+
+}
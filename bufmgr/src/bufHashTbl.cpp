@@ -15,100 +15,115 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+const FrameId BufHashTbl::END;
+
+int BufHashTbl::hash(const FileId file, const PageId pageNo) const
+{
+  // file ids are small and dense, so spread them out before adding the page
+  // number; unsigned arithmetic keeps the value in range
+  std::uint64_t tmp = static_cast<std::uint64_t>(file) * 0x9e3779b1ULL;
+  return static_cast<int>((tmp + pageNo) % static_cast<std::uint64_t>(HTSIZE));
+}
+
+std::uint64_t BufHashTbl::key(const FileId file, const PageId pageNo)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
-  return value;
+  return (static_cast<std::uint64_t>(file) << 32) | pageNo;
 }
 
-BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+BufHashTbl::BufHashTbl(const int htSize, const FrameId numFrames)
+	: HTSIZE(htSize), frames(numFrames)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
+  // allocate the chain heads and one node per frame
+  ht = new std::atomic<FrameId> [htSize];
   for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+    ht[i].store(END, std::memory_order_relaxed);
+  nodes = new hashBucket [numFrames];
+  for(FrameId i = 0; i < frames; i++) {
+    nodes[i].key.store(key(FileRegistry::INVALID_ID, Page::INVALID_NUMBER), std::memory_order_relaxed);
+    nodes[i].next.store(END, std::memory_order_relaxed);
+  }
 }
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
-    }
-  }
+  delete [] nodes;
   delete [] ht;
 }
 
-void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+void BufHashTbl::insert(const FileId file, const PageId pageNo, const FrameId frameNo)
 {
   int index = hash(file, pageNo);
+  const std::uint64_t k = key(file, pageNo);
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+  for (FrameId tmpBuc = ht[index].load(std::memory_order_relaxed); tmpBuc != END;
+       tmpBuc = nodes[tmpBuc].next.load(std::memory_order_relaxed)) {
+    if (nodes[tmpBuc].key.load(std::memory_order_relaxed) == k)
+  		throw HashAlreadyPresentException(FileRegistry::filename(file), pageNo, tmpBuc);
   }
 
-  tmpBuc = new hashBucket;
-  if (!tmpBuc)
+  if (frameNo >= frames)
   	throw HashTableException();
 
-  tmpBuc->file = (File*) file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+  // the node is complete before the head publishes it
+  nodes[frameNo].key.store(k, std::memory_order_relaxed);
+  nodes[frameNo].next.store(ht[index].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  ht[index].store(frameNo, std::memory_order_release);
 }
 
-void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo)
+void BufHashTbl::lookup(const FileId file, const PageId pageNo, FrameId &frameNo)
+{
+  if (!find(file, pageNo, frameNo))
+    throw HashNotFoundException(FileRegistry::filename(file), pageNo);
+}
+
+bool BufHashTbl::find(const FileId file, const PageId pageNo, FrameId &frameNo) const
 {
   int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+  const std::uint64_t k = key(file, pageNo);
+
+  // a probe racing with remove() and insert() may be led from one chain into
+  // another, so it gives up after as many steps as there are nodes
+  FrameId tmpBuc = ht[index].load(std::memory_order_acquire);
+  for (FrameId steps = 0; tmpBuc != END && steps < frames; steps++) {
+    if (nodes[tmpBuc].key.load(std::memory_order_acquire) == k)
     {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
+      frameNo = tmpBuc; // return frameNo by reference
+      return true;
     }
-    tmpBuc = tmpBuc->next;
+    tmpBuc = nodes[tmpBuc].next.load(std::memory_order_acquire);
   }
-
-  throw HashNotFoundException(file->filename(), pageNo);
+  return false;
 }
 
-void BufHashTbl::remove(const File* file, const PageId pageNo) {
+void BufHashTbl::remove(const FileId file, const PageId pageNo) {
 
   int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
+  const std::uint64_t k = key(file, pageNo);
+  FrameId tmpBuc = ht[index].load(std::memory_order_relaxed);
+  FrameId prevBuc = END;
 
-  while (tmpBuc)
+  while (tmpBuc != END)
 	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+    const FrameId next = nodes[tmpBuc].next.load(std::memory_order_relaxed);
+    if (nodes[tmpBuc].key.load(std::memory_order_relaxed) == k)
 		{
-      if(prevBuc)
-				prevBuc->next = tmpBuc->next;
+      // the node keeps its link, so a probe standing on it goes on along the chain
+      if(prevBuc != END)
+				nodes[prevBuc].next.store(next, std::memory_order_release);
       else
-				ht[index] = tmpBuc->next;
+				ht[index].store(next, std::memory_order_release);
 
-      delete tmpBuc;
+      nodes[tmpBuc].key.store(key(FileRegistry::INVALID_ID, Page::INVALID_NUMBER), std::memory_order_release);
       return;
     }
 		else
 		{
       prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+      tmpBuc = next;
     }
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  throw HashNotFoundException(FileRegistry::filename(file), pageNo);
 }
 
 }
@@ -7,40 +7,39 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include "file.h"
 
 namespace badgerdb {
 
 /**
 * @brief Declarations for buffer pool hash table
+*
+* A frame holds at most one page, so every frame has one node, kept at its frame number; nodes are never
+* freed while the table exists.
 */
 struct hashBucket {
 	/**
-	 * pointer a file object (more on this below)
-	 */
-	File *file;
-
-	/**
-	 * page number within a file
+	 * id of the open file the page belongs to in the high half, page number within the file in the low half
 	 */
-	PageId pageNo;
+	std::atomic<std::uint64_t> key;
 
 	/**
-	 * frame number of page in the buffer pool
+	 * Frame of the next node in the hash table, or BufHashTbl::END
 	 */
-	FrameId frameNo;
-
-	/**
-	 * Next node in the hash table
-	 */
-	hashBucket*   next;
+	std::atomic<FrameId> next;
 };
 
 
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
-* @warning This class is not threadsafe.
+* insert() and remove() must not run concurrently with each other, while find() may run concurrently with
+* both: the chains are linked through atomic frame numbers and a removed node keeps its link, so a probe
+* that stands on it still reaches the end of the chain.  Such a probe may miss an entry, when the node it
+* stands on moves to another chain, or return a frame whose page has just been removed; the caller checks
+* the result.
 */
 class BufHashTbl
 {
@@ -49,25 +48,52 @@ class BufHashTbl
 	 *	Size of Hash Table
 	 */
   int HTSIZE;
+
 	/**
-	 * Actual Hash table object
+	 * Number of nodes, one per frame
 	 */
-  hashBucket**  ht;
+  FrameId frames;
+
+	/**
+	 * Actual Hash table object: frame of the first node of every chain, or END
+	 */
+  std::atomic<FrameId>*  ht;
+
+	/**
+	 * Nodes, indexed by frame number
+	 */
+  hashBucket* nodes;
 
 	/**
 	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
 	 *
-	 * @param file   	File object
+	 * @param file   	File id
 	 * @param pageNo  Page number in the file
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  int	 hash(const FileId file, const PageId pageNo) const;
+
+	/**
+	 * returns the key of a node holding the given page
+	 *
+	 * @param file   	File id
+	 * @param pageNo  Page number in the file
+	 */
+  static std::uint64_t key(const FileId file, const PageId pageNo);
 
  public:
+	/**
+   * Frame number that ends a chain
+	 */
+  static const FrameId END = 0xffffffff;
+
 	/**
    * Constructor of BufHashTbl class
+	 *
+	 * @param htSize	Number of chains
+	 * @param numFrames	Number of frames that may be inserted, numbered from 0
 	 */
-	BufHashTbl(const int htSize);  // constructor
+	BufHashTbl(const int htSize, const FrameId numFrames);  // constructor
 
 	/**
    * Destructor of BufHashTbl class
@@ -77,33 +103,45 @@ class BufHashTbl
 	/**
    * Insert entry into hash table mapping (file, pageNo) to frameNo.
 	 *
-	 * @param file   	File object
+	 * @param file   	File id
 	 * @param pageNo 	Page number in the file
-	 * @param frameNo Frame number assigned to that page of the file
+	 * @param frameNo Frame number assigned to that page of the file, which must not be in the table
    * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as running of memory
+   * @throws  HashTableException if the frame number is out of range
 	 */
-  void insert(const File* file, const PageId pageNo, const FrameId frameNo);
+  void insert(const FileId file, const PageId pageNo, const FrameId frameNo);
 
 	/**
    * Check if (file, pageNo) is currently in the buffer pool (ie. in
    * the hash table).
 	 *
-	 * @param file  	File object
+	 * @param file  	File id
 	 * @param pageNo	Page number in the file
 	 * @param frameNo Frame number reference
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
-  void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
+  void lookup(const FileId file, const PageId pageNo, FrameId &frameNo);
+
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool, without throwing on a miss.  The buffer manager
+   * uses this on its hot paths, where a miss is normal.  While insert() or remove() run concurrently, the
+   * entry may be missed, or the frame returned may no longer hold the page.
+	 *
+	 * @param file  	File id
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference
+	 * @return  			False if the page entry is not found in the hash table
+	 */
+  bool find(const FileId file, const PageId pageNo, FrameId &frameNo) const;
 
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
-	 * @param file   	File object
+	 * @param file   	File id
 	 * @param pageNo  Page number in the file
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
-  void remove(const File* file, const PageId pageNo);  
+  void remove(const FileId file, const PageId pageNo);  
 };
 
 }
@@ -23,11 +23,19 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <cstdlib>
 #include <memory>
+#include <new>
+#include <thread>
+#include <vector>
 #include <iostream>
 #include "buffer.h"
+#include "log_manager.h"
+#include "page_guard.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
+#include "exceptions/page_checksum_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
@@ -37,38 +45,111 @@
 
 namespace badgerdb {
 
+const FrameId BufDesc::NO_FRAME;
+const std::uint32_t BufMgr::CLEAN_BATCH;
+
 BufMgr::BufMgr(std::uint32_t bufs)
 	: numBufs(bufs) {
-    bufDescTable = new BufDesc[bufs]; // allocating heap mem. for bufDescTable
+    // allocating heap mem. for bufDescTable, aligned to cache lines
+    void* descMem = NULL;
+    if(posix_memalign(&descMem, CACHE_LINE_SIZE, sizeof(BufDesc) * bufs) != 0) {
+        throw std::bad_alloc();
+    }
+    bufDescTable = static_cast<BufDesc*>(descMem);
 
     // initialize necessary frames number
     for (FrameId i = 0; i < bufs; i++)
     {
+        new (&bufDescTable[i]) BufDesc();
         bufDescTable[i].frameNo = i;
-        bufDescTable[i].valid = false;
     }
 
     bufPool = new Page[bufs]; // allocating spaces for page
 
     // determining the value for hashtable
     int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-    hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+    hashTable = new BufHashTbl (htsize, bufs);  // allocate the buffer hash table
     clockHand = bufs - 1; // point the the last element
+
+    // every frame starts out free, pushed backwards so that they are
+    // handed out in order
+    freeFrames = new FreeFrameList(bufs);
+    for (FrameId i = bufs; i > 0; i--)
+    {
+        freeFrames->push(i - 1);
+    }
+
+    // the clock sweep scans these bitmaps instead of the descriptors
+    bitmapWords = (bufs + 63) / 64;
+    validBits = new std::atomic<std::uint64_t>[bitmapWords];
+    refBits = new std::atomic<std::uint64_t>[bitmapWords];
+    pinnedBits = new std::atomic<std::uint64_t>[bitmapWords];
+    for (std::uint32_t i = 0; i < bitmapWords; i++)
+    {
+        validBits[i].store(0, std::memory_order_relaxed);
+        refBits[i].store(0, std::memory_order_relaxed);
+        pinnedBits[i].store(0, std::memory_order_relaxed);
+    }
+
+    // the admission filter is off until setAdmissionFilter() is called
+    admissionSketch = NULL;
+    admissionWindow = NULL;
+
+    // evicted pages are dropped until setVictimCache() is called
+    victimCache.reset();
+
+    // pages are written back without forcing a log until setLogManager() is called
+    logManager = NULL;
+
+    // File::readPage() verifies checksums until setLazyChecksums() is called
+    lazyChecksums = false;
+
+    // the pages of a closed file go before its id is handed to another file
+    releaseHook = FileRegistry::addReleaseHook([this](const FileId id) {
+        return dropFile(id);
+    });
 }
 
 
 BufMgr::~BufMgr() {
-    // loop thru every frame and check
-    // flush if the frame is valid and dirty
-    for(FrameId i = 0; i < numBufs; i++) {
-        if(bufDescTable[i].valid == true && bufDescTable[i].dirty == true) {
-            flushFile(bufDescTable[i].file);
+    FileRegistry::removeReleaseHook(releaseHook);
+
+    // write back the dirty pages in one pass over the files that have
+    // resident pages, each file in page order.  as in dropFile(), a write
+    // that fails is not reported: a destructor must not throw, and the other
+    // pages are still written
+    std::vector<FrameId> dirtyFrames;
+    for(FileId id = 0; id < fileFrames.size(); id++) {
+        dirtyFrames.clear();
+        for(FrameId i = fileFrames[id]; i != BufDesc::NO_FRAME; i = bufDescTable[i].nextInFile) {
+            if(bufDescTable[i].dirty()) {
+                dirtyFrames.push_back(i);
+            }
+        }
+        std::sort(dirtyFrames.begin(), dirtyFrames.end(), [this](FrameId a, FrameId b) {
+            return bufDescTable[a].pageNo < bufDescTable[b].pageNo;
+        });
+        for(std::size_t j = 0; j < dirtyFrames.size(); j++) {
+            try {
+                writeBack(dirtyFrames[j]);
+            }
+            catch(...) {
+            }
         }
     }
 
     // deallocating all dynamically allocated memory
-    delete[] bufDescTable;
+    delete admissionSketch;
+    delete admissionWindow;
+    for(FrameId i = 0; i < numBufs; i++) {
+        bufDescTable[i].~BufDesc();
+    }
+    free(bufDescTable);
+    delete[] validBits;
+    delete[] refBits;
+    delete[] pinnedBits;
     delete hashTable;
+    delete freeFrames;
     delete[] bufPool;
 }
 
@@ -78,49 +159,638 @@ void BufMgr::advanceClock()
     clockHand = (clockHand + 1) % numBufs;
 }
 
-void BufMgr::allocBuf(FrameId & frame)
+bool BufMgr::allocBuf(FrameId & frame, BufferAccessStrategy* strategy, Lsn & logLsn)
 {
-    unsigned int counter = 0; // counter to check if all pages are pinned
+    // a caller with an access strategy first recycles a frame of its own ring
+    if(strategy != NULL && getStrategyBuf(strategy, frame, logLsn)) {
+        return true;
+    }
+    if(logLsn != 0) {
+        return false;
+    }
+
+    // a free frame is taken without running the clock, which would clear
+    // the reference bits of the pages it passes on the way
+    // if all pages are pinned, throw BufferExceededException
+    if(!freeFrames->pop(frame)) {
+        if(!findVictim(frame)) {
+            throw BufferExceededException();
+        }
+        // a hit may have pinned the victim since the clock looked at it, the
+        // clock then passes it on the next try
+        if(!bufDescTable[frame].tryFreeze(0)) {
+            return false;
+        }
+        // the clock stays on the victim, so it is found again once the log
+        // was flushed
+        if(!logFlushed(frame, logLsn)) {
+            bufDescTable[frame].clearFlags(BufDesc::IO_IN_PROGRESS);
+            return false;
+        }
+        evictBuf(frame);
+    }
 
-    // implementing clock algorithm
-    do {
-        // check if the frame is valid, if so, proceed down the clock algo.
-        if(bufDescTable[clockHand].valid == true) {
-            // reset the refbit if the frame has been referenced recently
-            // and advance clock
-            if(bufDescTable[clockHand].refbit == true) {
-                bufDescTable[clockHand].refbit = false;
-                advanceClock();
+    // the frame joins the ring of the strategy, either filling a new slot
+    // or replacing the ring frame that could not be recycled. a frame the
+    // ring already holds, e.g. one that was flushed and came back through
+    // the free list, trades slots with that frame instead of taking a
+    // second one
+    if(strategy != NULL) {
+        std::unordered_map<FrameId, std::uint32_t>::iterator it = strategy->positions_.find(frame);
+        if(it != strategy->positions_.end()) {
+            if(it->second != strategy->current_) {
+                const FrameId replaced = strategy->ring_[strategy->current_];
+                strategy->ring_[it->second] = replaced;
+                strategy->positions_[replaced] = it->second;
+                strategy->ring_[strategy->current_] = frame;
+                it->second = strategy->current_;
             }
-            // increase counter for # of pinned pages
-            else if(bufDescTable[clockHand].pinCnt != 0) {
-                counter++;
-                advanceClock();
+        }
+        else if(strategy->ring_.size() < strategyRingSize(strategy)) {
+            strategy->current_ = strategy->ring_.size();
+            strategy->ring_.push_back(frame);
+            strategy->positions_[frame] = strategy->current_;
+        }
+        else {
+            strategy->positions_.erase(strategy->ring_[strategy->current_]);
+            strategy->ring_[strategy->current_] = frame;
+            strategy->positions_[frame] = strategy->current_;
+        }
+    }
+    return true;
+}
+
+bool BufMgr::logFlushed(const FrameId frame, Lsn & logLsn) const
+{
+    // write-ahead rule: a dirty page is only written once the log records
+    // of its updates are durable
+    if(logManager == NULL || !bufDescTable[frame].dirty()) {
+        return true;
+    }
+    const Lsn lsn = bufPool[frame].lsn();
+    if(lsn < logManager->flushedLsn()) {
+        return true;
+    }
+    logLsn = lsn;
+    return false;
+}
+
+bool BufMgr::findVictim(FrameId & frame)
+{
+    // implementing clock algorithm over the frame bitmaps, 64 frames per
+    // word: a frame can be allocated if it is free, or if it is neither
+    // referenced nor pinned. the clock stops on the victim so that it is
+    // found again right away if the caller does not take it
+    // the work is counted locally and added to the statistics once
+    std::uint64_t words = 0;
+    std::uint64_t cleared = 0;
+    bool found = false;
+    for(int attempt = 0; attempt < 2 && !found; attempt++) {
+        // two full rounds clear every reference bit on the way, so an
+        // unpinned frame must have turned up by then
+        std::uint64_t scanned = 0;
+        while(scanned < 2 * (std::uint64_t) numBufs) {
+            const std::uint32_t word = clockHand / 64;
+            const std::uint32_t end = (word + 1) * 64 < numBufs ? (word + 1) * 64 : numBufs;
+            words++;
+
+            // frames from the clock hand to the end of the word or the pool
+            std::uint64_t range = ~0ULL << (clockHand % 64);
+            if(end % 64 != 0) {
+                range &= ~0ULL >> (64 - end % 64);
             }
-            // if a frame is not pinned and dirty, flush it first before allocating it
-            else if(bufDescTable[clockHand].pinCnt == 0 && bufDescTable[clockHand].dirty == true) {
-                flushFile(bufDescTable[clockHand].file);
-                frame = clockHand;
-                return;
+
+            const std::uint64_t valid = validBits[word].load(std::memory_order_relaxed);
+            const std::uint64_t ref = refBits[word].load(std::memory_order_relaxed);
+            const std::uint64_t pinned = pinnedBits[word].load(std::memory_order_relaxed);
+            std::uint64_t candidates = (~valid | (~ref & ~pinned)) & range;
+
+            while(candidates != 0) {
+                const unsigned int bit = __builtin_ctzll(candidates);
+                const FrameId candidate = word * 64 + bit;
+                const std::uint64_t mask = 1ULL << bit;
+
+                // the pinned bitmap is only a hint, the state word decides
+                if((valid & mask) == 0 || bufDescTable[candidate].pinCnt() == 0) {
+                    // the frames the clock passed lose their reference bit
+                    const std::uint64_t passed = range & (mask - 1);
+                    cleared += __builtin_popcountll(refBits[word].fetch_and(~passed, std::memory_order_relaxed) & passed);
+                    clockHand = candidate;
+                    frame = candidate;
+                    found = true;
+                    break;
+                }
+                pinnedBits[word].fetch_or(mask, std::memory_order_relaxed);
+                candidates &= candidates - 1;
             }
-            // if it is not pinned and not dirty, allocate it straight away
-            else if(bufDescTable[clockHand].pinCnt == 0 && bufDescTable[clockHand].dirty == false) {
-                hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-                frame = clockHand;
-                return;
+            if(found) {
+                break;
             }
+
+            // nothing to take in this word, the clock passes all of it
+            cleared += __builtin_popcountll(refBits[word].fetch_and(~range, std::memory_order_relaxed) & range);
+            scanned += end - clockHand;
+            clockHand = end % numBufs;
         }
-        // if frame not valid, can allocate it straight away
-        else if(bufDescTable[clockHand].valid == false)
-        {
-            frame = clockHand;
-            return;
+
+        // a pin may have raced with an unpin and left a stale pinned bit
+        // behind, rebuild the bitmap from the state words and look again
+        if(!found) {
+            resyncPinnedBits();
         }
-    } while(counter <= numBufs);
+    }
+    bufStats.victimSearches++;
+    bufStats.clockWords += words;
+    bufStats.refBitsCleared += cleared;
+    return found;
+}
 
-    // if all pages are pinned, throw BufferExceededException
-    throw BufferExceededException();
+void BufMgr::resyncPinnedBits()
+{
+    for(std::uint32_t word = 0; word < bitmapWords; word++) {
+        std::uint64_t pinned = 0;
+        for(FrameId i = word * 64; i < numBufs && i < (word + 1) * 64; i++) {
+            if(bufDescTable[i].pinCnt() != 0) {
+                pinned |= 1ULL << (i % 64);
+            }
+        }
+        pinnedBits[word].store(pinned, std::memory_order_relaxed);
+    }
+}
+
+void BufMgr::pinFrame(const FrameId frame, const bool touch)
+{
+    const Lsn pinLsn = logManager != NULL ? logManager->nextLsn() : 0;
+    notePin(frame, bufDescTable[frame].pin(), pinLsn, touch);
+}
+
+void BufMgr::notePin(const FrameId frame, const std::uint32_t previous, const Lsn pinLsn, const bool touch)
+{
+    // only the first pin of a frame touches the pinned bitmap, and the
+    // reference bit is read before it is written so that hits on a hot
+    // frame do not keep writing its cache line
+    const std::uint64_t mask = 1ULL << (frame % 64);
+    if(previous == 0) {
+        bufDescTable[frame].pinLsn.store(pinLsn, std::memory_order_relaxed);
+        pinnedBits[frame / 64].fetch_or(mask, std::memory_order_relaxed);
+    }
+    if(touch && !isReferenced(frame)) {
+        refBits[frame / 64].fetch_or(mask, std::memory_order_relaxed);
+    }
+}
+
+bool BufMgr::unpinFrame(const FrameId frame, const bool dirty)
+{
+    const std::uint32_t previous = bufDescTable[frame].unpin(dirty);
+    if(previous == 1) {
+        pinnedBits[frame / 64].fetch_and(~(1ULL << (frame % 64)), std::memory_order_relaxed);
+    }
+    return previous != 0;
+}
+
+void BufMgr::setFrame(const FrameId frame, File* file, const PageId pageNo, const bool referenced)
+{
+    const std::uint64_t mask = 1ULL << (frame % 64);
+    bufDescTable[frame].pinLsn.store(logManager != NULL ? logManager->nextLsn() : 0, std::memory_order_relaxed);
+    bufDescTable[frame].Set(file, pageNo);
+    linkFrame(frame);
+    validBits[frame / 64].fetch_or(mask, std::memory_order_relaxed);
+    pinnedBits[frame / 64].fetch_or(mask, std::memory_order_relaxed);
+    if(referenced) {
+        refBits[frame / 64].fetch_or(mask, std::memory_order_relaxed);
+    }
+    else {
+        refBits[frame / 64].fetch_and(~mask, std::memory_order_relaxed);
+    }
+}
+
+void BufMgr::clearFrame(const FrameId frame)
+{
+    const std::uint64_t mask = ~(1ULL << (frame % 64));
+    if(bufDescTable[frame].valid()) {
+        unlinkFrame(frame);
+    }
+    bufDescTable[frame].Clear();
+    validBits[frame / 64].fetch_and(mask, std::memory_order_relaxed);
+    pinnedBits[frame / 64].fetch_and(mask, std::memory_order_relaxed);
+    refBits[frame / 64].fetch_and(mask, std::memory_order_relaxed);
+}
+
+void BufMgr::linkFrame(const FrameId frame)
+{
+    BufDesc& desc = bufDescTable[frame];
+    if(desc.fileId >= fileFrames.size()) {
+        fileFrames.resize(desc.fileId + 1, BufDesc::NO_FRAME);
+    }
+    desc.prevInFile = BufDesc::NO_FRAME;
+    desc.nextInFile = fileFrames[desc.fileId];
+    if(desc.nextInFile != BufDesc::NO_FRAME) {
+        bufDescTable[desc.nextInFile].prevInFile = frame;
+    }
+    fileFrames[desc.fileId] = frame;
+}
+
+void BufMgr::unlinkFrame(const FrameId frame)
+{
+    BufDesc& desc = bufDescTable[frame];
+    if(desc.nextInFile != BufDesc::NO_FRAME) {
+        bufDescTable[desc.nextInFile].prevInFile = desc.prevInFile;
+    }
+    if(desc.prevInFile != BufDesc::NO_FRAME) {
+        bufDescTable[desc.prevInFile].nextInFile = desc.nextInFile;
+    }
+    // the first frame of the list is the head of the file
+    else {
+        fileFrames[desc.fileId] = desc.nextInFile;
+    }
+}
+
+bool BufMgr::isReferenced(const FrameId frame) const
+{
+    return (refBits[frame / 64].load(std::memory_order_relaxed) & (1ULL << (frame % 64))) != 0;
+}
+
+bool BufMgr::getStrategyBuf(BufferAccessStrategy* strategy, FrameId & frame, Lsn & logLsn)
+{
+    // the ring is still growing, the next frame comes from the clock
+    if(strategy->ring_.size() < strategyRingSize(strategy)) {
+        return false;
+    }
+
+    strategy->current_ = (strategy->current_ + 1) % strategy->ring_.size();
+    FrameId candidate = strategy->ring_[strategy->current_];
+
+    // leave the frame alone if it is in use, or if it was referenced through
+    // the clock since the ring loaded it; it then belongs to the working set.
+    // a frame that was flushed or disposed is on the free list and is taken
+    // from there instead
+    if(!bufDescTable[candidate].valid() || isReferenced(candidate) || !bufDescTable[candidate].tryFreeze(0)) {
+        return false;
+    }
+
+    // the ring steps back, so that the frame is recycled once the log was
+    // flushed
+    if(!logFlushed(candidate, logLsn)) {
+        bufDescTable[candidate].clearFlags(BufDesc::IO_IN_PROGRESS);
+        strategy->current_ = (strategy->current_ + strategy->ring_.size() - 1) % strategy->ring_.size();
+        return false;
+    }
+    releaseBuf(candidate);
+    frame = candidate;
+    return true;
+}
+
+std::uint32_t BufMgr::strategyRingSize(const BufferAccessStrategy* strategy) const
+{
+    // never let a single ring take more than an eighth of the buffer pool
+    std::uint32_t limit = numBufs / 8 > 0 ? numBufs / 8 : 1;
+    return strategy->ring_size_ < limit ? strategy->ring_size_ : limit;
+}
+
+bool BufMgr::getWindowBuf(FrameId & frame, Lsn & logLsn)
+{
+    BufferAccessStrategy* window = admissionWindow;
+    // the window is still growing, it takes a frame like any other ring
+    if(window->ring_.size() < strategyRingSize(window)) {
+        return false;
+    }
+
+    // a frame whose page cannot be written before the log is flushed is
+    // passed over; the log is only flushed if no other frame is left
+    // the victim is frozen while the window is searched, so that its page
+    // stays unchanged until it is compared or evicted
+    FrameId victim;
+    Lsn victimLsn = 0;
+    bool haveVictim = findVictim(victim) && bufDescTable[victim].valid() && bufDescTable[victim].tryFreeze(0);
+    if(haveVictim && !logFlushed(victim, victimLsn)) {
+        bufDescTable[victim].clearFlags(BufDesc::IO_IN_PROGRESS);
+        haveVictim = false;
+    }
+    Lsn candidateLsn = 0;
+    for(std::uint32_t i = 0; i < window->ring_.size(); i++) {
+        window->current_ = (window->current_ + 1) % window->ring_.size();
+        const FrameId candidate = window->ring_[window->current_];
+        if(haveVictim && candidate == victim) {
+            releaseBuf(candidate);
+            frame = candidate;
+            return true;
+        }
+        if(!bufDescTable[candidate].valid() || bufDescTable[candidate].pinCnt() != 0) {
+            continue;
+        }
+
+        // a window page referenced again since it was read only leaves the
+        // window for the main pool if it has been seen more often than the
+        // clock's victim. the victim's frame then takes over its slot
+        if(isReferenced(candidate) && haveVictim) {
+            const std::uint64_t key = pageKey(bufDescTable[candidate].fileId, bufDescTable[candidate].pageNo);
+            const std::uint64_t victimKey = pageKey(bufDescTable[victim].fileId, bufDescTable[victim].pageNo);
+            if(admissionSketch->frequency(key) > admissionSketch->frequency(victimKey)) {
+                std::unordered_map<FrameId, std::uint32_t>::iterator it = window->positions_.find(victim);
+                if(it == window->positions_.end()) {
+                    evictBuf(victim);
+                    window->positions_.erase(candidate);
+                    window->ring_[window->current_] = victim;
+                    window->positions_[victim] = window->current_;
+                    frame = victim;
+                    return true;
+                }
+            }
+        }
+
+        Lsn lsn = 0;
+        if(!bufDescTable[candidate].tryFreeze(0)) {
+            continue;
+        }
+        if(!logFlushed(candidate, lsn)) {
+            bufDescTable[candidate].clearFlags(BufDesc::IO_IN_PROGRESS);
+            candidateLsn = std::max(candidateLsn, lsn);
+            continue;
+        }
+        if(haveVictim) {
+            bufDescTable[victim].clearFlags(BufDesc::IO_IN_PROGRESS);
+        }
+        releaseBuf(candidate);
+        frame = candidate;
+        return true;
+    }
+    if(haveVictim) {
+        bufDescTable[victim].clearFlags(BufDesc::IO_IN_PROGRESS);
+    }
+    logLsn = candidateLsn;
+    return false;
+}
+
+bool BufMgr::admitPage(File* file, const PageId pageNo)
+{
+    // the access itself was already recorded in the sketch by readPage()
+    const std::uint64_t key = pageKey(file->id(), pageNo);
+
+    // nothing to decide if a free frame is available, or if no frame can be
+    // allocated at all
+    FrameId victim;
+    if(!freeFrames->empty() || !findVictim(victim) || !bufDescTable[victim].valid()) {
+        return true;
+    }
+
+    // the new page only takes the victim's frame if it has been seen more
+    // often recently than the page it would push out
+    const std::uint64_t victimKey = pageKey(bufDescTable[victim].fileId, bufDescTable[victim].pageNo);
+    if(admissionSketch->frequency(key) > admissionSketch->frequency(victimKey)) {
+        bufStats.admitted++;
+        return true;
+    }
+    bufStats.rejected++;
+    return false;
+}
+
+std::uint64_t BufMgr::pageKey(const FileId file, const PageId pageNo)
+{
+    return static_cast<std::uint64_t>(file) ^ (static_cast<std::uint64_t>(pageNo) << 32);
+}
+
+void BufMgr::setAdmissionFilter(const bool enable)
+{
+    ExclusiveLatchGuard exclusive(mapLatch);
+    delete admissionSketch;
+    delete admissionWindow;
+    admissionSketch = NULL;
+    admissionWindow = NULL;
+
+    if(enable) {
+        // the probationary window gets 1% of the pool
+        admissionSketch = new FrequencySketch(numBufs);
+        admissionWindow = new BufferAccessStrategy(BufferAccessStrategy::BULKREAD,
+                numBufs / 100 > 0 ? numBufs / 100 : 1);
+    }
+}
+
+void BufMgr::setLazyChecksums(const bool enable)
+{
+    ExclusiveLatchGuard exclusive(mapLatch);
+    lazyChecksums = enable;
+}
+
+void BufMgr::setVictimCache(const std::size_t bytes)
+{
+    ExclusiveLatchGuard exclusive(mapLatch);
+    victimCache.reset(bytes > 0 ? new VictimCache(bytes) : NULL);
+}
 
+void BufMgr::evictBuf(const FrameId frame)
+{
+    // the victim leaves the pool but stays in memory, compressed; a page
+    // whose checksum was not verified yet is not kept. the page is copied
+    // under the latch and compressed after it; the reservation makes sure a
+    // copy compressed late never replaces a newer one
+    const bool keep = victimCache != NULL && bufDescTable[frame].valid() && !bufDescTable[frame].unverified();
+    const FileId fileId = bufDescTable[frame].fileId;
+    const PageId pageNo = bufDescTable[frame].pageNo;
+    releaseBuf(frame);
+    if(keep) {
+        pendingVictims.push_back(PendingVictim());
+        PendingVictim& victim = pendingVictims.back();
+        victim.cache = victimCache;
+        victim.ticket = victimCache->reserve(fileId, pageNo);
+        victim.fileId = fileId;
+        victim.pageNo = pageNo;
+        victim.page = bufPool[frame];
+    }
+}
+
+void BufMgr::putVictims(std::vector<PendingVictim>& victims)
+{
+    for(std::size_t i = 0; i < victims.size(); i++) {
+        const std::size_t stored = victims[i].cache->fill(victims[i].ticket, victims[i].fileId,
+                victims[i].pageNo, victims[i].page);
+        bufStats.victimBytes += Page::SIZE;
+        bufStats.victimCompressedBytes += stored;
+    }
+    victims.clear();
+}
+
+void BufMgr::releaseBuf(const FrameId frame)
+{
+    // write back the page if it was modified and drop it from the hashtable;
+    // if the write fails the frame is thawed, or hits on it would wait forever
+    if(bufDescTable[frame].valid()) {
+        if(bufDescTable[frame].dirty()) {
+            try {
+                writeBack(frame);
+            }
+            catch(...) {
+                bufDescTable[frame].clearFlags(BufDesc::IO_IN_PROGRESS);
+                throw;
+            }
+        }
+        hashTable->remove(bufDescTable[frame].fileId, bufDescTable[frame].pageNo);
+    }
+    clearFrame(frame);
+}
+
+void BufMgr::writeBack(const FrameId frame)
+{
+    // write-ahead rule: the log records of the page's updates reach disk first
+    if(logManager != NULL) {
+        logManager->flush(bufPool[frame].lsn());
+    }
+    bufDescTable[frame].file->writePage(bufPool[frame]);
+    bufStats.diskwrites++;
+}
+
+void BufMgr::setLogManager(LogManager* log)
+{
+    ExclusiveLatchGuard exclusive(mapLatch);
+    logManager = log;
+}
+
+void BufMgr::dirtyPageTable(std::vector<LogManager::DirtyPage>& pages)
+{
+    // frames keep their page while the latch is held.  a pinned frame may
+    // hold updates logged before the caller's start LSN that only mark it
+    // dirty when it is unpinned, so it counts as dirty since its first pin;
+    // a frame pinned after the walk passed it can only be updated later
+    SharedLatchGuard shared(mapLatch);
+    for(FrameId i = 0; i < numBufs; i++) {
+        const BufDesc& desc = bufDescTable[i];
+        // frames taken by reserveFrames() look valid and pinned, but hold no page
+        if(!desc.valid() || desc.file == NULL || (!desc.dirty() && desc.pinCnt() == 0)) {
+            continue;
+        }
+        LogManager::DirtyPage page;
+        page.filename = desc.file->filename();
+        page.page_number = desc.pageNo;
+        page.rec_lsn = desc.dirty() ? desc.recLsn.load(std::memory_order_relaxed)
+                                    : desc.pinLsn.load(std::memory_order_relaxed);
+        pages.push_back(page);
+    }
+}
+
+std::uint32_t BufMgr::cleanPages(const std::function<void(std::uint32_t)>& pace)
+{
+    std::vector<File*> synced;
+    const std::uint32_t written = cleanFrames(NULL, pace, synced);
+    for(std::size_t i = 0; i < synced.size(); i++) {
+        synced[i]->sync();
+    }
+    return written;
+}
+
+std::uint32_t BufMgr::cleanFile(const File* file)
+{
+    std::vector<File*> files;
+    return cleanFrames(file, [](std::uint32_t) {}, files);
+}
+
+std::uint32_t BufMgr::cleanFrames(const File* file, const std::function<void(std::uint32_t)>& pace,
+                                  std::vector<File*>& synced)
+{
+    // the dirty frames, keyed by file and page number for sorting
+    std::vector<std::pair<std::uint64_t, FrameId> > dirty;
+    {
+        SharedLatchGuard shared(mapLatch);
+        for(FrameId i = 0; i < numBufs; i++) {
+            if(bufDescTable[i].valid() && bufDescTable[i].dirty()
+                    && (file == NULL || bufDescTable[i].fileId == file->id())) {
+                const std::uint64_t key = (static_cast<std::uint64_t>(bufDescTable[i].fileId) << 32) | bufDescTable[i].pageNo;
+                dirty.push_back(std::make_pair(key, i));
+            }
+        }
+    }
+    std::sort(dirty.begin(), dirty.end());
+
+    std::uint32_t written = 0;
+    std::vector<std::pair<std::uint64_t, FrameId> > pinned;
+    std::vector<FrameId> frames;
+    std::vector<Page> copies;
+    std::vector<File*> files;
+    for(int pass = 0; pass < 2; pass++) {
+        for(std::size_t i = 0; i < dirty.size(); i += CLEAN_BATCH) {
+            pace(written);
+            frames.clear();
+            copies.clear();
+            files.clear();
+            {
+                // a frame frozen while unpinned is not in the middle of an update, and nobody pins it
+                // until it is thawed; pinning it keeps it from being evicted before its copy is
+                // written, and a guard that writes it after the copy dirties it again
+                ExclusiveLatchGuard exclusive(mapLatch);
+                for(std::size_t j = i; j < dirty.size() && j < i + CLEAN_BATCH; j++) {
+                    const FrameId frame = dirty[j].second;
+                    BufDesc& desc = bufDescTable[frame];
+                    const std::uint64_t key = (static_cast<std::uint64_t>(desc.fileId) << 32) | desc.pageNo;
+                    if(!desc.valid() || !desc.dirty() || key != dirty[j].first) {
+                        continue;
+                    }
+                    // no pins are added while the frame is frozen, and a guard counts its pin after pinning,
+                    // so if the guard pins read after the pin count match it, no raw Page pointer is out
+                    const std::uint32_t pins = desc.pinCnt();
+                    if(!desc.tryFreeze(pins)) {
+                        pinned.push_back(dirty[j]);
+                        continue;
+                    }
+                    bool latched = false;
+                    if(pins > 0) {
+                        if(pins != desc.guardPins.load(std::memory_order_acquire) || !desc.latch.tryLockShared()) {
+                            desc.clearFlags(BufDesc::IO_IN_PROGRESS);
+                            pinned.push_back(dirty[j]);
+                            continue;
+                        }
+                        latched = true;
+                    }
+                    copies.push_back(bufPool[frame]);
+                    if(latched) {
+                        desc.latch.unlockShared();
+                    }
+                    files.push_back(desc.file);
+                    frames.push_back(frame);
+                    desc.clearFlags(BufDesc::DIRTY);
+                    pinFrame(frame, false);
+                    desc.clearFlags(BufDesc::IO_IN_PROGRESS);
+                }
+            }
+            writeCopies(frames, copies, files);
+            written += frames.size();
+            for(std::size_t j = 0; j < files.size(); j++) {
+                if(std::find(synced.begin(), synced.end(), files[j]) == synced.end()) {
+                    synced.push_back(files[j]);
+                }
+            }
+        }
+        dirty.swap(pinned);
+        pinned.clear();
+    }
+    return written;
+}
+
+void BufMgr::writeCopies(const std::vector<FrameId>& frames, const std::vector<Page>& copies,
+                         const std::vector<File*>& files)
+{
+    std::size_t done = 0;
+    try {
+        for(; done < frames.size(); done++) {
+            if(logManager != NULL) {
+                logManager->flush(copies[done].lsn());
+            }
+            files[done]->writePage(copies[done]);
+            bufStats.diskwrites++;
+        }
+    }
+    catch(...) {
+        // the pages not written are dirty still
+        SharedLatchGuard shared(mapLatch);
+        for(std::size_t i = 0; i < frames.size(); i++) {
+            if(i >= done) {
+                bufDescTable[frames[i]].setFlags(BufDesc::DIRTY);
+            }
+            unpinFrame(frames[i], false);
+        }
+        throw;
+    }
+    SharedLatchGuard shared(mapLatch);
+    for(std::size_t i = 0; i < frames.size(); i++) {
+        unpinFrame(frames[i], false);
+    }
 }
 
 /**
@@ -131,31 +801,283 @@ void BufMgr::allocBuf(FrameId & frame)
  * @param file   	File object
  * @param PageNo  Page number in the file to be read
  * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+ * @param strategy	Access strategy of the caller, or NULL
  */
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+void BufMgr::readPage(File* file, const PageId pageNo, Page*& page, BufferAccessStrategy* strategy)
 {
     FrameId frameNumber;    // used to get frameNumber
-    try
-    {
-        // get frameNumber and set the refbit, and then increase pinCount
-        // also, return the ptr to the page
-        hashTable->lookup(file, pageNo, frameNumber);
-        bufDescTable[frameNumber].refbit = true;
-        bufDescTable[frameNumber].pinCnt++;
-        page = &bufPool[frameNumber];
+    bufStats.accesses++;
+    if(admissionSketch != NULL) {
+        admissionSketch->increment(pageKey(file->id(), pageNo));
     }
-    catch(HashNotFoundException e)
-    {
-        // if the page is not yet existed in the hashtable, allocate it and
-        // set the bufDescTable
-        // also, return the ptr to the page and its pageNo
-        FrameId frameFree;
-        allocBuf(frameFree);
-        bufPool[frameFree] = file->readPage(pageNo);
-        hashTable->insert(file, pageNo, frameFree);
-        bufDescTable[frameFree].Set(file, pageNo);
-        page = &bufPool[frameFree];
+
+    // a hit takes no latch
+    // a scan through a strategy does not count as a reference
+    if(!pinResident(file->id(), pageNo, frameNumber, strategy == NULL)) {
+        readMiss(file, pageNo, strategy, frameNumber);
+    }
+    page = &bufPool[frameNumber];
+
+    // a page read with lazy checksums is verified by its first reader, outside the mapping latch
+    if(bufDescTable[frameNumber].unverified()) {
+        verifyFrame(frameNumber);
+    }
+}
+
+bool BufMgr::pinResident(const FileId fileId, const PageId pageNo, FrameId& frame, const bool touch)
+{
+    // the frame found may be given to another page until it is pinned, so
+    // its page is checked once more after the pin
+    const Lsn pinLsn = logManager != NULL ? logManager->nextLsn() : 0;
+    std::uint32_t previous;
+    if(!hashTable->find(fileId, pageNo, frame) || !bufDescTable[frame].pinValid(previous)) {
+        return false;
+    }
+    if(bufDescTable[frame].fileId != fileId || bufDescTable[frame].pageNo != pageNo) {
+        unpinFrame(frame, false);
+        return false;
+    }
+    notePin(frame, previous, pinLsn, touch);
+    return true;
+}
+
+void BufMgr::readMiss(File* file, const PageId pageNo, BufferAccessStrategy* strategy, FrameId& frameNumber)
+{
+    // a frame whose page cannot be written back before the log is flushed
+    // is left alone; the log is flushed without the mapping latch and the
+    // miss starts over
+    Lsn logLsn = 0;
+    LogManager* log = NULL;
+    std::vector<PendingVictim> victims;
+    for(;;) {
+        putVictims(victims);
+        if(log != NULL) {
+            log->flush(logLsn);
+            logLsn = 0;
+        }
+        bool claimed = false;
+        bool cached = false;
+        bool verify = false;
+        {
+            ExclusiveLatchGuard exclusive(mapLatch);
+            log = logManager;
+            // another thread may have read the page, or be reading it, since the probe
+            if(!hashTable->find(file->id(), pageNo, frameNumber)) {
+                claimed = claimFrame(file, pageNo, strategy, frameNumber, logLsn);
+                victims.swap(pendingVictims);
+                if(!claimed) {
+                    continue;
+                }
+
+                // a page evicted earlier may still be in the victim cache, verified
+                cached = victimCache != NULL && victimCache->take(file->id(), pageNo, bufPool[frameNumber]);
+                if(cached) {
+                    bufStats.victimHits++;
+                }
+                else if(victimCache != NULL) {
+                    bufStats.victimMisses++;
+                }
+                verify = !lazyChecksums;
+            }
+        }
+        // the victim the frame was taken from is compressed outside the latch too
+        putVictims(victims);
+        // the reader is waited for outside the latch
+        if(!claimed) {
+            if(pinResident(file->id(), pageNo, frameNumber, strategy == NULL)) {
+                return;
+            }
+            continue;
+        }
+
+        // the page is read without the latch; other readers of it wait for
+        // the frame's I/O to finish, readers of other pages go on
+        if(!cached) {
+            try
+            {
+                bufPool[frameNumber] = verify ? file->readPage(pageNo) : file->readPageUnverified(pageNo);
+            }
+            catch(...)
+            {
+                ExclusiveLatchGuard exclusive(mapLatch);
+                hashTable->remove(file->id(), pageNo);
+                clearFrame(frameNumber);
+                freeFrames->push(frameNumber);
+                throw;
+            }
+            bufStats.diskreads++;
+            if(!verify) {
+                bufDescTable[frameNumber].setFlags(BufDesc::UNVERIFIED);
+            }
+        }
+        bufDescTable[frameNumber].clearFlags(BufDesc::IO_IN_PROGRESS);
+        return;
+    }
+}
+
+bool BufMgr::claimFrame(File* file, const PageId pageNo, BufferAccessStrategy* strategy, FrameId& frame,
+                        Lsn& logLsn)
+{
+    // with the admission filter on, a page that is less popular than
+    // the clock's victim is read into a frame of the probationary window
+    // and leaves the victim alone. only while the window fills up, or if
+    // all of its frames are pinned, does it take a frame from the clock
+    BufferAccessStrategy* frameStrategy = strategy;
+    bool allocated;
+    if(strategy == NULL && admissionWindow != NULL && !admitPage(file, pageNo)) {
+        frameStrategy = admissionWindow;
+        allocated = getWindowBuf(frame, logLsn)
+                || (logLsn == 0 && allocBuf(frame, frameStrategy, logLsn));
+    }
+    else {
+        allocated = allocBuf(frame, frameStrategy, logLsn);
+    }
+    if(!allocated) {
+        return false;
+    }
+
+    // the frame is pinned with I/O in progress before it can be found
+    hashTable->insert(file->id(), pageNo, frame);
+    setFrame(frame, file, pageNo, frameStrategy == NULL);
+    return true;
+}
+
+void BufMgr::verifyFrame(const FrameId frame)
+{
+    // one reader verifies; a reader that found the page verified may change it right away, so
+    // the others must not look at it before then
+    BufDesc& desc = bufDescTable[frame];
+    for(int spins = 0; ; spins++) {
+        std::uint64_t old = desc.state.load(std::memory_order_acquire);
+        if((old & (BufDesc::UNVERIFIED | BufDesc::VERIFYING)) == 0) {
+            return;
+        }
+        if((old & BufDesc::UNVERIFIED) != 0) {
+            if(desc.state.compare_exchange_weak(old, (old & ~BufDesc::UNVERIFIED) | BufDesc::VERIFYING,
+                        std::memory_order_acq_rel)) {
+                break;
+            }
+        }
+        else if(spins > 64) {
+            std::this_thread::yield();
+        }
+    }
+
+    if(bufPool[frame].checksumValid()) {
+        desc.clearFlags(BufDesc::VERIFYING);
+        return;
+    }
+    // the page stays unverified, so every reader of it fails the same way
+    const PageId pageNo = desc.pageNo;
+    const FileId fileId = desc.fileId;
+    desc.state.fetch_xor(BufDesc::UNVERIFIED | BufDesc::VERIFYING, std::memory_order_acq_rel);
+    unpinFrame(frame, false);
+    throw PageChecksumException(pageNo, FileRegistry::filename(fileId));
+}
+
+ReadPageGuard BufMgr::readPageShared(File* file, const PageId pageNo, BufferAccessStrategy* strategy)
+{
+    Page* page;
+    readPage(file, pageNo, page, strategy);
+    const FrameId frame = page - bufPool;
+    latchFrame(frame, false);
+    return ReadPageGuard(this, frame, page);
+}
+
+WritePageGuard BufMgr::readPageExclusive(File* file, const PageId pageNo, BufferAccessStrategy* strategy)
+{
+    Page* page;
+    readPage(file, pageNo, page, strategy);
+    const FrameId frame = page - bufPool;
+    latchFrame(frame, true);
+    return WritePageGuard(this, frame, page);
+}
+
+void BufMgr::latchFrame(const FrameId frame, const bool exclusive)
+{
+    // the guard pin is counted before the latch is waited for, so that cleanPages() tells it from a
+    // raw pin; the pin keeps the frame from being reassigned meanwhile
+    bufDescTable[frame].guardPins.fetch_add(1, std::memory_order_acq_rel);
+    if(exclusive) {
+        bufDescTable[frame].latch.lockExclusive();
+        bufDescTable[frame].beginWrite();
+    }
+    else {
+        bufDescTable[frame].latch.lockShared();
+    }
+}
+
+void BufMgr::releaseGuard(const FrameId frame, const bool exclusive)
+{
+    // the guard pin is uncounted before the pin is dropped, never the other way round
+    if(exclusive) {
+        bufDescTable[frame].endWrite();
+        bufDescTable[frame].latch.unlockExclusive();
+    }
+    else {
+        bufDescTable[frame].latch.unlockShared();
+    }
+    bufDescTable[frame].guardPins.fetch_sub(1, std::memory_order_acq_rel);
+    unpinFrame(frame, exclusive);
+}
+
+const Page* BufMgr::readPageOptimistic(File* file, const PageId pageNo, PageVersion& version)
+{
+    const FileId fileId = file->id();
+    for(int spins = 0; ; spins++) {
+        // a reader that keeps finding its page where it was writes nothing
+        if(version.frame < numBufs && startOptimistic(version.frame, fileId, pageNo, version)) {
+            return &bufPool[version.frame];
+        }
+
+        FrameId frame;
+        bool found;
+        bool verified = true;
+        {
+            SharedLatchGuard shared(mapLatch);
+            found = hashTable->find(fileId, pageNo, frame);
+            if(found && startOptimistic(frame, fileId, pageNo, version)) {
+                return &bufPool[frame];
+            }
+            verified = !found || !bufDescTable[frame].unverified();
+        }
+        if(!found || !verified) {
+            Page* page;
+            readPage(file, pageNo, page);
+            unpinFrame(page - bufPool, false);
+        }
+        else if(spins > 64) {
+            // a write guard holds the page
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool BufMgr::startOptimistic(const FrameId frame, const FileId fileId, const PageId pageNo, PageVersion& version)
+{
+    const BufDesc& desc = bufDescTable[frame];
+    const std::uint64_t start = desc.version.load(std::memory_order_acquire);
+    // a frame whose page is still being read has its version already
+    if((start & 1) != 0 || !desc.valid() || desc.ioInProgress() || desc.unverified()
+            || desc.fileId != fileId || desc.pageNo != pageNo) {
+        return false;
+    }
+    // the clock would take a page read only optimistically for cold; the bit is
+    // only written when it is clear
+    if(!isReferenced(frame)) {
+        refBits[frame / 64].fetch_or(1ULL << (frame % 64), std::memory_order_relaxed);
     }
+    version.frame = frame;
+    version.version = start;
+    return true;
+}
+
+bool BufMgr::validatePage(const PageVersion& version) const
+{
+    // the reads of the page are ordered before the second read of the version
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version.frame < numBufs
+        && bufDescTable[version.frame].version.load(std::memory_order_relaxed) == version.version;
 }
 
 /**
@@ -169,25 +1091,27 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
 {
     FrameId frameNumber;
-    try
-    {
-        // check if the page exist in the frame pool
-        hashTable->lookup(file, pageNo, frameNumber);
-        // decrement the pincount when unpin, when dirty is set true, set it to the bufDescTable as well
-        if(bufDescTable[frameNumber].pinCnt > 0) {
-            bufDescTable[frameNumber].pinCnt -= 1;
-            if(dirty == true) {
-                bufDescTable[frameNumber].dirty = true;
-            }
+    // check if the page exist in the frame pool; the caller's pin keeps the
+    // page in its frame, so the probe takes no latch. a probe racing with
+    // changes to the hashtable may miss, it is repeated under the latch
+    if(!hashTable->find(file->id(), pageNo, frameNumber)) {
+        SharedLatchGuard shared(mapLatch);
+        if(!hashTable->find(file->id(), pageNo, frameNumber)) {
             return;
         }
-        // if not pinned, throw exception
-        else if(bufDescTable[frameNumber].pinCnt == 0){
-            throw PageNotPinnedException(file->filename(), bufDescTable[frameNumber].pageNo, frameNumber);
-        }
     }
-    catch(HashNotFoundException e)
-    {
+
+    // decrement the pincount when unpin, when dirty is set true, set it to the bufDescTable as well
+    // if not pinned, throw exception
+    if(!unpinFrame(frameNumber, dirty)) {
+        throw PageNotPinnedException(file->filename(), bufDescTable[frameNumber].pageNo, frameNumber);
+    }
+
+    // a page written through its Page* is only known to have changed now, so
+    // optimistic reads that overlapped the write and validate later fail.  if
+    // the frame was given another page meanwhile, its readers only retry
+    if(dirty) {
+        bufDescTable[frameNumber].version.fetch_add(2, std::memory_order_release);
     }
 }
 
@@ -202,27 +1126,175 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
  */
 void BufMgr::flushFile(const File* file)
 {
-    // if the frame corresponding to the file is invalid, throw exception
+    ExclusiveLatchGuard exclusive(mapLatch);
+    releaseFile(file, true);
+}
+
+/**
+ * Drops all pages of the file from the buffer pool without writing them.
+ *
+ * @param file   	File object
+ * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+ * @throws BadBufferException If any frame allocated to the file is found to be invalid
+ */
+void BufMgr::invalidateFile(const File* file)
+{
+    ExclusiveLatchGuard exclusive(mapLatch);
+    releaseFile(file, false);
+}
+
+/**
+ * Compacts the file and renumbers its pages in the buffer pool.
+ *
+ * @param file   	File object
+ * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+ * @throws BadBufferException If any frame allocated to the file is found to be invalid
+ */
+void BufMgr::compactFile(File* file)
+{
+    ExclusiveLatchGuard exclusive(mapLatch);
+    freezeFileFrames(file);
+    const FrameId head = file->id() < fileFrames.size() ? fileFrames[file->id()] : BufDesc::NO_FRAME;
+
+    // the file must hold the latest contents of the pages it moves
+    std::vector<PageId> newNumbers;
+    try {
+        for(FrameId i = head; i != BufDesc::NO_FRAME; i = bufDescTable[i].nextInFile) {
+            if(bufDescTable[i].dirty()) {
+                writeBack(i);
+                bufDescTable[i].clearFlags(BufDesc::DIRTY);
+            }
+        }
+
+        // evicted pages of the file are not renumbered, they are dropped
+        if(victimCache != NULL) {
+            victimCache->eraseFile(file->id());
+        }
+        newNumbers = file->compact();
+    }
+    catch(...) {
+        thawFileFrames(file);
+        throw;
+    }
+
+    // all frames leave the hashtable before any is inserted again, since a
+    // page may move to the old number of another cached page
+    for(FrameId i = head; i != BufDesc::NO_FRAME; i = bufDescTable[i].nextInFile) {
+        hashTable->remove(file->id(), bufDescTable[i].pageNo);
+    }
+    for(FrameId i = head; i != BufDesc::NO_FRAME; i = bufDescTable[i].nextInFile) {
+        bufDescTable[i].beginWrite();
+        bufDescTable[i].pageNo = newNumbers[bufDescTable[i].pageNo];
+        File::renumberPage(bufPool[i], newNumbers);
+        hashTable->insert(file->id(), bufDescTable[i].pageNo, i);
+        bufDescTable[i].endWrite();
+    }
+    thawFileFrames(file);
+}
+
+bool BufMgr::dropFile(const FileId id)
+{
+    // the file is closed, so its pages are written back and dropped as by
+    // flushFile(); a write that fails is not reported, as a failing sync on
+    // close is not. a page still pinned keeps its frame, and the id
+    ExclusiveLatchGuard exclusive(mapLatch);
+    if(victimCache != NULL) {
+        victimCache->eraseFile(id);
+    }
+    if(id >= fileFrames.size()) {
+        return true;
+    }
+    bool dropped = true;
+    FrameId i = fileFrames[id];
+    while(i != BufDesc::NO_FRAME) {
+        const FrameId next = bufDescTable[i].nextInFile;
+        if(!bufDescTable[i].tryFreeze(0)) {
+            dropped = false;
+            i = next;
+            continue;
+        }
+        if(bufDescTable[i].dirty()) {
+            try {
+                writeBack(i);
+            }
+            catch(...) {
+            }
+        }
+        hashTable->remove(id, bufDescTable[i].pageNo);
+        clearFrame(i);
+        freeFrames->push(i);
+        i = next;
+    }
+    return dropped;
+}
+
+void BufMgr::freezeFileFrames(const File* file)
+{
+    if(file->id() >= fileFrames.size()) {
+        return;
+    }
+
+    // if a frame of the file is invalid, throw exception
     // if some1 is referring to the frame, throw exception
-    for(unsigned int i = 0; i < numBufs; i++) {
-        if(bufDescTable[i].valid == false && bufDescTable[i].file == file) {
-            throw BadBufferException(bufDescTable[i].frameNo, bufDescTable[i].dirty, bufDescTable[i].valid, bufDescTable[i].refbit);
+    // each frame is frozen once checked, so that no hit pins it before all are
+    for(FrameId i = fileFrames[file->id()]; i != BufDesc::NO_FRAME; i = bufDescTable[i].nextInFile) {
+        if(!bufDescTable[i].valid()) {
+            thawFileFrames(file, i);
+            throw BadBufferException(bufDescTable[i].frameNo, bufDescTable[i].dirty(), bufDescTable[i].valid(), isReferenced(i));
         }
-        if(bufDescTable[i].file == file && bufDescTable[i].pinCnt > 0) {
+        if(!bufDescTable[i].tryFreeze(0)) {
+            thawFileFrames(file, i);
             throw PagePinnedException(file->filename(), bufDescTable[i].pageNo, bufDescTable[i].frameNo);
         }
-        // if the frame is valid and dirty, flush it and remove it from hashtable
-        // clear the bufDescTable as well
-        if(bufDescTable[i].valid == true && bufDescTable[i].file == file) {
-            if(bufDescTable[i].dirty == true) {
-                bufDescTable[i].file->writePage(bufPool[i]);
-                bufDescTable[i].dirty = false;
+    }
+}
+
+void BufMgr::thawFileFrames(const File* file, const FrameId end)
+{
+    if(file->id() >= fileFrames.size()) {
+        return;
+    }
+    for(FrameId i = fileFrames[file->id()]; i != end; i = bufDescTable[i].nextInFile) {
+        bufDescTable[i].clearFlags(BufDesc::IO_IN_PROGRESS);
+    }
+}
+
+void BufMgr::releaseFile(const File* file, const bool writeBack)
+{
+    // both checks are made before any frame is released, so the file is
+    // left alone as a whole
+    freezeFileFrames(file);
+
+    // the file may be changed or removed behind the buffer pool's back once
+    // released, so its evicted pages go too
+    if(victimCache != NULL) {
+        victimCache->eraseFile(file->id());
+    }
+    if(file->id() >= fileFrames.size()) {
+        return;
+    }
+    const FrameId head = fileFrames[file->id()];
+
+    // flush the frames if they are dirty, remove them from the hashtable
+    // and put them on the free list; releasing the last frame also drops
+    // the list head, so the next frame is fetched first
+    // if a write fails, the frames not released yet are thawed
+    FrameId i = head;
+    try {
+        while(i != BufDesc::NO_FRAME) {
+            const FrameId next = bufDescTable[i].nextInFile;
+            if(!writeBack) {
+                bufDescTable[i].clearFlags(BufDesc::DIRTY);
             }
-            hashTable->remove(bufDescTable[i].file,
-                    bufDescTable[i].pageNo);
-            bufDescTable[i].Clear();
+            releaseBuf(i);
+            freeFrames->push(i);
+            i = next;
         }
     }
+    catch(...) {
+        thawFileFrames(file);
+        throw;
+    }
 }
 
 /**
@@ -232,18 +1304,57 @@ void BufMgr::flushFile(const File* file)
  * @param file   	File object
  * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
  * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+ * @param strategy	Access strategy of the caller, or NULL
  */
-void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
+void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page, BufferAccessStrategy* strategy)
 {
     // allocate new frame by calling allocatePage
     // return the ptr to the page and also value of pageNo
+    // as on a miss, the log is flushed without the mapping latch when the
+    // frame to take holds a page that must not be written before
     FrameId frameNumber;
-    allocBuf(frameNumber);
-    bufPool[frameNumber] = file->allocatePage();
-    page = &bufPool[frameNumber];
-    pageNo = page->page_number();
-    hashTable->insert(file, pageNo, frameNumber);
-    bufDescTable[frameNumber].Set(file, pageNo);
+    Lsn logLsn = 0;
+    LogManager* log = NULL;
+    std::vector<PendingVictim> victims;
+    for(bool allocated = false; !allocated; putVictims(victims)) {
+        if(log != NULL) {
+            log->flush(logLsn);
+            logLsn = 0;
+        }
+        ExclusiveLatchGuard exclusive(mapLatch);
+        log = logManager;
+        allocated = allocBuf(frameNumber, strategy, logLsn);
+        if(!allocated) {
+            victims.swap(pendingVictims);
+            continue;
+        }
+        try
+        {
+            bufPool[frameNumber] = file->allocatePage();
+        }
+        catch(...)
+        {
+            // the frame was emptied for the page, it goes back on the free list
+            clearFrame(frameNumber);
+            freeFrames->push(frameNumber);
+            throw;
+        }
+        page = &bufPool[frameNumber];
+        pageNo = page->page_number();
+        hashTable->insert(file->id(), pageNo, frameNumber);
+        setFrame(frameNumber, file, pageNo, strategy == NULL);
+        bufDescTable[frameNumber].clearFlags(BufDesc::IO_IN_PROGRESS);
+        victims.swap(pendingVictims);
+    }
+}
+
+WritePageGuard BufMgr::allocPageExclusive(File* file, PageId &pageNo, BufferAccessStrategy* strategy)
+{
+    Page* page;
+    allocPage(file, pageNo, page, strategy);
+    const FrameId frame = page - bufPool;
+    latchFrame(frame, true);
+    return WritePageGuard(this, frame, page);
 }
 
 /**
@@ -260,25 +1371,101 @@ void BufMgr::disposePage(File* file, const PageId PageNo)
     //for(unsigned int i = 0; i < numBufs; i++) {
     //    if(bufDescTable[i].file == file && bufDescTable[i].pageNo == PageNo) {
     FrameId frameNo;
-    try {
-        hashTable->lookup(file, PageNo, frameNo);
-        if(bufDescTable[frameNo].pinCnt != 0) {
-                throw PagePinnedException(bufDescTable[frameNo].file->filename(), bufDescTable[frameNo].pageNo, bufDescTable[frameNo].frameNo);
-        }
-            bufDescTable[frameNo].Clear();
-            hashTable->remove(file, PageNo);
-            file->deletePage(PageNo);
-            return;
+    ExclusiveLatchGuard exclusive(mapLatch);
+    if(hashTable->find(file->id(), PageNo, frameNo)) {
+        if(!bufDescTable[frameNo].tryFreeze(0)) {
+                throw PagePinnedException(file->filename(), bufDescTable[frameNo].pageNo, bufDescTable[frameNo].frameNo);
         }
-    catch(HashNotFoundException e) {
-        file->deletePage(PageNo);
+            clearFrame(frameNo);
+            freeFrames->push(frameNo);
+            hashTable->remove(file->id(), PageNo);
     }
+    if(victimCache != NULL) {
+        victimCache->erase(file->id(), PageNo);
+    }
+    file->deletePage(PageNo);
 
     // if the page does not exist in the buffer pool, delete it from it file on disk as well
     // unsure what will happen if the page does not exist even on disk
     // opppss, will throw error without deleting anything
 }
 
+void BufMgr::reserveFrames(const std::uint32_t count, std::vector<Page*>& pages)
+{
+    // the frames taken so far go back if one of them needs the log flushed
+    // first, which happens without the mapping latch
+    const std::size_t first = pages.size();
+    Lsn logLsn = 0;
+    LogManager* log = NULL;
+    std::vector<PendingVictim> victims;
+    for(bool reserved = false; !reserved; putVictims(victims)) {
+        if(log != NULL) {
+            log->flush(logLsn);
+            logLsn = 0;
+        }
+        ExclusiveLatchGuard exclusive(mapLatch);
+        log = logManager;
+        reserved = true;
+        try {
+            for(std::uint32_t i = 0; i < count && reserved; i++) {
+                FrameId frame;
+                reserved = allocBuf(frame, NULL, logLsn);
+                if(reserved) {
+                    // a reserved frame looks valid and pinned to the clock, but
+                    // belongs to no file and is not in the hashtable
+                    const std::uint64_t mask = 1ULL << (frame % 64);
+                    bufDescTable[frame].state.store(BufDesc::VALID | BufDesc::PIN_ONE, std::memory_order_release);
+                    validBits[frame / 64].fetch_or(mask, std::memory_order_relaxed);
+                    pinnedBits[frame / 64].fetch_or(mask, std::memory_order_relaxed);
+                    pages.push_back(&bufPool[frame]);
+                }
+            }
+        }
+        catch(...) {
+            unreserveFrames(pages, first);
+            throw;
+        }
+        if(!reserved) {
+            unreserveFrames(pages, first);
+        }
+        victims.swap(pendingVictims);
+    }
+}
+
+void BufMgr::unreserveFrames(std::vector<Page*>& pages, const std::size_t first)
+{
+    for(std::size_t i = first; i < pages.size(); i++) {
+        const FrameId frame = pages[i] - bufPool;
+        bufDescTable[frame].Clear();
+        clearFrame(frame);
+        freeFrames->push(frame);
+    }
+    pages.resize(first);
+}
+
+void BufMgr::releaseFrames(const std::vector<Page*>& pages)
+{
+    ExclusiveLatchGuard exclusive(mapLatch);
+    for(std::size_t i = 0; i < pages.size(); i++) {
+        if(pages[i] < bufPool || pages[i] >= bufPool + numBufs) {
+            throw BadBufferException(BufDesc::NO_FRAME, false, false, false);
+        }
+        const FrameId frame = pages[i] - bufPool;
+        const BufDesc& desc = bufDescTable[frame];
+        if(desc.file != NULL || !desc.valid() || desc.pinCnt() != 1) {
+            throw BadBufferException(frame, desc.dirty(), desc.valid(), isReferenced(frame));
+        }
+    }
+    for(std::size_t i = 0; i < pages.size(); i++) {
+        const FrameId frame = pages[i] - bufPool;
+        // the frame is cleared before clearFrame() sees it, as it is on no
+        // file's list
+        bufDescTable[frame].Clear();
+        clearFrame(frame);
+        freeFrames->push(frame);
+    }
+}
+
 // printing the usage of buffer pool frame
 void BufMgr::printSelf(void)
 {
@@ -289,9 +1476,9 @@ void BufMgr::printSelf(void)
     {
         tmpbuf = &(bufDescTable[i]);
         std::cout << "FrameNo:" << i << " ";
-        tmpbuf->Print();
+        tmpbuf->Print(isReferenced(i));
 
-        if (tmpbuf->valid == true)
+        if (tmpbuf->valid())
             validFrames++;
     }
 
@@ -7,8 +7,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
 #include "file.h"
 #include "bufHashTbl.h"
+#include "buffer_strategy.h"
+#include "free_frame_list.h"
+#include "frequency_sketch.h"
+#include "latch.h"
+#include "log_manager.h"
+#include "victim_cache.h"
 
 namespace badgerdb {
 
@@ -16,20 +30,75 @@ namespace badgerdb {
 * forward declaration of BufMgr class
 */
 class BufMgr;
+class PageGuard;
+class ReadPageGuard;
+class WritePageGuard;
 
 /**
 * @brief Class for maintaining information about buffer pool frames
+*
+* The pin count and the valid, dirty and I/O-in-progress flags of a frame are packed into one atomic 64-bit
+* state word, so pinning a resident page is a single compare-and-swap that needs no lock on the frame.  The
+* file and page number only change while BufMgr holds its mapping latch in exclusive mode and the frame is
+* unpinned with I/O in progress, which keeps new pins out until the flag is cleared.  The reference bit
+* used by the clock lives in a bitmap of BufMgr, next to the bitmaps the sweep scans.
 */
-class BufDesc {
+class alignas(CACHE_LINE_SIZE) BufDesc {
 
 	friend class BufMgr;
 
  private:
+	/**
+   * One pin in the state word; the pin count takes the low 32 bits
+	 */
+  static const std::uint64_t PIN_ONE = 1ULL;
+
+	/**
+   * Pin count bits of the state word
+	 */
+  static const std::uint64_t PIN_MASK = 0xffffffffULL;
+
+	/**
+   * Set if the frame holds a page
+	 */
+  static const std::uint64_t VALID = 1ULL << 40;
+
+	/**
+   * Set if the page was modified since it was read
+	 */
+  static const std::uint64_t DIRTY = 1ULL << 41;
+
+	/**
+   * Set while the page is being read into or written from the frame, or while BufMgr changes the frame
+   * under its exclusive mapping latch; nobody pins the frame meanwhile
+	 */
+  static const std::uint64_t IO_IN_PROGRESS = 1ULL << 42;
+
+	/**
+   * Set while the page read into the frame with lazy checksums has not been verified
+	 */
+  static const std::uint64_t UNVERIFIED = 1ULL << 43;
+
+	/**
+   * Set while a reader verifies the checksum of the page
+	 */
+  static const std::uint64_t VERIFYING = 1ULL << 44;
+
+	/**
+   * Frame number that ends a list of frames
+	 */
+  static const FrameId NO_FRAME = 0xffffffff;
+
 	/**
    * Pointer to file to which corresponding frame is assigned
 	 */
   File* file;
 
+	/**
+   * Id of the file, used to find the page in the hash table and in the per-file frame lists
+	 */
+  FileId fileId;
+
 	/**
    * Page within file to which corresponding frame is assigned
 	 */
@@ -40,42 +109,224 @@ class BufDesc {
 	 */
   FrameId	frameNo;
 
+	/**
+   * Next frame holding a page of the same file, or NO_FRAME
+	 */
+  FrameId nextInFile;
+
+	/**
+   * Previous frame holding a page of the same file, or NO_FRAME
+	 */
+  FrameId prevInFile;
+
+	/**
+   * Packed pin count and flags
+	 */
+  std::atomic<std::uint64_t> state;
+
+	/**
+   * End of the write-ahead log when the frame was last pinned while it had no pins; every update made
+   * since gets a later LSN
+	 */
+  std::atomic<Lsn> pinLsn;
+
+	/**
+   * Lower bound of the LSN of the first update not written back, taken from pinLsn when the frame
+   * turns dirty
+	 */
+  std::atomic<Lsn> recLsn;
+
+	/**
+   * Latch on the contents of the page, held by page guards: shared by readers, exclusive by a writer
+	 */
+  RWLatch latch;
+
+	/**
+   * Number of pins held by page guards, counted after the pin and before the latch is taken
+	 */
+  std::atomic<std::uint32_t> guardPins;
+
+	/**
+   * Version of the frame's contents for optimistic readers: odd while a write guard holds the frame or
+   * the frame changes pages, and different after every such change
+	 */
+  std::atomic<std::uint64_t> version;
+
 	/**
    * Number of times this page has been pinned
 	 */
-  int pinCnt;
+  std::uint32_t pinCnt() const
+	{
+		return state.load(std::memory_order_acquire) & PIN_MASK;
+	}
 
 	/**
    * True if page is dirty;  false otherwise
 	 */
-  bool dirty;
+  bool dirty() const
+	{
+		return (state.load(std::memory_order_acquire) & DIRTY) != 0;
+	}
+
+	/**
+   * True if the checksum of the page has not been verified yet
+	 */
+  bool unverified() const
+	{
+		return (state.load(std::memory_order_acquire) & (UNVERIFIED | VERIFYING)) != 0;
+	}
 
 	/**
    * True if page is valid
 	 */
-  bool valid;
+  bool valid() const
+	{
+		return (state.load(std::memory_order_acquire) & VALID) != 0;
+	}
+
+	/**
+   * True while I/O is in progress on the frame
+	 */
+  bool ioInProgress() const
+	{
+		return (state.load(std::memory_order_acquire) & IO_IN_PROGRESS) != 0;
+	}
 
 	/**
-   * Has this buffer frame been reference recently
+	 * Pin the frame with one atomic increment.
+	 *
+	 * @return  Pin count before this pin
+	 */
+  std::uint32_t pin()
+	{
+		return state.fetch_add(PIN_ONE, std::memory_order_acq_rel) & PIN_MASK;
+	}
+
+	/**
+	 * Pin the frame if it holds a page, waiting while I/O is in progress on it.  The page may have changed
+	 * by the time the frame is pinned, the caller checks it.
+	 *
+	 * @param previous	Pin count before this pin, set if the frame was pinned
+	 * @return  				False if the frame holds no page
 	 */
-  bool refbit;
+  bool pinValid(std::uint32_t& previous)
+	{
+		std::uint64_t old = state.load(std::memory_order_acquire);
+		for(int spins = 0; ; spins++) {
+			if((old & VALID) == 0) {
+				return false;
+			}
+			if((old & IO_IN_PROGRESS) == 0) {
+				if(state.compare_exchange_weak(old, old + PIN_ONE, std::memory_order_acq_rel)) {
+					previous = old & PIN_MASK;
+					return true;
+				}
+				continue;
+			}
+			if(spins > 64) {
+				std::this_thread::yield();
+			}
+			old = state.load(std::memory_order_acquire);
+		}
+	}
+
+	/**
+	 * Set IO_IN_PROGRESS if the frame has exactly the given number of pins and no I/O in progress, so that
+	 * no pin is added until it is cleared.
+	 *
+	 * @param pins			Pin count the frame must have
+	 * @return  				False if the pin count differs or I/O is in progress
+	 */
+  bool tryFreeze(const std::uint32_t pins)
+	{
+		std::uint64_t old = state.load(std::memory_order_acquire);
+		do {
+			if((old & PIN_MASK) != pins || (old & IO_IN_PROGRESS) != 0) {
+				return false;
+			}
+		} while(!state.compare_exchange_weak(old, old | IO_IN_PROGRESS, std::memory_order_acq_rel));
+		return true;
+	}
+
+	/**
+	 * Drop one pin of the frame.
+	 *
+	 * @param setDirty	True to mark the page dirty
+	 * @return  				Pin count before this unpin, 0 if the frame was not pinned
+	 */
+  std::uint32_t unpin(const bool setDirty)
+	{
+		// read while still pinned, so that a new first pin cannot have moved it past our updates
+		const Lsn firstLsn = pinLsn.load(std::memory_order_relaxed);
+		std::uint64_t old = state.load(std::memory_order_relaxed);
+		do {
+			if((old & PIN_MASK) == 0) {
+				return 0;
+			}
+		} while(!state.compare_exchange_weak(old, (old - PIN_ONE) | (setDirty ? DIRTY : 0),
+					std::memory_order_acq_rel));
+		if(setDirty && (old & DIRTY) == 0) {
+			recLsn.store(firstLsn, std::memory_order_relaxed);
+		}
+		return old & PIN_MASK;
+	}
+
+	/**
+	 * Set the given flags in the state word.
+	 */
+  void setFlags(const std::uint64_t flags)
+	{
+		state.fetch_or(flags, std::memory_order_acq_rel);
+	}
+
+	/**
+	 * Clear the given flags in the state word.
+	 */
+  void clearFlags(const std::uint64_t flags)
+	{
+		state.fetch_and(~flags, std::memory_order_acq_rel);
+	}
+
+	/**
+	 * Make the version odd before the contents change under a write guard.
+	 */
+  void beginWrite()
+	{
+		version.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	/**
+	 * Make the version even, and new, after the contents changed under a write guard.
+	 */
+  void endWrite()
+	{
+		version.fetch_add(1, std::memory_order_release);
+	}
 
 	/**
    * Initialize buffer frame for a new user
 	 */
   void Clear()
 	{
-    pinCnt = 0;
+		// the frame stays closed to optimistic readers until Set() gives it a page
+		version.fetch_or(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
 		file = NULL;
+		fileId = FileRegistry::INVALID_ID;
 		pageNo = Page::INVALID_NUMBER;
-    dirty = false;
-    refbit = false;
-		valid = false;
+		nextInFile = NO_FRAME;
+		prevInFile = NO_FRAME;
+		pinLsn.store(0, std::memory_order_relaxed);
+		recLsn.store(0, std::memory_order_relaxed);
+		guardPins.store(0, std::memory_order_relaxed);
+		state.store(0, std::memory_order_release);
   };
 
 	/**
 	 * Set values of member variables corresponding to assignment of frame to a page in the file. Called when a frame
-	 * in buffer pool is allocated to any page in the file through readPage() or allocPage()
+	 * in buffer pool is allocated to any page in the file through readPage() or allocPage().  The frame is left
+	 * with I/O in progress, which the caller clears once the page is in it.
 	 *
 	 * @param filePtr	File object
 	 * @param pageNum	Page number in the file
@@ -83,26 +334,30 @@ class BufDesc {
   void Set(File* filePtr, PageId pageNum)
 	{
 		file = filePtr;
+		fileId = filePtr->id();
     pageNo = pageNum;
-    pinCnt = 1;
-    dirty = false;
-    valid = true;
-    refbit = true;
+		state.store(VALID | PIN_ONE | IO_IN_PROGRESS, std::memory_order_release);
+		version.fetch_add(1, std::memory_order_release);
   }
 
-  void Print()
+	/**
+	 * Print the frame state.
+	 *
+	 * @param refbit	Reference bit of the frame, kept by BufMgr
+	 */
+  void Print(const bool refbit)
 	{
 		if(file)
 		{
-			std::cout << "file:" << file->filename() << " ";
+			std::cout << "file:" << FileRegistry::filename(fileId) << " ";
 			std::cout << "pageNo:" << pageNo << " ";
 		}
 		else
 			std::cout << "file:NULL ";
 
-		std::cout << "valid:" << valid << " ";
-		std::cout << "pinCnt:" << pinCnt << " ";
-		std::cout << "dirty:" << dirty << " ";
+		std::cout << "valid:" << valid() << " ";
+		std::cout << "pinCnt:" << pinCnt() << " ";
+		std::cout << "dirty:" << dirty() << " ";
 		std::cout << "refbit:" << refbit << "\n";
   }
 
@@ -111,6 +366,7 @@ class BufDesc {
 	 */
   BufDesc()
 	{
+		version.store(0, std::memory_order_relaxed);
   	Clear();
   }
 };
@@ -118,30 +374,98 @@ class BufDesc {
 
 /**
 * @brief Class to maintain statistics of buffer usage
+*
+* Counters are atomic so that concurrent readers of the buffer pool can update them.
 */
 struct BufStats
 {
 	/**
-   * Total number of accesses to buffer pool
+   * Total number of accesses to buffer pool: pages read, found in the pool or not.  Allocating a page
+   * is not counted.
 	 */
-  int accesses;
+  std::atomic<int> accesses;
 
 	/**
-   * Number of pages read from disk (including allocs)
+   * Number of pages read from disk (allocations are not counted)
 	 */
-  int diskreads;
+  std::atomic<int> diskreads;
 
 	/**
    * Number of pages written back to disk
 	 */
-  int diskwrites;
+  std::atomic<int> diskwrites;
+
+	/**
+   * Number of pages read on a miss that the admission filter let replace the clock's victim
+	 */
+  std::atomic<int> admitted;
+
+	/**
+   * Number of pages read on a miss that the admission filter sent to the probationary window
+	 */
+  std::atomic<int> rejected;
+
+	/**
+   * Number of pages read on a miss that were found in the victim cache instead of read from disk
+	 */
+  std::atomic<int> victimHits;
+
+	/**
+   * Number of pages read on a miss that were not in the victim cache, while it was on
+	 */
+  std::atomic<int> victimMisses;
+
+	/**
+   * Bytes of the pages put into the victim cache
+	 */
+  std::atomic<std::uint64_t> victimBytes;
+
+	/**
+   * Bytes the pages put into the victim cache took compressed
+	 */
+  std::atomic<std::uint64_t> victimCompressedBytes;
+
+	/**
+   * Number of times the clock looked for a victim
+	 */
+  std::atomic<std::uint64_t> victimSearches;
+
+	/**
+   * Number of bitmap words, of 64 frames each, the clock examined while looking for victims
+	 */
+  std::atomic<std::uint64_t> clockWords;
+
+	/**
+   * Number of reference bits the clock cleared on the frames it passed
+	 */
+  std::atomic<std::uint64_t> refBitsCleared;
+
+	/**
+   * Compression ratio of the pages put into the victim cache, 0 if there were none
+	 */
+  double victimCompressionRatio() const
+  {
+		const std::uint64_t compressed = victimCompressedBytes;
+		return compressed > 0 ? static_cast<double>(victimBytes) / compressed : 0;
+  }
 
 	/**
    * Clear all values
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = 0;
+		diskreads = 0;
+		diskwrites = 0;
+		admitted = 0;
+		rejected = 0;
+		victimHits = 0;
+		victimMisses = 0;
+		victimBytes = 0;
+		victimCompressedBytes = 0;
+		victimSearches = 0;
+		clockWords = 0;
+		refBitsCleared = 0;
   }
 
 	/**
@@ -154,12 +478,61 @@ struct BufStats
 };
 
 
+/**
+* @brief Frame and version of a page read optimistically, see BufMgr::readPageOptimistic()
+*
+* Kept by the reader between reads of the same page, the frame is where the next read looks first.
+*/
+struct PageVersion
+{
+	/**
+   * Frame the page was read from
+	 */
+  FrameId frame;
+
+	/**
+   * Version of the frame when the read started
+	 */
+  std::uint64_t version;
+
+	/**
+   * Constructor of PageVersion class
+	 */
+  PageVersion()
+		: frame(0), version(1)
+  {
+  }
+};
+
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file
+*
+* readPage(), unPinPage(), allocPage(), flushFile(), invalidateFile(), compactFile() and disposePage() may be called from
+* several threads.
+* A hit on a resident page takes no latch: it probes the hash table, pins the frame with a compare-and-swap on
+* its state word and checks that the frame still holds the page.  A miss claims a frame under the exclusive
+* mapping latch and reads the page after releasing it; readers of that page wait for the read, readers of
+* other pages go on.  A frame the mapping latch holder changes is frozen first, see BufDesc::tryFreeze().
+* An access strategy and the Page* handed out for a pinned page belong to a single caller.
 */
 class BufMgr
 {
+	friend class PageGuard;
+
  private:
+	/**
+   * A page evicted into the victim cache: copied while the mapping latch is held, compressed after it is released
+	 */
+  struct PendingVictim
+  {
+    std::shared_ptr<VictimCache> cache;
+    std::uint64_t ticket;
+    FileId fileId;
+    PageId pageNo;
+    Page page;
+  };
+
 	/**
    * Current position of clockhand in our buffer pool
 	 */
@@ -175,16 +548,95 @@ class BufMgr
 	 */
   BufHashTbl *hashTable;
 
+	/**
+   * Frames that hold no page.  Allocation takes from it before running the clock, and frames emptied by
+   * flushFile() and disposePage() go back on it.  Every invalid frame is on the list.
+	 */
+  FreeFrameList *freeFrames;
+
+	/**
+   * First frame of the list of resident pages of every file, indexed by FileId, or BufDesc::NO_FRAME.  The
+   * lists are linked through the BufDesc entries, so that work on one file only touches the frames of that
+   * file.  Changes only under the exclusive mapping latch.
+	 */
+  std::vector<FrameId> fileFrames;
+
 	/**
    * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
 	 */
   BufDesc *bufDescTable;
 
+	/**
+   * Latch protecting changes to the hash table and the assignment of frames to pages.  Hits do not take it,
+   * so they only contend on the state words of their frames; misses, allocation, flushing and disposal take
+   * it in exclusive mode.
+	 */
+  RWLatch mapLatch;
+
+	/**
+   * Number of 64-bit words in each of the frame bitmaps
+	 */
+  std::uint32_t bitmapWords;
+
+	/**
+   * Bit per frame, set if the frame holds a page.  Changes only under the exclusive mapping latch.
+	 */
+  std::atomic<std::uint64_t>* validBits;
+
+	/**
+   * Bit per frame, set if the frame has been referenced since the clock last passed it
+	 */
+  std::atomic<std::uint64_t>* refBits;
+
+	/**
+   * Bit per frame, set while the frame is pinned.  Maintained on the 0-to-1 and 1-to-0 transitions of the
+   * pin count, so under concurrent pins it is only a hint; the sweep checks the state word of a frame
+   * before taking it.
+	 */
+  std::atomic<std::uint64_t>* pinnedBits;
+
 	/**
    * Maintains Buffer pool usage statistics
 	 */
   BufStats bufStats;
 
+	/**
+   * Frequency sketch of recent page accesses, NULL if the admission filter is off
+	 */
+  FrequencySketch* admissionSketch;
+
+	/**
+   * Probationary window for pages the admission filter does not let into the main pool
+	 */
+  BufferAccessStrategy* admissionWindow;
+
+	/**
+   * Compressed pages evicted by the clock, NULL if the victim cache is off.  Shared with evictions that are
+   * still compressing pages into it after setVictimCache() replaced it.
+	 */
+  std::shared_ptr<VictimCache> victimCache;
+
+	/**
+   * Pages evictBuf() reserved room for in the victim cache.  The holder of the exclusive mapping latch takes
+   * them before it releases the latch and compresses them with putVictims() afterwards.
+	 */
+  std::vector<PendingVictim> pendingVictims;
+
+	/**
+   * Write-ahead log that must be durable up to a page's LSN before the page is written back, or NULL
+	 */
+  LogManager* logManager;
+
+	/**
+   * True if pages read on a miss are verified by their first reader instead of while the mapping latch is held
+	 */
+  bool lazyChecksums;
+
+	/**
+   * Handle of dropFile() among the release hooks of the file registry
+	 */
+  int releaseHook;
+
 	/**
    * Advance clock to next frame in the buffer pool
 	 */
@@ -194,11 +646,330 @@ class BufMgr
 	 * Allocate a free frame.
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param strategy	Access strategy of the caller, or NULL to allocate from the whole pool
+	 * @param logLsn  	Set to the LSN the log must be flushed to if the frame to take holds a dirty page
+	 * 								whose log records are not durable yet
+	 * @return  				False if the log must be flushed first, or a hit pinned the victim; the caller
+	 * 								flushes the log without holding the mapping latch and tries again
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void allocBuf(FrameId & frame);
+  bool allocBuf(FrameId & frame, BufferAccessStrategy* strategy, Lsn & logLsn);
+
+	/**
+	 * Check the write-ahead rule for the page of a frame about to be written back.
+	 *
+	 * @param frame   	Frame number
+	 * @param logLsn  	Set to the LSN the log must be flushed to if the check fails
+	 * @return  				True if the page is clean or its log records are durable
+	 */
+  bool logFlushed(const FrameId frame, Lsn & logLsn) const;
+
+	/**
+	 * Run the clock until it rests on a frame that can be allocated, without taking the frame.
+	 * The sweep scans the valid, reference and pinned bitmaps 64 frames at a time and clears the
+	 * reference bits of the frames it passes.
+	 *
+	 * @param frame   	Frame reference, frame ID of the victim returned via this variable
+	 * @return  				False if every frame is pinned
+	 */
+  bool findVictim(FrameId & frame);
+
+	/**
+	 * Rebuild the pinned bitmap from the pin counts in the state words.
+	 */
+  void resyncPinnedBits();
+
+	/**
+	 * Pin a frame and keep the pinned and reference bitmaps up to date.
+	 *
+	 * @param frame   	Frame number
+	 * @param touch			True to set the reference bit of the frame
+	 */
+  void pinFrame(const FrameId frame, const bool touch);
+
+	/**
+	 * Keep the pinned and reference bitmaps up to date after a frame was pinned.
+	 *
+	 * @param frame   	Frame number
+	 * @param previous	Pin count before the pin
+	 * @param pinLsn		End of the log, read before the pin
+	 * @param touch			True to set the reference bit of the frame
+	 */
+  void notePin(const FrameId frame, const std::uint32_t previous, const Lsn pinLsn, const bool touch);
+
+	/**
+	 * Pin the frame of a resident page without the mapping latch, waiting while the page is read into it.
+	 *
+	 * @param fileId   	File id
+	 * @param pageNo  	Page number in the file
+	 * @param frame   	Frame reference, set to the frame of the page
+	 * @param touch			True to set the reference bit of the frame
+	 * @return  				False if the page was not found in the buffer pool
+	 */
+  bool pinResident(const FileId fileId, const PageId pageNo, FrameId& frame, const bool touch);
+
+	/**
+	 * Drop one pin of a frame and keep the pinned bitmap up to date.
+	 *
+	 * @param frame   	Frame number
+	 * @param dirty			True to mark the page dirty
+	 * @return  				False if the frame was not pinned
+	 */
+  bool unpinFrame(const FrameId frame, const bool dirty);
+
+	/**
+	 * Assign a frame to a page, pinned once with I/O in progress, and update the bitmaps.
+	 *
+	 * @param frame   	Frame number
+	 * @param file   		File object
+	 * @param pageNo  	Page number in the file
+	 * @param referenced	True to set the reference bit of the frame
+	 */
+  void setFrame(const FrameId frame, File* file, const PageId pageNo, const bool referenced);
+
+	/**
+	 * Mark a frame as free and update the bitmaps.
+	 *
+	 * @param frame   	Frame number
+	 */
+  void clearFrame(const FrameId frame);
+
+	/**
+	 * Add a frame to the front of the list of frames of its file.
+	 *
+	 * @param frame   	Frame number
+	 */
+  void linkFrame(const FrameId frame);
+
+	/**
+	 * Remove a frame from the list of frames of its file.
+	 *
+	 * @param frame   	Frame number
+	 */
+  void unlinkFrame(const FrameId frame);
+
+	/**
+	 * Check that no frame of the file is pinned or invalid, and freeze all of them.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool; no frame is frozen then
+   * @throws BadBufferException If any frame allocated to the file is found to be invalid; no frame is frozen then
+	 */
+  void freezeFileFrames(const File* file);
+
+	/**
+	 * Release hook of the file registry: write back and drop the pages of a file whose last File object
+	 * was closed, and drop them from the victim cache, so that they are not found under its id once the id
+	 * is reused.
+	 *
+	 * @param id   	Id of the file
+	 * @return  		False if a page of the file is still pinned, and kept
+	 */
+  bool dropFile(const FileId id);
+
+	/**
+	 * Thaw the frames of the file frozen by freezeFileFrames().
+	 *
+	 * @param file   	File object
+	 * @param end   	Frame of the file's list to stop at
+	 */
+  void thawFileFrames(const File* file, const FrameId end = BufDesc::NO_FRAME);
+
+	/**
+	 * Check that no frame of the file is pinned or invalid and freeze them, then release all of them.
+	 *
+	 * @param file   	File object
+	 * @param writeBack	True to write dirty pages to disk, false to discard them
+	 */
+  void releaseFile(const File* file, const bool writeBack);
+
+	/**
+	 * Reference bit of a frame.
+	 *
+	 * @param frame   	Frame number
+	 */
+  bool isReferenced(const FrameId frame) const;
+
+	/**
+	 * Decide whether a page read on a miss may replace the clock's victim.  The page is admitted
+	 * if the frequency sketch has seen it more often recently than the victim's page.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			True if the page is admitted, false if it goes to the probationary window
+	 */
+  bool admitPage(File* file, const PageId pageNo);
+
+	/**
+	 * Key of a page in the frequency sketch.
+	 *
+	 * @param file   	File id
+	 * @param pageNo  Page number in the file
+	 */
+  static std::uint64_t pageKey(const FileId file, const PageId pageNo);
+
+	/**
+	 * Try to recycle the next frame of the ring of the given access strategy.
+	 * A frame is only recycled if it is unpinned and nobody outside the ring
+	 * has referenced it since it was loaded.
+	 *
+	 * @param strategy	Access strategy of the caller
+	 * @param frame   	Frame reference, frame ID of the recycled frame returned via this variable
+	 * @param logLsn  	Set if the next frame holds a dirty page whose log records are not durable yet
+	 * @return  				True if a frame of the ring was recycled
+	 */
+  bool getStrategyBuf(BufferAccessStrategy* strategy, FrameId & frame, Lsn & logLsn);
+
+	/**
+	 * Find a frame of the probationary window for a page the admission filter rejected.  The
+	 * window's unpinned frames are tried in ring order.  A window page that was referenced again
+	 * moves to the main pool if it has been seen more often than the clock's victim, and the
+	 * victim's frame replaces it in the window; otherwise it is evicted like any window page.
+	 *
+	 * Frames whose pages cannot be written before the log is flushed are passed over.
+	 *
+	 * @param frame   	Frame reference, frame ID of the frame found returned via this variable
+	 * @param logLsn  	Set if every unpinned window frame needs the log flushed first
+	 * @return  				False if the window is still growing, all of its frames are pinned, or the log
+	 * 								must be flushed first
+	 */
+  bool getWindowBuf(FrameId & frame, Lsn & logLsn);
+
+	/**
+	 * Number of frames the ring of the given strategy may hold in this buffer pool.
+	 *
+	 * @param strategy	Access strategy
+	 * @return  				Ring size, capped to an eighth of the buffer pool
+	 */
+  std::uint32_t strategyRingSize(const BufferAccessStrategy* strategy) const;
+
+	/**
+	 * Return frames taken by reserveFrames() to the free list.
+	 *
+	 * @param pages   	Pages of the reserved frames
+	 * @param first   	Index in pages of the first frame to return; pages is cut to this size
+	 */
+  void unreserveFrames(std::vector<Page*>& pages, const std::size_t first);
+
+	/**
+	 * Evict the clock's victim: release the frame, and if there is a victim cache reserve room for its
+	 * page there and copy the page to pendingVictims, to be compressed once the latch is released.
+	 *
+	 * @param frame   	Frame number of the victim, frozen
+	 */
+  void evictBuf(const FrameId frame);
+
+	/**
+	 * Compress pages evicted into the victim cache and store them there.  Called without the mapping
+	 * latch, with the pages taken from pendingVictims while it was held.
+	 *
+	 * @param victims   	Pages to store; emptied
+	 */
+  void putVictims(std::vector<PendingVictim>& victims);
+
+	/**
+	 * Write back the page held by a frame if it is dirty and remove it from the buffer pool.
+	 *
+	 * @param frame   	Frame number of a frame frozen while unpinned
+	 */
+  void releaseBuf(const FrameId frame);
+
+	/**
+	 * Write the page held by a dirty frame to its file, after forcing the write-ahead log up to the
+	 * page's LSN.  Leaves the frame's flags alone.
+	 *
+	 * @param frame   	Frame number
+	 */
+  void writeBack(const FrameId frame);
+
+	/**
+	 * Write back the dirty pages of one file or of all of them for cleanPages() and cleanFile().
+	 *
+	 * @param file   	File whose pages to write, or NULL for all files
+	 * @param pace   	Called before each batch with the number of pages written so far
+	 * @param synced 	The files written to are appended to this vector, to be synced by the caller
+	 * @return  			Number of pages written
+	 */
+  std::uint32_t cleanFrames(const File* file, const std::function<void(std::uint32_t)>& pace,
+                            std::vector<File*>& synced);
+
+	/**
+	 * Write copies of a batch of dirty frames taken by cleanPages() and hand the frames back.
+	 *
+	 * @param frames   	Frames pinned by cleanPages(), whose DIRTY flag it cleared
+	 * @param copies   	Copies of their pages
+	 * @param files   	Files of their pages
+	 */
+  void writeCopies(const std::vector<FrameId>& frames, const std::vector<Page>& copies,
+                   const std::vector<File*>& files);
+
+	/**
+	 * Latch a frame pinned for a page guard.
+	 *
+	 * @param frame   	Frame number
+	 * @param exclusive	True to take the latch in exclusive mode
+	 */
+  void latchFrame(const FrameId frame, const bool exclusive);
+
+	/**
+	 * Unlatch and unpin a frame held by a page guard; an exclusive guard marks the page dirty.
+	 *
+	 * @param frame   	Frame number
+	 * @param exclusive	True if the latch is held in exclusive mode
+	 */
+  void releaseGuard(const FrameId frame, const bool exclusive);
+
+	/**
+	 * The part of readPage() for a page that is not in the buffer pool: under the exclusive mapping latch, claim
+	 * a frame for the page unless another thread has read it meanwhile, then read the page into the frame
+	 * without the latch, or pin the other thread's frame once its read is done.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @param strategy	Access strategy of the caller, or NULL
+	 * @param frame   	Frame reference, set to the frame of the page
+	 */
+  void readMiss(File* file, const PageId pageNo, BufferAccessStrategy* strategy, FrameId& frame);
+
+	/**
+	 * Allocate a frame for a page read on a miss and enter it in the hash table, pinned with I/O in progress.
+	 * Called with the mapping latch held exclusively.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @param strategy	Access strategy of the caller, or NULL
+	 * @param frame   	Frame reference, set to the frame claimed
+	 * @param logLsn  	Set as by allocBuf()
+	 * @return  				False as allocBuf()
+	 */
+  bool claimFrame(File* file, const PageId pageNo, BufferAccessStrategy* strategy, FrameId& frame, Lsn& logLsn);
+
+	/**
+	 * Verify the checksum of a pinned page read with lazy checksums, unless another reader has.  Concurrent
+	 * readers wait for the one that verifies.
+	 *
+	 * @param frame   	Frame number
+	 * @throws PageChecksumException If the page does not match its checksum; the frame is unpinned then
+	 */
+  void verifyFrame(const FrameId frame);
+
+	/**
+	 * Start an optimistic read of a page if the frame holds it and no write guard does.
+	 *
+	 * @param frame   	Frame number
+	 * @param fileId   	Id of the file of the page
+	 * @param pageNo  	Page number
+	 * @param version  	Frame and version of the read, set if it started
+	 * @return  				True if the read started
+	 */
+  bool startOptimistic(const FrameId frame, const FileId fileId, const PageId pageNo, PageVersion& version);
 
  public:
+	/**
+   * Number of dirty frames cleanPages() copies while it holds the mapping latch
+	 */
+  static const std::uint32_t CLEAN_BATCH = 8;
+
 	/**
    * Actual buffer pool from which frames are allocated
 	 */
@@ -210,7 +981,8 @@ class BufMgr
   BufMgr(std::uint32_t bufs);
 
 	/**
-   * Destructor of BufMgr class
+   * Destructor of BufMgr class: writes back the dirty pages.  A page that cannot be written is lost, and
+   * the others are still written.
 	 */
   ~BufMgr();
 
@@ -222,8 +994,67 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
 	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param strategy	Access strategy of the caller. If given, a page that is not in the buffer pool is read into a frame
+	 * 								of the strategy's ring, and the page is not marked as recently referenced.
+	 * @throws PageChecksumException If the page read from the file does not match its checksum
+	 */
+  void readPage(File* file, const PageId PageNo, Page*& page, BufferAccessStrategy* strategy = NULL);
+
+	/**
+	 * Reads the given page like readPage() and returns it pinned with the latch of its frame held in shared
+	 * mode.  The guard unlatches and unpins the page when it is destroyed.  Waits while a write guard of the
+	 * page is held.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param strategy	Access strategy of the caller, as for readPage()
+	 * @return  			Guard of the page
 	 */
-  void readPage(File* file, const PageId PageNo, Page*& page);
+  ReadPageGuard readPageShared(File* file, const PageId PageNo, BufferAccessStrategy* strategy = NULL);
+
+	/**
+	 * Reads the given page like readPage() and returns it pinned with the latch of its frame held in
+	 * exclusive mode.  The guard marks the page dirty, unlatches and unpins it when it is destroyed.  Waits
+	 * while other guards of the page are held.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param strategy	Access strategy of the caller, as for readPage()
+	 * @return  			Guard of the page
+	 */
+  WritePageGuard readPageExclusive(File* file, const PageId PageNo, BufferAccessStrategy* strategy = NULL);
+
+	/**
+	 * Starts an optimistic read of the given page, which neither pins the page nor takes a latch: as long as
+	 * the frame in version.frame still holds the page, nothing is written, so many threads can read a hot page
+	 * such as an index root without moving its cache lines.  Otherwise the page is looked up, or read into the
+	 * pool, first.  The page may be changed or evicted at any time during the read, so the reader must not
+	 * rely on anything it read, not even to follow an offset or throw an exception, until validatePage()
+	 * returns true; if it returns false, the reader starts over.
+	 *
+	 * Only changes made through write guards are noticed while they are made: pages read optimistically must
+	 * be written through readPageExclusive() or allocPageExclusive().  A page written through the Page* of
+	 * readPage() only gets a new version when unPinPage() marks it dirty, so a read validated before then may
+	 * have seen the write half done.  BTreeIndex and HashIndex write their pages that way, under latches of
+	 * their own, so their pages must not be read optimistically.  Optimistic reads are not counted in the
+	 * BufStats.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param version	Frame and version of the read.  Its frame is tried first, and both are set for
+	 * 								validatePage().
+	 * @return  			The page, to be read until validatePage()
+	 */
+  const Page* readPageOptimistic(File* file, const PageId PageNo, PageVersion& version);
+
+	/**
+	 * Checks that an optimistic read saw a consistent page: the frame has not been written, nor given another
+	 * page, since readPageOptimistic().
+	 *
+	 * @param version	Frame and version of the read
+	 * @return  			True if what was read since readPageOptimistic() holds
+	 */
+  bool validatePage(const PageVersion& version) const;
 
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
@@ -242,8 +1073,20 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
 	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 * @param strategy	Access strategy of the caller. If given, the page is assigned a frame of the strategy's ring.
 	 */
-  void allocPage(File* file, PageId &PageNo, Page*& page);
+  void allocPage(File* file, PageId &PageNo, Page*& page, BufferAccessStrategy* strategy = NULL);
+
+	/**
+	 * Allocates a new, empty page like allocPage() and returns it pinned with the latch of its frame held in
+	 * exclusive mode.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @param strategy	Access strategy of the caller, as for allocPage()
+	 * @return  			Guard of the page
+	 */
+  WritePageGuard allocPageExclusive(File* file, PageId &PageNo, BufferAccessStrategy* strategy = NULL);
 
 	/**
 	 * Writes out all dirty pages of the file to disk.
@@ -256,6 +1099,27 @@ class BufMgr
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Drops all pages of the file from the buffer pool without writing them, e.g. before the file is removed.
+	 * All the frames assigned to the file need to be unpinned.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+	 */
+  void invalidateFile(const File* file);
+
+	/**
+	 * Compacts the file with File::compact() and renumbers its pages in the buffer pool, so that they
+	 * stay cached.  Dirty pages of the file are written out first.  All the frames assigned to the file
+	 * need to be unpinned.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+	 */
+  void compactFile(File* file);
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
@@ -266,6 +1130,110 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Takes frames out of the buffer pool for the caller's own use, e.g. as work space of a sort or a join, so
+	 * that its memory is part of the pool's budget instead of coming on top of it.  The frames are emptied like
+	 * victims of the clock, writing back dirty pages, and then belong to the caller until it hands them back
+	 * with releaseFrames(); meanwhile the clock never picks them.
+	 *
+	 * @param count   	Number of frames
+	 * @param pages   	The Page objects of the frames are appended to this vector
+	 * @throws BufferExceededException If fewer than count frames can be taken; none are taken then
+	 */
+  void reserveFrames(const std::uint32_t count, std::vector<Page*>& pages);
+
+	/**
+	 * Returns frames taken with reserveFrames() to the buffer pool.
+	 *
+	 * @param pages   	Page objects of the frames
+	 * @throws BadBufferException If a page is not the page of a reserved frame
+	 */
+  void releaseFrames(const std::vector<Page*>& pages);
+
+	/**
+	 * Turn the TinyLFU admission filter on or off.  When it is on, every access is recorded in a
+	 * constant-size frequency sketch, and a page read on a miss only takes the frame of the clock's
+	 * victim if it has been accessed more often recently than the victim.  Other pages are read
+	 * into a small probationary window (1% of the pool) without evicting the victim.  A window page
+	 * only moves to the main pool if it is referenced again and has been seen more often than the
+	 * clock's victim by then.
+	 *
+	 * @param enable	True to turn the filter on
+	 */
+  void setAdmissionFilter(const bool enable);
+
+	/**
+	 * Choose when the checksums of pages read on a miss are verified.  By default File::readPage() verifies a
+	 * page while the mapping latch is held exclusively, so a corrupt page never enters the pool.  With lazy
+	 * checksums the page is read unverified and the first readPage() of it verifies it after the latch is
+	 * released, so that other misses and hits are not held up by the checksum.  Either way a page that does
+	 * not match its checksum is never handed out: readPage() throws PageChecksumException instead.
+	 *
+	 * @param enable	True to verify lazily
+	 */
+  void setLazyChecksums(const bool enable);
+
+	/**
+	 * Turn the victim cache on or off.  When it is on, pages the clock evicts are kept in memory, compressed,
+	 * and a page read on a miss is taken from there if it is found, without a disk read.  Pages recycled by
+	 * access strategies are not kept, so scans do not flush the cache.  Its hits, misses and compression
+	 * ratio are counted in the BufStats.  Turning it off, or on again, drops the pages it holds.
+	 *
+	 * @param bytes   	Compressed bytes the cache may hold, on top of the frames; 0 to turn it off
+	 */
+  void setVictimCache(const std::size_t bytes);
+
+	/**
+	 * Enforce the write-ahead rule with the given log: before a dirty page is written back, the log is
+	 * made durable up to the LSN in the page's header.  Pages never logged have LSN 0 and are written
+	 * as before.  The log must outlive the buffer manager, whose destructor writes back dirty pages.  Hits
+	 * read the log without the mapping latch, so it is set before other threads use the buffer manager.
+	 *
+	 * @param log   	Write-ahead log, or NULL to write pages back without forcing a log
+	 */
+  void setLogManager(LogManager* log);
+
+	/**
+	 * Collect the pages that are dirty in the buffer pool, each with a lower bound of the LSN of its
+	 * first update that has not been written back, for a checkpoint.
+	 *
+	 * @param pages   	The dirty pages are appended to this vector
+	 */
+  void dirtyPageTable(std::vector<LogManager::DirtyPage>& pages);
+
+	/**
+	 * Write back the dirty pages in file and page order without evicting them, e.g. for a checkpoint.  A
+	 * batch of dirty frames at a time is copied and marked clean under the mapping latch, and the copies
+	 * are written after it is released, so readers and writers of the pages go on meanwhile; a page
+	 * changed again turns dirty again.  A pinned frame is copied under its frame latch in shared mode if all
+	 * its pins belong to page guards and none of them writes; other pinned frames may be in the middle of
+	 * an update, so they are skipped and looked at once more at the end.  The files written to are synced
+	 * before returning.
+	 *
+	 * @param pace   	Called before each batch with the number of pages written so far; it may sleep to
+	 * 					throttle the writes
+	 * @return  			Number of pages written
+	 */
+  std::uint32_t cleanPages(const std::function<void(std::uint32_t)>& pace);
+
+	/**
+	 * Write back the dirty pages of the file without evicting them, like cleanPages() but without syncing
+	 * the file, so that reading the file directly sees the changes made in the buffer pool, e.g. before a
+	 * sort or scan.  Pinned pages that may be in the middle of an update are skipped.
+	 *
+	 * @param file   	File object
+	 * @return  			Number of pages written
+	 */
+  std::uint32_t cleanFile(const File* file);
+
+	/**
+   * Number of frames in the buffer pool.
+	 */
+  std::uint32_t frameCount() const
+  {
+		return numBufs;
+  }
+
+	/**
    * Print member variable values.
 	 */
   void  printSelf();
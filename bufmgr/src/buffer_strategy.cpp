@@ -0,0 +1,32 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "buffer_strategy.h"
+
+namespace badgerdb {
+
+BufferAccessStrategy::BufferAccessStrategy(const Type type,
+                                           const std::uint32_t ringSize)
+    : type_(type),
+      ring_size_(ringSize),
+      current_(0) {
+  if (ring_size_ == 0) {
+    switch (type_) {
+      case BULKREAD:
+        ring_size_ = BULKREAD_RING_SIZE;
+        break;
+      case BULKWRITE:
+        ring_size_ = BULKWRITE_RING_SIZE;
+        break;
+      case VACUUM:
+        ring_size_ = VACUUM_RING_SIZE;
+        break;
+    }
+  }
+}
+
+}
@@ -0,0 +1,135 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+* forward declaration of BufMgr class
+*/
+class BufMgr;
+
+/**
+ * @brief Per-caller buffer access strategy which confines an operation to a
+ *        small private ring of frames.
+ *
+ * Large sequential operations (full scans, bulk loads, vacuum-style rewrites)
+ * touch every page exactly once.  Reading them through the normal clock sets
+ * the reference bit of each page and flushes the working set of everybody
+ * else out of the buffer pool.  A caller that passes a strategy to
+ * BufMgr::readPage() or BufMgr::allocPage() instead recycles the frames of its
+ * own ring: pages it brings in are not marked as referenced, and once the ring
+ * is full the oldest of its frames is reused for the next page.
+ *
+ * A strategy object belongs to a single caller and a single BufMgr.
+ *
+ * @warning This class is not threadsafe.
+ */
+class BufferAccessStrategy {
+ public:
+  /**
+   * Kind of operation the strategy is used for.  The kind only decides the
+   * default ring size.
+   */
+  enum Type {
+    /**
+     * Large sequential read, e.g. a full scan through a file.
+     */
+    BULKREAD,
+
+    /**
+     * Bulk load of new pages through BufMgr::allocPage().
+     */
+    BULKWRITE,
+
+    /**
+     * Read-modify-write pass over every page of a file.
+     */
+    VACUUM
+  };
+
+  /**
+   * Default ring size, in frames, of BULKREAD strategies (256 KB of pages).
+   */
+  static const std::uint32_t BULKREAD_RING_SIZE = 32;
+
+  /**
+   * Default ring size, in frames, of BULKWRITE strategies (16 MB of pages).
+   * Writes need a bigger ring so that dirty frames are not written back one
+   * at a time.
+   */
+  static const std::uint32_t BULKWRITE_RING_SIZE = 2048;
+
+  /**
+   * Default ring size, in frames, of VACUUM strategies (256 KB of pages).
+   */
+  static const std::uint32_t VACUUM_RING_SIZE = 32;
+
+  /**
+   * Constructs a strategy of the given kind.
+   *
+   * @param type      Kind of operation.
+   * @param ringSize  Number of frames in the ring, or 0 for the default of the
+   *                  given kind.  BufMgr never lets a ring grow past an eighth
+   *                  of its pool.
+   */
+  explicit BufferAccessStrategy(const Type type,
+                                const std::uint32_t ringSize = 0);
+
+  /**
+   * Returns the kind of operation this strategy is used for.
+   *
+   * @return  Kind of operation.
+   */
+  Type type() const { return type_; }
+
+  /**
+   * Returns the requested number of frames in the ring.
+   *
+   * @return  Requested ring size.
+   */
+  std::uint32_t ringSize() const { return ring_size_; }
+
+ private:
+  /**
+   * Kind of operation this strategy is used for.
+   */
+  Type type_;
+
+  /**
+   * Requested number of frames in the ring.
+   */
+  std::uint32_t ring_size_;
+
+  /**
+   * Frames currently owned by the ring.  Grows until the ring is full.
+   */
+  std::vector<FrameId> ring_;
+
+  /**
+   * Position in <ring_> of each frame it holds.  A frame that left the ring
+   * through the free list can come back to it, and must not take a second
+   * slot.
+   */
+  std::unordered_map<FrameId, std::uint32_t> positions_;
+
+  /**
+   * Position in <ring_> of the frame handed out last.
+   */
+  std::uint32_t current_;
+
+  friend class BufMgr;
+};
+
+}
@@ -0,0 +1,73 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Allocator handing out memory aligned to CACHE_LINE_SIZE.
+ *
+ * Before C++17, std::allocator only guarantees the alignment of the
+ * fundamental types, so a std::vector of a type declared
+ * alignas(CACHE_LINE_SIZE) needs this allocator for its elements to
+ * actually start on cache lines of their own.
+ */
+template <typename T>
+class CacheAlignedAllocator {
+ public:
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind {
+    typedef CacheAlignedAllocator<U> other;
+  };
+
+  CacheAlignedAllocator() {}
+
+  template <typename U>
+  CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+  /**
+   * Allocates memory for <count> objects, starting on a cache line.
+   *
+   * @throws  std::bad_alloc  If no memory is left.
+   */
+  T* allocate(const std::size_t count) {
+    void* memory;
+    if (posix_memalign(&memory, CACHE_LINE_SIZE, count * sizeof(T)) != 0) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(memory);
+  }
+
+  /**
+   * Frees memory returned by allocate().
+   */
+  void deallocate(T* memory, const std::size_t) {
+    std::free(memory);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const CacheAlignedAllocator<T>&,
+                const CacheAlignedAllocator<U>&) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const CacheAlignedAllocator<T>&,
+                const CacheAlignedAllocator<U>&) {
+  return false;
+}
+
+}
@@ -0,0 +1,99 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "checkpointer.h"
+
+#include <vector>
+
+namespace badgerdb {
+
+Checkpointer::Checkpointer(BufMgr* buf_mgr, LogManager* log,
+                           const unsigned int interval_ms,
+                           const unsigned int pages_per_second)
+    : buf_mgr_(buf_mgr),
+      log_(log),
+      interval_(interval_ms),
+      pages_per_second_(pages_per_second),
+      stop_(false),
+      checkpoints_(0),
+      pages_written_(0) {
+  if (interval_ms > 0) {
+    thread_ = std::thread(&Checkpointer::run, this);
+  }
+}
+
+Checkpointer::~Checkpointer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  stop_cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+Lsn Checkpointer::checkpoint() {
+  std::lock_guard<std::mutex> checkpoint_lock(checkpoint_mutex_);
+
+  // Updates logged from <start> on are found by recovery in the log; those
+  // before it are on disk or on a page collected after the write-back.
+  const Lsn start = log_->nextLsn();
+  const std::chrono::steady_clock::time_point started =
+      std::chrono::steady_clock::now();
+  const std::uint32_t written = buf_mgr_->cleanPages(
+      [this, started](const std::uint32_t written) { pace(started, written); });
+  std::vector<LogManager::DirtyPage> dirty_pages;
+  buf_mgr_->dirtyPageTable(dirty_pages);
+  const Lsn lsn = log_->logCheckpoint(start, dirty_pages);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  checkpoints_++;
+  pages_written_ += written;
+  return lsn;
+}
+
+std::uint64_t Checkpointer::checkpoints() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return checkpoints_;
+}
+
+std::uint64_t Checkpointer::pagesWritten() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pages_written_;
+}
+
+void Checkpointer::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_cv_.wait_for(lock, interval_, [this]() { return stop_; })) {
+    lock.unlock();
+    try {
+      checkpoint();
+    } catch (...) {
+      // A page or the log could not be written; the next checkpoint tries again, and
+      // recovery starts at the last one that succeeded.
+    }
+    lock.lock();
+  }
+}
+
+void Checkpointer::pace(const std::chrono::steady_clock::time_point start,
+                        const std::uint32_t written) {
+  if (pages_per_second_ == 0) {
+    return;
+  }
+  // Once stopped, the rest of the checkpoint goes at full speed so that the
+  // destructor does not wait for it.
+  const std::chrono::steady_clock::time_point due =
+      start + std::chrono::microseconds(
+                  static_cast<std::uint64_t>(written) * 1000000 /
+                  pages_per_second_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  stop_cv_.wait_until(lock, due, [this]() { return stop_; });
+}
+
+}
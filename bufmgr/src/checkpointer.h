@@ -0,0 +1,125 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "buffer.h"
+#include "log_manager.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Takes fuzzy checkpoints of a buffer pool and its write-ahead log.
+ *
+ * A checkpoint notes the end of the log, writes back the pages dirty in the
+ * buffer pool in file and page order without evicting them
+ * (BufMgr::cleanPages()), collects the pages still or again dirty with
+ * BufMgr::dirtyPageTable(), and logs them together with the running
+ * transactions (LogManager::logCheckpoint()).  Nothing waits for it:
+ * transactions keep running, and pages keep being updated, while it is
+ * taken.  Recovery then starts reading the log at the last checkpoint
+ * instead of at the beginning, and redoes updates from the oldest update of
+ * a page that was dirty at the checkpoint on; writing the pages back keeps
+ * that update recent.
+ *
+ * The writes may be limited to a number of pages per second, so that a
+ * checkpoint spreads them out instead of taking the disk from the
+ * foreground in a burst.
+ *
+ * Checkpoints are taken on demand with checkpoint(), and by a background
+ * thread at a fixed interval if one is given.
+ */
+class Checkpointer {
+ public:
+  /**
+   * Constructs a checkpointer, starting its background thread if an
+   * interval is given.
+   *
+   * @param buf_mgr     Buffer manager whose dirty pages are collected.
+   * @param log         Write-ahead log the buffer manager enforces.
+   * @param interval_ms Milliseconds between background checkpoints; 0 for
+   *                    none.
+   * @param pages_per_second  Pages a checkpoint writes back per second at
+   *                    most; 0 for no limit.
+   */
+  Checkpointer(BufMgr* buf_mgr, LogManager* log,
+               const unsigned int interval_ms,
+               const unsigned int pages_per_second = 0);
+
+  /**
+   * Stops the background thread.
+   */
+  ~Checkpointer();
+
+  /**
+   * Takes a checkpoint.
+   *
+   * @return  LSN of the checkpoint record.
+   * @throws  FileIOException  If a page or the log cannot be written or
+   *                           synced.
+   */
+  Lsn checkpoint();
+
+  /**
+   * Returns the number of checkpoints taken.
+   */
+  std::uint64_t checkpoints() const;
+
+  /**
+   * Returns the number of pages the checkpoints have written back.
+   */
+  std::uint64_t pagesWritten() const;
+
+ private:
+  Checkpointer(const Checkpointer&);
+  Checkpointer& operator=(const Checkpointer&);
+
+  /**
+   * Body of the background thread.
+   */
+  void run();
+
+  /**
+   * Sleeps until <written> pages are due since <start>, or until stopped.
+   */
+  void pace(const std::chrono::steady_clock::time_point start,
+            const std::uint32_t written);
+
+  BufMgr* buf_mgr_;
+  LogManager* log_;
+  std::chrono::milliseconds interval_;
+  unsigned int pages_per_second_;
+
+  /**
+   * Serializes checkpoints.
+   */
+  std::mutex checkpoint_mutex_;
+
+  /**
+   * Protects the members below.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Signalled to stop the background thread.
+   */
+  std::condition_variable stop_cv_;
+  bool stop_;
+
+  std::uint64_t checkpoints_;
+  std::uint64_t pages_written_;
+
+  std::thread thread_;
+};
+
+}
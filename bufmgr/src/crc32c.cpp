@@ -0,0 +1,202 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Reflected CRC-32C polynomial.
+ */
+const std::uint32_t POLYNOMIAL = 0x82f63b78;
+
+/**
+ * Tables of slicing-by-8: table[k][b] is the CRC of byte b followed by k
+ * zero bytes.
+ */
+struct Tables {
+  std::uint32_t table[8][256];
+
+  Tables() {
+    for (std::uint32_t b = 0; b < 256; ++b) {
+      std::uint32_t crc = b;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (POLYNOMIAL & (0 - (crc & 1)));
+      }
+      table[0][b] = crc;
+    }
+    for (std::uint32_t b = 0; b < 256; ++b) {
+      for (int k = 1; k < 8; ++k) {
+        table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+      }
+    }
+  }
+};
+
+std::uint32_t extendTables(std::uint32_t crc, const unsigned char* p,
+                           std::size_t length) {
+  // built on first use, so that checksums work during static initialization
+  static const Tables tables;
+  const std::uint32_t (*t)[256] = tables.table;
+  for (; length >= 8; p += 8, length -= 8) {
+    std::uint32_t low;
+    std::uint32_t high;
+    std::memcpy(&low, p, 4);
+    std::memcpy(&high, p + 4, 4);
+    low ^= crc;
+    crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^
+          t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+          t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^
+          t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+  }
+  for (; length > 0; ++p, --length) {
+    crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+
+/**
+ * Bytes of each of the three streams that the CRC instruction works on at
+ * once.
+ */
+const std::size_t STRIPE = 256;
+
+/**
+ * Tables that advance a CRC over STRIPE zero bytes, one per byte of the CRC.
+ * The step is linear, so the CRC of a stripe following others is the
+ * advanced CRC of those, xor the CRC of the stripe alone.
+ */
+struct ShiftTables {
+  std::uint32_t table[4][256];
+
+  ShiftTables() {
+    for (int k = 0; k < 4; ++k) {
+      for (std::uint32_t b = 0; b < 256; ++b) {
+        std::uint32_t crc = b << (8 * k);
+        for (std::size_t i = 0; i < STRIPE; ++i) {
+          for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (POLYNOMIAL & (0 - (crc & 1)));
+          }
+        }
+        table[k][b] = crc;
+      }
+    }
+  }
+
+  std::uint32_t shift(const std::uint32_t crc) const {
+    return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^
+           table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+  }
+};
+
+__attribute__((target("sse4.2")))
+std::uint32_t extendHardware(std::uint32_t crc, const unsigned char* p,
+                             std::size_t length) {
+  // The instruction takes three cycles but can start one every cycle, so
+  // three independent stripes keep it busy.
+  static const ShiftTables shifts;
+  for (; length >= 3 * STRIPE; p += 3 * STRIPE, length -= 3 * STRIPE) {
+    std::uint64_t a = crc;
+    std::uint64_t b = 0;
+    std::uint64_t c = 0;
+    for (std::size_t i = 0; i < STRIPE; i += 8) {
+      std::uint64_t word;
+      std::memcpy(&word, p + i, 8);
+      a = _mm_crc32_u64(a, word);
+      std::memcpy(&word, p + STRIPE + i, 8);
+      b = _mm_crc32_u64(b, word);
+      std::memcpy(&word, p + 2 * STRIPE + i, 8);
+      c = _mm_crc32_u64(c, word);
+    }
+    crc = shifts.shift(shifts.shift(static_cast<std::uint32_t>(a)) ^
+                       static_cast<std::uint32_t>(b)) ^
+          static_cast<std::uint32_t>(c);
+  }
+
+  std::uint64_t crc64 = crc;
+  for (; length >= 8; p += 8, length -= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p, 8);
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<std::uint32_t>(crc64);
+  for (; length > 0; ++p, --length) {
+    crc = _mm_crc32_u8(crc, *p);
+  }
+  return crc;
+}
+
+bool detectHardware() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+
+std::uint32_t extendHardware(std::uint32_t crc, const unsigned char* p,
+                             std::size_t length) {
+  for (; length >= 8; p += 8, length -= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p, 8);
+    crc = __crc32cd(crc, word);
+  }
+  for (; length > 0; ++p, --length) {
+    crc = __crc32cb(crc, *p);
+  }
+  return crc;
+}
+
+bool detectHardware() {
+  return true;
+}
+
+#else
+
+std::uint32_t extendHardware(std::uint32_t crc, const unsigned char* p,
+                             std::size_t length) {
+  return extendTables(crc, p, length);
+}
+
+bool detectHardware() {
+  return false;
+}
+
+#endif
+
+}
+
+std::uint32_t Crc32c::extend(const std::uint32_t crc, const void* data,
+                             const std::size_t length) {
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  return ~(hardware() ? extendHardware(~crc, p, length)
+                      : extendTables(~crc, p, length));
+}
+
+std::uint32_t Crc32c::extendSoftware(const std::uint32_t crc,
+                                     const void* data,
+                                     const std::size_t length) {
+  return ~extendTables(~crc, static_cast<const unsigned char*>(data), length);
+}
+
+bool Crc32c::hardware() {
+  static const bool hardware = detectHardware();
+  return hardware;
+}
+
+}
@@ -0,0 +1,65 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief CRC-32C (Castagnoli), the checksum of database pages.
+ *
+ * Computed with the CRC32 instruction of SSE4.2 on x86-64 processors that
+ * have it, which is checked once at startup, over three interleaved stripes
+ * whose CRCs are then combined, and with that of ARMv8 when the
+ * compiler targets it.  Otherwise a table-driven version that consumes eight
+ * bytes per step (slicing-by-8) is used.  Both give the same results.
+ */
+class Crc32c {
+ public:
+  /**
+   * Returns the CRC of the given bytes.
+   *
+   * @param data    Bytes to checksum.
+   * @param length  Number of bytes.
+   * @return  CRC-32C of the bytes.
+   */
+  static std::uint32_t compute(const void* data, const std::size_t length) {
+    return extend(0, data, length);
+  }
+
+  /**
+   * Returns the CRC of some bytes followed by the given ones, so that a
+   * checksum can be computed piece by piece.
+   *
+   * @param crc     CRC of the bytes before; 0 for none.
+   * @param data    Bytes to append.
+   * @param length  Number of bytes.
+   * @return  CRC-32C of all bytes.
+   */
+  static std::uint32_t extend(const std::uint32_t crc, const void* data,
+                              const std::size_t length);
+
+  /**
+   * Like extend(), but always with the table-driven version.
+   */
+  static std::uint32_t extendSoftware(const std::uint32_t crc,
+                                      const void* data,
+                                      const std::size_t length);
+
+  /**
+   * Returns true if extend() uses CRC instructions of the processor.
+   */
+  static bool hardware();
+
+ private:
+  Crc32c();
+};
+
+}
@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bad_file_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+BadFileException::BadFileException(const std::string& name,
+                                   const std::string& problem)
+    : BadgerDbException(""), filename_(name) {
+  std::stringstream ss;
+  ss << "Bad file '" << filename_ << "': " << problem;
+  message_.assign(ss.str());
+}
+
+}
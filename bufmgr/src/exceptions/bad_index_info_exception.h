@@ -0,0 +1,31 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when an index is used in a way that
+ *        does not match how it was built, e.g. with a key of the wrong type
+ *        or on a file that does not hold an index of that kind.
+ */
+class BadIndexInfoException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a bad index info exception with the given reason.
+   *
+   * @param reason  What does not match.
+   */
+  explicit BadIndexInfoException(const std::string& reason);
+};
+
+}
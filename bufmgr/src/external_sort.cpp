@@ -0,0 +1,352 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "external_sort.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <memory>
+
+namespace badgerdb {
+
+const std::uint32_t ExternalSort::MIN_BUDGET_FRAMES;
+const std::uint32_t ExternalSort::READ_AHEAD_PAGES;
+const std::uint32_t ExternalSort::WRITE_PAGES;
+
+ExternalSort::ExternalSort(BufMgr* buf_mgr, const std::uint32_t budget_frames,
+                           const unsigned int threads, const RecordLess& less)
+    : buf_mgr_(buf_mgr),
+      budget_frames_(std::max(budget_frames, MIN_BUDGET_FRAMES)),
+      threads_(std::max(threads, 1u)),
+      less_(less),
+      input_(NULL),
+      input_filter_(NULL),
+      emit_(NULL),
+      input_pages_(0),
+      next_input_page_(0),
+      runs_formed_(0),
+      merges_(0),
+      pages_written_(0) {
+}
+
+void ExternalSort::sort(File* input, const RecordCallback& emit,
+                        const PageFilter& pages) {
+  // Pages changed in the pool are read from the file below.
+  buf_mgr_->cleanFile(input);
+  input_ = input;
+  input_filter_ = &pages;
+  emit_ = &emit;
+  input_pages_ = input->pageCount();
+  next_input_page_ = 1;
+  runs_.clear();
+  spills_.reset(input->filename() + ".sort.");
+  runs_formed_ = 0;
+  merges_ = 0;
+  pages_written_ = 0;
+
+  std::vector<Page*> frames;
+  buf_mgr_->reserveFrames(budget_frames_, frames);
+  try {
+    if (input_pages_ <= frames.size() + 1) {
+      // Everything fits: one read, one sort.
+      const PageId count = input_pages_ > 0 ? input_pages_ - 1 : 0;
+      std::vector<Record> records;
+      if (count > 0) {
+        input_->readPages(1, count, &frames[0]);
+        SpillFiles::collect(&frames[0], count, pages, records);
+      }
+      sortRecords(records);
+      std::string scratch;
+      for (std::size_t i = 0; i < records.size(); ++i) {
+        scratch.assign(records[i].data, records[i].length);
+        emit(scratch);
+      }
+    } else {
+      sortExternally(frames);
+    }
+  } catch (...) {
+    runs_.clear();
+    spills_.removeAll();
+    buf_mgr_->releaseFrames(frames);
+    throw;
+  }
+  buf_mgr_->releaseFrames(frames);
+}
+
+void ExternalSort::sortExternally(const std::vector<Page*>& frames) {
+  // Each thread forms runs in its own share of the frames, which must leave
+  // room for at least one input and one output frame.
+  const std::size_t threads =
+      std::max<std::size_t>(1, std::min<std::size_t>(
+          threads_, frames.size() / MIN_BUDGET_FRAMES));
+  const std::size_t share = frames.size() / threads;
+  std::vector<std::vector<Page*> > shares(threads);
+  std::vector<std::future<void> > workers;
+  for (std::size_t t = 0; t < threads; ++t) {
+    shares[t].assign(frames.begin() + t * share,
+                     frames.begin() + (t + 1) * share);
+    workers.push_back(std::async(std::launch::async, &ExternalSort::formRuns,
+                                 this, std::cref(shares[t])));
+  }
+  // Let every worker stop before passing on the first failure.
+  std::exception_ptr error;
+  for (std::size_t t = 0; t < workers.size(); ++t) {
+    try {
+      workers[t].get();
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  runs_formed_ = runs_.size();
+  if (runs_.empty()) {
+    return;
+  }
+
+  // Every run being merged needs two frames; a merge into a new run also
+  // needs frames to write from.
+  const std::uint32_t write_frames = writeFrames(frames.size());
+  const std::size_t final_fan_in = frames.size() / 2;
+  const std::size_t fan_in = (frames.size() - write_frames) / 2;
+  while (runs_.size() > final_fan_in) {
+    // Merge just enough of the shortest runs that the rest and the result
+    // fit into the final merge; the other runs are not read again.
+    std::sort(runs_.begin(), runs_.end(),
+              [](const Run& a, const Run& b) { return a.pages < b.pages; });
+    const std::size_t excess = runs_.size() - final_fan_in;
+    const std::size_t count = std::min(fan_in, excess + 1);
+    std::vector<Run> group(runs_.begin(), runs_.begin() + count);
+    runs_.erase(runs_.begin(), runs_.begin() + count);
+    runs_.push_back(merge(group, frames, spills_.next()));
+  }
+  merge(runs_, frames, std::string());
+  runs_.clear();
+}
+
+std::uint32_t ExternalSort::writeFrames(const std::size_t frames) {
+  return std::max<std::uint32_t>(
+      1, std::min<std::size_t>(WRITE_PAGES, frames / MIN_BUDGET_FRAMES));
+}
+
+bool ExternalSort::less(const Record& a, const Record& b) const {
+  if (less_) {
+    return less_(a.data, a.length, b.data, b.length);
+  }
+  const int order = std::memcmp(a.data, b.data, std::min(a.length, b.length));
+  return order < 0 || (order == 0 && a.length < b.length);
+}
+
+void ExternalSort::sortRecords(std::vector<Record>& records) const {
+  std::sort(records.begin(), records.end(),
+            [this](const Record& a, const Record& b) { return less(a, b); });
+}
+
+void ExternalSort::formRuns(const std::vector<Page*>& frames) {
+  const std::uint32_t write_frames = writeFrames(frames.size());
+  const PageId input_frames = frames.size() - write_frames;
+  const std::vector<Page*> output(frames.begin() + input_frames, frames.end());
+  std::vector<Record> records;
+  for (;;) {
+    const PageId first = next_input_page_.fetch_add(input_frames);
+    if (first >= input_pages_) {
+      return;
+    }
+    const PageId count = std::min(input_frames, input_pages_ - first);
+    input_->readPages(first, count, &frames[0]);
+    records.clear();
+    SpillFiles::collect(&frames[0], count, *input_filter_, records);
+    if (records.empty()) {
+      continue;
+    }
+    sortRecords(records);
+
+    RunWriter writer(spills_.next(), output);
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      writer.add(records[i].data, records[i].length);
+    }
+    const Run run = writer.finish();
+    pages_written_ += run.pages;
+    std::lock_guard<std::mutex> lock(runs_mutex_);
+    runs_.push_back(run);
+  }
+}
+
+ExternalSort::Run ExternalSort::merge(const std::vector<Run>& runs,
+                                      const std::vector<Page*>& frames,
+                                      const std::string& output) {
+  const std::size_t k = runs.size();
+  ++merges_;
+  const std::size_t write_frames = output.empty() ? 0 : writeFrames(frames.size());
+  const std::size_t run_frames = std::min<std::size_t>(
+      2 * READ_AHEAD_PAGES, (frames.size() - write_frames) / k);
+
+  std::unique_ptr<RunWriter> writer;
+  if (!output.empty()) {
+    writer.reset(new RunWriter(
+        output, std::vector<Page*>(frames.end() - write_frames, frames.end())));
+  }
+  std::vector<std::unique_ptr<RunReader> > readers(k);
+  for (std::size_t i = 0; i < k; ++i) {
+    readers[i].reset(new RunReader(
+        runs[i], std::vector<Page*>(frames.begin() + i * run_frames,
+                                    frames.begin() + (i + 1) * run_frames)));
+  }
+
+  // Returns true if run a holds the next record rather than run b; a run
+  // with no records left never does.
+  auto wins = [this, &readers](const std::size_t a, const std::size_t b) {
+    if (readers[a]->done()) {
+      return false;
+    }
+    if (readers[b]->done()) {
+      return true;
+    }
+    return !less(readers[b]->record(), readers[a]->record());
+  };
+
+  // Loser tree: the runs are the leaves k..2k-1 of a binary tree whose inner
+  // node n holds the run that lost the match at n, and losers[0] the overall
+  // winner.  Replacing the winner's record replays only the matches on its
+  // path to the root.
+  std::vector<std::size_t> losers(k);
+  {
+    std::vector<std::size_t> winners(2 * k);
+    for (std::size_t i = 0; i < k; ++i) {
+      winners[k + i] = i;
+    }
+    for (std::size_t n = k - 1; n >= 1; --n) {
+      const std::size_t left = winners[2 * n];
+      const std::size_t right = winners[2 * n + 1];
+      const bool left_wins = wins(left, right);
+      winners[n] = left_wins ? left : right;
+      losers[n] = left_wins ? right : left;
+    }
+    losers[0] = winners[1];
+  }
+
+  std::string scratch;
+  for (;;) {
+    std::size_t winner = losers[0];
+    RunReader& reader = *readers[winner];
+    if (reader.done()) {
+      break;
+    }
+    const Record& record = reader.record();
+    if (writer) {
+      writer->add(record.data, record.length);
+    } else {
+      scratch.assign(record.data, record.length);
+      (*emit_)(scratch);
+    }
+    reader.advance();
+    for (std::size_t n = (winner + k) / 2; n >= 1; n /= 2) {
+      if (wins(losers[n], winner)) {
+        std::swap(losers[n], winner);
+      }
+    }
+    losers[0] = winner;
+  }
+
+  readers.clear();
+  for (std::size_t i = 0; i < k; ++i) {
+    File::remove(runs[i].filename);
+  }
+  Run run = {std::string(), 0};
+  if (writer) {
+    run = writer->finish();
+    pages_written_ += run.pages;
+  }
+  return run;
+}
+
+ExternalSort::RunReader::RunReader(const Run& run,
+                                   const std::vector<Page*>& frames)
+    : file_(File::open(run.filename)),
+      num_pages_(run.pages + 1),
+      block_pages_(frames.size() / 2),
+      next_to_read_(1),
+      current_(0),
+      page_(0),
+      slot_(0),
+      has_pending_(false),
+      done_(false) {
+  for (int i = 0; i < 2; ++i) {
+    blocks_[i].assign(frames.begin() + i * block_pages_,
+                      frames.begin() + (i + 1) * block_pages_);
+    block_count_[i] = 0;
+  }
+  fill(0, next_to_read_);
+  next_to_read_ += block_count_[0];
+  prefetch();
+  record_.data = NULL;
+  record_.length = 0;
+  advance();
+}
+
+ExternalSort::RunReader::~RunReader() {
+  if (has_pending_) {
+    pending_.wait();
+  }
+}
+
+void ExternalSort::RunReader::advance() {
+  for (;;) {
+    if (page_ < block_count_[current_]) {
+      const Page* page = blocks_[current_][page_];
+      while (slot_ < page->slotCount()) {
+        if (page->getRecordBytes(++slot_, record_.data, record_.length)) {
+          return;
+        }
+      }
+      ++page_;
+      slot_ = 0;
+    } else if (!nextBlock()) {
+      done_ = true;
+      return;
+    }
+  }
+}
+
+void ExternalSort::RunReader::fill(const int block,
+                                   const PageId first_page_number) {
+  const PageId count = std::min(block_pages_, num_pages_ - first_page_number);
+  file_.readPages(first_page_number, count, &blocks_[block][0]);
+  block_count_[block] = count;
+}
+
+void ExternalSort::RunReader::prefetch() {
+  if (next_to_read_ >= num_pages_) {
+    return;
+  }
+  const int other = 1 - current_;
+  // Invalidate the block first, so that it is not used if the read fails.
+  block_count_[other] = 0;
+  pending_ = std::async(std::launch::async, &RunReader::fill, this, other,
+                        next_to_read_);
+  has_pending_ = true;
+  next_to_read_ += std::min(block_pages_, num_pages_ - next_to_read_);
+}
+
+bool ExternalSort::RunReader::nextBlock() {
+  if (!has_pending_) {
+    return false;
+  }
+  has_pending_ = false;
+  pending_.get();
+  current_ = 1 - current_;
+  page_ = 0;
+  slot_ = 0;
+  prefetch();
+  return true;
+}
+
+}
@@ -0,0 +1,308 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "spill_files.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Sorts the records of a file of any size within a fixed memory
+ *        budget.
+ *
+ * The memory of a sort is a number of frames taken out of the buffer pool
+ * with BufMgr::reserveFrames() for the duration of sort(), so sorting does
+ * not need memory on top of the pool, and the pool cannot evict it.
+ *
+ * If the records fit into the budget, they are sorted in memory.  Otherwise
+ * the sort first forms runs: each of several threads reads as many pages of
+ * the input as its share of the frames holds, sorts their records and
+ * writes them as a run to a temporary file.  The runs are then merged with a
+ * loser tree, which takes about log2(runs) comparisons per record.  Each run
+ * being merged has two blocks of frames: while the records of one are
+ * merged, the next pages of the run are read into the other in the
+ * background.  If there are more runs than the budget can merge at once,
+ * groups of them are first merged into longer runs.
+ *
+ * Temporary files are named after the input file and removed when the sort
+ * ends.
+ *
+ * @warning This class is not threadsafe; one sort() runs at a time.
+ */
+class ExternalSort {
+ public:
+  /**
+   * Returns true if record a sorts before record b.
+   */
+  typedef std::function<bool(const char* a, std::size_t a_length,
+                             const char* b, std::size_t b_length)> RecordLess;
+
+  /**
+   * Receives the records in order.
+   */
+  typedef std::function<void(const std::string& record)> RecordCallback;
+
+  /**
+   * Returns true if the page with the given number holds records to sort;
+   * e.g. HeapFile::isDataPage().
+   */
+  typedef SpillFiles::PageFilter PageFilter;
+
+  /**
+   * Smallest budget, in frames, that a sort works with.
+   */
+  static const std::uint32_t MIN_BUDGET_FRAMES = 8;
+
+  /**
+   * Pages read ahead per run while merging, if the budget allows.
+   */
+  static const std::uint32_t READ_AHEAD_PAGES = 8;
+
+  /**
+   * Frames a run is written from at a time, if the budget allows.
+   */
+  static const std::uint32_t WRITE_PAGES = 8;
+
+  /**
+   * Constructs a sort.
+   *
+   * @param buf_mgr       Buffer manager to take the frames from.
+   * @param budget_frames Number of frames to sort in; at least
+   *                      MIN_BUDGET_FRAMES are used.
+   * @param threads       Number of threads forming runs.
+   * @param less          Order of the records; bytewise if empty.
+   */
+  ExternalSort(BufMgr* buf_mgr, const std::uint32_t budget_frames,
+               const unsigned int threads = 1,
+               const RecordLess& less = RecordLess());
+
+  /**
+   * Sorts the records of a file and hands them to a callback in order.
+   *
+   * @param input File to sort; its dirty pages in the buffer pool are
+   *              written out first, as the file is then read directly.
+   * @param emit  Called for each record, in order.
+   * @param pages Pages to read records from; every used page if empty.
+   * @throws  BufferExceededException If the budget cannot be taken from the
+   *                                  buffer pool.
+   */
+  void sort(File* input, const RecordCallback& emit,
+            const PageFilter& pages = PageFilter());
+
+  /**
+   * Returns the number of runs formed by the last sort; 0 if it sorted in
+   * memory.
+   */
+  std::uint32_t runs() const { return runs_formed_; }
+
+  /**
+   * Returns the number of merges made by the last sort, including the final
+   * one; more than one if there were more runs than the budget can merge at
+   * once.
+   */
+  std::uint32_t merges() const { return merges_; }
+
+  /**
+   * Returns the number of pages written to runs by the last sort.
+   */
+  std::uint64_t pagesWritten() const { return pages_written_; }
+
+ private:
+  ExternalSort(const ExternalSort&);
+  ExternalSort& operator=(const ExternalSort&);
+
+  typedef SpillFiles::Record Record;
+  typedef SpillFiles::Spill Run;
+  typedef SpillFiles::Writer RunWriter;
+
+  /**
+   * Reads the records of a run in order, reading ahead in the background.
+   */
+  class RunReader {
+   public:
+    /**
+     * Opens a run and starts reading its first blocks.
+     *
+     * @param run     Run to read.
+     * @param frames  Frames to read into; two blocks of half of them each.
+     */
+    RunReader(const Run& run, const std::vector<Page*>& frames);
+
+    /**
+     * Waits for a read in progress.
+     */
+    ~RunReader();
+
+    /**
+     * Returns true once every record has been returned.
+     */
+    bool done() const { return done_; }
+
+    /**
+     * Returns the current record.
+     */
+    const Record& record() const { return record_; }
+
+    /**
+     * Moves to the next record.
+     */
+    void advance();
+
+   private:
+    RunReader(const RunReader&);
+    RunReader& operator=(const RunReader&);
+
+    /**
+     * Reads pages of the run into a block.
+     */
+    void fill(const int block, const PageId first_page_number);
+
+    /**
+     * Starts reading the pages after the last block read into the other
+     * block.
+     */
+    void prefetch();
+
+    /**
+     * Makes the next block current, waiting for it if needed.
+     */
+    bool nextBlock();
+
+    File file_;
+    PageId num_pages_;
+    PageId block_pages_;
+    std::vector<Page*> blocks_[2];
+    PageId block_count_[2];
+    PageId next_to_read_;
+    int current_;
+    PageId page_;
+    SlotId slot_;
+    std::future<void> pending_;
+    bool has_pending_;
+    Record record_;
+    bool done_;
+  };
+
+  /**
+   * Returns the number of frames out of the given ones that a run is written
+   * from.
+   */
+  static std::uint32_t writeFrames(const std::size_t frames);
+
+  /**
+   * Compares two records.
+   */
+  bool less(const Record& a, const Record& b) const;
+
+  /**
+   * Sorts records in place.
+   */
+  void sortRecords(std::vector<Record>& records) const;
+
+  /**
+   * Sorts an input larger than the given frames: forms runs in parallel and
+   * merges them.
+   */
+  void sortExternally(const std::vector<Page*>& frames);
+
+  /**
+   * Forms runs from the input with the given frames, running until the
+   * input is used up.
+   */
+  void formRuns(const std::vector<Page*>& frames);
+
+  /**
+   * Merges runs, writing the result to a new run if <output> is not empty
+   * and handing it to <emit_> otherwise.
+   *
+   * @param runs    Runs to merge; their files are removed.
+   * @param frames  Frames to read and write through.
+   * @param output  Name of the run to write, or empty.
+   * @return  The new run if one was written.
+   */
+  Run merge(const std::vector<Run>& runs, const std::vector<Page*>& frames,
+            const std::string& output);
+
+  /**
+   * Buffer manager the budget is taken from.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * Number of frames to sort in.
+   */
+  std::uint32_t budget_frames_;
+
+  /**
+   * Number of threads forming runs.
+   */
+  unsigned int threads_;
+
+  /**
+   * Order of the records, or empty for bytewise order.
+   */
+  RecordLess less_;
+
+  /**
+   * File being sorted.
+   */
+  File* input_;
+
+  /**
+   * Pages of the input to read records from.
+   */
+  const PageFilter* input_filter_;
+
+  /**
+   * Callback receiving the sorted records.
+   */
+  const RecordCallback* emit_;
+
+  /**
+   * Number of pages of the input file, and the next one to be read into a
+   * run.
+   */
+  PageId input_pages_;
+  std::atomic<PageId> next_input_page_;
+
+  /**
+   * Runs waiting to be merged.
+   */
+  std::vector<Run> runs_;
+
+  /**
+   * Protects runs_ while runs are formed.
+   */
+  std::mutex runs_mutex_;
+
+  /**
+   * Temporary files of the current sort.
+   */
+  SpillFiles spills_;
+
+  /**
+   * Statistics of the last sort.
+   */
+  std::uint32_t runs_formed_;
+  std::uint32_t merges_;
+  std::atomic<std::uint64_t> pages_written_;
+};
+
+}
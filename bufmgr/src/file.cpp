@@ -7,31 +7,47 @@
 
 #include "file.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
+#include <cerrno>
 #include <cstdio>
+#include <cstring>
 #include <cassert>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
+#include "exceptions/bad_file_exception.h"
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_checksum_exception.h"
 #include "file_iterator.h"
+#include "lz_codec.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
-File::CountMap File::open_counts_;
+const std::uint32_t FileHeader::MAGIC;
+const std::uint32_t FileHeader::VERSION;
+const PageId File::DEFAULT_EXTENT_PAGES;
+const std::size_t File::MAX_STORED_SIZE;
+const std::size_t File::RUN_SIZE;
 
-File File::create(const std::string& filename) {
-  return File(filename, true /* create_new */);
+File File::create(const std::string& filename, const bool compressed) {
+  return File(filename, true /* create_new */, compressed);
 }
 
 File File::open(const std::string& filename) {
-  return File(filename, false /* create_new */);
+  return File(filename, false /* create_new */, false /* compressed */);
 }
 
 void File::remove(const std::string& filename) {
@@ -48,7 +64,7 @@ bool File::isOpen(const std::string& filename) {
   if (!exists(filename)) {
     return false;
   }
-  return open_counts_.find(filename) != open_counts_.end();
+  return FileRegistry::isOpen(filename);
 }
 
 bool File::exists(const std::string& filename) {
@@ -63,17 +79,52 @@ bool File::exists(const std::string& filename) {
 }
 
 File::File(const File& other)
-  : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
-  ++open_counts_[filename_];
+  : id_(other.id_),
+    fd_(other.fd_),
+    sync_(other.sync_),
+    map_(other.map_) {
+  if (id_ != FileRegistry::INVALID_ID) {
+    FileRegistry::retain(id_);
+  }
+}
+
+File::File(File&& other)
+  : id_(other.id_),
+    fd_(other.fd_),
+    sync_(other.sync_),
+    map_(other.map_) {
+  other.id_ = FileRegistry::INVALID_ID;
+  other.fd_ = -1;
+  other.sync_ = NULL;
+  other.map_ = NULL;
 }
 
 File& File::operator=(const File& rhs) {
   // This accounts for self-assignment and assignment of a File object for the
   // same file.
+  if (rhs.id_ != FileRegistry::INVALID_ID) {
+    FileRegistry::retain(rhs.id_);
+  }
   close();	//close my file and associate me with the new one
-  filename_ = rhs.filename_;
-  openIfNeeded(false /* create_new */);
+  id_ = rhs.id_;
+  fd_ = rhs.fd_;
+  sync_ = rhs.sync_;
+  map_ = rhs.map_;
+  return *this;
+}
+
+File& File::operator=(File&& rhs) {
+  if (this != &rhs) {
+    close();
+    id_ = rhs.id_;
+    fd_ = rhs.fd_;
+    sync_ = rhs.sync_;
+    map_ = rhs.map_;
+    rhs.id_ = FileRegistry::INVALID_ID;
+    rhs.fd_ = -1;
+    rhs.sync_ = NULL;
+    rhs.map_ = NULL;
+  }
   return *this;
 }
 
@@ -81,14 +132,27 @@ File::~File() {
   close();
 }
 
+void File::setDurability(const GroupSync::Mode mode,
+                         const std::size_t batch_bytes,
+                         const unsigned int batch_interval_ms) {
+  sync_->setMode(mode, batch_bytes, batch_interval_ms);
+}
+
+std::string File::filename() const {
+  return id_ != FileRegistry::INVALID_ID ? FileRegistry::filename(id_)
+                                         : std::string();
+}
+
 Page File::allocatePage() {
   FileHeader header = readHeader();
+  // A new page is empty, so it is written from the header alone.
   Page new_page;
-  Page existing_page;
+  header.pending_previous = Page::INVALID_NUMBER;
   if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
     new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
+    header.first_free_page =
+        readPage(header.first_free_page, true /* allow_free */)
+            .next_page_number();
     --header.num_free_pages;
 
     if (header.first_used_page == Page::INVALID_NUMBER ||
@@ -97,6 +161,8 @@ Page File::allocatePage() {
       // than the one we just allocated, so add the new page to the head.
       if (header.first_used_page > new_page.page_number()) {
         new_page.set_next_page_number(header.first_used_page);
+      } else {
+        header.last_used_page = new_page.page_number();
       }
       header.first_used_page = new_page.page_number();
     } else {
@@ -107,60 +173,196 @@ Page File::allocatePage() {
         next_page_number = (*iter).next_page_number();
         if (next_page_number > new_page.page_number() ||
             next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
+          header.pending_previous = (*iter).page_number();
           break;
         }
       }
-      existing_page.set_next_page_number(new_page.page_number());
       new_page.set_next_page_number(next_page_number);
+      if (next_page_number == Page::INVALID_NUMBER) {
+        header.last_used_page = new_page.page_number();
+      }
     }
 
     assert((header.num_free_pages == 0) ==
            (header.first_free_page == Page::INVALID_NUMBER));
   } else {
+    reserve(header, 1);
     new_page.set_page_number(header.num_pages);
     if (header.first_used_page == Page::INVALID_NUMBER) {
       header.first_used_page = new_page.page_number();
     } else {
       // If we have pages allocated, we need to add the new page to the tail
       // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+      header.pending_previous = header.last_used_page;
     }
+    header.last_used_page = new_page.page_number();
     ++header.num_pages;
   }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+  header.pending_page = new_page.page_number();
+  header.pending_next = new_page.next_page_number();
+  header.pending_previous_next = new_page.page_number();
+  header.pending_used = true;
+  writePending(header);
+
+  return new_page;
+}
+
+std::vector<Page> File::allocatePages(const PageId count) {
+  std::vector<Page> new_pages(count);
+  if (count == 0) {
+    return new_pages;
+  }
+  FileHeader header = readHeader();
+  reserve(header, count);
+
+  // The run is contiguous on disk, so it is written with one call.
+  const PageId first_page_number = header.num_pages;
+  std::vector<char> buffer(count * Page::SIZE);
+  for (PageId i = 0; i < count; ++i) {
+    Page& new_page = new_pages[i];
+    new_page.set_page_number(first_page_number + i);
+    if (i + 1 < count) {
+      new_page.set_next_page_number(first_page_number + i + 1);
+    }
+    new_page.header_.checksum =
+        Page::computeChecksum(new_page.header_, &new_page.data_[0]);
+    char* const page_bytes = &buffer[i * Page::SIZE];
+    std::memcpy(page_bytes, &new_page.header_, sizeof(new_page.header_));
+    std::memcpy(page_bytes + sizeof(new_page.header_), &new_page.data_[0],
+                Page::DATA_SIZE);
+    if (map_ != NULL) {
+      writeCompressed(first_page_number + i, page_bytes);
+    }
+  }
+  if (map_ == NULL) {
+    writeAt(pagePosition(first_page_number), &buffer[0], buffer.size());
+  }
+
+  header.pending_page = Page::INVALID_NUMBER;
+  header.pending_previous = Page::INVALID_NUMBER;
+  if (header.first_used_page == Page::INVALID_NUMBER) {
+    header.first_used_page = first_page_number;
+  } else {
+    header.pending_previous = header.last_used_page;
+    header.pending_previous_next = first_page_number;
   }
+  header.last_used_page = first_page_number + count - 1;
+  header.num_pages += count;
+  writePending(header);
+
+  return new_pages;
+}
+
+void File::setExtentSize(const PageId pages) {
+  FileHeader header = readHeader();
+  header.extent_pages = pages > 0 ? pages : 1;
   writeHeader(header);
+}
 
-  return new_page;
+void File::setPunchHoles(const bool punch) {
+  FileHeader header = readHeader();
+  header.punch_holes = punch;
+  writeHeader(header);
+}
+
+std::vector<PageId> File::compact() {
+  if (map_ != NULL) {
+    return compactCompressed();
+  }
+  FileHeader header = readHeader();
+  std::vector<PageId> new_numbers(header.num_pages, Page::INVALID_NUMBER);
+
+  std::string temp_name;
+  const int temp_fd = createCompacted(temp_name);
+  try {
+    // The used list is in page number order, which also makes sure that
+    // following it ends.
+    char buffer[Page::SIZE];
+    PageId new_number = 1;
+    PageId page_number = header.first_used_page;
+    while (page_number != Page::INVALID_NUMBER) {
+      Page page = readPage(page_number, false /* allow_free */);
+      const PageId next_page_number = page.next_page_number();
+      if (next_page_number != Page::INVALID_NUMBER &&
+          next_page_number <= page_number) {
+        throw BadFileException(filename(),
+                               "used pages are not in page number order");
+      }
+      new_numbers[page_number] = new_number;
+      page.set_page_number(new_number);
+      if (next_page_number != Page::INVALID_NUMBER) {
+        page.set_next_page_number(new_number + 1);
+      }
+      pageImage(page.header_, page, buffer);
+      writeCompacted(temp_fd, temp_name, pagePosition(new_number), buffer,
+                     Page::SIZE);
+      page_number = next_page_number;
+      ++new_number;
+    }
+
+    const PageId used_pages = new_number - 1;
+    header.num_pages = used_pages + 1;
+    header.first_used_page = used_pages > 0 ? 1 : Page::INVALID_NUMBER;
+    header.last_used_page = used_pages;
+    header.num_free_pages = 0;
+    header.first_free_page = Page::INVALID_NUMBER;
+    header.num_reserved_pages = header.num_pages;
+    writeCompacted(temp_fd, temp_name, 0 /* offset */,
+                   reinterpret_cast<const char*>(&header), sizeof(header));
+    if (::ftruncate(temp_fd, pagePosition(header.num_pages)) != 0) {
+      throw FileIOException(temp_name, "ftruncate", errno);
+    }
+  } catch (...) {
+    ::close(temp_fd);
+    ::unlink(temp_name.c_str());
+    throw;
+  }
+  replaceWithCompacted(temp_fd, temp_name);
+
+  return new_numbers;
+}
+
+void File::renumberPage(Page& page, const std::vector<PageId>& new_numbers) {
+  page.set_page_number(new_numbers[page.page_number()]);
+  if (page.next_page_number() != Page::INVALID_NUMBER &&
+      page.next_page_number() < new_numbers.size()) {
+    page.set_next_page_number(new_numbers[page.next_page_number()]);
+  }
 }
 
 Page File::readPage(const PageId page_number) const {
   FileHeader header = readHeader();
   if (page_number >= header.num_pages) {
-    throw InvalidPageException(page_number, filename_);
+    throw InvalidPageException(page_number, filename());
   }
   return readPage(page_number, false /* allow_free */);
 }
 
-Page File::readPage(const PageId page_number, const bool allow_free) const {
+Page File::readPageUnverified(const PageId page_number) const {
+  FileHeader header = readHeader();
+  if (page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename());
+  }
+  return readPage(page_number, false /* allow_free */, false /* verify */);
+}
+
+Page File::readPage(const PageId page_number, const bool allow_free,
+                    const bool verify) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+  char buffer[Page::SIZE];
+  if (map_ != NULL) {
+    readCompressed(page_number, buffer, Page::SIZE);
+  } else {
+    readAt(pagePosition(page_number), buffer, Page::SIZE);
+  }
+  std::memcpy(&page.header_, buffer, sizeof(page.header_));
+  std::memcpy(&page.data_[0], buffer + sizeof(page.header_), Page::DATA_SIZE);
+  // a torn or corrupted page may not even look used
+  if (verify && !page.checksumValid()) {
+    throw PageChecksumException(page_number, filename());
+  }
   if (!allow_free && !page.isUsed()) {
-    throw InvalidPageException(page_number, filename_);
+    throw InvalidPageException(page_number, filename());
   }
 
   return page;
@@ -170,7 +372,7 @@ void File::writePage(const Page& new_page) {
   PageHeader header = readPageHeader(new_page.page_number());
   if (header.current_page_number == Page::INVALID_NUMBER) {
     // Page has been deleted since it was read.
-    throw InvalidPageException(new_page.page_number(), filename_);
+    throw InvalidPageException(new_page.page_number(), filename());
   }
   // Page on disk may have had its next page pointer updated since it was read;
   // we don't modify that, but we do keep all the other modifications to the
@@ -183,31 +385,62 @@ void File::writePage(const Page& new_page) {
 
 void File::deletePage(const PageId page_number) {
   FileHeader header = readHeader();
-  Page existing_page = readPage(page_number);
-  Page previous_page;
+  const Page existing_page = readPage(page_number);
+  header.pending_previous = Page::INVALID_NUMBER;
   // If this page is the head of the used list, update the header to point to
   // the next page in line.
   if (page_number == header.first_used_page) {
     header.first_used_page = existing_page.next_page_number();
+    if (page_number == header.last_used_page) {
+      header.last_used_page = Page::INVALID_NUMBER;
+    }
   } else {
     // Walk the used list so we can update the page that points to this one.
     for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
+      if ((*iter).next_page_number() == existing_page.page_number()) {
+        header.pending_previous = (*iter).page_number();
+        header.pending_previous_next = existing_page.next_page_number();
         break;
       }
     }
+    if (page_number == header.last_used_page) {
+      header.last_used_page = header.pending_previous;
+    }
   }
   // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
-  existing_page.set_next_page_number(header.first_free_page);
+  header.pending_page = page_number;
+  header.pending_next = header.first_free_page;
+  header.pending_used = false;
   header.first_free_page = page_number;
   ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
+  writePending(header);
+}
+
+void File::writePending(FileHeader& header) {
+  writeHeader(header);
+  finishPendingWrites(header);
+}
+
+void File::finishPendingWrites(FileHeader& header) {
+  if (header.pending_page != Page::INVALID_NUMBER) {
+    Page page;
+    if (header.pending_used) {
+      page.set_page_number(header.pending_page);
+    }
+    page.set_next_page_number(header.pending_next);
+    writePage(header.pending_page, page);
+    if (!header.pending_used && header.punch_holes) {
+      punchHole(header.pending_page);
+    }
+  }
+  if (header.pending_previous != Page::INVALID_NUMBER) {
+    Page previous_page =
+        readPage(header.pending_previous, false /* allow_free */);
+    previous_page.set_next_page_number(header.pending_previous_next);
+    writePage(header.pending_previous, previous_page);
   }
-  writePage(page_number, existing_page);
+  header.pending_page = Page::INVALID_NUMBER;
+  header.pending_previous = Page::INVALID_NUMBER;
   writeHeader(header);
 }
 
@@ -220,51 +453,133 @@ FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+File::File(const std::string& name, const bool create_new,
+           const bool compressed)
+  : id_(FileRegistry::INVALID_ID),
+    fd_(-1),
+    sync_(NULL),
+    map_(NULL) {
+  openIfNeeded(name, create_new, compressed);
 
   if (create_new) {
-    // File starts with 1 page (the header).
-    FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+    // File starts with 1 page (the header), followed by the page map of a
+    // compressed file.
+    FileHeader header = {FileHeader::MAGIC, FileHeader::VERSION,
+                         1 /* num_pages */, 0 /* first_used_page */,
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         0 /* last_used_page */, 1 /* num_reserved_pages */,
+                         DEFAULT_EXTENT_PAGES /* extent_pages */,
+                         false /* punch_holes */, compressed,
+                         compressed ? map_->offset() : 0 /* page_map_offset */,
+                         Page::INVALID_NUMBER /* pending_page */,
+                         Page::INVALID_NUMBER /* pending_next */,
+                         Page::INVALID_NUMBER /* pending_previous */,
+                         Page::INVALID_NUMBER /* pending_previous_next */,
+                         false /* pending_used */};
     writeHeader(header);
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
-  if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
-    ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+void File::openIfNeeded(const std::string& name, const bool create_new,
+                        const bool compressed) {
+  if (FileRegistry::retain(name, id_)) {	//exists an entry already
+    fd_ = FileRegistry::fd(id_);
+    sync_ = FileRegistry::sync(id_);
+    map_ = FileRegistry::pageMap(id_);
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
-    const bool already_exists = exists(filename_);
+    int flags = O_RDWR;
+    const bool already_exists = exists(name);
     if (create_new) {
       // Error if we try to overwrite an existing file.
       if (already_exists) {
-        throw FileExistsException(filename_);
+        throw FileExistsException(name);
       }
-      // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
+      // New files have to be truncated on open.  O_EXCL makes a file created
+      // since the check an error too.
+      flags |= O_CREAT | O_EXCL | O_TRUNC;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
-        throw FileNotFoundException(filename_);
+        throw FileNotFoundException(name);
+      }
+    }
+    fd_ = ::open(name.c_str(), flags, 0644);
+    if (fd_ < 0) {
+      if (create_new && errno == EEXIST) {
+        throw FileExistsException(name);
+      }
+      throw FileIOException(name, "open", errno);
+    }
+    std::shared_ptr<PageMap> page_map;
+    try {
+      if (create_new) {
+        if (compressed) {
+          page_map.reset(new PageMap(Page::SIZE,
+                                     std::vector<PageMap::Slot>(1)));
+        }
+      } else {
+        FileHeader header;
+        if (readUpTo(0 /* offset */, reinterpret_cast<char*>(&header),
+                     sizeof(header)) < sizeof(header) ||
+            header.magic != FileHeader::MAGIC) {
+          throw BadFileException(name, "not a database file");
+        }
+        if (header.version != FileHeader::VERSION) {
+          throw BadFileException(
+              name, "format version " + std::to_string(header.version) +
+                        ", expected " + std::to_string(FileHeader::VERSION));
+        }
+        if (header.compressed) {
+          std::vector<PageMap::Slot> slots(header.num_reserved_pages);
+          readSlotAt(header.page_map_offset,
+                     reinterpret_cast<char*>(&slots[0]),
+                     slots.size() * sizeof(PageMap::Slot));
+          page_map.reset(new PageMap(header.page_map_offset, slots));
+        }
+      }
+    } catch (...) {
+      ::close(fd_);
+      fd_ = -1;
+      throw;
+    }
+    // Another thread may have opened the file meanwhile; its descriptor and
+    // page map are shared then, and ours are dropped.
+    const bool first = FileRegistry::add(name, fd_, page_map, id_);
+    if (!first) {
+      ::close(fd_);
+      fd_ = FileRegistry::fd(id_);
+      map_ = FileRegistry::pageMap(id_);
+    } else {
+      map_ = page_map.get();
+    }
+    sync_ = FileRegistry::sync(id_);
+    if (first && !create_new) {
+      // Page writes a crash cut short are finished before anyone reads the
+      // pages.
+      FileHeader header = readHeader();
+      if (header.pending_page != Page::INVALID_NUMBER ||
+          header.pending_previous != Page::INVALID_NUMBER) {
+        try {
+          finishPendingWrites(header);
+        } catch (...) {
+          close();
+          throw;
+        }
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
-    open_counts_[filename_] = 1;
   }
 }
 
 void File::close() {
-  --open_counts_[filename_];
-  stream_.reset();
-  if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
-    open_counts_.erase(filename_);
+  // Closing twice (e.g. an explicit destructor call followed by the implicit
+  // one) does nothing the second time.
+  if (id_ != FileRegistry::INVALID_ID) {
+    FileRegistry::release(id_);
   }
+  id_ = FileRegistry::INVALID_ID;
+  fd_ = -1;
+  sync_ = NULL;
+  map_ = NULL;
 }
 
 void File::writePage(const PageId page_number, const Page& new_page) {
@@ -273,33 +588,538 @@ void File::writePage(const PageId page_number, const Page& new_page) {
 
 void File::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
-  stream_->flush();
+  char buffer[Page::SIZE];
+  pageImage(header, new_page, buffer);
+  if (map_ != NULL) {
+    writeCompressed(page_number, buffer);
+  } else {
+    writeAt(pagePosition(page_number), buffer, Page::SIZE);
+  }
+}
+
+void File::pageImage(const PageHeader& header, const Page& page,
+                     char* buffer) {
+  PageHeader summed = header;
+  summed.checksum = Page::computeChecksum(header, &page.data_[0]);
+  std::memcpy(buffer, &summed, sizeof(summed));
+  std::memcpy(buffer + sizeof(summed), &page.data_[0], Page::DATA_SIZE);
+}
+
+int File::createCompacted(std::string& temp_name) const {
+  temp_name = filename() + ".compact";
+  struct stat status;
+  const mode_t mode = ::fstat(fd_, &status) == 0 ? status.st_mode & 07777
+                                                 : 0644;
+  const int temp_fd =
+      ::open(temp_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, mode);
+  if (temp_fd < 0) {
+    throw FileIOException(temp_name, "open", errno);
+  }
+  return temp_fd;
+}
+
+void File::writeCompacted(const int temp_fd, const std::string& temp_name,
+                          const off_t offset, const char* buffer,
+                          const std::size_t length) {
+  const int error = writeFd(temp_fd, offset, buffer, length);
+  if (error != 0) {
+    throw FileIOException(temp_name, "pwrite", error);
+  }
+}
+
+void File::replaceWithCompacted(const int temp_fd,
+                                const std::string& temp_name) {
+  const std::string name = filename();
+  try {
+    if (::fsync(temp_fd) != 0) {
+      throw FileIOException(temp_name, "fsync", errno);
+    }
+    if (::rename(temp_name.c_str(), name.c_str()) != 0) {
+      throw FileIOException(name, "rename", errno);
+    }
+  } catch (...) {
+    ::close(temp_fd);
+    ::unlink(temp_name.c_str());
+    throw;
+  }
+  // The shared descriptor is switched over in one step, so no File ever
+  // reads the old file under the new page numbers.
+  while (::dup2(temp_fd, fd_) < 0) {
+    if (errno != EINTR) {
+      const int error = errno;
+      ::close(temp_fd);
+      throw FileIOException(name, "dup2", error);
+    }
+  }
+  ::close(temp_fd);
+
+  // Until the directory is synced, a crash may bring back the old file, which
+  // is whole as well; a failure to sync it is therefore not an error.
+  const std::string::size_type slash = name.rfind('/');
+  const std::string directory =
+      slash == std::string::npos ? "." : name.substr(0, slash + 1);
+  const int directory_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (directory_fd >= 0) {
+    ::fsync(directory_fd);
+    ::close(directory_fd);
+  }
 }
 
 FileHeader File::readHeader() const {
   FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  readAt(0 /* offset */, reinterpret_cast<char*>(&header), sizeof(header));
 
   return header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->flush();
+  writeAt(0 /* offset */, reinterpret_cast<const char*>(&header),
+          sizeof(header));
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (map_ != NULL) {
+    readCompressed(page_number, reinterpret_cast<char*>(&header),
+                   sizeof(header));
+    return header;
+  }
+  readAt(pagePosition(page_number), reinterpret_cast<char*>(&header),
+         sizeof(header));
 
   return header;
 }
 
+void File::reserve(FileHeader& header, const PageId pages) {
+  const PageId needed = header.num_pages + pages;
+  if (needed <= header.num_reserved_pages) {
+    return;
+  }
+  const PageId extent = header.extent_pages;
+  const PageId reserved = (needed + extent - 1) / extent * extent;
+  if (map_ != NULL) {
+    // Compressed pages take space as they are written; only the page map
+    // needs room for them.
+    header.num_reserved_pages = map_->reserve(reserved, writer());
+    header.page_map_offset = map_->offset();
+    return;
+  }
+  const off_t offset = pagePosition(header.num_reserved_pages);
+  const off_t length = pagePosition(reserved) - offset;
+  if (::fallocate(fd_, 0 /* mode */, offset, length) != 0) {
+    // Filesystems without fallocate() get the extent written out instead.
+    const int error =
+        errno == EOPNOTSUPP ? ::posix_fallocate(fd_, offset, length) : errno;
+    if (error != 0) {
+      throw FileIOException(filename(), "fallocate", error);
+    }
+  }
+  header.num_reserved_pages = reserved;
+}
+
+void File::readPages(const PageId first_page_number, const PageId count,
+                     Page* pages) const {
+  if (count == 0) {
+    return;
+  }
+  std::vector<Page*> pointers(count);
+  for (PageId i = 0; i < count; ++i) {
+    pointers[i] = &pages[i];
+  }
+  readPages(first_page_number, count, &pointers[0]);
+}
+
+void File::readPages(const PageId first_page_number, const PageId count,
+                     Page* const* pages) const {
+  if (map_ != NULL) {
+    // Pages written one after the other usually sit in adjacent slots, and
+    // each run of those, up to the size of the buffer, is read with one call.
+    std::vector<PageMap::Slot> slots(count);
+    if (count > 0) {
+      map_->find(first_page_number, count, &slots[0]);
+    }
+    char run[RUN_SIZE];
+    char buffer[Page::SIZE];
+    PageId i = 0;
+    while (i < count) {
+      const std::uint64_t run_offset = slots[i].offset;
+      PageId run_end = i + 1;
+      if (run_offset != 0) {
+        while (run_end < count &&
+               slots[run_end].offset ==
+                   slots[run_end - 1].offset + slots[run_end - 1].capacity &&
+               slots[run_end].offset + slots[run_end].capacity - run_offset <=
+                   RUN_SIZE) {
+          ++run_end;
+        }
+        readSlotAt(run_offset, run,
+                   slots[run_end - 1].offset + slots[run_end - 1].capacity -
+                       run_offset);
+      }
+      for (; i < run_end; ++i) {
+        if (slots[i].offset != 0) {
+          unpack(first_page_number + i, &run[slots[i].offset - run_offset],
+                 slots[i].capacity, buffer, Page::SIZE);
+        } else {
+          std::memset(buffer, 0, Page::SIZE);
+        }
+        Page& page = *pages[i];
+        std::memcpy(&page.header_, buffer, sizeof(page.header_));
+        std::memcpy(&page.data_[0], buffer + sizeof(page.header_),
+                    Page::DATA_SIZE);
+      }
+    }
+  } else {
+    // Each page takes two iovecs, one for its header and one for its data.
+    const PageId batch_pages = IOV_MAX / 2;
+    std::vector<struct iovec> iov;
+    for (PageId done = 0; done < count; done += batch_pages) {
+      const PageId batch = std::min(batch_pages, count - done);
+      iov.resize(2 * batch);
+      for (PageId i = 0; i < batch; ++i) {
+        Page& page = *pages[done + i];
+        iov[2 * i].iov_base = &page.header_;
+        iov[2 * i].iov_len = sizeof(page.header_);
+        iov[2 * i + 1].iov_base = &page.data_[0];
+        iov[2 * i + 1].iov_len = Page::DATA_SIZE;
+      }
+
+      off_t offset = pagePosition(first_page_number + done);
+      std::size_t next = 0;
+      while (next < iov.size()) {
+        ssize_t n = ::preadv(fd_, &iov[next], iov.size() - next, offset);
+        if (n < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throw FileIOException(filename(), "preadv", errno);
+        }
+        if (n == 0) {
+          // Past the end of the file, which only pages the file does not
+          // have yet may be; the others would read back as empty pages.
+          if (first_page_number + done + next / 2 < readHeader().num_pages) {
+            throw FileIOException(filename(), "preadv past the end of the file",
+                                  EIO);
+          }
+          for (; next < iov.size(); ++next) {
+            std::memset(iov[next].iov_base, 0, iov[next].iov_len);
+          }
+          break;
+        }
+        offset += n;
+        // Skip the iovecs that were filled and trim a partly filled one.
+        while (n > 0 && static_cast<std::size_t>(n) >= iov[next].iov_len) {
+          n -= iov[next].iov_len;
+          ++next;
+        }
+        if (n > 0) {
+          iov[next].iov_base = static_cast<char*>(iov[next].iov_base) + n;
+          iov[next].iov_len -= n;
+        }
+      }
+    }
+  }
+
+  for (PageId i = 0; i < count; ++i) {
+    if (!pages[i]->checksumValid()) {
+      throw PageChecksumException(first_page_number + i, filename());
+    }
+  }
+}
+
+void File::appendPages(const PageId count, Page* const* pages) {
+  if (count == 0) {
+    return;
+  }
+  FileHeader header = readHeader();
+  reserve(header, count);
+
+  const PageId first_page_number = header.num_pages;
+  for (PageId i = 0; i < count; ++i) {
+    pages[i]->set_page_number(first_page_number + i);
+    pages[i]->set_next_page_number(i + 1 < count ? first_page_number + i + 1
+                                                 : Page::INVALID_NUMBER);
+    pages[i]->header_.checksum =
+        Page::computeChecksum(pages[i]->header_, &pages[i]->data_[0]);
+  }
+
+  if (map_ != NULL) {
+    char buffer[Page::SIZE];
+    for (PageId i = 0; i < count; ++i) {
+      std::memcpy(buffer, &pages[i]->header_, sizeof(pages[i]->header_));
+      std::memcpy(buffer + sizeof(pages[i]->header_), &pages[i]->data_[0],
+                  Page::DATA_SIZE);
+      writeCompressed(first_page_number + i, buffer);
+    }
+  } else {
+    // Each page takes two iovecs, one for its header and one for its data.
+    const PageId batch_pages = IOV_MAX / 2;
+    std::vector<struct iovec> iov;
+    for (PageId done = 0; done < count; done += batch_pages) {
+      const PageId batch = std::min(batch_pages, count - done);
+      iov.resize(2 * batch);
+      for (PageId i = 0; i < batch; ++i) {
+        Page& page = *pages[done + i];
+        iov[2 * i].iov_base = &page.header_;
+        iov[2 * i].iov_len = sizeof(page.header_);
+        iov[2 * i + 1].iov_base = &page.data_[0];
+        iov[2 * i + 1].iov_len = Page::DATA_SIZE;
+      }
+
+      off_t offset = pagePosition(first_page_number + done);
+      std::size_t next = 0;
+      while (next < iov.size()) {
+        ssize_t n = ::pwritev(fd_, &iov[next], iov.size() - next, offset);
+        if (n < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throw FileIOException(filename(), "pwritev", errno);
+        }
+        offset += n;
+        // Skip the iovecs that were written and trim a partly written one.
+        while (n > 0 && static_cast<std::size_t>(n) >= iov[next].iov_len) {
+          n -= iov[next].iov_len;
+          ++next;
+        }
+        if (n > 0) {
+          iov[next].iov_base = static_cast<char*>(iov[next].iov_base) + n;
+          iov[next].iov_len -= n;
+        }
+      }
+    }
+    sync_->noteWrite(count * Page::SIZE);
+  }
+
+  if (header.first_used_page == Page::INVALID_NUMBER) {
+    header.first_used_page = first_page_number;
+  } else {
+    Page last_page = readPage(header.last_used_page, false /* allow_free */);
+    last_page.set_next_page_number(first_page_number);
+    writePage(last_page.page_number(), last_page);
+  }
+  header.last_used_page = first_page_number + count - 1;
+  header.num_pages += count;
+  writeHeader(header);
+}
+
+void File::punchHole(const PageId page_number) {
+  if (map_ != NULL) {
+    // A deleted page is stored as a few compressed bytes anyway.
+    return;
+  }
+  // The rest of the page was just written as zeros; the kernel frees its
+  // whole blocks.
+  const off_t offset = pagePosition(page_number) + sizeof(PageHeader);
+  if (::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset,
+                  Page::SIZE - sizeof(PageHeader)) != 0 &&
+      errno != EOPNOTSUPP) {
+    throw FileIOException(filename(), "fallocate", errno);
+  }
+}
+
+std::vector<PageId> File::compactCompressed() {
+  FileHeader header = readHeader();
+  std::vector<PageId> new_numbers(header.num_pages, Page::INVALID_NUMBER);
+
+  // The used pages are packed one after the other from the front of the new
+  // file, followed by their map.
+  std::string temp_name;
+  const int temp_fd = createCompacted(temp_name);
+  std::vector<PageMap::Slot> slots(1, PageMap::Slot());
+  std::uint64_t end = Page::SIZE;
+  std::uint64_t map_offset;
+  try {
+    char buffer[Page::SIZE];
+    char stored[MAX_STORED_SIZE];
+    PageId page_number = header.first_used_page;
+    while (page_number != Page::INVALID_NUMBER) {
+      Page page = readPage(page_number, false /* allow_free */);
+      const PageId next_page_number = page.next_page_number();
+      if (next_page_number != Page::INVALID_NUMBER &&
+          next_page_number <= page_number) {
+        throw BadFileException(filename(),
+                               "used pages are not in page number order");
+      }
+      const PageId new_number = slots.size();
+      new_numbers[page_number] = new_number;
+      page.set_page_number(new_number);
+      if (next_page_number != Page::INVALID_NUMBER) {
+        page.set_next_page_number(new_number + 1);
+      }
+      pageImage(page.header_, page, buffer);
+      const std::size_t stored_length = pack(buffer, stored);
+      writeCompacted(temp_fd, temp_name, end, stored, stored_length);
+
+      PageMap::Slot slot = PageMap::Slot();
+      slot.offset = end;
+      slot.capacity = PageMap::align(stored_length);
+      slots.push_back(slot);
+      end += slot.capacity;
+      page_number = next_page_number;
+    }
+    map_offset = end;
+    writeCompacted(temp_fd, temp_name, map_offset,
+                   reinterpret_cast<const char*>(&slots[0]),
+                   slots.size() * sizeof(PageMap::Slot));
+    end = PageMap::align(end + slots.size() * sizeof(PageMap::Slot));
+
+    const PageId used_pages = slots.size() - 1;
+    header.num_pages = used_pages + 1;
+    header.first_used_page = used_pages > 0 ? 1 : Page::INVALID_NUMBER;
+    header.last_used_page = used_pages;
+    header.num_free_pages = 0;
+    header.first_free_page = Page::INVALID_NUMBER;
+    header.num_reserved_pages = slots.size();
+    header.page_map_offset = map_offset;
+    writeCompacted(temp_fd, temp_name, 0 /* offset */,
+                   reinterpret_cast<const char*>(&header), sizeof(header));
+    if (::ftruncate(temp_fd, end) != 0) {
+      throw FileIOException(temp_name, "ftruncate", errno);
+    }
+  } catch (...) {
+    ::close(temp_fd);
+    ::unlink(temp_name.c_str());
+    throw;
+  }
+  replaceWithCompacted(temp_fd, temp_name);
+  map_->reset(map_offset, slots, end);
+
+  return new_numbers;
+}
+
+void File::readCompressed(const PageId page_number, char* buffer,
+                          const std::size_t length) const {
+  const PageMap::Slot slot = map_->find(page_number);
+  if (slot.offset == 0) {
+    std::memset(buffer, 0, length);
+    return;
+  }
+  // Each sequence the first bytes come from adds at least one of them for at
+  // most four stored bytes, apart from the continuations of its lengths, of
+  // which a page has fewer than 2 * (Page::SIZE / 255 + 1).  A slot holds at
+  // most MAX_STORED_SIZE bytes, rounded up.
+  char stored[MAX_STORED_SIZE + PageMap::ALIGNMENT];
+  const std::size_t stored_length = std::min<std::size_t>(
+      std::min<std::size_t>(slot.capacity, sizeof(stored)),
+      sizeof(std::uint32_t) + 4 * length + 2 * (Page::SIZE / 255 + 1));
+  readSlotAt(slot.offset, stored, stored_length);
+  unpack(page_number, stored, stored_length, buffer, length);
+}
+
+void File::writeCompressed(const PageId page_number, const char* buffer) {
+  char stored[MAX_STORED_SIZE];
+  const std::size_t length = pack(buffer, stored);
+  const PageMap::Slot slot = map_->place(page_number, length);
+  writeAt(slot.offset, stored, length);
+  map_->record(page_number, slot, writer());
+}
+
+std::size_t File::pack(const char* buffer, char* stored) {
+  // At most one byte short of a page, so that a length of Page::SIZE marks a
+  // page stored as it is.
+  std::uint32_t length = LzCodec::compress(
+      buffer, Page::SIZE, stored + sizeof(length), Page::SIZE - 1);
+  if (length == 0) {
+    length = Page::SIZE;
+    std::memcpy(stored + sizeof(length), buffer, Page::SIZE);
+  }
+  std::memcpy(stored, &length, sizeof(length));
+  return sizeof(length) + length;
+}
+
+void File::unpack(const PageId page_number, const char* stored,
+                  const std::size_t length, char* buffer,
+                  const std::size_t page_length) const {
+  std::uint32_t stored_length = 0;
+  bool valid = length >= sizeof(stored_length);
+  if (valid) {
+    std::memcpy(&stored_length, stored, sizeof(stored_length));
+    // only a whole page needs all of the stored bytes
+    valid = stored_length <= length - sizeof(stored_length) ||
+            (page_length < Page::SIZE && stored_length <= Page::SIZE);
+  }
+  const std::size_t available =
+      std::min<std::size_t>(stored_length, length - sizeof(stored_length));
+  if (valid && stored_length == Page::SIZE) {
+    valid = page_length <= available;
+    if (valid) {
+      std::memcpy(buffer, stored + sizeof(stored_length), page_length);
+    }
+  } else if (valid && page_length == Page::SIZE) {
+    valid = LzCodec::decompress(stored + sizeof(stored_length), stored_length,
+                                buffer, Page::SIZE);
+  } else if (valid) {
+    valid = LzCodec::decompressPrefix(stored + sizeof(stored_length),
+                                      available, buffer, page_length);
+  }
+  if (!valid) {
+    throw PageChecksumException(page_number, filename());
+  }
+}
+
+PageMap::Writer File::writer() {
+  return [this](const off_t offset, const char* buffer,
+                const std::size_t length) { writeAt(offset, buffer, length); };
+}
+
+void File::readAt(const off_t offset, char* buffer,
+                  const std::size_t length) const {
+  if (readUpTo(offset, buffer, length) < length) {
+    // The file is shorter than its header says, e.g. truncated.
+    throw FileIOException(filename(), "pread past the end of the file", EIO);
+  }
+}
+
+void File::readSlotAt(const off_t offset, char* buffer,
+                      const std::size_t length) const {
+  const std::size_t done = readUpTo(offset, buffer, length);
+  std::memset(buffer + done, 0, length - done);
+}
+
+std::size_t File::readUpTo(const off_t offset, char* buffer,
+                           const std::size_t length) const {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pread(fd_, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename(), "pread", errno);
+    }
+    if (n == 0) {
+      break;
+    }
+    done += n;
+  }
+  return done;
+}
+
+int File::writeFd(const int fd, const off_t offset, const char* buffer,
+                  const std::size_t length) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n =
+        ::pwrite(fd, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errno;
+    }
+    done += n;
+  }
+  return 0;
+}
+
+void File::writeAt(const off_t offset, const char* buffer,
+                   const std::size_t length) {
+  const int error = writeFd(fd_, offset, buffer, length);
+  if (error != 0) {
+    throw FileIOException(filename(), "pwrite", error);
+  }
+  sync_->noteWrite(length);
+}
+
 }
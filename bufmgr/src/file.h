@@ -7,12 +7,14 @@
 
 #pragma once
 
-#include <fstream>
+#include <cstddef>
 #include <string>
-#include <map>
-#include <memory>
+#include <vector>
+#include <sys/types.h>
 
+#include "file_registry.h"
 #include "page.h"
+#include "page_map.h"
 
 namespace badgerdb {
 
@@ -22,6 +24,27 @@ class FileIterator;
  * @brief Header metadata for files on disk which contain pages.
  */
 struct FileHeader {
+  /**
+   * Value of magic in every database file.
+   */
+  static const std::uint32_t MAGIC = 0x42644266;
+
+  /**
+   * Version of the file format written by this code.  Files of other
+   * versions are not opened.
+   */
+  static const std::uint32_t VERSION = 2;
+
+  /**
+   * MAGIC, marking the file as a database file.
+   */
+  std::uint32_t magic;
+
+  /**
+   * Version of the format the file is written in.
+   */
+  std::uint32_t version;
+
   /**
    * Number of pages allocated in the file.
    */
@@ -42,6 +65,67 @@ struct FileHeader {
    */
   PageId first_free_page;
 
+  /**
+   * Page number of the last used page in the file.
+   */
+  PageId last_used_page;
+
+  /**
+   * Number of pages the file has disk space for.  Pages from num_pages on
+   * are preallocated but not yet allocated.  In a compressed file, number of
+   * pages the page map has room for.
+   */
+  PageId num_reserved_pages;
+
+  /**
+   * Number of pages the file grows by when it runs out of reserved pages.
+   */
+  PageId extent_pages;
+
+  /**
+   * Whether deleting a page gives its disk space back to the filesystem.
+   */
+  bool punch_holes;
+
+  /**
+   * Whether pages are stored compressed, see File::create().
+   */
+  bool compressed;
+
+  /**
+   * In a compressed file, offset of the page map in the file.
+   */
+  std::uint64_t page_map_offset;
+
+  /**
+   * Page that allocatePage() or deletePage() is rewriting as an empty used
+   * or free page, or Page::INVALID_NUMBER.  The header is written with the
+   * pending rewrites before the pages and without them after, so a file
+   * opened after a crash in between finishes them.
+   */
+  PageId pending_page;
+
+  /**
+   * Next page of pending_page, in the used or the free list.
+   */
+  PageId pending_next;
+
+  /**
+   * Used page whose next page is being changed to pending_previous_next, or
+   * Page::INVALID_NUMBER.
+   */
+  PageId pending_previous;
+
+  /**
+   * New next page of pending_previous.
+   */
+  PageId pending_previous_next;
+
+  /**
+   * Whether pending_page becomes a used page rather than a free one.
+   */
+  bool pending_used;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -49,46 +133,89 @@ struct FileHeader {
    * @return  True if the other header is equal to this one.
    */
   bool operator==(const FileHeader& rhs) const {
-    return num_pages == rhs.num_pages &&
+    return magic == rhs.magic &&
+        version == rhs.version &&
+        num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        first_free_page == rhs.first_free_page &&
+        last_used_page == rhs.last_used_page &&
+        num_reserved_pages == rhs.num_reserved_pages &&
+        extent_pages == rhs.extent_pages &&
+        punch_holes == rhs.punch_holes &&
+        compressed == rhs.compressed &&
+        page_map_offset == rhs.page_map_offset &&
+        pending_page == rhs.pending_page &&
+        pending_next == rhs.pending_next &&
+        pending_previous == rhs.pending_previous &&
+        pending_previous_next == rhs.pending_previous_next &&
+        pending_used == rhs.pending_used;
   }
 };
 
+static_assert(sizeof(FileHeader) <= Page::SIZE,
+              "File header must fit into page 0.");
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
+ * The File class wraps a file descriptor of an underlying file on disk.  Files contain
  * fixed-sized pages, and they never deallocate space (though they do reuse
  * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * underlying file, they will share the file descriptor.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the FileRegistry) and just returns a file object with
+ * the already opened descriptor for the file without actually opening the UNIX file again.
+ *
+ * Pages are read and written with pread() and pwrite(), without buffering in
+ * user space.  When writes become durable is decided per file by its
+ * durability mode, see setDurability().
+ *
+ * A file grows in extents of several pages, preallocated on disk with
+ * fallocate(), so that allocating a page rarely extends the file.  Page 0
+ * holds the file header, so every page starts at a multiple of Page::SIZE.
+ *
+ * A compressed file instead stores each page compressed with LzCodec, in a
+ * slot of its own size that a PageMap in the file records.  Pages are
+ * compressed when written and decompressed when read, so everything above
+ * File, e.g. the buffer pool, sees whole pages; their checksums cover the
+ * pages as they were before compression.  Pages that do not compress are
+ * stored as they are.  A page that grows out of its slot moves to the end of
+ * the file, and compact() reclaims the space it leaves behind.
+ *
+ * A File object is a small handle holding the FileId of the open file.  Copying or
+ * destroying one only adjusts the reference count of that id, and moving one costs nothing.
  *
  * @warning This class is not threadsafe.
  */
 class File {
  public:
+  /**
+   * Number of pages a new file grows by when it runs out of reserved pages.
+   */
+  static const PageId DEFAULT_EXTENT_PAGES = 128;
+
   /**
    * Creates a new file.
    *
-   * @param filename  Name of the file.
+   * @param filename    Name of the file.
+   * @param compressed  Whether to store the pages of the file compressed.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static File create(const std::string& filename);
+  static File create(const std::string& filename,
+                     const bool compressed = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
-	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * It first checks if the file is already open. If so, then the new File object created uses the same file descriptor to read to or write fom
+	 * that already open file. The reference count kept by the FileRegistry is incremented whenever an already open file is
+	 * opened again. Otherwise the UNIX file is actually opened and registered under a new FileId.
    *
    * @param filename  Name of the file.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  BadFileException  If the file is not a database file of the
+   *                            current format version.
    */
   static File open(const std::string& filename);
 
@@ -124,6 +251,13 @@ class File {
    */
   File(const File& other);
 
+  /**
+   * Move constructor.  The other File object no longer refers to a file.
+   *
+   * @param other File object to move from.
+   */
+  File(File&& other);
+
   /**
    * Assignment operator.
    *
@@ -132,6 +266,14 @@ class File {
    */
   File& operator=(const File& rhs);
 
+  /**
+   * Move assignment operator.
+   *
+   * @param rhs File object to move from.
+   * @return    Newly assigned file object.
+   */
+  File& operator=(File&& rhs);
+
   /**
    * Destructor that automatically closes the underlying file if no other
    * File objects are using it.
@@ -139,25 +281,177 @@ class File {
   ~File();
 
   /**
-   * Allocates a new page in the file.
+   * Allocates a new page in the file.  A crash of the process while the
+   * page is linked into the used list leaves a file that is consistent once
+   * opened again, with or without the new page.
    *
    * @return The new page.
    */
   Page allocatePage();
 
   /**
-   * Reads an existing page from the file.
+   * Allocates a run of new pages with consecutive page numbers at the end of
+   * the file.  Unlike allocatePage(), this never reuses deleted pages.  The
+   * pages are written before the header counts them.
+   *
+   * @param count   Number of pages to allocate.
+   * @return The new pages, in page number order.
+   * @throws  FileIOException  If the file cannot be extended.
+   */
+  std::vector<Page> allocatePages(const PageId count);
+
+  /**
+   * Sets the number of pages the file grows by when it runs out of
+   * reserved pages.  The setting is stored in the file header.
+   *
+   * @param pages   Pages per extent; at least 1.
+   */
+  void setExtentSize(const PageId pages);
+
+  /**
+   * Returns the number of pages the file grows by when it runs out of
+   * reserved pages.
+   */
+  PageId extentSize() const { return readHeader().extent_pages; }
+
+  /**
+   * Sets whether deletePage() punches a hole into the file where the
+   * deleted page was, giving its disk space back to the filesystem.  Only
+   * the page header, which links the page into the free list, stays
+   * allocated.  The setting is stored in the file header.
+   *
+   * @param punch   True to punch holes for deleted pages.
+   */
+  void setPunchHoles(const bool punch);
+
+  /**
+   * Returns whether deletePage() punches holes for deleted pages.
+   */
+  bool punchHoles() const { return readHeader().punch_holes; }
+
+  /**
+   * Returns whether the pages of the file are stored compressed.
+   */
+  bool compressed() const { return map_ != NULL; }
+
+  /**
+   * Returns the number of pages in the file, used or free, including the
+   * header page 0; pages are numbered below it.
+   */
+  PageId pageCount() const { return readHeader().num_pages; }
+
+  /**
+   * Returns the number of the first used page, from which the used pages
+   * are linked in page number order; Page::INVALID_NUMBER if there is none.
+   */
+  PageId firstUsedPage() const { return readHeader().first_used_page; }
+
+  /**
+   * Reads consecutive pages straight into the given Page objects, without
+   * checking whether they are used, and verifies their checksums.  Pages
+   * the file does not have yet read as zeros.  May be called from several
+   * threads.
+   *
+   * @param first_page_number Number of the first page to read.
+   * @param count             Number of pages to read.
+   * @param pages             Array of at least <count> pages to read into.
+   * @throws  FileIOException  If preadv() fails, or a page the header counts
+   *                           ends past the end of the file.
+   * @throws  PageChecksumException  If a page does not match its checksum.
+   */
+  void readPages(const PageId first_page_number, const PageId count,
+                 Page* pages) const;
+
+  /**
+   * Reads consecutive pages straight into the Page objects pointed to, which
+   * need not be next to each other in memory, e.g. frames of the buffer
+   * pool.  Otherwise like readPages() above.
+   *
+   * @param first_page_number Number of the first page to read.
+   * @param count             Number of pages to read.
+   * @param pages             Array of at least <count> pointers to pages to
+   *                          read into.
+   * @throws  FileIOException  If preadv() fails, or a page the header counts
+   *                           ends past the end of the file.
+   * @throws  PageChecksumException  If a page does not match its checksum.
+   */
+  void readPages(const PageId first_page_number, const PageId count,
+                 Page* const* pages) const;
+
+  /**
+   * Appends pages to the end of the file as used pages and writes them with
+   * one call, setting their page numbers.  Unlike allocatePages() this needs
+   * no copy of the pages, so it suits writing out pages that were filled in
+   * place, e.g. sorted runs spilled from buffer pool frames.
+   *
+   * @param count Number of pages to append.
+   * @param pages Array of <count> pointers to the pages to append.
+   * @throws  FileIOException  If the file cannot be extended or written.
+   */
+  void appendPages(const PageId count, Page* const* pages);
+
+  /**
+   * Moves the used pages to the front of the file, keeping their order, and
+   * truncates the file after the last of them.  Afterwards the used pages
+   * are numbered 1 to n and the file has no free pages.
+   *
+   * Pages of the file held elsewhere keep their old numbers; use
+   * BufMgr::compactFile() for files read through a buffer manager.  The
+   * compacted file is written and synced next to this one, under the name
+   * with ".compact" appended, and then renamed over it, so a crash leaves
+   * either the old or the new file in place, and the disk needs room for
+   * both meanwhile.  A compressed file is rewritten the same way, without
+   * the slots its pages have moved out of.
+   *
+   * @return  New page number of each page, indexed by its old page number;
+   *          Page::INVALID_NUMBER for pages that were not used.
+   * @throws  FileIOException  If the new file cannot be written or renamed;
+   *                           this file is unchanged then.
+   * @throws  BadFileException  If the used pages are not linked in page number
+   *                            order.
+   */
+  std::vector<PageId> compact();
+
+  /**
+   * Gives a copy of a page held elsewhere during compact(), e.g. in a frame
+   * of the buffer pool, the page numbers compact() gave it and the next used
+   * page.
+   *
+   * @param page        Copy of a used page, numbered as before compact().
+   * @param new_numbers New page numbers returned by compact().
+   */
+  static void renumberPage(Page& page,
+                           const std::vector<PageId>& new_numbers);
+
+  /**
+   * Reads an existing page from the file and verifies its checksum.
    *
    * @param page_number   Number of page to read.
    * @return  The page.
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
+   * @throws  PageChecksumException  If the page does not match its checksum.
    */
   Page readPage(const PageId page_number) const;
 
   /**
-   * Writes a page into the file, replacing any existing contents.  The page
-   * must have been already allocated in this file by a call to allocatePage().
+   * Reads an existing page from the file like readPage(), but without
+   * verifying its checksum, so that the caller can verify it later with
+   * Page::checksumValid().
+   *
+   * @param page_number   Number of page to read.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  PageChecksumException  If the file is compressed and the page
+   *                                 cannot be decompressed.
+   */
+  Page readPageUnverified(const PageId page_number) const;
+
+  /**
+   * Writes a page into the file, replacing any existing contents, with a
+   * new checksum.  The page must have been already allocated in this file by
+   * a call to allocatePage().
    *
    * @see allocatePage()
    * @param new_page  Page to write.
@@ -165,18 +459,74 @@ class File {
   void writePage(const Page& new_page);
 
   /**
-   * Deletes a page from the file.
+   * Deletes a page from the file.  Like allocatePage(), a crash of the
+   * process while the page is unlinked leaves a consistent file.
    *
    * @param page_number   Number of page to delete.
    */
   void deletePage(const PageId page_number);
 
+  /**
+   * Sets when writes to the file become durable.  The mode belongs to the
+   * open file and is shared by all File objects referring to it.  Switching
+   * to a mode other than GroupSync::NONE first syncs the writes made so far.
+   *
+   * @param mode              GroupSync::NONE, GroupSync::BATCHED or
+   *                          GroupSync::COMMIT.
+   * @param batch_bytes       In mode BATCHED, unsynced bytes after which the
+   *                          flusher thread syncs the file.
+   * @param batch_interval_ms In mode BATCHED, milliseconds after a write by
+   *                          which the flusher thread syncs the file.
+   * @throws  FileIOException  If fdatasync() fails.
+   */
+  void setDurability(const GroupSync::Mode mode,
+                     const std::size_t batch_bytes =
+                         GroupSync::DEFAULT_BATCH_BYTES,
+                     const unsigned int batch_interval_ms =
+                         GroupSync::DEFAULT_BATCH_INTERVAL_MS);
+
+  /**
+   * Returns the durability mode of the file.
+   */
+  GroupSync::Mode durability() const { return sync_->mode(); }
+
+  /**
+   * In durability mode GroupSync::COMMIT, returns once every write made to
+   * the file before the call is durable.  Concurrent callers share one
+   * fdatasync().  Does nothing in the other modes.
+   *
+   * @throws  FileIOException  If fdatasync() fails.
+   */
+  void commit() { sync_->commit(); }
+
+  /**
+   * Returns once every write made to the file before the call is durable,
+   * whatever the durability mode.
+   *
+   * @throws  FileIOException  If fdatasync() fails.
+   */
+  void sync() { sync_->sync(); }
+
+  /**
+   * Returns the number of times the file has been synced since it was
+   * opened.
+   */
+  std::uint64_t syncCount() const { return sync_->syncCount(); }
+
   /**
    * Returns the name of the file this object represents.
    *
    * @return Name of file.
    */
-  const std::string& filename() const { return filename_; }
+  std::string filename() const;
+
+  /**
+   * Returns the id of the file this object represents, which stays the same
+   * for as long as the file is open.
+   *
+   * @return Id of file.
+   */
+  FileId id() const { return id_; }
 
   /**
    * Returns an iterator at the first page in the file.
@@ -201,10 +551,21 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static off_t pagePosition(const PageId page_number) {
+    return static_cast<off_t>(page_number) * Page::SIZE;
   }
 
+  /**
+   * Largest number of bytes pack() stores for a page.
+   */
+  static const std::size_t MAX_STORED_SIZE = sizeof(std::uint32_t) + Page::SIZE;
+
+  /**
+   * Most bytes of adjacent slots readPages() reads with one call on a
+   * compressed file.
+   */
+  static const std::size_t RUN_SIZE = 64 * 1024;
+
   /**
    * Constructs a file object representing a file on the filesystem.
    * This method should not be called directly; instead use the static methods
@@ -214,30 +575,38 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param compressed  Whether a new file stores its pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const bool compressed);
 
   /**
-   * Opens the underlying file named in filename_.
+   * Opens the underlying file with the given name.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor.
    *
+   * The page map of a compressed file is loaded here, so that it is
+   * registered along with the file.
+   *
+   * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param compressed  Whether a new file stores its pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const std::string& name, const bool create_new,
+                    const bool compressed);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying file descriptor in <fd_>.
    * This method only closes the file if no other File objects exist that access
-   * the same file.
+   * the same file.  Afterwards this object does not refer to a file.
    */
   void close();
 
@@ -250,11 +619,15 @@ class File {
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
+   * @param verify        Whether to verify the checksum of the page.
    * @return  The page.
    * @throws  InvalidPageException  If the page is free (unused) and
    *                                allow_free is false.
+   * @throws  PageChecksumException  If verify is set and the page does not
+   *                                 match its checksum.
    */
-  Page readPage(const PageId page_number, const bool allow_free) const;
+  Page readPage(const PageId page_number, const bool allow_free,
+                const bool verify = true) const;
 
   /**
    * Writes a page into the file at the given page number.  This does not
@@ -278,6 +651,197 @@ class File {
   void writePage(const PageId page_number, const PageHeader& header,
                  const Page& new_page);
 
+  /**
+   * Fills a buffer of Page::SIZE bytes with a page as it is stored: the
+   * given header with the checksum of the page, followed by its data.
+   *
+   * @param header  Header of the page.
+   * @param page    Page whose data to copy.
+   * @param buffer  Buffer to fill.
+   */
+  static void pageImage(const PageHeader& header, const Page& page,
+                        char* buffer);
+
+  /**
+   * Creates the file a compaction is written to, replacing one left over by
+   * a compaction that did not finish.
+   *
+   * @param temp_name Receives the name of the file.
+   * @return  Descriptor of the file.
+   * @throws  FileIOException  If the file cannot be created.
+   */
+  int createCompacted(std::string& temp_name) const;
+
+  /**
+   * Writes bytes at the given offset of the file a compaction is written to.
+   *
+   * @param temp_fd   Descriptor of the file.
+   * @param temp_name Name of the file, for errors.
+   * @param offset    Offset from the beginning of the file.
+   * @param buffer    Bytes to write.
+   * @param length    Number of bytes to write.
+   * @throws  FileIOException  If pwrite() fails.
+   */
+  static void writeCompacted(const int temp_fd, const std::string& temp_name,
+                             const off_t offset, const char* buffer,
+                             const std::size_t length);
+
+  /**
+   * Syncs the file a compaction was written to and renames it over this
+   * one, then makes the descriptor every File of this file shares refer to
+   * it.  The file is removed if that fails.
+   *
+   * @param temp_fd   Descriptor of the file, which is closed.
+   * @param temp_name Name of the file.
+   * @throws  FileIOException  If the file cannot be synced or renamed.
+   */
+  void replaceWithCompacted(const int temp_fd, const std::string& temp_name);
+
+  /**
+   * Makes sure the file has disk space for <pages> more pages after the
+   * allocated ones, growing it by whole extents if it does not.  Updates the
+   * given header but does not write it.
+   *
+   * @param header  Header of this file.
+   * @param pages   Number of pages about to be allocated.
+   * @throws  FileIOException  If the file cannot be extended.
+   */
+  void reserve(FileHeader& header, const PageId pages);
+
+  /**
+   * Gives the disk space of a deleted page, except for its header, back to
+   * the filesystem.  Does nothing if the filesystem cannot punch holes.
+   *
+   * @param page_number   Number of the deleted page.
+   * @throws  FileIOException  If fallocate() fails otherwise.
+   */
+  void punchHole(const PageId page_number);
+
+  /**
+   * Moves the used pages of a compressed file to the front of the file like
+   * compact(), leaving out unused slots.
+   *
+   * @return  New page number of each page, indexed by its old page number.
+   * @throws  FileIOException  If the new file cannot be written or renamed.
+   * @throws  BadFileException  If the used pages are not linked in page number
+   *                            order.
+   */
+  std::vector<PageId> compactCompressed();
+
+  /**
+   * Reads the first bytes of a page of a compressed file from its slot,
+   * decompressed; only as many stored bytes are read as they take.  A page
+   * that was never written reads as zeros.
+   *
+   * @param page_number   Number of page to read.
+   * @param buffer        Buffer to read the bytes into.
+   * @param length        Number of bytes to read; at most Page::SIZE.
+   * @throws  FileIOException  If pread() fails.
+   * @throws  PageChecksumException  If the page cannot be decompressed.
+   */
+  void readCompressed(const PageId page_number, char* buffer,
+                      const std::size_t length) const;
+
+  /**
+   * Compresses a page of a compressed file and writes it to its slot, or to
+   * a new one if it does not fit.
+   *
+   * @param page_number   Number of page to write.
+   * @param buffer        Page::SIZE bytes of the page.
+   * @throws  FileIOException  If pwrite() fails.
+   */
+  void writeCompressed(const PageId page_number, const char* buffer);
+
+  /**
+   * Compresses a page into the form it is stored in: the length of the
+   * compressed bytes followed by them, or by the page itself if it does not
+   * compress.
+   *
+   * @param buffer  Page::SIZE bytes of the page.
+   * @param stored  Buffer of at least MAX_STORED_SIZE bytes.
+   * @return  Number of bytes to store.
+   */
+  static std::size_t pack(const char* buffer, char* stored);
+
+  /**
+   * Decompresses the first bytes of a page as stored by pack().
+   *
+   * @param page_number   Number of the page, for errors.
+   * @param stored        Stored bytes.
+   * @param length        Number of stored bytes available.
+   * @param buffer        Buffer to decompress the bytes into.
+   * @param page_length   Number of bytes to decompress; at most Page::SIZE.
+   * @throws  PageChecksumException  If the page cannot be decompressed.
+   */
+  void unpack(const PageId page_number, const char* stored,
+              const std::size_t length, char* buffer,
+              const std::size_t page_length) const;
+
+  /**
+   * Returns a function that writes to this file with writeAt().
+   */
+  PageMap::Writer writer();
+
+  /**
+   * Reads bytes at the given offset.
+   *
+   * @param offset  Offset from the beginning of the file.
+   * @param buffer  Buffer to read into.
+   * @param length  Number of bytes to read.
+   * @throws  FileIOException  If pread() fails or the file ends first.
+   */
+  void readAt(const off_t offset, char* buffer, const std::size_t length) const;
+
+  /**
+   * Reads the slots of compressed pages, or the page map, at the given
+   * offset.  Slots and the map are padded to PageMap::ALIGNMENT, and the
+   * padding at the end of the file, like map entries never written, reads as
+   * zeros.  unpack() detects a stored page that is cut short.
+   *
+   * @param offset  Offset from the beginning of the file.
+   * @param buffer  Buffer to read into.
+   * @param length  Number of bytes to read.
+   * @throws  FileIOException  If pread() fails.
+   */
+  void readSlotAt(const off_t offset, char* buffer,
+                  const std::size_t length) const;
+
+  /**
+   * Reads bytes at the given offset until <length> bytes are read or the
+   * file ends.
+   *
+   * @param offset  Offset from the beginning of the file.
+   * @param buffer  Buffer to read into.
+   * @param length  Number of bytes to read.
+   * @return  Number of bytes read.
+   * @throws  FileIOException  If pread() fails.
+   */
+  std::size_t readUpTo(const off_t offset, char* buffer,
+                       const std::size_t length) const;
+
+  /**
+   * Writes bytes to a file descriptor at the given offset.
+   *
+   * @param fd      File descriptor.
+   * @param offset  Offset from the beginning of the file.
+   * @param buffer  Bytes to write.
+   * @param length  Number of bytes to write.
+   * @return  0, or the errno of the failed pwrite().
+   */
+  static int writeFd(const int fd, const off_t offset, const char* buffer,
+                     const std::size_t length);
+
+  /**
+   * Writes bytes at the given offset and records the write for the
+   * durability mode of the file.
+   *
+   * @param offset  Offset from the beginning of the file.
+   * @param buffer  Bytes to write.
+   * @param length  Number of bytes to write.
+   * @throws  FileIOException  If pwrite() fails.
+   */
+  void writeAt(const off_t offset, const char* buffer, const std::size_t length);
+
   /**
    * Reads the header for this file from disk.
    *
@@ -292,6 +856,23 @@ class File {
    */
   void writeHeader(const FileHeader& header);
 
+  /**
+   * Writes the header with the pending page rewrites set in it, then the
+   * pages, then the header with the rewrites cleared, so that a crash in
+   * between leaves the rewrites to finishPendingWrites().
+   *
+   * @param header  New header of the file, with the pending rewrites set.
+   */
+  void writePending(FileHeader& header);
+
+  /**
+   * Rewrites the pages the header says are pending and clears them in the
+   * header.  Rewriting a page twice leaves the same page.
+   *
+   * @param header  Header of the file; its pending rewrites are cleared.
+   */
+  void finishPendingWrites(FileHeader& header);
+
   /**
    * Reads only the header of the given page from disk (not the record data
    * or slot table).  No bounds checking is performed.
@@ -301,29 +882,27 @@ class File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
-  typedef std::map<std::string,
-                   std::shared_ptr<std::fstream> > StreamMap;
-  typedef std::map<std::string, int> CountMap;
-
   /**
-   * Streams for opened files.
+   * Id of the file this object represents, or FileRegistry::INVALID_ID.
    */
-  static StreamMap open_streams_;
+  FileId id_;
 
   /**
-   * Counts for opened files.
+   * File descriptor of underlying filesystem object, owned by the
+   * FileRegistry.
    */
-  static CountMap open_counts_;
+  int fd_;
 
   /**
-   * Name of the file this object represents.
+   * Sync state of the file, owned by the FileRegistry.
    */
-  std::string filename_;
+  GroupSync* sync_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Page map of a compressed file, owned by the FileRegistry; NULL if the
+   * file is not compressed.
    */
-  std::shared_ptr<std::fstream> stream_;
+  PageMap* map_;
 
   friend class FileIterator;
   friend class FileTest;
@@ -0,0 +1,151 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_registry.h"
+
+#include <unistd.h>
+
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+const FileId FileRegistry::INVALID_ID;
+
+std::mutex FileRegistry::mutex_;
+std::deque<FileRegistry::Entry> FileRegistry::entries_;
+std::vector<FileId> FileRegistry::free_ids_;
+std::map<std::string, FileId> FileRegistry::ids_;
+std::mutex FileRegistry::hooks_mutex_;
+std::map<int, std::function<bool(FileId)> > FileRegistry::hooks_;
+int FileRegistry::next_hook_ = 0;
+
+bool FileRegistry::retain(const std::string& filename, FileId& id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::map<std::string, FileId>::const_iterator it = ids_.find(filename);
+  if (it == ids_.end()) {
+    return false;
+  }
+  id = it->second;
+  ++entries_[id].open_count;
+  return true;
+}
+
+bool FileRegistry::add(const std::string& filename, const int fd,
+                       const std::shared_ptr<PageMap>& page_map, FileId& id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  // The name is looked up again under the same lock as the insert, so that
+  // two threads opening one file end up with one id.
+  std::map<std::string, FileId>::const_iterator it = ids_.find(filename);
+  if (it != ids_.end()) {
+    id = it->second;
+    ++entries_[id].open_count;
+    return false;
+  }
+  if (free_ids_.empty()) {
+    id = entries_.size();
+    entries_.push_back(Entry());
+  } else {
+    id = free_ids_.back();
+    free_ids_.pop_back();
+  }
+  entries_[id].filename = filename;
+  entries_[id].fd = fd;
+  entries_[id].sync.reset(new GroupSync(fd, filename));
+  entries_[id].page_map = page_map;
+  entries_[id].open_count = 1;
+  ids_[filename] = id;
+  return true;
+}
+
+void FileRegistry::retain(const FileId id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  ++entries_[id].open_count;
+}
+
+void FileRegistry::release(const FileId id) {
+  // The last reference takes the file's name out of the table; the hooks,
+  // syncing and closing then run without the mutex, so that opening and
+  // closing other files does not wait for the disk.  The id is only freed
+  // once the hooks are done with it.
+  std::shared_ptr<GroupSync> sync;
+  int fd;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Entry& entry = entries_[id];
+    if (--entry.open_count != 0) {
+      return;
+    }
+    ids_.erase(entry.filename);
+  }
+  bool reusable = true;
+  {
+    std::lock_guard<std::mutex> hooks_guard(hooks_mutex_);
+    for (std::map<int, std::function<bool(FileId)> >::const_iterator it =
+             hooks_.begin();
+         it != hooks_.end(); ++it) {
+      reusable = it->second(id) && reusable;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Entry& entry = entries_[id];
+    sync.swap(entry.sync);
+    fd = entry.fd;
+    entry.filename.clear();
+    entry.fd = -1;
+    entry.page_map.reset();
+    if (reusable) {
+      free_ids_.push_back(id);
+    }
+  }
+  if (sync->mode() != GroupSync::NONE) {
+    try {
+      sync->sync();
+    } catch (const FileIOException&) {
+    }
+  }
+  sync.reset();
+  ::close(fd);
+}
+
+int FileRegistry::addReleaseHook(const std::function<bool(FileId)>& hook) {
+  std::lock_guard<std::mutex> guard(hooks_mutex_);
+  hooks_[next_hook_] = hook;
+  return next_hook_++;
+}
+
+void FileRegistry::removeReleaseHook(const int handle) {
+  std::lock_guard<std::mutex> guard(hooks_mutex_);
+  hooks_.erase(handle);
+}
+
+bool FileRegistry::isOpen(const std::string& filename) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return ids_.find(filename) != ids_.end();
+}
+
+std::string FileRegistry::filename(const FileId id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return id < entries_.size() ? entries_[id].filename : std::string();
+}
+
+int FileRegistry::fd(const FileId id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return entries_[id].fd;
+}
+
+GroupSync* FileRegistry::sync(const FileId id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return entries_[id].sync.get();
+}
+
+PageMap* FileRegistry::pageMap(const FileId id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return entries_[id].page_map.get();
+}
+
+}
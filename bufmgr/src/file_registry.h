@@ -0,0 +1,211 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "group_sync.h"
+#include "page_map.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Process-wide table of open files, each identified by a dense integer
+ *        FileId.
+ *
+ * A file gets an id when it is first opened and keeps it until the last File
+ * object referring to it is closed; the id may then be handed out again, once
+ * the release hooks, through which buffer managers drop the pages they keep
+ * under the id, have run.  The
+ * registry owns the file descriptor, the GroupSync and, for compressed files,
+ * the PageMap of every open file and counts the File objects that use it.  Only opening a file looks up its name; copying and closing a
+ * File, and the buffer manager's page lookups, work on the id alone.
+ *
+ * All methods are static and may be called from several threads.
+ */
+class FileRegistry {
+ public:
+  /**
+   * Id that no open file has.
+   */
+  static const FileId INVALID_ID = 0xffffffff;
+
+  /**
+   * Returns the id of the open file with the given name and adds a reference
+   * to it.
+   *
+   * @param filename  Name of the file.
+   * @param id        Id of the file, returned via this variable.
+   * @return  False if the file is not open.
+   */
+  static bool retain(const std::string& filename, FileId& id);
+
+  /**
+   * Registers a newly opened file with one reference.  If another thread has
+   * registered a file of the same name since retain() missed it, a reference
+   * to that file is added instead and the caller closes its descriptor.
+   *
+   * @param filename  Name of the file.
+   * @param fd        File descriptor of the file; the registry takes
+   *                  ownership if the file is registered.
+   * @param page_map  Page map of the file if it is compressed, else NULL.
+   * @param id        Id of the file, returned via this variable.
+   * @return  False if the file was registered already.
+   */
+  static bool add(const std::string& filename, const int fd,
+                  const std::shared_ptr<PageMap>& page_map, FileId& id);
+
+  /**
+   * Adds a reference to an open file.
+   *
+   * @param id  Id of the file.
+   */
+  static void retain(const FileId id);
+
+  /**
+   * Drops a reference to an open file.  The last reference runs the release
+   * hooks, syncs the file unless its durability mode is NONE, closes the file
+   * descriptor and frees the id.  A failing sync is not reported, since this
+   * runs in destructors; call File::sync() first to see errors.
+   *
+   * @param id  Id of the file.
+   */
+  static void release(const FileId id);
+
+  /**
+   * Registers a function to call with the id of a file whose last reference
+   * is dropped, before the file descriptor is closed and the id reused.  The
+   * function returns false if it still keeps something under the id, which
+   * is then never handed out again.
+   *
+   * @param hook  Function to call; it must not open or close files.
+   * @return  Handle to remove the hook with.
+   */
+  static int addReleaseHook(const std::function<bool(FileId)>& hook);
+
+  /**
+   * Removes a release hook.  Once this returns, the hook is not running and
+   * will not be called again.
+   *
+   * @param handle  Handle returned by addReleaseHook().
+   */
+  static void removeReleaseHook(const int handle);
+
+  /**
+   * Returns true if a file with the given name is open.
+   *
+   * @param filename  Name of the file.
+   */
+  static bool isOpen(const std::string& filename);
+
+  /**
+   * Returns the name of an open file, or an empty string if the id is not in
+   * use.  The name is copied, since the id may be released and reused as soon
+   * as the registry's mutex is dropped.
+   *
+   * @param id  Id of the file.
+   */
+  static std::string filename(const FileId id);
+
+  /**
+   * Returns the file descriptor of an open file.
+   *
+   * @param id  Id of the file.
+   */
+  static int fd(const FileId id);
+
+  /**
+   * Returns the sync state of an open file.
+   *
+   * @param id  Id of the file.
+   */
+  static GroupSync* sync(const FileId id);
+
+  /**
+   * Returns the page map of an open file, or NULL if it is not compressed.
+   *
+   * @param id  Id of the file.
+   */
+  static PageMap* pageMap(const FileId id);
+
+ private:
+  /**
+   * @brief State of one open file.
+   */
+  struct Entry {
+    /**
+     * Name of the file.
+     */
+    std::string filename;
+
+    /**
+     * File descriptor of the underlying filesystem object.
+     */
+    int fd;
+
+    /**
+     * Durability mode and sync state of the file.
+     */
+    std::shared_ptr<GroupSync> sync;
+
+    /**
+     * Where the pages of a compressed file are stored; empty otherwise.
+     */
+    std::shared_ptr<PageMap> page_map;
+
+    /**
+     * Number of File objects referring to the file.
+     */
+    int open_count;
+  };
+
+  /**
+   * Protects all members.
+   */
+  static std::mutex mutex_;
+
+  /**
+   * Entries indexed by id.  A deque, so that entries never move.
+   */
+  static std::deque<Entry> entries_;
+
+  /**
+   * Ids of closed files, ready for reuse.
+   */
+  static std::vector<FileId> free_ids_;
+
+  /**
+   * Ids of the open files by name.
+   */
+  static std::map<std::string, FileId> ids_;
+
+  /**
+   * Protects hooks_ and next_hook_, and is held while the hooks run.  Taken
+   * before mutex_ if both are held.
+   */
+  static std::mutex hooks_mutex_;
+
+  /**
+   * Release hooks by handle.
+   */
+  static std::map<int, std::function<bool(FileId)> > hooks_;
+
+  /**
+   * Handle of the next release hook.
+   */
+  static int next_hook_;
+};
+
+}
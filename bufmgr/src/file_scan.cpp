@@ -0,0 +1,87 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_scan.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+const std::size_t FileScan::DEFAULT_BLOCK_BYTES;
+
+FileScan::FileScan(File* file, const std::size_t block_bytes)
+    : file_(file),
+      block_pages_(std::max<std::size_t>(block_bytes / Page::SIZE, 1)),
+      current_(NULL),
+      pending_(NULL),
+      blocks_read_(0) {
+  num_pages_ = file_->pageCount();
+  next_page_number_ = file_->firstUsedPage();
+  for (int i = 0; i < 2; ++i) {
+    blocks_[i].first = Page::INVALID_NUMBER;
+    blocks_[i].count = 0;
+    blocks_[i].pages.resize(block_pages_);
+  }
+  if (next_page_number_ != Page::INVALID_NUMBER) {
+    // The first block is read in the background too, so that the caller can
+    // set up while it is on its way.
+    pending_ = &blocks_[0];
+    pending_read_ = std::async(std::launch::async, &FileScan::fill, this,
+                               pending_, next_page_number_);
+  }
+}
+
+FileScan::~FileScan() {
+  if (pending_ != NULL) {
+    pending_read_.wait();
+  }
+}
+
+Page* FileScan::next() {
+  if (next_page_number_ == Page::INVALID_NUMBER ||
+      next_page_number_ >= num_pages_) {
+    return NULL;
+  }
+  if (current_ == NULL || !current_->contains(next_page_number_)) {
+    Block* const other = current_ == &blocks_[0] ? &blocks_[1] : &blocks_[0];
+    if (pending_ != NULL) {
+      pending_ = NULL;
+      pending_read_.get();
+    }
+    if (!other->contains(next_page_number_)) {
+      // The used list jumped away from the blocks read so far.
+      fill(other, next_page_number_);
+    }
+    current_ = other;
+    prefetch();
+  }
+
+  Page* page = &current_->pages[next_page_number_ - current_->first];
+  next_page_number_ = page->next_page_number();
+  return page;
+}
+
+void FileScan::fill(Block* block, const PageId first_page_number) {
+  block->first = first_page_number;
+  block->count = std::min(block_pages_, num_pages_ - first_page_number);
+  file_->readPages(block->first, block->count, &block->pages[0]);
+  ++blocks_read_;
+}
+
+void FileScan::prefetch() {
+  const PageId first = current_->first + current_->count;
+  if (first >= num_pages_) {
+    return;
+  }
+  pending_ = current_ == &blocks_[0] ? &blocks_[1] : &blocks_[0];
+  // Invalidate the block first, so that it is not used if the read fails.
+  pending_->count = 0;
+  pending_read_ = std::async(std::launch::async, &FileScan::fill, this,
+                             pending_, first);
+}
+
+}
@@ -0,0 +1,162 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <future>
+#include <vector>
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Cursor for scanning the used pages of a file in large blocks.
+ *
+ * Where FileIterator reads every page on its own, a FileScan reads the file
+ * in blocks of many consecutive pages.  While the caller works on the pages
+ * of one block, the next block is read in the background into a second
+ * buffer.  Pages are read straight into the buffers and handed out by
+ * pointer, without being copied.
+ *
+ * Pages come in used list order.  As long as the used list runs forward
+ * through the file, which it does unless the file was modified through
+ * other means, every block is read once; a jump elsewhere reads a new block
+ * at the target page.
+ *
+ * The file must not be modified during the scan.
+ */
+class FileScan {
+ public:
+  /**
+   * Size of a block if none is given.
+   */
+  static const std::size_t DEFAULT_BLOCK_BYTES = 1 << 20;
+
+  /**
+   * Starts a scan at the first used page of the file.
+   *
+   * @param file        File to scan.
+   * @param block_bytes Bytes read at once; rounded down to whole pages, at
+   *                    least one.
+   */
+  explicit FileScan(File* file,
+                    const std::size_t block_bytes = DEFAULT_BLOCK_BYTES);
+
+  /**
+   * Waits for a read still running in the background.
+   */
+  ~FileScan();
+
+  /**
+   * Returns the next used page of the file.  The page stays valid until the
+   * next call; changes to it are not written to the file.
+   *
+   * @return  The page, or NULL after the last page.
+   * @throws  FileIOException  If the file cannot be read.
+   */
+  Page* next();
+
+  /**
+   * Returns the number of blocks read so far.
+   */
+  std::size_t blocksRead() const { return blocks_read_; }
+
+ private:
+  /**
+   * @brief Buffer holding a run of consecutive pages of the file.
+   */
+  struct Block {
+    /**
+     * Number of the first page in the block.
+     */
+    PageId first;
+
+    /**
+     * Number of pages read into the block.
+     */
+    PageId count;
+
+    /**
+     * The pages.
+     */
+    std::vector<Page> pages;
+
+    /**
+     * Returns true if the block holds the page with the given number.
+     */
+    bool contains(const PageId page_number) const {
+      return page_number >= first && page_number - first < count;
+    }
+  };
+
+  FileScan(const FileScan&);
+  FileScan& operator=(const FileScan&);
+
+  /**
+   * Reads pages into a block, starting at the given page.
+   *
+   * @param block             Block to read into.
+   * @param first_page_number Number of first page to read.
+   */
+  void fill(Block* block, const PageId first_page_number);
+
+  /**
+   * Starts reading the block after the current one into the other buffer.
+   */
+  void prefetch();
+
+  /**
+   * File being scanned.
+   */
+  File* file_;
+
+  /**
+   * Number of pages in the file when the scan started.
+   */
+  PageId num_pages_;
+
+  /**
+   * Number of pages in a block.
+   */
+  PageId block_pages_;
+
+  /**
+   * The two buffers.
+   */
+  Block blocks_[2];
+
+  /**
+   * Block holding the pages handed out.
+   */
+  Block* current_;
+
+  /**
+   * Block being read in the background, or NULL.
+   */
+  Block* pending_;
+
+  /**
+   * Completion of the background read into <pending_>.
+   */
+  std::future<void> pending_read_;
+
+  /**
+   * Number of the next page to hand out.
+   */
+  PageId next_page_number_;
+
+  /**
+   * Number of blocks read so far, counted by the reading thread.
+   */
+  std::atomic<std::size_t> blocks_read_;
+};
+
+}
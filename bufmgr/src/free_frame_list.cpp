@@ -0,0 +1,47 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "free_frame_list.h"
+
+namespace badgerdb {
+
+FreeFrameList::FreeFrameList(const std::uint32_t frames) : head_(END) {
+  next_ = new std::atomic<FrameId>[frames];
+  for (std::uint32_t i = 0; i < frames; ++i) {
+    next_[i].store(END, std::memory_order_relaxed);
+  }
+}
+
+FreeFrameList::~FreeFrameList() {
+  delete[] next_;
+}
+
+void FreeFrameList::push(const FrameId frame) {
+  std::uint64_t head = head_.load(std::memory_order_relaxed);
+  do {
+    next_[frame].store(frameOf(head), std::memory_order_relaxed);
+  } while (!head_.compare_exchange_weak(head, makeHead(frame, head),
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed));
+}
+
+bool FreeFrameList::pop(FrameId& frame) {
+  std::uint64_t head = head_.load(std::memory_order_acquire);
+  do {
+    if (frameOf(head) == END) {
+      return false;
+    }
+    // A concurrent pop may already have taken the frame; the tag makes the
+    // exchange below fail in that case, so a stale next-pointer is harmless.
+  } while (!head_.compare_exchange_weak(
+      head, makeHead(next_[frameOf(head)].load(std::memory_order_relaxed), head),
+      std::memory_order_acquire, std::memory_order_acquire));
+  frame = frameOf(head);
+  return true;
+}
+
+}
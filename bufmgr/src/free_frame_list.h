@@ -0,0 +1,100 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Lock-free stack of the frames of a buffer pool that hold no page.
+ *
+ * The stack is linked through an array with one next-pointer per frame, so it
+ * needs no allocation after construction.  The head word packs the top frame
+ * with a tag that changes on every push and pop; a pop that raced with a pop
+ * and a push of the same frame then fails its compare-and-swap instead of
+ * linking in a stale next-pointer (the ABA problem).
+ *
+ * A frame must not be pushed while it is already on the list.
+ */
+class FreeFrameList {
+ public:
+  /**
+   * Constructs an empty list for a pool of the given size.
+   *
+   * @param frames  Number of frames in the buffer pool.
+   */
+  explicit FreeFrameList(const std::uint32_t frames);
+
+  /**
+   * Destructor of FreeFrameList class
+   */
+  ~FreeFrameList();
+
+  /**
+   * Puts a frame on the list.
+   *
+   * @param frame   Frame that no longer holds a page.
+   */
+  void push(const FrameId frame);
+
+  /**
+   * Takes a frame off the list.
+   *
+   * @param frame   Frame reference, the frame taken is returned via this
+   *                variable.
+   * @return  False if the list is empty.
+   */
+  bool pop(FrameId& frame);
+
+  /**
+   * Returns true if there is no frame on the list.
+   */
+  bool empty() const {
+    return frameOf(head_.load(std::memory_order_acquire)) == END;
+  }
+
+ private:
+  FreeFrameList(const FreeFrameList&);
+  FreeFrameList& operator=(const FreeFrameList&);
+
+  /**
+   * Frame number that marks the end of the list.
+   */
+  static const FrameId END = 0xffffffff;
+
+  /**
+   * Returns the frame in the low half of a head word.
+   */
+  static FrameId frameOf(const std::uint64_t head) {
+    return static_cast<FrameId>(head);
+  }
+
+  /**
+   * Builds a head word from a frame and the tag of the previous head.
+   */
+  static std::uint64_t makeHead(const FrameId frame,
+                                const std::uint64_t previous) {
+    return (((previous >> 32) + 1) << 32) | frame;
+  }
+
+  /**
+   * Top frame in the low 32 bits, tag in the high 32 bits.
+   */
+  std::atomic<std::uint64_t> head_;
+
+  /**
+   * Frame below each frame on the list.
+   */
+  std::atomic<FrameId>* next_;
+};
+
+}
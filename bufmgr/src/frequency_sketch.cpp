@@ -0,0 +1,113 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "frequency_sketch.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Seeds of the four hash functions.
+ */
+const std::uint64_t SEEDS[4] = {0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL,
+                                0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
+
+/**
+ * Mask that clears the top bit of every counter after a shift, halving them.
+ */
+const std::uint64_t RESET_MASK = 0x7777777777777777ULL;
+
+/**
+ * Spreads the bits of a key so that nearby keys land in unrelated counters.
+ */
+std::uint64_t spread(std::uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+}
+
+FrequencySketch::FrequencySketch(const std::uint32_t capacity)
+    : additions_(0) {
+  std::uint32_t words = 64;
+  while (words < capacity) {
+    words <<= 1;
+  }
+  table_mask_ = words - 1;
+  table_ = new std::atomic<std::uint64_t>[words];
+  for (std::uint32_t i = 0; i < words; ++i) {
+    table_[i].store(0, std::memory_order_relaxed);
+  }
+  sample_size_ = 10 * (capacity > 0 ? capacity : 1);
+}
+
+FrequencySketch::~FrequencySketch() {
+  delete[] table_;
+}
+
+void FrequencySketch::increment(const std::uint64_t key) {
+  const std::uint64_t hash = spread(key);
+  // Each key uses one group of four counters in every word it maps to.
+  const int start = (hash & 3) << 2;
+  bool added = false;
+  for (int i = 0; i < 4; ++i) {
+    added |= incrementAt(indexOf(hash, i), start + i);
+  }
+  if (added &&
+      additions_.fetch_add(1, std::memory_order_relaxed) + 1 >= sample_size_) {
+    reset();
+  }
+}
+
+std::uint32_t FrequencySketch::frequency(const std::uint64_t key) const {
+  const std::uint64_t hash = spread(key);
+  const int start = (hash & 3) << 2;
+  std::uint32_t frequency = MAX_FREQUENCY;
+  for (int i = 0; i < 4; ++i) {
+    const std::uint64_t word =
+        table_[indexOf(hash, i)].load(std::memory_order_relaxed);
+    const std::uint32_t count = (word >> ((start + i) << 2)) & 0xf;
+    if (count < frequency) {
+      frequency = count;
+    }
+  }
+  return frequency;
+}
+
+void FrequencySketch::reset() {
+  for (std::uint32_t i = 0; i <= table_mask_; ++i) {
+    const std::uint64_t word = table_[i].load(std::memory_order_relaxed);
+    table_[i].store((word >> 1) & RESET_MASK, std::memory_order_relaxed);
+  }
+  additions_.store(additions_.load(std::memory_order_relaxed) / 2,
+                   std::memory_order_relaxed);
+}
+
+std::uint32_t FrequencySketch::indexOf(const std::uint64_t hash,
+                                       const int i) const {
+  std::uint64_t h = (hash + SEEDS[i]) * SEEDS[i];
+  h += h >> 32;
+  return static_cast<std::uint32_t>(h) & table_mask_;
+}
+
+bool FrequencySketch::incrementAt(const std::uint32_t word, const int counter) {
+  const int offset = counter << 2;
+  const std::uint64_t mask = 0xfULL << offset;
+  std::uint64_t current = table_[word].load(std::memory_order_relaxed);
+  while ((current & mask) != mask) {
+    if (table_[word].compare_exchange_weak(current,
+                                           current + (1ULL << offset),
+                                           std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}
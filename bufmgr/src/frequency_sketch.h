@@ -0,0 +1,108 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief Count-min sketch of 4-bit counters which estimates how often keys
+ *        were seen recently (TinyLFU).
+ *
+ * The table is a fixed array of 64-bit words, each holding sixteen 4-bit
+ * counters, sized from the expected number of distinct hot keys.  Every key
+ * maps to one counter in each of four words; its frequency estimate is the
+ * minimum of the four.  After a sample of 10 increments per expected key all
+ * counters are halved, so old popularity fades away.
+ *
+ * Counters are updated with relaxed compare-and-swap on the table words, so
+ * the sketch can be shared by concurrent readers without a lock.  Updates
+ * racing with a reset may be lost, which only makes estimates less precise.
+ */
+class FrequencySketch {
+ public:
+  /**
+   * Largest value a counter can hold.
+   */
+  static const std::uint32_t MAX_FREQUENCY = 15;
+
+  /**
+   * Constructs a sketch for the given number of hot keys.
+   *
+   * @param capacity  Expected number of distinct keys worth remembering,
+   *                  typically the number of frames in the buffer pool.
+   */
+  explicit FrequencySketch(const std::uint32_t capacity);
+
+  /**
+   * Destructor of FrequencySketch class
+   */
+  ~FrequencySketch();
+
+  /**
+   * Records one occurrence of the given key.
+   *
+   * @param key   Key to record, e.g. a hash of (file, page number).
+   */
+  void increment(const std::uint64_t key);
+
+  /**
+   * Returns the estimated number of recent occurrences of the given key.
+   *
+   * @param key   Key to look up.
+   * @return  Estimated frequency, at most MAX_FREQUENCY.
+   */
+  std::uint32_t frequency(const std::uint64_t key) const;
+
+  /**
+   * Halves every counter.  Called automatically once per sample period.
+   */
+  void reset();
+
+ private:
+  /**
+   * Returns the index of the word holding counter <i> of the given key.
+   *
+   * @param hash  Spread hash of the key.
+   * @param i     Number of the hash function, 0 to 3.
+   */
+  std::uint32_t indexOf(const std::uint64_t hash, const int i) const;
+
+  /**
+   * Increments the counter at the given position unless it is saturated.
+   *
+   * @param word    Index of the table word.
+   * @param counter Counter within the word, 0 to 15.
+   * @return  True if the counter was incremented.
+   */
+  bool incrementAt(const std::uint32_t word, const int counter);
+
+  /**
+   * Number of words in <table_> minus one; the table size is a power of two.
+   */
+  std::uint32_t table_mask_;
+
+  /**
+   * Counter words.
+   */
+  std::atomic<std::uint64_t>* table_;
+
+  /**
+   * Number of increments after which all counters are halved.
+   */
+  std::uint32_t sample_size_;
+
+  /**
+   * Increments since the last reset.
+   */
+  std::atomic<std::uint32_t> additions_;
+};
+
+}
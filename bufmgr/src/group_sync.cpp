@@ -0,0 +1,159 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "group_sync.h"
+
+#include <cerrno>
+#include <unistd.h>
+
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+const std::size_t GroupSync::DEFAULT_BATCH_BYTES;
+const unsigned int GroupSync::DEFAULT_BATCH_INTERVAL_MS;
+
+GroupSync::GroupSync(const int fd, const std::string& name)
+    : fd_(fd),
+      name_(name),
+      mode_(NONE),
+      batch_bytes_(DEFAULT_BATCH_BYTES),
+      batch_interval_(DEFAULT_BATCH_INTERVAL_MS),
+      written_(0),
+      synced_(0),
+      syncing_(false),
+      last_sync_(std::chrono::steady_clock::now()),
+      syncs_(0),
+      flush_error_(0) {
+}
+
+GroupSync::~GroupSync() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stopFlusher(lock);
+}
+
+void GroupSync::setMode(const Mode mode, const std::size_t batch_bytes,
+                        const unsigned int batch_interval_ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stopFlusher(lock);
+  mode_ = mode;
+  batch_bytes_ = batch_bytes;
+  batch_interval_ = std::chrono::milliseconds(batch_interval_ms);
+  if (mode_ == BATCHED) {
+    flusher_ = std::thread(&GroupSync::flush, this);
+  }
+  if (mode_ != NONE) {
+    syncUpTo(lock, written_);
+  }
+}
+
+GroupSync::Mode GroupSync::mode() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return mode_;
+}
+
+void GroupSync::noteWrite(const std::size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  written_ += bytes;
+  if (mode_ == BATCHED && written_ - synced_ >= batch_bytes_) {
+    flush_cv_.notify_one();
+  }
+}
+
+void GroupSync::commit() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  throwFlushError();
+  if (mode_ == COMMIT) {
+    syncUpTo(lock, written_);
+  }
+}
+
+void GroupSync::sync() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  throwFlushError();
+  syncUpTo(lock, written_);
+}
+
+std::uint64_t GroupSync::syncCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return syncs_;
+}
+
+void GroupSync::syncUpTo(std::unique_lock<std::mutex>& lock,
+                         const std::uint64_t target) {
+  while (synced_ < target) {
+    if (syncing_) {
+      // Somebody else is syncing; its sync may already cover our writes.
+      synced_cv_.wait(lock);
+      continue;
+    }
+
+    // Lead a sync that covers everything written so far, including the
+    // writes of the committers that will queue up behind us.
+    syncing_ = true;
+    const std::uint64_t covered = written_;
+    last_sync_ = std::chrono::steady_clock::now();
+    ++syncs_;
+    lock.unlock();
+    int result;
+    do {
+      result = fdatasync(fd_);
+    } while (result != 0 && errno == EINTR);
+    const int error = errno;
+    lock.lock();
+    syncing_ = false;
+    if (result == 0 && covered > synced_) {
+      synced_ = covered;
+    }
+    synced_cv_.notify_all();
+    if (result != 0) {
+      throw FileIOException(name_, "fdatasync", error);
+    }
+  }
+}
+
+void GroupSync::flush() {
+  // The thread stops once <flusher_> no longer refers to it.
+  std::unique_lock<std::mutex> lock(mutex_);
+  const std::thread::id self = std::this_thread::get_id();
+  while (flusher_.get_id() == self) {
+    // A write is synced within one interval, or as soon as the batch fills.
+    flush_cv_.wait_for(lock, batch_interval_, [this, self] {
+      return flusher_.get_id() != self || written_ - synced_ >= batch_bytes_;
+    });
+    if (flusher_.get_id() != self || synced_ >= written_) {
+      continue;
+    }
+    try {
+      syncUpTo(lock, written_);
+    } catch (const FileIOException& e) {
+      // Nobody waits for this sync; the next commit() or sync() reports it.
+      flush_error_ = e.error();
+    }
+  }
+}
+
+void GroupSync::stopFlusher(std::unique_lock<std::mutex>& lock) {
+  if (!flusher_.joinable()) {
+    return;
+  }
+  std::thread flusher(std::move(flusher_));
+  flush_cv_.notify_all();
+  lock.unlock();
+  flusher.join();
+  lock.lock();
+}
+
+void GroupSync::throwFlushError() {
+  if (flush_error_ != 0) {
+    const int error = flush_error_;
+    flush_error_ = 0;
+    throw FileIOException(name_, "fdatasync", error);
+  }
+}
+
+}
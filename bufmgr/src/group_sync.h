@@ -0,0 +1,242 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace badgerdb {
+
+/**
+ * @brief Decides when the writes to one file descriptor are made durable
+ *        with fdatasync(), and shares one fdatasync() between concurrent
+ *        committers (group commit).
+ *
+ * Writes are counted in bytes.  A commit waits until every byte written
+ * before it has been synced.  If no sync is running, the committer starts one
+ * that covers everything written so far; committers that arrive while it runs
+ * wait for it, and if their writes came too late to be covered, one of them
+ * starts the next sync for all of them.
+ *
+ * Writes never sync themselves, so that a caller holding a latch, such as
+ * the buffer manager writing back a victim, does not wait for the disk.  In
+ * mode BATCHED a background thread does the syncing.
+ *
+ * All methods may be called from several threads.
+ */
+class GroupSync {
+ public:
+  /**
+   * When writes become durable.
+   */
+  enum Mode {
+    /**
+     * Only when sync() is called.  Writes go to the operating system and
+     * survive a crash of the process, but not of the machine.
+     */
+    NONE,
+
+    /**
+     * In the background: a flusher thread syncs the file once a number of
+     * bytes is unsynced, and at the latest some time after a write.  Bounds
+     * how much a crash of the machine can lose.
+     */
+    BATCHED,
+
+    /**
+     * When commit() is called.  Committers share syncs.
+     */
+    COMMIT
+  };
+
+  /**
+   * Default number of unsynced bytes after which the flusher syncs.
+   */
+  static const std::size_t DEFAULT_BATCH_BYTES = 4 << 20;
+
+  /**
+   * Default time in milliseconds after a write by which the flusher syncs.
+   */
+  static const unsigned int DEFAULT_BATCH_INTERVAL_MS = 100;
+
+  /**
+   * Constructs the sync state for a file descriptor, in mode NONE.
+   *
+   * @param fd    Open file descriptor; not owned.
+   * @param name  Name of the file, for error messages.
+   */
+  GroupSync(const int fd, const std::string& name);
+
+  /**
+   * Stops the flusher thread, if any.  Unsynced writes are not synced.
+   */
+  ~GroupSync();
+
+  /**
+   * Changes the durability mode.  Writes made so far are synced first if the
+   * new mode is not NONE.
+   *
+   * @param mode              New mode.
+   * @param batch_bytes       Unsynced bytes after which the flusher syncs.
+   * @param batch_interval_ms Milliseconds after a write by which the
+   *                          flusher syncs.
+   * @throws  FileIOException  If fdatasync() fails.
+   */
+  void setMode(const Mode mode, const std::size_t batch_bytes,
+               const unsigned int batch_interval_ms);
+
+  /**
+   * Returns the durability mode.
+   */
+  Mode mode() const;
+
+  /**
+   * Records a write of the given number of bytes, and wakes the flusher if
+   * the mode is BATCHED and the batch is full.  Never syncs.
+   *
+   * @param bytes   Number of bytes written.
+   */
+  void noteWrite(const std::size_t bytes);
+
+  /**
+   * In mode COMMIT, returns once every write recorded before the call is
+   * durable.  Does nothing in the other modes.
+   *
+   * @throws  FileIOException  If fdatasync() fails, here or in the flusher
+   *                           since the last call that threw.
+   */
+  void commit();
+
+  /**
+   * Returns once every write recorded before the call is durable, whatever
+   * the mode.
+   *
+   * @throws  FileIOException  If fdatasync() fails, here or in the flusher
+   *                           since the last call that threw.
+   */
+  void sync();
+
+  /**
+   * Returns the number of fdatasync() calls made so far.
+   */
+  std::uint64_t syncCount() const;
+
+ private:
+  GroupSync(const GroupSync&);
+  GroupSync& operator=(const GroupSync&);
+
+  /**
+   * Waits until the first <target> bytes are synced, running fdatasync()
+   * itself if no other thread does.
+   *
+   * @param lock    Lock on <mutex_>, held on entry and on return.
+   * @param target  Number of bytes that must be synced.
+   */
+  void syncUpTo(std::unique_lock<std::mutex>& lock,
+                const std::uint64_t target);
+
+  /**
+   * Body of the flusher thread of mode BATCHED.
+   */
+  void flush();
+
+  /**
+   * Stops the flusher thread and waits for it.
+   *
+   * @param lock    Lock on <mutex_>, held on entry and on return.
+   */
+  void stopFlusher(std::unique_lock<std::mutex>& lock);
+
+  /**
+   * Throws the error the flusher ran into, if any, and forgets it.
+   */
+  void throwFlushError();
+
+  /**
+   * File descriptor to sync.
+   */
+  const int fd_;
+
+  /**
+   * Name of the file.
+   */
+  const std::string name_;
+
+  /**
+   * Protects all members below.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Signalled when a sync finishes.
+   */
+  std::condition_variable synced_cv_;
+
+  /**
+   * Signalled when the flusher has a full batch to sync or must stop.
+   */
+  std::condition_variable flush_cv_;
+
+  /**
+   * Durability mode.
+   */
+  Mode mode_;
+
+  /**
+   * Unsynced bytes after which the flusher syncs.
+   */
+  std::size_t batch_bytes_;
+
+  /**
+   * Time after a write by which the flusher syncs.
+   */
+  std::chrono::milliseconds batch_interval_;
+
+  /**
+   * Bytes written so far.
+   */
+  std::uint64_t written_;
+
+  /**
+   * Bytes known to be durable.
+   */
+  std::uint64_t synced_;
+
+  /**
+   * True while a thread runs fdatasync().
+   */
+  bool syncing_;
+
+  /**
+   * Start of the last sync.
+   */
+  std::chrono::steady_clock::time_point last_sync_;
+
+  /**
+   * Number of fdatasync() calls made.
+   */
+  std::uint64_t syncs_;
+
+  /**
+   * Flusher thread, running in mode BATCHED.  A flusher thread stops when
+   * this no longer refers to it.
+   */
+  std::thread flusher_;
+
+  /**
+   * errno of a failed sync of the flusher not reported yet, or 0.
+   */
+  int flush_error_;
+};
+
+}
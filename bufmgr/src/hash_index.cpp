@@ -0,0 +1,387 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "hash_index.h"
+
+#include <cstring>
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "key_hash.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Metadata stored at the start of the metadata page, followed by the
+ * numbers of the directory pages.
+ */
+struct IndexMeta {
+  std::uint32_t magic;
+  std::uint16_t key_type;
+  std::uint16_t key_size;
+  std::uint32_t global_depth;
+  PageId buckets;
+  std::uint32_t directory_pages;
+};
+
+const std::uint32_t INDEX_MAGIC = 0x48736849;
+
+}
+
+static_assert(sizeof(IndexMeta) +
+              ((1u << HashIndex::MAX_GLOBAL_DEPTH) /
+               HashIndex::DIRECTORY_ENTRIES) * sizeof(PageId) <=
+              Page::DATA_SIZE,
+              "Directory page numbers must fit into the metadata page.");
+static_assert(HashIndex::DIRECTORY_ENTRIES * sizeof(PageId) <= Page::DATA_SIZE,
+              "Directory slots must fit into a page.");
+
+const std::size_t HashIndex::DEFAULT_STRING_KEY_SIZE;
+const std::size_t HashIndex::MAX_STRING_KEY_SIZE;
+const std::uint32_t HashIndex::DIRECTORY_ENTRIES;
+const int HashIndex::MAX_GLOBAL_DEPTH;
+const PageId HashIndex::META_PAGE;
+const std::size_t HashIndex::RECORD_ID_BYTES;
+
+HashIndex::HashIndex(BufMgr* buf_mgr, File* file, const KeyType key_type,
+                     const std::size_t string_key_size)
+    : buf_mgr_(buf_mgr),
+      file_(file),
+      key_type_(key_type),
+      key_size_(key_type == INTEGER_KEY ? sizeof(std::int64_t)
+                                        : string_key_size),
+      entry_size_(key_size_ + RECORD_ID_BYTES),
+      bucket_capacity_((Page::DATA_SIZE - sizeof(BucketHeader)) / entry_size_),
+      global_depth_(0),
+      buckets_(0) {
+  if (key_size_ == 0 || key_size_ > MAX_STRING_KEY_SIZE) {
+    throw BadIndexInfoException("string key size out of range");
+  }
+  open();
+}
+
+bool HashIndex::insert(const std::int64_t key, const RecordId& record_id) {
+  return insertKey(encode(key), record_id);
+}
+
+bool HashIndex::insert(const std::string& key, const RecordId& record_id) {
+  return insertKey(encode(key), record_id);
+}
+
+bool HashIndex::lookup(const std::int64_t key, RecordId& record_id) {
+  return lookupKey(encode(key), record_id);
+}
+
+bool HashIndex::lookup(const std::string& key, RecordId& record_id) {
+  return lookupKey(encode(key), record_id);
+}
+
+bool HashIndex::erase(const std::int64_t key) {
+  return eraseKey(encode(key));
+}
+
+bool HashIndex::erase(const std::string& key) {
+  return eraseKey(encode(key));
+}
+
+void HashIndex::open() {
+  Page* page;
+  try {
+    buf_mgr_->readPage(file_, META_PAGE, page);
+  } catch (const InvalidPageException&) {
+    PageId page_number;
+    buf_mgr_->allocPage(file_, page_number, page);
+    buf_mgr_->unPinPage(file_, page_number, true);
+    if (page_number != META_PAGE) {
+      throw BadIndexInfoException("file does not hold a hash index");
+    }
+
+    PageId directory_number;
+    buf_mgr_->allocPage(file_, directory_number, page);
+    Page* bucket;
+    PageId bucket_number;
+    try {
+      buf_mgr_->allocPage(file_, bucket_number, bucket);
+    } catch (...) {
+      buf_mgr_->unPinPage(file_, directory_number, true);
+      throw;
+    }
+    header(bucket)->local_depth = 0;
+    header(bucket)->count = 0;
+    slots(page)[0] = bucket_number;
+    buf_mgr_->unPinPage(file_, bucket_number, true);
+    buf_mgr_->unPinPage(file_, directory_number, true);
+
+    directory_pages_.push_back(directory_number);
+    buckets_ = 1;
+    writeMeta();
+    return;
+  }
+
+  IndexMeta meta;
+  std::memcpy(&meta, data(page), sizeof(meta));
+  if (meta.magic != INDEX_MAGIC) {
+    buf_mgr_->unPinPage(file_, META_PAGE, false);
+    throw BadIndexInfoException("file does not hold a hash index");
+  }
+  if (meta.key_type != key_type_ || meta.key_size != key_size_) {
+    buf_mgr_->unPinPage(file_, META_PAGE, false);
+    throw BadIndexInfoException("index was built with other keys");
+  }
+  global_depth_ = meta.global_depth;
+  buckets_ = meta.buckets;
+  directory_pages_.resize(meta.directory_pages);
+  std::memcpy(&directory_pages_[0], data(page) + sizeof(meta),
+              meta.directory_pages * sizeof(PageId));
+  buf_mgr_->unPinPage(file_, META_PAGE, false);
+}
+
+void HashIndex::writeMeta() {
+  IndexMeta meta;
+  std::memset(&meta, 0, sizeof(meta));
+  meta.magic = INDEX_MAGIC;
+  meta.key_type = key_type_;
+  meta.key_size = key_size_;
+  meta.global_depth = global_depth_;
+  meta.buckets = buckets_;
+  meta.directory_pages = directory_pages_.size();
+
+  Page* page;
+  buf_mgr_->readPage(file_, META_PAGE, page);
+  std::memcpy(data(page), &meta, sizeof(meta));
+  std::memcpy(data(page) + sizeof(meta), &directory_pages_[0],
+              directory_pages_.size() * sizeof(PageId));
+  buf_mgr_->unPinPage(file_, META_PAGE, true);
+}
+
+std::string HashIndex::encode(const std::int64_t key) const {
+  if (key_type_ != INTEGER_KEY) {
+    throw BadIndexInfoException("index has string keys");
+  }
+  std::string encoded(sizeof(key), '\0');
+  std::memcpy(&encoded[0], &key, sizeof(key));
+  return encoded;
+}
+
+std::string HashIndex::encode(const std::string& key) const {
+  if (key_type_ != STRING_KEY) {
+    throw BadIndexInfoException("index has integer keys");
+  }
+  if (key.length() > key_size_) {
+    throw BadIndexInfoException("string key longer than the key size");
+  }
+  std::string encoded(key);
+  encoded.resize(key_size_, '\0');
+  return encoded;
+}
+
+std::uint64_t HashIndex::hash(const char* key) const {
+  return KeyHash::compute(key, key_size_);
+}
+
+PageId HashIndex::bucketOf(const std::uint64_t slot) {
+  const PageId directory_number = directory_pages_[slot / DIRECTORY_ENTRIES];
+  Page* page;
+  buf_mgr_->readPage(file_, directory_number, page);
+  const PageId bucket_number = slots(page)[slot % DIRECTORY_ENTRIES];
+  buf_mgr_->unPinPage(file_, directory_number, false);
+  return bucket_number;
+}
+
+int HashIndex::lowerBound(Page* page, const char* key) const {
+  int low = 0;
+  int high = header(page)->count;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (std::memcmp(entry(page, middle), key, key_size_) < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool HashIndex::lookupKey(const std::string& key, RecordId& record_id) {
+  SharedLatchGuard guard(latch_);
+  const std::uint64_t slot =
+      hash(key.data()) & ((1ULL << global_depth_) - 1);
+  const PageId bucket_number = bucketOf(slot);
+  Page* bucket;
+  buf_mgr_->readPage(file_, bucket_number, bucket);
+  const int position = lowerBound(bucket, key.data());
+  const bool found = position < header(bucket)->count &&
+      std::memcmp(entry(bucket, position), key.data(), key_size_) == 0;
+  if (found) {
+    std::memcpy(&record_id.page_number, entry(bucket, position) + key_size_,
+                sizeof(PageId));
+    std::memcpy(&record_id.slot_number,
+                entry(bucket, position) + key_size_ + sizeof(PageId),
+                sizeof(SlotId));
+  }
+  buf_mgr_->unPinPage(file_, bucket_number, false);
+  return found;
+}
+
+bool HashIndex::insertKey(const std::string& key, const RecordId& record_id) {
+  ExclusiveLatchGuard guard(latch_);
+  const std::uint64_t hash_value = hash(key.data());
+  for (;;) {
+    const std::uint64_t slot = hash_value & ((1ULL << global_depth_) - 1);
+    const PageId bucket_number = bucketOf(slot);
+    Page* bucket;
+    buf_mgr_->readPage(file_, bucket_number, bucket);
+    BucketHeader* bucket_header = header(bucket);
+    const int position = lowerBound(bucket, key.data());
+    if (position < bucket_header->count &&
+        std::memcmp(entry(bucket, position), key.data(), key_size_) == 0) {
+      buf_mgr_->unPinPage(file_, bucket_number, false);
+      return false;
+    }
+    if (bucket_header->count < bucket_capacity_) {
+      char* at = entry(bucket, position);
+      std::memmove(at + entry_size_, at,
+                   (bucket_header->count - position) * entry_size_);
+      std::memcpy(at, key.data(), key_size_);
+      std::memcpy(at + key_size_, &record_id.page_number, sizeof(PageId));
+      std::memcpy(at + key_size_ + sizeof(PageId), &record_id.slot_number,
+                  sizeof(SlotId));
+      ++bucket_header->count;
+      buf_mgr_->unPinPage(file_, bucket_number, true);
+      return true;
+    }
+    buf_mgr_->unPinPage(file_, bucket_number, false);
+    // The entries of the bucket may all go the same way, so try again.
+    split(slot);
+  }
+}
+
+bool HashIndex::eraseKey(const std::string& key) {
+  ExclusiveLatchGuard guard(latch_);
+  const std::uint64_t slot =
+      hash(key.data()) & ((1ULL << global_depth_) - 1);
+  const PageId bucket_number = bucketOf(slot);
+  Page* bucket;
+  buf_mgr_->readPage(file_, bucket_number, bucket);
+  BucketHeader* bucket_header = header(bucket);
+  const int position = lowerBound(bucket, key.data());
+  const bool found = position < bucket_header->count &&
+      std::memcmp(entry(bucket, position), key.data(), key_size_) == 0;
+  if (found) {
+    char* at = entry(bucket, position);
+    std::memmove(at, at + entry_size_,
+                 (bucket_header->count - position - 1) * entry_size_);
+    --bucket_header->count;
+  }
+  buf_mgr_->unPinPage(file_, bucket_number, found);
+  return found;
+}
+
+void HashIndex::split(const std::uint64_t slot) {
+  const PageId old_number = bucketOf(slot);
+  Page* old_bucket;
+  buf_mgr_->readPage(file_, old_number, old_bucket);
+  BucketHeader* old_header = header(old_bucket);
+  const int local_depth = old_header->local_depth;
+  try {
+    if (local_depth == global_depth_) {
+      if (global_depth_ == MAX_GLOBAL_DEPTH) {
+        throw InsufficientSpaceException(old_number, entry_size_, 0);
+      }
+      doubleDirectory();
+    }
+  } catch (...) {
+    buf_mgr_->unPinPage(file_, old_number, false);
+    throw;
+  }
+
+  PageId new_number;
+  Page* new_bucket;
+  try {
+    buf_mgr_->allocPage(file_, new_number, new_bucket);
+  } catch (...) {
+    buf_mgr_->unPinPage(file_, old_number, false);
+    throw;
+  }
+  BucketHeader* new_header = header(new_bucket);
+  new_header->local_depth = local_depth + 1;
+  new_header->count = 0;
+
+  // Entries with the next hash bit set move; both buckets stay sorted.
+  int kept = 0;
+  for (int i = 0; i < old_header->count; ++i) {
+    const char* moving = entry(old_bucket, i);
+    if ((hash(moving) >> local_depth) & 1) {
+      std::memcpy(entry(new_bucket, new_header->count++), moving, entry_size_);
+    } else {
+      if (kept != i) {
+        std::memcpy(entry(old_bucket, kept), moving, entry_size_);
+      }
+      ++kept;
+    }
+  }
+  old_header->count = kept;
+  old_header->local_depth = local_depth + 1;
+  buf_mgr_->unPinPage(file_, new_number, true);
+  buf_mgr_->unPinPage(file_, old_number, true);
+
+  // Point the slots of the new half at the new bucket.
+  const std::uint64_t size = 1ULL << global_depth_;
+  const std::uint64_t step = 1ULL << (local_depth + 1);
+  const std::uint64_t first =
+      (slot & ((1ULL << local_depth) - 1)) | (1ULL << local_depth);
+  for (std::uint64_t s = first; s < size; ) {
+    const PageId directory_number = directory_pages_[s / DIRECTORY_ENTRIES];
+    Page* page;
+    buf_mgr_->readPage(file_, directory_number, page);
+    const std::uint64_t page_end = (s / DIRECTORY_ENTRIES + 1) * DIRECTORY_ENTRIES;
+    for (; s < size && s < page_end; s += step) {
+      slots(page)[s % DIRECTORY_ENTRIES] = new_number;
+    }
+    buf_mgr_->unPinPage(file_, directory_number, true);
+  }
+
+  ++buckets_;
+  writeMeta();
+}
+
+void HashIndex::doubleDirectory() {
+  const std::uint64_t size = 1ULL << global_depth_;
+  if (size < DIRECTORY_ENTRIES) {
+    // The directory still fits into its first page.
+    Page* page;
+    buf_mgr_->readPage(file_, directory_pages_[0], page);
+    std::memcpy(slots(page) + size, slots(page), size * sizeof(PageId));
+    buf_mgr_->unPinPage(file_, directory_pages_[0], true);
+  } else {
+    const std::size_t pages = directory_pages_.size();
+    for (std::size_t i = 0; i < pages; ++i) {
+      Page* page;
+      buf_mgr_->readPage(file_, directory_pages_[i], page);
+      PageId copy_number;
+      Page* copy;
+      try {
+        buf_mgr_->allocPage(file_, copy_number, copy);
+      } catch (...) {
+        buf_mgr_->unPinPage(file_, directory_pages_[i], false);
+        directory_pages_.resize(pages);
+        throw;
+      }
+      std::memcpy(slots(copy), slots(page),
+                  DIRECTORY_ENTRIES * sizeof(PageId));
+      buf_mgr_->unPinPage(file_, copy_number, true);
+      buf_mgr_->unPinPage(file_, directory_pages_[i], false);
+      directory_pages_.push_back(copy_number);
+    }
+  }
+  ++global_depth_;
+  writeMeta();
+}
+
+}
@@ -0,0 +1,341 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "file.h"
+#include "latch.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Extendible hash index mapping unique integer or string keys to
+ *        record ids.
+ *
+ * The index is made of bucket pages and a directory of 2^global depth
+ * bucket page numbers, indexed by the low global depth bits of the hash of a
+ * key.  Each bucket has a local depth: the number of low hash bits shared by
+ * all of its keys, so 2^(global depth - local depth) directory slots point
+ * to it.  A full bucket is split in two by the next hash bit, moving about
+ * half of its entries to a new bucket, and only the directory slots of that
+ * bucket change.  When the bucket's local depth equals the global depth, the
+ * directory first doubles by copying itself; no entries move.
+ *
+ * Page 1 of the file holds the global depth and the numbers of the directory
+ * pages, which are read when the index is opened.  A lookup then reads one
+ * directory page and one bucket page.  All pages are read and written
+ * through the given buffer manager.
+ *
+ * Keys are stored with a fixed size like in BTreeIndex.  Entries of a bucket
+ * are kept sorted by key.  Erasing an entry never merges buckets.
+ *
+ * Lookups may run concurrently; inserts and erases are serialized with each
+ * other and with lookups.
+ */
+class HashIndex {
+ public:
+  /**
+   * Type of the keys of an index.
+   */
+  enum KeyType {
+    INTEGER_KEY = 1,
+    STRING_KEY = 2
+  };
+
+  /**
+   * Size of string keys if none is given.
+   */
+  static const std::size_t DEFAULT_STRING_KEY_SIZE = 32;
+
+  /**
+   * Largest size of string keys.
+   */
+  static const std::size_t MAX_STRING_KEY_SIZE = 255;
+
+  /**
+   * Number of directory slots per directory page.
+   */
+  static const std::uint32_t DIRECTORY_ENTRIES = 1024;
+
+  /**
+   * Largest global depth; the directory then takes 1024 pages.
+   */
+  static const int MAX_GLOBAL_DEPTH = 20;
+
+  /**
+   * Opens the index stored in the given file, or creates an empty index if
+   * the file has no pages.
+   *
+   * @param buf_mgr         Buffer manager to read and write pages through.
+   * @param file            File holding the index.
+   * @param key_type        Type of the keys.
+   * @param string_key_size Size of string keys in bytes; ignored for integer
+   *                        keys.
+   * @throws  BadIndexInfoException If the file holds something else than an
+   *                                index with these keys.
+   */
+  HashIndex(BufMgr* buf_mgr, File* file, const KeyType key_type,
+            const std::size_t string_key_size = DEFAULT_STRING_KEY_SIZE);
+
+  /**
+   * Inserts a key unless it is already present.
+   *
+   * @param key       Key to insert.
+   * @param record_id Record id the key maps to.
+   * @return  False if the index already held the key; it is left unchanged.
+   * @throws  BadIndexInfoException       If the index does not have integer
+   *                                      keys.
+   * @throws  InsufficientSpaceException  If the bucket of the key is full and
+   *                                      the directory cannot grow.
+   */
+  bool insert(const std::int64_t key, const RecordId& record_id);
+
+  /**
+   * Inserts a key unless it is already present.
+   *
+   * @param key       Key to insert.
+   * @param record_id Record id the key maps to.
+   * @return  False if the index already held the key; it is left unchanged.
+   * @throws  BadIndexInfoException       If the index does not have string
+   *                                      keys, or the key is longer than the
+   *                                      key size.
+   * @throws  InsufficientSpaceException  If the bucket of the key is full and
+   *                                      the directory cannot grow.
+   */
+  bool insert(const std::string& key, const RecordId& record_id);
+
+  /**
+   * Finds the record id a key maps to.
+   *
+   * @param key       Key to look up.
+   * @param record_id The record id is returned via this reference.
+   * @return  False if the index does not hold the key.
+   * @throws  BadIndexInfoException If the index does not have integer keys.
+   */
+  bool lookup(const std::int64_t key, RecordId& record_id);
+
+  /**
+   * Finds the record id a key maps to.
+   *
+   * @param key       Key to look up.
+   * @param record_id The record id is returned via this reference.
+   * @return  False if the index does not hold the key.
+   * @throws  BadIndexInfoException If the index does not have string keys, or
+   *                                the key is longer than the key size.
+   */
+  bool lookup(const std::string& key, RecordId& record_id);
+
+  /**
+   * Erases a key.
+   *
+   * @param key Key to erase.
+   * @return  False if the index did not hold the key.
+   * @throws  BadIndexInfoException If the index does not have integer keys.
+   */
+  bool erase(const std::int64_t key);
+
+  /**
+   * Erases a key.
+   *
+   * @param key Key to erase.
+   * @return  False if the index did not hold the key.
+   * @throws  BadIndexInfoException If the index does not have string keys, or
+   *                                the key is longer than the key size.
+   */
+  bool erase(const std::string& key);
+
+  /**
+   * Returns the number of hash bits that index the directory.
+   */
+  int globalDepth() const { return global_depth_; }
+
+  /**
+   * Returns the number of bucket pages.
+   */
+  PageId buckets() const { return buckets_; }
+
+ private:
+  HashIndex(const HashIndex&);
+  HashIndex& operator=(const HashIndex&);
+
+  /**
+   * Header at the start of the data of each bucket page.
+   */
+  struct BucketHeader {
+    /**
+     * Number of low hash bits shared by the keys of the bucket.
+     */
+    std::uint16_t local_depth;
+
+    /**
+     * Number of entries.
+     */
+    std::uint16_t count;
+  };
+
+  /**
+   * Number of the page holding the index metadata.
+   */
+  static const PageId META_PAGE = 1;
+
+  /**
+   * Bytes of a record id at the end of each entry.
+   */
+  static const std::size_t RECORD_ID_BYTES = sizeof(PageId) + sizeof(SlotId);
+
+  /**
+   * Returns the data bytes of a page.
+   */
+  static char* data(Page* page) { return page->data(); }
+
+  /**
+   * Returns the header of a bucket page.
+   */
+  static BucketHeader* header(Page* page) {
+    return reinterpret_cast<BucketHeader*>(data(page));
+  }
+
+  /**
+   * Returns the i-th entry of a bucket.
+   */
+  char* entry(Page* page, const int i) const {
+    return data(page) + sizeof(BucketHeader) + i * entry_size_;
+  }
+
+  /**
+   * Returns the directory slots of a directory page.
+   */
+  static PageId* slots(Page* page) {
+    return reinterpret_cast<PageId*>(data(page));
+  }
+
+  /**
+   * Reads the metadata page, or creates it, the first directory page and an
+   * empty bucket if the file has no pages.
+   */
+  void open();
+
+  /**
+   * Writes the global depth, bucket count and directory pages to the
+   * metadata page.
+   */
+  void writeMeta();
+
+  /**
+   * Encodes an integer key, checking the key type.
+   */
+  std::string encode(const std::int64_t key) const;
+
+  /**
+   * Encodes a string key, checking the key type and size.
+   */
+  std::string encode(const std::string& key) const;
+
+  /**
+   * Returns the hash of an encoded key.
+   */
+  std::uint64_t hash(const char* key) const;
+
+  /**
+   * Returns the number of the bucket page a directory slot points to.
+   */
+  PageId bucketOf(const std::uint64_t slot);
+
+  /**
+   * Returns the position of the first entry of a bucket whose key is not
+   * smaller than the given one.
+   */
+  int lowerBound(Page* page, const char* key) const;
+
+  /**
+   * Finds an encoded key; returns false if it is not present.
+   */
+  bool lookupKey(const std::string& key, RecordId& record_id);
+
+  /**
+   * Inserts an encoded key; returns false if it is already present.
+   */
+  bool insertKey(const std::string& key, const RecordId& record_id);
+
+  /**
+   * Erases an encoded key; returns false if it is not present.
+   */
+  bool eraseKey(const std::string& key);
+
+  /**
+   * Splits the full bucket that a directory slot points to by its next hash
+   * bit, doubling the directory first if needed.
+   *
+   * @throws  InsufficientSpaceException  If the directory cannot grow.
+   */
+  void split(const std::uint64_t slot);
+
+  /**
+   * Doubles the directory, the new half pointing to the same buckets as the
+   * old one.
+   */
+  void doubleDirectory();
+
+  /**
+   * Buffer manager the pages are read through.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * File holding the index.
+   */
+  File* file_;
+
+  /**
+   * Type of the keys.
+   */
+  KeyType key_type_;
+
+  /**
+   * Size of the encoded keys in bytes.
+   */
+  std::size_t key_size_;
+
+  /**
+   * Size of an entry: encoded key and record id.
+   */
+  std::size_t entry_size_;
+
+  /**
+   * Most entries a bucket holds.
+   */
+  int bucket_capacity_;
+
+  /**
+   * Number of hash bits that index the directory.
+   */
+  int global_depth_;
+
+  /**
+   * Number of bucket pages.
+   */
+  PageId buckets_;
+
+  /**
+   * Numbers of the directory pages, in slot order.
+   */
+  std::vector<PageId> directory_pages_;
+
+  /**
+   * Held shared by lookups and exclusively by inserts and erases.
+   */
+  RWLatch latch_;
+};
+
+}
@@ -0,0 +1,302 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "hash_join.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include "key_hash.h"
+
+namespace badgerdb {
+
+const std::uint32_t HashJoin::MIN_BUDGET_FRAMES;
+const std::uint32_t HashJoin::READ_PAGES;
+const std::uint32_t HashJoin::MAX_PARTITIONS;
+const int HashJoin::MAX_DEPTH;
+const std::size_t HashJoin::PROBE_BATCH;
+const std::uint32_t HashJoin::NO_ENTRY;
+
+HashJoin::HashJoin(BufMgr* buf_mgr, const std::uint32_t budget_frames)
+    : buf_mgr_(buf_mgr),
+      budget_frames_(std::max(budget_frames, MIN_BUDGET_FRAMES)),
+      build_is_left_(true),
+      emit_(NULL),
+      partitions_(0),
+      build_chunks_(0),
+      pages_written_(0) {
+}
+
+void HashJoin::join(const Input& left, const Input& right,
+                    const MatchCallback& emit) {
+  // Pages changed in the pool are read from the files below.
+  buf_mgr_->cleanFile(left.file);
+  buf_mgr_->cleanFile(right.file);
+  emit_ = &emit;
+  spills_.reset(left.file->filename() + ".join.");
+  partitions_ = 0;
+  build_chunks_ = 0;
+  pages_written_ = 0;
+  build_is_left_ = pagesOf(left) <= pagesOf(right);
+
+  buf_mgr_->reserveFrames(budget_frames_, frames_);
+  try {
+    if (build_is_left_) {
+      joinInputs(left, right, 0);
+    } else {
+      joinInputs(right, left, 0);
+    }
+  } catch (...) {
+    spills_.removeAll();
+    buf_mgr_->releaseFrames(frames_);
+    frames_.clear();
+    throw;
+  }
+  buf_mgr_->releaseFrames(frames_);
+  frames_.clear();
+  // Let go of the memory of the last hash table.
+  std::vector<std::uint32_t>().swap(buckets_);
+  std::vector<Entry>().swap(entries_);
+  std::vector<Record>().swap(records_);
+}
+
+std::size_t HashJoin::keyOf(const Input& input, const char* data,
+                            const std::size_t length, const char*& key) {
+  if (input.key_offset >= length) {
+    key = data;
+    return 0;
+  }
+  key = data + input.key_offset;
+  return std::min(input.key_length, length - input.key_offset);
+}
+
+PageId HashJoin::pagesOf(const Input& input) {
+  const PageId num_pages = input.file->pageCount();
+  return num_pages > 0 ? num_pages - 1 : 0;
+}
+
+std::uint32_t HashJoin::readFrames() const {
+  return std::max<std::uint32_t>(
+      1, std::min<std::size_t>(READ_PAGES, frames_.size() / MIN_BUDGET_FRAMES));
+}
+
+PageId HashJoin::read(const Input& input, const PageId first_page_number,
+                      const PageId count, Page* const* frames,
+                      std::vector<Record>& records) const {
+  const PageId num_pages = input.file->pageCount();
+  if (first_page_number >= num_pages) {
+    return 0;
+  }
+  const PageId pages = std::min(count, num_pages - first_page_number);
+  input.file->readPages(first_page_number, pages, frames);
+  SpillFiles::collect(frames, pages, input.pages, records);
+  return pages;
+}
+
+void HashJoin::joinInputs(const Input& build, const Input& probe,
+                          const int depth) {
+  const PageId capacity = frames_.size() - readFrames();
+  const PageId build_pages = pagesOf(build);
+  if (build_pages <= capacity || depth == MAX_DEPTH) {
+    joinInMemory(build, probe);
+    return;
+  }
+
+  // Aim for partitions of three quarters of the budget, as the hash does not
+  // split the records exactly evenly.  Each partition needs a frame to be
+  // written from.
+  const PageId target = std::max<PageId>(1, capacity * 3 / 4);
+  const std::size_t count = std::max<std::size_t>(2, std::min<std::size_t>(
+      std::min<std::size_t>(MAX_PARTITIONS, capacity),
+      (build_pages + target - 1) / target));
+  const std::vector<Partition> build_partitions = split(build, count, depth);
+  const std::vector<Partition> probe_partitions = split(probe, count, depth);
+  for (std::size_t i = 0; i < count; ++i) {
+    ++partitions_;
+    if (build_partitions[i].pages > 0 && probe_partitions[i].pages > 0) {
+      File build_file = File::open(build_partitions[i].filename);
+      File probe_file = File::open(probe_partitions[i].filename);
+      const Input build_partition = {&build_file, build.key_offset,
+                                     build.key_length, PageFilter()};
+      const Input probe_partition = {&probe_file, probe.key_offset,
+                                     probe.key_length, PageFilter()};
+      // A partition as large as its input holds mostly one key, and would
+      // not shrink by splitting it again either.
+      joinInputs(build_partition, probe_partition,
+                 build_partitions[i].pages < build_pages ? depth + 1
+                                                         : MAX_DEPTH);
+    }
+    File::remove(build_partitions[i].filename);
+    File::remove(probe_partitions[i].filename);
+  }
+}
+
+std::vector<HashJoin::Partition> HashJoin::split(const Input& input,
+                                                 const std::size_t count,
+                                                 const int depth) {
+  const std::uint32_t read_frames = readFrames();
+  const std::size_t partition_frames =
+      std::min<std::size_t>(READ_PAGES,
+                            (frames_.size() - read_frames) / count);
+  std::vector<std::unique_ptr<PartitionWriter> > writers(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const std::vector<Page*>::const_iterator first =
+        frames_.begin() + read_frames + i * partition_frames;
+    writers[i].reset(new PartitionWriter(
+        spills_.next(),
+        std::vector<Page*>(first, first + partition_frames)));
+  }
+
+  // A different hash function on each level, so that a partition that is
+  // split again spreads over all of the new partitions.
+  const std::uint64_t seed = depth + 1;
+  std::vector<Record> records;
+  for (PageId first = 1;;) {
+    records.clear();
+    const PageId pages = read(input, first, read_frames, &frames_[0], records);
+    if (pages == 0) {
+      break;
+    }
+    first += pages;
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      const char* key;
+      const std::size_t key_length =
+          keyOf(input, records[i].data, records[i].length, key);
+      const std::uint64_t h = KeyHash::compute(key, key_length, seed);
+      writers[(h >> 32) % count]->add(records[i].data, records[i].length);
+    }
+  }
+
+  std::vector<Partition> partitions(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    partitions[i] = writers[i]->finish();
+    pages_written_ += partitions[i].pages;
+  }
+  return partitions;
+}
+
+void HashJoin::joinInMemory(const Input& build, const Input& probe) {
+  const std::uint32_t read_frames = readFrames();
+  const PageId capacity = frames_.size() - read_frames;
+  Page* const* probe_frames = &frames_[capacity];
+  std::vector<Record> probe_records;
+  Probe batch[PROBE_BATCH];
+
+  // Usually one chunk; more only if the build input could not be split
+  // small enough.
+  for (PageId build_first = 1;;) {
+    records_.clear();
+    const PageId build_pages =
+        read(build, build_first, capacity, &frames_[0], records_);
+    if (build_pages == 0) {
+      break;
+    }
+    build_first += build_pages;
+    if (records_.empty()) {
+      continue;
+    }
+    buildTable(build, records_);
+    ++build_chunks_;
+
+    for (PageId probe_first = 1;;) {
+      probe_records.clear();
+      const PageId probe_pages =
+          read(probe, probe_first, read_frames, probe_frames, probe_records);
+      if (probe_pages == 0) {
+        break;
+      }
+      probe_first += probe_pages;
+      std::size_t batched = 0;
+      for (std::size_t i = 0; i < probe_records.size(); ++i) {
+        batch[batched].data = probe_records[i].data;
+        batch[batched].length = probe_records[i].length;
+        if (++batched == PROBE_BATCH) {
+          probeBatch(build, probe, batch, batched);
+          batched = 0;
+        }
+      }
+      probeBatch(build, probe, batch, batched);
+    }
+  }
+}
+
+void HashJoin::buildTable(const Input& build,
+                          const std::vector<Record>& records) {
+  std::size_t bucket_count = 1;
+  while (bucket_count < records.size()) {
+    bucket_count *= 2;
+  }
+  buckets_.assign(bucket_count, NO_ENTRY);
+  entries_.resize(records.size());
+  const std::uint64_t mask = bucket_count - 1;
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    const char* key;
+    const std::size_t key_length =
+        keyOf(build, records[i].data, records[i].length, key);
+    Entry& entry = entries_[i];
+    entry.hash = KeyHash::compute(key, key_length);
+    entry.data = records[i].data;
+    entry.length = records[i].length;
+    std::uint32_t& bucket = buckets_[entry.hash & mask];
+    entry.next = bucket;
+    bucket = i;
+  }
+}
+
+void HashJoin::probeBatch(const Input& build, const Input& probe,
+                          Probe* batch, const std::size_t count) {
+  const std::uint64_t mask = buckets_.size() - 1;
+  // Three passes over the batch, so that the cache misses on the buckets,
+  // and then on the first entries of their chains, are all in flight at
+  // once rather than one after the other.
+  for (std::size_t i = 0; i < count; ++i) {
+    const char* key;
+    const std::size_t key_length =
+        keyOf(probe, batch[i].data, batch[i].length, key);
+    batch[i].hash = KeyHash::compute(key, key_length);
+    __builtin_prefetch(&buckets_[batch[i].hash & mask]);
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    batch[i].entry = buckets_[batch[i].hash & mask];
+    if (batch[i].entry != NO_ENTRY) {
+      __builtin_prefetch(&entries_[batch[i].entry]);
+    }
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    const char* key;
+    const std::size_t key_length =
+        keyOf(probe, batch[i].data, batch[i].length, key);
+    for (std::uint32_t e = batch[i].entry; e != NO_ENTRY;
+         e = entries_[e].next) {
+      const Entry& entry = entries_[e];
+      if (entry.hash != batch[i].hash) {
+        continue;
+      }
+      const char* build_key;
+      const std::size_t build_key_length =
+          keyOf(build, entry.data, entry.length, build_key);
+      if (build_key_length == key_length &&
+          std::memcmp(build_key, key, key_length) == 0) {
+        emit(entry.data, entry.length, batch[i].data, batch[i].length);
+      }
+    }
+  }
+}
+
+void HashJoin::emit(const char* build, const std::size_t build_length,
+                    const char* probe, const std::size_t probe_length) {
+  if (build_is_left_) {
+    left_record_.assign(build, build_length);
+    right_record_.assign(probe, probe_length);
+  } else {
+    left_record_.assign(probe, probe_length);
+    right_record_.assign(build, build_length);
+  }
+  (*emit_)(left_record_, right_record_);
+}
+
+}
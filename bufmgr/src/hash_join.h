@@ -0,0 +1,312 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "spill_files.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Equi-join of the records of two files within a fixed memory budget.
+ *
+ * The key of a record is a range of its bytes at a fixed offset; records
+ * join if their keys are equal.  Like ExternalSort, the join takes its
+ * memory as frames out of the buffer pool with BufMgr::reserveFrames() and
+ * reads the input files directly, a block of pages at a time, after writing
+ * out their pages that are dirty in the pool.
+ *
+ * The smaller input is the build side.  If its pages fit into the budget,
+ * they are read into it and a hash table is built over their records; the
+ * other input is then read once and each of its records probes the table.
+ * Probes are made in batches: the buckets of a whole batch are prefetched
+ * before the first is looked at, so their cache misses overlap.
+ *
+ * Otherwise both inputs are first split by the hash of the key into as many
+ * partitions as needed for each build partition to fit, written to
+ * temporary files; matching records land in partitions of the same number,
+ * which are then joined pair by pair (grace hash join).  A build partition
+ * that is still too large is split again with another hash function.  One
+ * that cannot be split, because most of its records share a key, is joined
+ * in chunks of the budget, reading its probe partition once per chunk.
+ *
+ * Temporary files are named after the left input and removed when the join
+ * ends.
+ *
+ * @warning This class is not threadsafe; one join() runs at a time.
+ */
+class HashJoin {
+ public:
+  /**
+   * Returns true if the page with the given number holds records to join;
+   * e.g. HeapFile::isDataPage().
+   */
+  typedef std::function<bool(const PageId page_number)> PageFilter;
+
+  /**
+   * Receives a pair of joining records, the one of the left input first.
+   */
+  typedef std::function<void(const std::string& left,
+                             const std::string& right)> MatchCallback;
+
+  /**
+   * An input of a join: the records of every used page of a file that the
+   * filter accepts.
+   */
+  struct Input {
+    /**
+     * File holding the records; its dirty pages in the buffer pool are
+     * written out first, as the file is then read directly.
+     */
+    File* file;
+
+    /**
+     * Offset of the key in each record.
+     */
+    std::size_t key_offset;
+
+    /**
+     * Length of the key; the key of a record too short to hold it is its
+     * bytes from key_offset on, if any.
+     */
+    std::size_t key_length;
+
+    /**
+     * Pages to read records from; every used page if empty.
+     */
+    PageFilter pages;
+  };
+
+  /**
+   * Smallest budget, in frames, that a join works with.
+   */
+  static const std::uint32_t MIN_BUDGET_FRAMES = 8;
+
+  /**
+   * Pages of the probe side, and of an input being partitioned, read at a
+   * time if the budget allows.
+   */
+  static const std::uint32_t READ_PAGES = 8;
+
+  /**
+   * Most partitions an input is split into at once, which bounds the number
+   * of open files.
+   */
+  static const std::uint32_t MAX_PARTITIONS = 256;
+
+  /**
+   * Most times a partition is split again.
+   */
+  static const int MAX_DEPTH = 3;
+
+  /**
+   * Probe records whose buckets are prefetched together.
+   */
+  static const std::size_t PROBE_BATCH = 16;
+
+  /**
+   * Constructs a join.
+   *
+   * @param buf_mgr       Buffer manager to take the frames from.
+   * @param budget_frames Number of frames to join in; at least
+   *                      MIN_BUDGET_FRAMES are used.  The hash table takes
+   *                      about 24 bytes per build record on top.
+   */
+  HashJoin(BufMgr* buf_mgr, const std::uint32_t budget_frames);
+
+  /**
+   * Joins two inputs and hands each pair of records with equal keys to a
+   * callback, in no particular order.
+   *
+   * @param left  Left input.
+   * @param right Right input.
+   * @param emit  Called for each pair of joining records.
+   * @throws  BufferExceededException If the budget cannot be taken from the
+   *                                  buffer pool.
+   */
+  void join(const Input& left, const Input& right, const MatchCallback& emit);
+
+  /**
+   * Returns the number of partition pairs the last join wrote, counting
+   * those split again; 0 if it joined in memory.
+   */
+  std::uint32_t partitions() const { return partitions_; }
+
+  /**
+   * Returns the number of hash tables the last join built; more than the
+   * number of partitions if some had to be joined in chunks.
+   */
+  std::uint32_t buildChunks() const { return build_chunks_; }
+
+  /**
+   * Returns the number of pages written to partitions by the last join.
+   */
+  std::uint64_t pagesWritten() const { return pages_written_; }
+
+ private:
+  HashJoin(const HashJoin&);
+  HashJoin& operator=(const HashJoin&);
+
+  typedef SpillFiles::Record Record;
+  typedef SpillFiles::Spill Partition;
+  typedef SpillFiles::Writer PartitionWriter;
+
+  /**
+   * A build record in the hash table.
+   */
+  struct Entry {
+    std::uint64_t hash;
+    const char* data;
+    std::uint32_t length;
+
+    /**
+     * Next entry of the same bucket, or NO_ENTRY.
+     */
+    std::uint32_t next;
+  };
+
+  /**
+   * A probe record on its way through a batch.
+   */
+  struct Probe {
+    const char* data;
+    std::size_t length;
+    std::uint64_t hash;
+    std::uint32_t entry;
+  };
+
+  /**
+   * End of a bucket chain.
+   */
+  static const std::uint32_t NO_ENTRY = 0xffffffff;
+
+  /**
+   * Returns the key of a record of an input via <key>, and its length.
+   */
+  static std::size_t keyOf(const Input& input, const char* data,
+                           const std::size_t length, const char*& key);
+
+  /**
+   * Returns the number of pages of a file that may hold records.
+   */
+  static PageId pagesOf(const Input& input);
+
+  /**
+   * Returns the number of frames the probe side is read through.
+   */
+  std::uint32_t readFrames() const;
+
+  /**
+   * Reads up to <count> pages of an input from <first_page_number> on and
+   * appends the records of those the filter accepts.
+   *
+   * @return  Number of pages read.
+   */
+  PageId read(const Input& input, const PageId first_page_number,
+              const PageId count, Page* const* frames,
+              std::vector<Record>& records) const;
+
+  /**
+   * Joins a build and a probe input, splitting them into partitions if the
+   * build input does not fit.
+   */
+  void joinInputs(const Input& build, const Input& probe, const int depth);
+
+  /**
+   * Splits an input into partitions by the hash of the key.
+   */
+  std::vector<Partition> split(const Input& input, const std::size_t count,
+                               const int depth);
+
+  /**
+   * Joins a build and a probe input by building hash tables over as much of
+   * the build input as fits at a time.
+   */
+  void joinInMemory(const Input& build, const Input& probe);
+
+  /**
+   * Builds the hash table over records of the build input.
+   */
+  void buildTable(const Input& build, const std::vector<Record>& records);
+
+  /**
+   * Probes the hash table with a batch of records of the probe input.
+   */
+  void probeBatch(const Input& build, const Input& probe, Probe* batch,
+                  const std::size_t count);
+
+  /**
+   * Hands a pair of joining records to the callback.
+   */
+  void emit(const char* build, const std::size_t build_length,
+            const char* probe, const std::size_t probe_length);
+
+  /**
+   * Buffer manager the budget is taken from.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * Number of frames to join in.
+   */
+  std::uint32_t budget_frames_;
+
+  /**
+   * Frames of the budget while a join runs.
+   */
+  std::vector<Page*> frames_;
+
+  /**
+   * Whether the left input is the build side of the current join.
+   */
+  bool build_is_left_;
+
+  /**
+   * Callback receiving the joining records.
+   */
+  const MatchCallback* emit_;
+
+  /**
+   * Hash table: first entry of each bucket, and the entries.
+   */
+  std::vector<std::uint32_t> buckets_;
+  std::vector<Entry> entries_;
+
+  /**
+   * Records of the pages in the budget.
+   */
+  std::vector<Record> records_;
+
+  /**
+   * Copies of the current pair of records handed to the callback.
+   */
+  std::string left_record_;
+  std::string right_record_;
+
+  /**
+   * Temporary files of the current join.
+   */
+  SpillFiles spills_;
+
+  /**
+   * Statistics of the last join.
+   */
+  std::uint32_t partitions_;
+  std::uint32_t build_chunks_;
+  std::uint64_t pages_written_;
+};
+
+}
@@ -0,0 +1,267 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "heap_file.h"
+
+#include <algorithm>
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/invalid_record_exception.h"
+
+namespace badgerdb {
+
+const PageId HeapFile::FSM_ENTRIES;
+const std::size_t HeapFile::FSM_CATEGORY_BYTES;
+const int HeapFile::FSM_MAX_CATEGORY;
+const PageId HeapFile::NO_PAGE;
+
+HeapFile::HeapFile(BufMgr* buf_mgr, File* file)
+    : buf_mgr_(buf_mgr),
+      file_(file),
+      data_pages_(0) {
+  std::fill(heads_, heads_ + FSM_MAX_CATEGORY + 1, NO_PAGE);
+  std::fill(non_empty_, non_empty_ + sizeof(non_empty_) / sizeof(non_empty_[0]),
+            0);
+  load();
+}
+
+HeapFile::~HeapFile() {
+  flush();
+}
+
+RecordId HeapFile::insert(const std::string& record) {
+  if (record.length() + sizeof(PageSlot) > Page::DATA_SIZE) {
+    throw InsufficientSpaceException(Page::INVALID_NUMBER, record.length(),
+                                     Page::DATA_SIZE - sizeof(PageSlot));
+  }
+  // Pages of category 0 may lack room even for an empty record.
+  const int needed = std::max<int>(1, std::min<int>(
+      (record.length() + FSM_CATEGORY_BYTES - 1) / FSM_CATEGORY_BYTES,
+      FSM_MAX_CATEGORY));
+
+  PageId page_number;
+  Page* page;
+  for (;;) {
+    page_number = findPage(needed);
+    if (page_number == NO_PAGE) {
+      allocateDataPage(page_number, page);
+      break;
+    }
+    buf_mgr_->readPage(file_, page_number, page);
+    if (page->hasSpaceForRecord(record)) {
+      break;
+    }
+    // The map promised more room than the page has, e.g. after a crash.
+    const std::size_t free_space = page->getFreeSpace();
+    setFreeSpace(page_number, free_space);
+    buf_mgr_->unPinPage(file_, page_number, false);
+    // The top category also holds pages with less room than a record close
+    // to a page in size needs, and the page stays in it; no page of the
+    // category is sure to fit, so a new one is allocated.
+    if (category(free_space) >= needed) {
+      allocateDataPage(page_number, page);
+      break;
+    }
+  }
+
+  const RecordId record_id = page->insertRecord(record);
+  setFreeSpace(page_number, page->getFreeSpace());
+  buf_mgr_->unPinPage(file_, page_number, true);
+  return record_id;
+}
+
+std::string HeapFile::get(const RecordId& record_id) {
+  Page* page = pinRecordPage(record_id);
+  std::string record;
+  try {
+    record = page->getRecord(record_id);
+  } catch (...) {
+    buf_mgr_->unPinPage(file_, record_id.page_number, false);
+    throw;
+  }
+  buf_mgr_->unPinPage(file_, record_id.page_number, false);
+  return record;
+}
+
+void HeapFile::update(const RecordId& record_id, const std::string& record) {
+  Page* page = pinRecordPage(record_id);
+  try {
+    page->updateRecord(record_id, record);
+  } catch (...) {
+    buf_mgr_->unPinPage(file_, record_id.page_number, false);
+    throw;
+  }
+  setFreeSpace(record_id.page_number, page->getFreeSpace());
+  buf_mgr_->unPinPage(file_, record_id.page_number, true);
+}
+
+void HeapFile::erase(const RecordId& record_id) {
+  Page* page = pinRecordPage(record_id);
+  try {
+    page->deleteRecord(record_id);
+  } catch (...) {
+    buf_mgr_->unPinPage(file_, record_id.page_number, false);
+    throw;
+  }
+  setFreeSpace(record_id.page_number, page->getFreeSpace());
+  buf_mgr_->unPinPage(file_, record_id.page_number, true);
+}
+
+void HeapFile::flush() {
+  for (PageId i = 0; i < fsm_dirty_.size(); ++i) {
+    if (!fsm_dirty_[i]) {
+      continue;
+    }
+    const PageId fsm_page_number = 1 + i * (FSM_ENTRIES + 1);
+    const std::size_t first = fsm_page_number + 1;
+    const std::size_t last =
+        std::min<std::size_t>(first + FSM_ENTRIES, fsm_.size());
+    std::string entries(FSM_ENTRIES, '\0');
+    if (first < last) {
+      std::copy(fsm_.begin() + first, fsm_.begin() + last, entries.begin());
+    }
+
+    Page* page;
+    buf_mgr_->readPage(file_, fsm_page_number, page);
+    page->updateRecord({fsm_page_number, 1}, entries);
+    buf_mgr_->unPinPage(file_, fsm_page_number, true);
+    fsm_dirty_[i] = false;
+  }
+}
+
+int HeapFile::category(const std::size_t free_space) {
+  // A record needs a new slot unless a free one is left, so that is not
+  // counted as room.
+  if (free_space < sizeof(PageSlot)) {
+    return 0;
+  }
+  return std::min<std::size_t>(
+      (free_space - sizeof(PageSlot)) / FSM_CATEGORY_BYTES, FSM_MAX_CATEGORY);
+}
+
+void HeapFile::load() {
+  for (PageId fsm_page_number = 1; ; fsm_page_number += FSM_ENTRIES + 1) {
+    Page* page;
+    try {
+      buf_mgr_->readPage(file_, fsm_page_number, page);
+    } catch (const InvalidPageException&) {
+      break;
+    }
+    const std::string entries = page->getRecord({fsm_page_number, 1});
+    buf_mgr_->unPinPage(file_, fsm_page_number, false);
+    fsm_dirty_.push_back(false);
+
+    for (PageId i = 0; i < FSM_ENTRIES && i < entries.size(); ++i) {
+      const std::uint8_t entry = entries[i];
+      if (entry != 0) {
+        const PageId page_number = fsm_page_number + 1 + i;
+        grow(page_number);
+        fsm_[page_number] = entry;
+        link(page_number);
+        ++data_pages_;
+      }
+    }
+  }
+}
+
+void HeapFile::grow(const PageId page_number) {
+  if (page_number >= fsm_.size()) {
+    // Doubling keeps the cost of growing constant per page.
+    const std::size_t size =
+        std::max<std::size_t>(page_number + 1, 2 * fsm_.size());
+    fsm_.resize(size, 0);
+    next_.resize(size, NO_PAGE);
+    prev_.resize(size, NO_PAGE);
+  }
+  const PageId fsm_index = (page_number - 1) / (FSM_ENTRIES + 1);
+  if (fsm_index >= fsm_dirty_.size()) {
+    fsm_dirty_.resize(fsm_index + 1, false);
+  }
+}
+
+void HeapFile::setFreeSpace(const PageId page_number,
+                            const std::size_t free_space) {
+  const std::uint8_t entry = category(free_space) + 1;
+  if (fsm_[page_number] == entry) {
+    return;
+  }
+  if (fsm_[page_number] != 0) {
+    unlink(page_number);
+  }
+  fsm_[page_number] = entry;
+  link(page_number);
+  fsm_dirty_[(page_number - 1) / (FSM_ENTRIES + 1)] = true;
+}
+
+void HeapFile::link(const PageId page_number) {
+  const int c = fsm_[page_number] - 1;
+  next_[page_number] = heads_[c];
+  prev_[page_number] = NO_PAGE;
+  if (heads_[c] != NO_PAGE) {
+    prev_[heads_[c]] = page_number;
+  }
+  heads_[c] = page_number;
+  non_empty_[c / 64] |= 1ULL << (c % 64);
+}
+
+void HeapFile::unlink(const PageId page_number) {
+  const int c = fsm_[page_number] - 1;
+  const PageId next = next_[page_number];
+  const PageId prev = prev_[page_number];
+  if (prev != NO_PAGE) {
+    next_[prev] = next;
+  } else {
+    heads_[c] = next;
+    if (next == NO_PAGE) {
+      non_empty_[c / 64] &= ~(1ULL << (c % 64));
+    }
+  }
+  if (next != NO_PAGE) {
+    prev_[next] = prev;
+  }
+}
+
+PageId HeapFile::findPage(const int min_category) const {
+  // Take the fullest page that has room, so that pages fill up in turn.
+  const int words = sizeof(non_empty_) / sizeof(non_empty_[0]);
+  for (int word = min_category / 64; word < words; ++word) {
+    std::uint64_t bits = non_empty_[word];
+    if (word == min_category / 64) {
+      bits &= ~0ULL << (min_category % 64);
+    }
+    if (bits != 0) {
+      return heads_[word * 64 + __builtin_ctzll(bits)];
+    }
+  }
+  return NO_PAGE;
+}
+
+void HeapFile::allocateDataPage(PageId& page_number, Page*& page) {
+  buf_mgr_->allocPage(file_, page_number, page);
+  if (isFsmPage(page_number)) {
+    // The file has reached the next FSM page.
+    page->insertRecord(std::string(FSM_ENTRIES, '\0'));
+    buf_mgr_->unPinPage(file_, page_number, true);
+    grow(page_number);
+    buf_mgr_->allocPage(file_, page_number, page);
+  }
+  grow(page_number);
+  ++data_pages_;
+  setFreeSpace(page_number, page->getFreeSpace());
+}
+
+Page* HeapFile::pinRecordPage(const RecordId& record_id) {
+  if (record_id.page_number >= fsm_.size() ||
+      fsm_[record_id.page_number] == 0) {
+    throw InvalidRecordException(record_id, record_id.page_number);
+  }
+  Page* page;
+  buf_mgr_->readPage(file_, record_id.page_number, page);
+  return page;
+}
+
+}
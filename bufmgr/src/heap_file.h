@@ -0,0 +1,254 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Unordered collection of records stored in the pages of a file.
+ *
+ * A HeapFile finds room for new records by itself, using a free-space map
+ * (FSM).  The map holds one byte per data page: 0 if the page is not a data
+ * page, otherwise one more than the page's free space in units of
+ * FSM_CATEGORY_BYTES.  It is stored in FSM pages at fixed positions of the
+ * file: page 1 and every (FSM_ENTRIES + 1)th page after it, each holding the
+ * entries of the FSM_ENTRIES data pages that follow it.
+ *
+ * In memory, the data pages of each category are linked into a list, and a
+ * bitmap tells which lists are not empty.  An insert takes a page from the
+ * first non-empty list of a category with enough room, so finding a page
+ * takes constant time however large the file is.
+ *
+ * The FSM pages are updated in memory and written through the buffer
+ * manager by flush() and by the destructor.  An FSM page that is out of date
+ * after a crash costs at most a failed attempt to insert into a page, or
+ * free space that stays unused until its page changes again.
+ *
+ * All pages are read and written through the given buffer manager.  The
+ * file must hold nothing but the heap file.
+ *
+ * @warning This class is not threadsafe.
+ */
+class HeapFile {
+ public:
+  /**
+   * Number of data pages described by one FSM page.
+   */
+  static const PageId FSM_ENTRIES = 4000;
+
+  /**
+   * Free bytes per FSM category.
+   */
+  static const std::size_t FSM_CATEGORY_BYTES = 32;
+
+  /**
+   * Highest FSM category.
+   */
+  static const int FSM_MAX_CATEGORY = 254;
+
+  /**
+   * Opens the heap file stored in the given file, reading its free-space map.
+   *
+   * @param buf_mgr Buffer manager to read and write pages through.
+   * @param file    File holding the heap file; may be empty.
+   */
+  HeapFile(BufMgr* buf_mgr, File* file);
+
+  /**
+   * Writes the free-space map.
+   */
+  ~HeapFile();
+
+  /**
+   * Inserts a record into a page with enough room, allocating a new page if
+   * there is none.
+   *
+   * @param record  Record to insert.
+   * @return  Id of the new record.
+   * @throws  InsufficientSpaceException  If the record does not fit into an
+   *                                      empty page.
+   */
+  RecordId insert(const std::string& record);
+
+  /**
+   * Returns a record.
+   *
+   * @param record_id Id of the record.
+   * @return  The record.
+   * @throws  InvalidRecordException  If there is no such record.
+   */
+  std::string get(const RecordId& record_id);
+
+  /**
+   * Replaces a record, which stays in its page.
+   *
+   * @param record_id Id of the record.
+   * @param record    New contents of the record.
+   * @throws  InvalidRecordException      If there is no such record.
+   * @throws  InsufficientSpaceException  If the new record does not fit into
+   *                                      the page.
+   */
+  void update(const RecordId& record_id, const std::string& record);
+
+  /**
+   * Deletes a record.
+   *
+   * @param record_id Id of the record.
+   * @throws  InvalidRecordException  If there is no such record.
+   */
+  void erase(const RecordId& record_id);
+
+  /**
+   * Writes the FSM pages changed since the last flush to the buffer manager.
+   */
+  void flush();
+
+  /**
+   * Returns the number of data pages in the heap file.
+   */
+  PageId dataPages() const { return data_pages_; }
+
+  /**
+   * Returns true if the page with the given number is a data page rather
+   * than an FSM page, for readers of the file that bypass this class.
+   */
+  static bool isDataPage(const PageId page_number) {
+    return page_number != Page::INVALID_NUMBER && !isFsmPage(page_number);
+  }
+
+ private:
+  HeapFile(const HeapFile&);
+  HeapFile& operator=(const HeapFile&);
+
+  /**
+   * Number of the page in the list of each category that marks its end.
+   */
+  static const PageId NO_PAGE = Page::INVALID_NUMBER;
+
+  /**
+   * Returns true if the page is an FSM page.
+   */
+  static bool isFsmPage(const PageId page_number) {
+    return (page_number - 1) % (FSM_ENTRIES + 1) == 0;
+  }
+
+  /**
+   * Returns the number of the FSM page holding the entry of a data page.
+   */
+  static PageId fsmPageOf(const PageId page_number) {
+    return page_number - (page_number - 1) % (FSM_ENTRIES + 1);
+  }
+
+  /**
+   * Returns the FSM category of a page with the given free space.
+   */
+  static int category(const std::size_t free_space);
+
+  /**
+   * Reads the FSM pages of the file.
+   */
+  void load();
+
+  /**
+   * Makes room in the in-memory map for the given page number.
+   */
+  void grow(const PageId page_number);
+
+  /**
+   * Records the free space of a data page in the map.
+   *
+   * @param page_number Data page.
+   * @param free_space  Free bytes in the page.
+   */
+  void setFreeSpace(const PageId page_number, const std::size_t free_space);
+
+  /**
+   * Adds a page to the list of its category.
+   */
+  void link(const PageId page_number);
+
+  /**
+   * Removes a page from the list of its category.
+   */
+  void unlink(const PageId page_number);
+
+  /**
+   * Returns a data page of at least the given category, or NO_PAGE.
+   */
+  PageId findPage(const int min_category) const;
+
+  /**
+   * Allocates a new data page, and a new FSM page before it if needed.  The
+   * data page is returned pinned.
+   *
+   * @param page_number Number of the new page is returned via this reference.
+   * @param page        The new page is returned via this reference.
+   */
+  void allocateDataPage(PageId& page_number, Page*& page);
+
+  /**
+   * Reads and pins the page of a record, checking that it is a data page.
+   *
+   * @throws  InvalidRecordException  If the page is not a data page.
+   */
+  Page* pinRecordPage(const RecordId& record_id);
+
+  /**
+   * Buffer manager the pages are read through.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * File holding the heap file.
+   */
+  File* file_;
+
+  /**
+   * FSM entry of every page, indexed by page number.
+   */
+  std::vector<std::uint8_t> fsm_;
+
+  /**
+   * Next and previous page in the list of the page's category, indexed by
+   * page number.
+   */
+  std::vector<PageId> next_;
+  std::vector<PageId> prev_;
+
+  /**
+   * First page of the list of each category.
+   */
+  PageId heads_[FSM_MAX_CATEGORY + 1];
+
+  /**
+   * Bit c is set if the list of category c is not empty.
+   */
+  std::uint64_t non_empty_[(FSM_MAX_CATEGORY + 64) / 64];
+
+  /**
+   * Whether each FSM page changed since it was last written, indexed by FSM
+   * page number divided by FSM_ENTRIES + 1.
+   */
+  std::vector<bool> fsm_dirty_;
+
+  /**
+   * Number of data pages.
+   */
+  PageId data_pages_;
+};
+
+}
@@ -0,0 +1,53 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief Hash of keys, as used by HashIndex and HashJoin to pick buckets and
+ *        partitions.
+ *
+ * FNV-1a over the bytes of the key, then a finalizer that spreads every input
+ * bit over the low bits the buckets are chosen by.  Each seed gives another
+ * hash function; seed 0 is the one stored hash indexes are laid out by, so
+ * it must not change.
+ */
+class KeyHash {
+ public:
+  /**
+   * Returns the hash of a key.
+   *
+   * @param key     Bytes of the key.
+   * @param length  Number of bytes.
+   * @param seed    Selects the hash function.
+   * @return  Hash of the key.
+   */
+  static std::uint64_t compute(const char* key, const std::size_t length,
+                               const std::uint64_t seed = 0) {
+    std::uint64_t h =
+        14695981039346656037ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+    for (std::size_t i = 0; i < length; ++i) {
+      h = (h ^ static_cast<unsigned char>(key[i])) * 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+ private:
+  KeyHash();
+};
+
+}
@@ -0,0 +1,203 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace badgerdb {
+
+/**
+ * @brief Reader-writer spin latch for short critical sections.
+ *
+ * The whole latch is one 32-bit word: the low bits count the shared holders,
+ * one bit marks an exclusive holder and one bit marks a waiting exclusive
+ * requester.  New shared requests back off while an exclusive requester is
+ * waiting, so writers are not starved by a steady stream of readers.
+ * Waiters spin briefly and then yield the processor.
+ *
+ * Latches are not reentrant and are meant to be held for microseconds, not
+ * across user code.
+ */
+class RWLatch {
+ public:
+  /**
+   * Constructs an unlocked latch.
+   */
+  RWLatch() : state_(0) {}
+
+  /**
+   * Acquires the latch in shared mode.
+   */
+  void lockShared() {
+    int spins = 0;
+    while (true) {
+      std::uint32_t state = state_.load(std::memory_order_relaxed);
+      if ((state & (EXCLUSIVE | EXCLUSIVE_WAITING)) == 0 &&
+          state_.compare_exchange_weak(state, state + 1,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return;
+      }
+      backOff(spins);
+    }
+  }
+
+  /**
+   * Acquires the latch in shared mode if that is possible without waiting.
+   *
+   * @return  True if the latch was acquired.
+   */
+  bool tryLockShared() {
+    std::uint32_t state = state_.load(std::memory_order_relaxed);
+    return (state & (EXCLUSIVE | EXCLUSIVE_WAITING)) == 0 &&
+        state_.compare_exchange_strong(state, state + 1,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed);
+  }
+
+  /**
+   * Releases the latch held in shared mode.
+   */
+  void unlockShared() {
+    state_.fetch_sub(1, std::memory_order_release);
+  }
+
+  /**
+   * Acquires the latch in exclusive mode.
+   */
+  void lockExclusive() {
+    int spins = 0;
+    while (true) {
+      std::uint32_t state = state_.load(std::memory_order_relaxed);
+      if ((state & ~EXCLUSIVE_WAITING) == 0) {
+        if (state_.compare_exchange_weak(state, EXCLUSIVE,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+          return;
+        }
+      } else if ((state & EXCLUSIVE_WAITING) == 0) {
+        // Announce ourselves so that new readers stay out.
+        state_.fetch_or(EXCLUSIVE_WAITING, std::memory_order_relaxed);
+      }
+      backOff(spins);
+    }
+  }
+
+  /**
+   * Acquires the latch in exclusive mode if that is possible without waiting.
+   *
+   * @return  True if the latch was acquired.
+   */
+  bool tryLockExclusive() {
+    std::uint32_t state = state_.load(std::memory_order_relaxed);
+    return (state & ~EXCLUSIVE_WAITING) == 0 &&
+        state_.compare_exchange_strong(state, EXCLUSIVE,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed);
+  }
+
+  /**
+   * Releases the latch held in exclusive mode.
+   */
+  void unlockExclusive() {
+    state_.fetch_and(~EXCLUSIVE, std::memory_order_release);
+  }
+
+ private:
+  /**
+   * Set while the latch is held in exclusive mode.
+   */
+  static const std::uint32_t EXCLUSIVE = 1u << 31;
+
+  /**
+   * Set while an exclusive requester waits for the shared holders to leave.
+   */
+  static const std::uint32_t EXCLUSIVE_WAITING = 1u << 30;
+
+  /**
+   * Spins a few times, then starts yielding the processor.
+   *
+   * @param spins   Number of times the caller has backed off so far.
+   */
+  static void backOff(int& spins) {
+    if (++spins > 64) {
+      std::this_thread::yield();
+    }
+  }
+
+  /**
+   * Latch word.
+   */
+  std::atomic<std::uint32_t> state_;
+};
+
+/**
+ * @brief Holds an RWLatch in shared mode for the lifetime of the guard.
+ */
+class SharedLatchGuard {
+ public:
+  /**
+   * Acquires the given latch in shared mode.
+   *
+   * @param latch   Latch to hold.
+   */
+  explicit SharedLatchGuard(RWLatch& latch) : latch_(latch) {
+    latch_.lockShared();
+  }
+
+  /**
+   * Releases the latch.
+   */
+  ~SharedLatchGuard() {
+    latch_.unlockShared();
+  }
+
+ private:
+  SharedLatchGuard(const SharedLatchGuard&);
+  SharedLatchGuard& operator=(const SharedLatchGuard&);
+
+  /**
+   * Latch held by this guard.
+   */
+  RWLatch& latch_;
+};
+
+/**
+ * @brief Holds an RWLatch in exclusive mode for the lifetime of the guard.
+ */
+class ExclusiveLatchGuard {
+ public:
+  /**
+   * Acquires the given latch in exclusive mode.
+   *
+   * @param latch   Latch to hold.
+   */
+  explicit ExclusiveLatchGuard(RWLatch& latch) : latch_(latch) {
+    latch_.lockExclusive();
+  }
+
+  /**
+   * Releases the latch.
+   */
+  ~ExclusiveLatchGuard() {
+    latch_.unlockExclusive();
+  }
+
+ private:
+  ExclusiveLatchGuard(const ExclusiveLatchGuard&);
+  ExclusiveLatchGuard& operator=(const ExclusiveLatchGuard&);
+
+  /**
+   * Latch held by this guard.
+   */
+  RWLatch& latch_;
+};
+
+}
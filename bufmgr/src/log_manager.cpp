@@ -0,0 +1,559 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "log_manager.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+const Lsn LogManager::FIRST_LSN;
+const std::size_t LogManager::READ_BLOCK_BYTES;
+const std::size_t LogManager::MERGE_GAP;
+
+namespace {
+
+/**
+ * The log header: magic, format version, and the LSN of the last checkpoint
+ * record at CHECKPOINT_OFFSET.
+ */
+const char LOG_MAGIC[8] = {'B', 'D', 'B', 'W', 'A', 'L', '\0', '\0'};
+const std::uint32_t LOG_VERSION = 2;
+const std::size_t VERSION_OFFSET = 8;
+const std::size_t CHECKPOINT_OFFSET = 16;
+
+template <typename T>
+void put(std::string& record, const T value) {
+  record.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/**
+ * Reads a value at <position> of a record and advances it; false if the
+ * record is too short.
+ */
+template <typename T>
+bool get(const char* data, const std::size_t length, std::size_t& position,
+         T& value) {
+  if (length - position < sizeof(value)) {
+    return false;
+  }
+  std::memcpy(&value, data + position, sizeof(value));
+  position += sizeof(value);
+  return true;
+}
+
+bool getBytes(const char* data, const std::size_t length,
+              std::size_t& position, const std::size_t count,
+              std::string& bytes) {
+  if (length - position < count) {
+    return false;
+  }
+  bytes.assign(data + position, count);
+  position += count;
+  return true;
+}
+
+}
+
+LogManager::LogManager(const std::string& filename)
+    : filename_(filename),
+      fd_(::open(filename.c_str(), O_RDWR | O_CREAT, 0644)),
+      sync_(fd_, filename),
+      next_lsn_(0),
+      next_txn_(1),
+      checkpoint_lsn_(0),
+      flushed_lsn_(0) {
+  if (fd_ < 0) {
+    throw FileIOException(filename_, "open", errno);
+  }
+  try {
+    open();
+  } catch (...) {
+    ::close(fd_);
+    throw;
+  }
+}
+
+LogManager::~LogManager() {
+  try {
+    flush(nextLsn() - 1);
+  } catch (...) {
+    // The records not written are lost, like those of a crash.
+  }
+  ::close(fd_);
+}
+
+TxnId LogManager::begin() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const TxnId txn = next_txn_++;
+  last_lsn_[txn] = 0;
+  return txn;
+}
+
+Lsn LogManager::logUpdate(const TxnId txn, const File* file,
+                          const Page& before, Page* after) {
+  return logChange(txn, UPDATE, file, before, after, 0);
+}
+
+Lsn LogManager::logCompensation(const TxnId txn, const File* file,
+                                const Page& before, Page* after,
+                                const Lsn undo_next) {
+  return logChange(txn, COMPENSATION, file, before, after, undo_next);
+}
+
+Lsn LogManager::logChange(const TxnId txn, const RecordType type,
+                          const File* file, const Page& before, Page* after,
+                          const Lsn undo_next) {
+  char old_image[Page::SIZE];
+  char new_image[Page::SIZE];
+  pageImage(before, old_image);
+  pageImage(*after, new_image);
+
+  std::string record(sizeof(RecordHeader), '\0');
+  const std::string& name = file->filename();
+  put(record, static_cast<std::uint16_t>(name.size()));
+  record.append(name);
+  put(record, after->page_number());
+  if (type == COMPENSATION) {
+    put(record, undo_next);
+  }
+  const std::size_t count_offset = record.size();
+  put(record, static_cast<std::uint16_t>(0));
+
+  // One range per run of changed bytes; runs separated by fewer than
+  // MERGE_GAP unchanged bytes are cheaper to log as one.
+  std::uint16_t ranges = 0;
+  std::size_t i = 0;
+  while (i < Page::SIZE) {
+    if (old_image[i] == new_image[i]) {
+      i++;
+      continue;
+    }
+    const std::size_t start = i;
+    std::size_t end = i + 1;
+    for (std::size_t j = end; j < Page::SIZE && j < end + MERGE_GAP; j++) {
+      if (old_image[j] != new_image[j]) {
+        end = j + 1;
+      }
+    }
+    put(record, static_cast<std::uint16_t>(start));
+    put(record, static_cast<std::uint16_t>(end - start));
+    record.append(old_image + start, end - start);
+    record.append(new_image + start, end - start);
+    ranges++;
+    i = end;
+  }
+  if (ranges == 0) {
+    return after->lsn();
+  }
+  std::memcpy(&record[count_offset], &ranges, sizeof(ranges));
+
+  const Lsn lsn = append(txn, type, record);
+  after->set_lsn(lsn);
+  return lsn;
+}
+
+Lsn LogManager::commit(const TxnId txn) {
+  std::string record(sizeof(RecordHeader), '\0');
+  const Lsn lsn = append(txn, COMMIT, record);
+  flush(lsn);
+  return lsn;
+}
+
+void LogManager::flush(const Lsn lsn) {
+  if (lsn < flushedLsn()) {
+    return;
+  }
+
+  // Write whatever is buffered, including the records of other threads.  A
+  // flusher that finds its record already written by another skips ahead to
+  // the sync, which it then shares.
+  Lsn target;
+  {
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    if (written_lsn_ <= lsn) {
+      std::string pending;
+      Lsn pending_lsn;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending.swap(buffer_);
+        pending_lsn = buffer_lsn_;
+        buffer_lsn_ = next_lsn_;
+      }
+      if (!pending.empty()) {
+        writeAt(pending_lsn, pending.data(), pending.size());
+        written_lsn_ = pending_lsn + pending.size();
+        sync_.noteWrite(pending.size());
+      }
+    }
+    target = written_lsn_;
+  }
+
+  sync_.sync();
+  Lsn flushed = flushed_lsn_.load(std::memory_order_acquire);
+  while (flushed < target &&
+         !flushed_lsn_.compare_exchange_weak(flushed, target,
+                                             std::memory_order_acq_rel)) {
+  }
+}
+
+Lsn LogManager::logAbort(const TxnId txn) {
+  std::string record(sizeof(RecordHeader), '\0');
+  return append(txn, ABORT, record);
+}
+
+Lsn LogManager::logCheckpoint(const Lsn start,
+                              const std::vector<DirtyPage>& dirty_pages) {
+  std::string record(sizeof(RecordHeader), '\0');
+  put(record, start);
+  put(record, static_cast<std::uint32_t>(dirty_pages.size()));
+  for (std::size_t i = 0; i < dirty_pages.size(); i++) {
+    put(record, static_cast<std::uint16_t>(dirty_pages[i].filename.size()));
+    record.append(dirty_pages[i].filename);
+    put(record, dirty_pages[i].page_number);
+    put(record, dirty_pages[i].rec_lsn);
+  }
+
+  // The transactions are taken as of the record, so that none can slip
+  // between the two.
+  Lsn lsn;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    put(record, static_cast<std::uint32_t>(last_lsn_.size()));
+    for (std::unordered_map<TxnId, Lsn>::const_iterator it = last_lsn_.begin();
+         it != last_lsn_.end(); ++it) {
+      put(record, it->first);
+      put(record, it->second);
+    }
+    lsn = appendLocked(0, CHECKPOINT, record);
+  }
+  flush(lsn);
+
+  // The header is only pointed to a durable checkpoint, and never back to
+  // an older one.
+  std::lock_guard<std::mutex> write_lock(write_mutex_);
+  if (lsn < checkpointLsn()) {
+    return lsn;
+  }
+  writeAt(CHECKPOINT_OFFSET, reinterpret_cast<const char*>(&lsn), sizeof(lsn));
+  sync_.noteWrite(sizeof(lsn));
+  sync_.sync();
+  std::lock_guard<std::mutex> lock(mutex_);
+  checkpoint_lsn_ = lsn;
+  return lsn;
+}
+
+Lsn LogManager::checkpointLsn() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return checkpoint_lsn_;
+}
+
+bool LogManager::read(const Lsn lsn, LogRecord& record) const {
+  Lsn end;
+  {
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    end = written_lsn_;
+  }
+  std::string bytes;
+  return lsn >= FIRST_LSN && lsn < end && readRecord(lsn, end, bytes) &&
+         parse(bytes.data(), bytes.size(), record);
+}
+
+void LogManager::apply(const LogRecord& record, const bool undo, Page* page) {
+  char image[Page::SIZE];
+  page->copyTo(image);
+  for (std::size_t i = 0; i < record.ranges.size(); i++) {
+    const LogRecord::Range& range = record.ranges[i];
+    const std::string& bytes = undo ? range.before : range.after;
+    std::memcpy(image + range.offset, bytes.data(),
+                std::min<std::size_t>(bytes.size(), Page::SIZE - range.offset));
+  }
+
+  // Ranges may span the cleared LSN of the images.
+  const Lsn lsn = page->lsn();
+  page->copyFrom(image);
+  page->set_lsn(lsn);
+}
+
+Lsn LogManager::append(const TxnId txn, const RecordType type,
+                       std::string& record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return appendLocked(txn, type, record);
+}
+
+Lsn LogManager::appendLocked(const TxnId txn, const RecordType type,
+                             std::string& record) {
+  RecordHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.length = static_cast<std::uint32_t>(record.size());
+  header.lsn = next_lsn_.load(std::memory_order_relaxed);
+  header.prev_lsn = txn != 0 ? last_lsn_[txn] : 0;
+  header.txn = txn;
+  header.type = static_cast<std::uint8_t>(type);
+  std::memcpy(&record[0], &header, sizeof(header));
+  header.checksum = checksum(record.data(), record.size());
+  std::memcpy(&record[offsetof(RecordHeader, checksum)], &header.checksum,
+              sizeof(header.checksum));
+
+  buffer_.append(record);
+  next_lsn_.store(header.lsn + record.size(), std::memory_order_release);
+  if (type == COMMIT || type == ABORT) {
+    last_lsn_.erase(txn);
+  } else if (txn != 0) {
+    last_lsn_[txn] = header.lsn;
+  }
+  return header.lsn;
+}
+
+bool LogManager::parse(const char* data, const std::size_t length,
+                       LogRecord& record) {
+  RecordHeader header;
+  if (length < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.length != length ||
+      checksum(data, length) != header.checksum) {
+    return false;
+  }
+  record.lsn = header.lsn;
+  record.prev_lsn = header.prev_lsn;
+  record.txn = header.txn;
+  record.type = static_cast<RecordType>(header.type);
+  record.filename.clear();
+  record.page_number = Page::INVALID_NUMBER;
+  record.ranges.clear();
+  record.undo_next_lsn = 0;
+  record.checkpoint_start = 0;
+  record.transactions.clear();
+  record.dirty_pages.clear();
+
+  std::size_t position = sizeof(header);
+  if (record.type == UPDATE || record.type == COMPENSATION) {
+    std::uint16_t name_length;
+    std::uint16_t count;
+    if (!get(data, length, position, name_length) ||
+        !getBytes(data, length, position, name_length, record.filename) ||
+        !get(data, length, position, record.page_number) ||
+        (record.type == COMPENSATION &&
+         !get(data, length, position, record.undo_next_lsn)) ||
+        !get(data, length, position, count)) {
+      return false;
+    }
+    record.ranges.resize(count);
+    for (std::uint16_t i = 0; i < count; i++) {
+      LogRecord::Range& range = record.ranges[i];
+      std::uint16_t range_length;
+      if (!get(data, length, position, range.offset) ||
+          !get(data, length, position, range_length) ||
+          range.offset + range_length > Page::SIZE ||
+          !getBytes(data, length, position, range_length, range.before) ||
+          !getBytes(data, length, position, range_length, range.after)) {
+        return false;
+      }
+    }
+  } else if (record.type == CHECKPOINT) {
+    std::uint32_t count;
+    if (!get(data, length, position, record.checkpoint_start) ||
+        !get(data, length, position, count)) {
+      return false;
+    }
+    record.dirty_pages.resize(count);
+    for (std::uint32_t i = 0; i < count; i++) {
+      DirtyPage& page = record.dirty_pages[i];
+      std::uint16_t name_length;
+      if (!get(data, length, position, name_length) ||
+          !getBytes(data, length, position, name_length, page.filename) ||
+          !get(data, length, position, page.page_number) ||
+          !get(data, length, position, page.rec_lsn)) {
+        return false;
+      }
+    }
+    if (!get(data, length, position, count)) {
+      return false;
+    }
+    record.transactions.resize(count);
+    for (std::uint32_t i = 0; i < count; i++) {
+      if (!get(data, length, position, record.transactions[i].first) ||
+          !get(data, length, position, record.transactions[i].second)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void LogManager::pageImage(const Page& page, char* image) {
+  page.copyTo(image);
+  const Lsn cleared = 0;
+  std::memcpy(image + offsetof(PageHeader, lsn), &cleared, sizeof(cleared));
+}
+
+std::uint32_t LogManager::checksum(const char* record,
+                                   const std::size_t length) {
+  // FNV-1a over everything after the checksum field.
+  std::uint32_t hash = 2166136261u;
+  for (std::size_t i = offsetof(RecordHeader, lsn); i < length; i++) {
+    hash ^= static_cast<unsigned char>(record[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void LogManager::open() {
+  const off_t size = ::lseek(fd_, 0, SEEK_END);
+  if (size < 0) {
+    throw FileIOException(filename_, "lseek", errno);
+  }
+
+  Lsn end = FIRST_LSN;
+  if (size == 0) {
+    char header[FIRST_LSN] = {};
+    std::memcpy(header, LOG_MAGIC, sizeof(LOG_MAGIC));
+    std::memcpy(header + VERSION_OFFSET, &LOG_VERSION, sizeof(LOG_VERSION));
+    writeAt(0, header, sizeof(header));
+    sync_.noteWrite(sizeof(header));
+    sync_.sync();
+  } else {
+    char header[FIRST_LSN] = {};
+    if (static_cast<Lsn>(size) >= FIRST_LSN) {
+      readAt(0, header, sizeof(header));
+    }
+    std::uint32_t version;
+    std::memcpy(&version, header + VERSION_OFFSET, sizeof(version));
+    if (std::memcmp(header, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 ||
+        version != LOG_VERSION) {
+      throw FileIOException(filename_, "open log", EINVAL);
+    }
+    std::memcpy(&checkpoint_lsn_, header + CHECKPOINT_OFFSET,
+                sizeof(checkpoint_lsn_));
+
+    // The log ends at the first record that is incomplete or damaged; a
+    // crash can only have torn the last one written.
+    std::string record;
+    while (readRecord(end, size, record)) {
+      RecordHeader record_header;
+      std::memcpy(&record_header, record.data(), sizeof(record_header));
+      if (record_header.txn >= next_txn_) {
+        next_txn_ = record_header.txn + 1;
+      }
+      end += record.size();
+    }
+    if (end < static_cast<Lsn>(size)) {
+      if (::ftruncate(fd_, end) != 0) {
+        throw FileIOException(filename_, "ftruncate", errno);
+      }
+      sync_.noteWrite(static_cast<Lsn>(size) - end);
+      sync_.sync();
+    }
+    if (checkpoint_lsn_ >= end) {
+      checkpoint_lsn_ = 0;
+    }
+  }
+
+  buffer_lsn_ = end;
+  next_lsn_.store(end, std::memory_order_release);
+  written_lsn_ = end;
+  flushed_lsn_.store(end, std::memory_order_release);
+}
+
+bool LogManager::readRecord(const Lsn lsn, const Lsn end,
+                            std::string& record) const {
+  if (end - lsn < sizeof(RecordHeader)) {
+    return false;
+  }
+  RecordHeader header;
+  readAt(lsn, reinterpret_cast<char*>(&header), sizeof(header));
+  if (header.length < sizeof(RecordHeader) || header.length > end - lsn ||
+      header.lsn != lsn) {
+    return false;
+  }
+  record.resize(header.length);
+  readAt(lsn, &record[0], header.length);
+  return checksum(record.data(), record.size()) == header.checksum;
+}
+
+LogManager::Reader::Reader(const LogManager& log, const Lsn start)
+    : log_(log),
+      position_(start),
+      block_lsn_(start) {
+  std::lock_guard<std::mutex> write_lock(log.write_mutex_);
+  end_ = log.written_lsn_;
+}
+
+bool LogManager::Reader::next(LogRecord& record) {
+  if (!fill(sizeof(RecordHeader))) {
+    return false;
+  }
+  std::uint32_t length;
+  std::memcpy(&length, &block_[position_ - block_lsn_], sizeof(length));
+  if (length < sizeof(RecordHeader) || !fill(length) ||
+      !parse(&block_[position_ - block_lsn_], length, record) ||
+      record.lsn != position_) {
+    return false;
+  }
+  position_ += length;
+  return true;
+}
+
+bool LogManager::Reader::fill(const std::size_t length) {
+  if (end_ < position_ || end_ - position_ < length) {
+    return false;
+  }
+  if (position_ + length <= block_lsn_ + block_.size()) {
+    return true;
+  }
+  block_lsn_ = position_;
+  block_.resize(static_cast<std::size_t>(
+      std::min<Lsn>(end_ - position_, std::max(length, READ_BLOCK_BYTES))));
+  log_.readAt(block_lsn_, &block_[0], block_.size());
+  return true;
+}
+
+void LogManager::readAt(const Lsn offset, char* data,
+                        const std::size_t length) const {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pread(fd_, data + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, "pread", errno);
+    }
+    if (n == 0) {
+      // Past the end of the log.
+      std::memset(data + done, 0, length - done);
+      return;
+    }
+    done += n;
+  }
+}
+
+void LogManager::writeAt(const Lsn offset, const char* data,
+                         const std::size_t length) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pwrite(fd_, data + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, "pwrite", errno);
+    }
+    done += n;
+  }
+}
+
+}
@@ -0,0 +1,476 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "file.h"
+#include "group_sync.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Sequential write-ahead log of page updates.
+ *
+ * Every update of a page is described by a log record, appended to the end
+ * of a single log file before the page itself is written.  The LSN of a
+ * record is its byte offset in the log; the LSN of the last update of a page
+ * is stored in its header.  BufMgr makes the log durable up to that LSN
+ * before it writes the page back (see BufMgr::setLogManager()), so that a
+ * page on disk never holds an update whose record could be lost.  Pages can
+ * therefore be written lazily: a transaction is durable as soon as its
+ * commit record is.
+ *
+ * Records are appended to a buffer in memory and written to the log by
+ * flush().  Concurrent committers share writes and fdatasync() calls: while
+ * one flushes, the others append, and the next flush covers all of them
+ * (group commit).
+ *
+ * An update record holds the byte ranges of the page image (header and data,
+ * as written to disk) that changed, with their contents before and after.
+ * Each record is checksummed; when a log is opened, a torn record at its end
+ * and everything after it is cut off.
+ *
+ * The header of the log points to the last checkpoint record (see
+ * Checkpointer), where Recovery starts reading the log after a crash.
+ *
+ * All methods may be called from several threads.
+ */
+class LogManager {
+ public:
+  /**
+   * Types of log records.
+   */
+  enum RecordType {
+    /**
+     * Change of byte ranges of a page.
+     */
+    UPDATE = 1,
+
+    /**
+     * End of a committed transaction.
+     */
+    COMMIT = 2,
+
+    /**
+     * Undo of an update during rollback; never undone itself.
+     */
+    COMPENSATION = 3,
+
+    /**
+     * End of a transaction that has been rolled back.
+     */
+    ABORT = 4,
+
+    /**
+     * Transactions running and pages dirty at a checkpoint.
+     */
+    CHECKPOINT = 5
+  };
+
+  /**
+   * A page that is dirty in a buffer pool, and a lower bound of the LSN of
+   * the first update that is not on disk.
+   */
+  struct DirtyPage {
+    std::string filename;
+    PageId page_number;
+    Lsn rec_lsn;
+  };
+
+  /**
+   * A record read back from the log.
+   */
+  struct LogRecord {
+    /**
+     * A changed byte range of a page image.
+     */
+    struct Range {
+      std::uint16_t offset;
+      std::string before;
+      std::string after;
+    };
+
+    Lsn lsn;
+    Lsn prev_lsn;
+    TxnId txn;
+    RecordType type;
+
+    /**
+     * Page changed by an UPDATE or COMPENSATION record, and its changes.
+     */
+    std::string filename;
+    PageId page_number;
+    std::vector<Range> ranges;
+
+    /**
+     * Next record to undo after a COMPENSATION record.
+     */
+    Lsn undo_next_lsn;
+
+    /**
+     * Contents of a CHECKPOINT record: where recovery starts reading, the
+     * last LSN of each running transaction, and the dirty pages.
+     */
+    Lsn checkpoint_start;
+    std::vector<std::pair<TxnId, Lsn> > transactions;
+    std::vector<DirtyPage> dirty_pages;
+  };
+
+  /**
+   * Reads the records of a log in order, a block at a time.
+   */
+  class Reader {
+   public:
+    /**
+     * Starts reading at the given LSN, up to the end of the log written so
+     * far.
+     */
+    Reader(const LogManager& log, const Lsn start);
+
+    /**
+     * Reads the next record.
+     *
+     * @return  False at the end of the log.
+     */
+    bool next(LogRecord& record);
+
+    /**
+     * Returns the LSN of the next record.
+     */
+    Lsn position() const { return position_; }
+
+   private:
+    /**
+     * Makes sure the block holds <length> bytes from the position on.
+     *
+     * @return  False if the log ends before.
+     */
+    bool fill(const std::size_t length);
+
+    const LogManager& log_;
+    Lsn position_;
+    Lsn end_;
+    std::string block_;
+    Lsn block_lsn_;
+  };
+
+  /**
+   * LSN of the first record; the log starts with a header.
+   */
+  static const Lsn FIRST_LSN = 32;
+
+  /**
+   * Bytes a Reader reads at a time.
+   */
+  static const std::size_t READ_BLOCK_BYTES = 1 << 20;
+
+  /**
+   * Changed byte ranges of a page image closer than this are logged as one.
+   */
+  static const std::size_t MERGE_GAP = 8;
+
+  /**
+   * Opens the log with the given name, creating it if it does not exist.
+   *
+   * @param filename  Name of the log file.
+   * @throws  FileIOException  If the log cannot be opened, read or is not a
+   *                           log.
+   */
+  explicit LogManager(const std::string& filename);
+
+  /**
+   * Makes the records appended so far durable and closes the log.  A
+   * BufMgr using the log must be destroyed first.
+   */
+  ~LogManager();
+
+  /**
+   * Starts a transaction.
+   *
+   * @return  ID of the transaction, unique within the log.
+   */
+  TxnId begin();
+
+  /**
+   * Logs an update of a page and sets the LSN of the page to that of the
+   * record.  The caller holds the page pinned and is its only writer.
+   *
+   * @param txn     Transaction making the update.
+   * @param file    File of the page.
+   * @param before  Copy of the page before the update.
+   * @param after   The page after the update.
+   * @return  LSN of the record, or the LSN of the page if nothing changed.
+   */
+  Lsn logUpdate(const TxnId txn, const File* file, const Page& before,
+                Page* after);
+
+  /**
+   * Logs the undo of an update, like logUpdate(), as a compensation record.
+   *
+   * @param txn       Transaction being rolled back.
+   * @param file      File of the page.
+   * @param before    Copy of the page before the undo.
+   * @param after     The page after the undo.
+   * @param undo_next LSN of the next record of the transaction to undo.
+   * @return  LSN of the record, or the LSN of the page if nothing changed.
+   */
+  Lsn logCompensation(const TxnId txn, const File* file, const Page& before,
+                      Page* after, const Lsn undo_next);
+
+  /**
+   * Logs the end of a transaction that has been rolled back.
+   *
+   * @param txn   Transaction rolled back.
+   * @return  LSN of the record.
+   */
+  Lsn logAbort(const TxnId txn);
+
+  /**
+   * Logs a checkpoint, makes it durable and points the log header to it.
+   * The running transactions are taken as of the record.
+   *
+   * @param start       LSN from which on the log was appended while the
+   *                    dirty pages were collected.
+   * @param dirty_pages Pages dirty in the buffer pool at <start> or later.
+   * @return  LSN of the record.
+   * @throws  FileIOException  If the log cannot be written or synced.
+   */
+  Lsn logCheckpoint(const Lsn start, const std::vector<DirtyPage>& dirty_pages);
+
+  /**
+   * Returns the LSN of the last checkpoint record, or 0 if there is none.
+   */
+  Lsn checkpointLsn() const;
+
+  /**
+   * Reads the record with the given LSN, which must have been flushed.
+   *
+   * @return  False if there is no intact record there.
+   */
+  bool read(const Lsn lsn, LogRecord& record) const;
+
+  /**
+   * Writes the changes of an update or compensation record to a page: the
+   * bytes after the change, or with <undo> the bytes before it.  The LSN of
+   * the page is left alone.
+   */
+  static void apply(const LogRecord& record, const bool undo, Page* page);
+
+  /**
+   * Logs the commit of a transaction and returns once it is durable.
+   *
+   * @param txn   Transaction to commit.
+   * @return  LSN of the commit record.
+   * @throws  FileIOException  If the log cannot be written or synced.
+   */
+  Lsn commit(const TxnId txn);
+
+  /**
+   * Returns once the record with the given LSN, and every record before it,
+   * is durable.  Returns at once for LSN 0 and for records already durable.
+   *
+   * @param lsn   LSN of a record.
+   * @throws  FileIOException  If the log cannot be written or synced.
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Returns the end of the durable part of the log: every record with a
+   * smaller LSN is durable.
+   */
+  Lsn flushedLsn() const { return flushed_lsn_.load(std::memory_order_acquire); }
+
+  /**
+   * Returns the LSN the next record will get.
+   */
+  Lsn nextLsn() const { return next_lsn_.load(std::memory_order_acquire); }
+
+  /**
+   * Returns the number of times the log has been synced since it was opened.
+   */
+  std::uint64_t syncCount() const { return sync_.syncCount(); }
+
+  /**
+   * Returns the name of the log file.
+   */
+  const std::string& filename() const { return filename_; }
+
+ private:
+  LogManager(const LogManager&);
+  LogManager& operator=(const LogManager&);
+
+  /**
+   * Header of every log record.
+   */
+  struct RecordHeader {
+    /**
+     * Length of the record in bytes, header included.
+     */
+    std::uint32_t length;
+
+    /**
+     * Checksum of the record from the field after this one on.
+     */
+    std::uint32_t checksum;
+
+    /**
+     * LSN of the record.
+     */
+    Lsn lsn;
+
+    /**
+     * LSN of the previous record of the same transaction, or 0.
+     */
+    Lsn prev_lsn;
+
+    /**
+     * Transaction that wrote the record.
+     */
+    TxnId txn;
+
+    /**
+     * A RecordType.
+     */
+    std::uint8_t type;
+    std::uint8_t reserved[7];
+  };
+
+  /**
+   * Appends a record with the given body, which starts with room for the
+   * header, and returns its LSN.  Transaction 0 is none.
+   */
+  Lsn append(const TxnId txn, const RecordType type, std::string& record);
+
+  /**
+   * Like append(), with <mutex_> held.
+   */
+  Lsn appendLocked(const TxnId txn, const RecordType type,
+                   std::string& record);
+
+  /**
+   * Logs the change between two images of a page as a record of the given
+   * type; undo_next is added to compensation records.
+   */
+  Lsn logChange(const TxnId txn, const RecordType type, const File* file,
+                const Page& before, Page* after, const Lsn undo_next);
+
+  /**
+   * Decodes a record read from the log.
+   *
+   * @return  False if the record is damaged.
+   */
+  static bool parse(const char* data, const std::size_t length,
+                    LogRecord& record);
+
+  /**
+   * Writes the page image of <page> to <image>, with the LSN cleared.
+   */
+  static void pageImage(const Page& page, char* image);
+
+  /**
+   * Returns the checksum of a record.
+   */
+  static std::uint32_t checksum(const char* record, const std::size_t length);
+
+  /**
+   * Creates the log header, or checks it and finds the end of the log,
+   * cutting off a torn tail.
+   */
+  void open();
+
+  /**
+   * Reads the record at the given offset into <record>.
+   *
+   * @return  False if there is no complete, intact record there.
+   */
+  bool readRecord(const Lsn lsn, const Lsn end, std::string& record) const;
+
+  /**
+   * Reads <length> bytes of the log at <offset>.
+   */
+  void readAt(const Lsn offset, char* data, const std::size_t length) const;
+
+  /**
+   * Writes <length> bytes to the log at <offset>.
+   */
+  void writeAt(const Lsn offset, const char* data, const std::size_t length);
+
+  /**
+   * Name of the log file.
+   */
+  const std::string filename_;
+
+  /**
+   * Descriptor of the log file.
+   */
+  int fd_;
+
+  /**
+   * Shares fdatasync() calls between flushers.
+   */
+  GroupSync sync_;
+
+  /**
+   * Serializes writes of the buffer to the log.
+   */
+  mutable std::mutex write_mutex_;
+
+  /**
+   * Protects the members below, up to written_lsn_, and checkpoint_lsn_.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Records appended but not written yet, and the LSN of the first.
+   */
+  std::string buffer_;
+  Lsn buffer_lsn_;
+
+  /**
+   * LSN of the next record; changed under <mutex_>.
+   */
+  std::atomic<Lsn> next_lsn_;
+
+  /**
+   * ID of the next transaction.
+   */
+  TxnId next_txn_;
+
+  /**
+   * LSN of the last record of each running transaction, or 0.
+   */
+  std::unordered_map<TxnId, Lsn> last_lsn_;
+
+  /**
+   * End of the log written to the file; changed under <write_mutex_>.
+   */
+  Lsn written_lsn_;
+
+  /**
+   * LSN of the last checkpoint record, or 0.
+   */
+  Lsn checkpoint_lsn_;
+
+  /**
+   * End of the durable part of the log.
+   */
+  std::atomic<Lsn> flushed_lsn_;
+
+  friend class Recovery;
+};
+
+}
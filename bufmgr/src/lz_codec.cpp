@@ -0,0 +1,307 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lz_codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+
+const std::size_t LzCodec::MAX_INPUT_LENGTH;
+
+namespace {
+
+/**
+ * Bits of the hash of four bytes that index the match table.
+ */
+const int HASH_BITS = 12;
+
+/**
+ * Shortest copy.
+ */
+const std::size_t MIN_MATCH = 4;
+
+/**
+ * Every 2^SKIP_SHIFT positions without a match, the search steps one byte
+ * further.
+ */
+const unsigned int SKIP_SHIFT = 5;
+
+std::uint32_t load32(const unsigned char* p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+std::uint32_t hashOf(const unsigned char* p) {
+  return (load32(p) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * Returns the number of continuation bytes of a length field whose value in
+ * the token is 15.
+ */
+std::size_t continuationBytes(const std::size_t length) {
+  return length >= 15 ? (length - 15) / 255 + 1 : 0;
+}
+
+unsigned char* putContinuation(unsigned char* out, std::size_t length) {
+  for (length -= 15; length >= 255; length -= 255) {
+    *out++ = 255;
+  }
+  *out++ = static_cast<unsigned char>(length);
+  return out;
+}
+
+/**
+ * Writes a sequence of literals followed by a copy, or by nothing if
+ * <match_length> is 0.  Returns the end of the sequence, or NULL if it does
+ * not fit before <out_end>.  Bytes up to <literals_end> may be read past the
+ * literals, and bytes up to <out_end> written past the sequence.
+ */
+unsigned char* putSequence(unsigned char* out, unsigned char* const out_end,
+                           const unsigned char* literals,
+                           const unsigned char* const literals_end,
+                           const std::size_t literal_length,
+                           const std::size_t distance,
+                           const std::size_t match_length) {
+  const std::size_t code = match_length > 0 ? match_length - MIN_MATCH : 0;
+  std::size_t needed = 1 + continuationBytes(literal_length) + literal_length;
+  if (match_length > 0) {
+    needed += 2 + continuationBytes(code);
+  }
+  if (needed > static_cast<std::size_t>(out_end - out)) {
+    return NULL;
+  }
+
+  unsigned char* const token = out++;
+  *token = static_cast<unsigned char>(
+      (literal_length >= 15 ? 15 : literal_length) << 4);
+  if (literal_length >= 15) {
+    out = putContinuation(out, literal_length);
+  }
+  if (literal_length <= 16 && out_end - out >= 16 &&
+      literals_end - literals >= 16) {
+    // short runs, the common case, are copied in one fixed-size move
+    std::memcpy(out, literals, 16);
+  } else {
+    std::memcpy(out, literals, literal_length);
+  }
+  out += literal_length;
+  if (match_length > 0) {
+    *out++ = static_cast<unsigned char>(distance & 0xff);
+    *out++ = static_cast<unsigned char>(distance >> 8);
+    *token |= static_cast<unsigned char>(code >= 15 ? 15 : code);
+    if (code >= 15) {
+      out = putContinuation(out, code);
+    }
+  }
+  return out;
+}
+
+/**
+ * Adds the continuation bytes of a length field to <length>.  Returns false
+ * if the input ends first.
+ */
+bool getContinuation(const unsigned char*& in, const unsigned char* const end,
+                     std::size_t& length) {
+  unsigned char byte;
+  do {
+    if (in == end) {
+      return false;
+    }
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Decompresses into [out, out_end).  If <prefix> is set, stops when the
+ * buffer is full; otherwise the input must fill it exactly.  A template
+ * parameter, so that whole-page decompression carries none of the checks.
+ */
+template <bool prefix>
+bool decode(const unsigned char* in, const unsigned char* const in_end,
+            unsigned char* const out_begin, unsigned char* const out_end) {
+  unsigned char* out = out_begin;
+  for (;;) {
+    if (prefix && out == out_end) {
+      return true;
+    }
+    if (in == in_end) {
+      return false;
+    }
+    const unsigned int token = *in++;
+
+    std::size_t literal_length = token >> 4;
+    if (literal_length == 15 && !getContinuation(in, in_end, literal_length)) {
+      return false;
+    }
+    if (literal_length <= 16 && in_end - in >= 16 && out_end - out >= 16) {
+      // short runs, the common case, are copied in one fixed-size move
+      std::memcpy(out, in, 16);
+    } else {
+      std::size_t copied = literal_length;
+      if (prefix && copied > static_cast<std::size_t>(out_end - out)) {
+        copied = out_end - out;
+      }
+      if (copied > static_cast<std::size_t>(in_end - in) ||
+          copied > static_cast<std::size_t>(out_end - out)) {
+        return false;
+      }
+      std::memcpy(out, in, copied);
+      if (copied < literal_length) {
+        return true;
+      }
+    }
+    in += literal_length;
+    out += literal_length;
+    if (in == in_end) {
+      // the last sequence has no copy
+      return out == out_end;
+    }
+
+    if (in_end - in < 2) {
+      return false;
+    }
+    const std::size_t distance = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+    in += 2;
+    std::size_t match_length = token & 15;
+    if (match_length == 15 && !getContinuation(in, in_end, match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (prefix && match_length > static_cast<std::size_t>(out_end - out)) {
+      match_length = out_end - out;
+    }
+    if (distance == 0 ||
+        distance > static_cast<std::size_t>(out - out_begin) ||
+        match_length > static_cast<std::size_t>(out_end - out)) {
+      return false;
+    }
+
+    // A copy may overlap its own output, repeating the last <distance>
+    // bytes.  It then also repeats every multiple of <distance>, so after
+    // the first few bytes it is copied eight bytes at a time from a multiple
+    // of at least eight back.
+    const unsigned char* const from = out - distance;
+    std::size_t i = 0;
+    std::size_t step = distance;
+    if (distance >= match_length) {
+      std::memcpy(out, from, match_length);
+      i = match_length;
+    } else if (distance < 8) {
+      step = distance * ((8 + distance - 1) / distance);
+      for (; i < step && i < match_length; ++i) {
+        out[i] = from[i];
+      }
+    }
+    for (; i + 8 <= match_length; i += 8) {
+      std::memcpy(out + i, out + i - step, 8);
+    }
+    for (; i < match_length; ++i) {
+      out[i] = out[i - step];
+    }
+    out += match_length;
+  }
+}
+
+}
+
+std::size_t LzCodec::compress(const void* input, const std::size_t length,
+                              void* output, const std::size_t capacity) {
+  if (length > MAX_INPUT_LENGTH) {
+    return 0;
+  }
+  const unsigned char* const begin = static_cast<const unsigned char*>(input);
+  const unsigned char* const end = begin + length;
+  unsigned char* const out_begin = static_cast<unsigned char*>(output);
+  unsigned char* const out_end = out_begin + capacity;
+  unsigned char* out = out_begin;
+  // start of the literals not yet written
+  const unsigned char* anchor = begin;
+
+  if (length > MIN_MATCH) {
+    // positions fit 16 bits, as the input is at most MAX_INPUT_LENGTH bytes
+    std::uint16_t table[1 << HASH_BITS];
+    std::memset(table, 0, sizeof(table));
+    const unsigned char* const last = end - MIN_MATCH;
+    const unsigned char* p = begin;
+    unsigned int misses = 0;
+    while (p <= last) {
+      const std::uint32_t hash = hashOf(p);
+      const unsigned char* const candidate = begin + table[hash];
+      table[hash] = static_cast<std::uint16_t>(p - begin);
+      if (candidate >= p || load32(candidate) != load32(p)) {
+        p += 1 + (misses++ >> SKIP_SHIFT);
+        continue;
+      }
+
+      // extend the match eight bytes at a time; the first differing byte of
+      // two words holds their lowest differing bit on little-endian machines
+      std::size_t matched = MIN_MATCH;
+      while (p + matched + 8 <= end) {
+        std::uint64_t a;
+        std::uint64_t b;
+        std::memcpy(&a, p + matched, sizeof(a));
+        std::memcpy(&b, candidate + matched, sizeof(b));
+        if (a != b) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+          matched += __builtin_clzll(a ^ b) / 8;
+#else
+          matched += __builtin_ctzll(a ^ b) / 8;
+#endif
+          break;
+        }
+        matched += 8;
+      }
+      if (p + matched + 8 > end) {
+        while (p + matched < end && p[matched] == candidate[matched]) {
+          ++matched;
+        }
+      }
+
+      out = putSequence(out, out_end, anchor, end, p - anchor, p - candidate,
+                        matched);
+      if (out == NULL) {
+        return 0;
+      }
+      p += matched;
+      anchor = p;
+      misses = 0;
+      // the bytes just before the end of a copy often start the next one
+      if (p <= last) {
+        table[hashOf(p - 2)] = static_cast<std::uint16_t>(p - 2 - begin);
+      }
+    }
+  }
+
+  out = putSequence(out, out_end, anchor, end, end - anchor, 0, 0);
+  if (out == NULL) {
+    return 0;
+  }
+  return out - out_begin;
+}
+
+bool LzCodec::decompress(const void* input, const std::size_t length,
+                         void* output, const std::size_t output_length) {
+  const unsigned char* const in = static_cast<const unsigned char*>(input);
+  unsigned char* const out = static_cast<unsigned char*>(output);
+  return decode<false>(in, in + length, out, out + output_length);
+}
+
+bool LzCodec::decompressPrefix(const void* input, const std::size_t length,
+                               void* output,
+                               const std::size_t prefix_length) {
+  const unsigned char* const in = static_cast<const unsigned char*>(input);
+  unsigned char* const out = static_cast<unsigned char*>(output);
+  return decode<true>(in, in + length, out, out + prefix_length);
+}
+
+}
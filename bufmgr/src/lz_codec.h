@@ -0,0 +1,90 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * @brief Fast LZ77 compression of pages.
+ *
+ * Input is encoded as a series of sequences, each a run of literal bytes
+ * followed by a copy of at least four bytes from up to 64 KB back, the last
+ * one with literals only.  A sequence starts with a token byte holding the
+ * number of literals in its high and the copy length minus four in its low
+ * four bits; a value of 15 is continued by further bytes that are added to
+ * it, up to a byte below 255.  The literals follow, then the two-byte
+ * little-endian distance of the copy, then the continuation of its length.
+ * This is the block format of LZ4.
+ *
+ * Matches are found through a table of the last position of each hash of
+ * four bytes, and runs without matches are skipped over in growing steps, so
+ * that incompressible input costs little.  Decompression checks every length
+ * and distance against the buffers, so corrupted input fails instead of
+ * reading or writing out of bounds.
+ */
+class LzCodec {
+ public:
+  /**
+   * Longest input compress() accepts, since copies reach back 64 KB.
+   */
+  static const std::size_t MAX_INPUT_LENGTH = 65535;
+
+  /**
+   * Returns the size of the largest output compress() can produce for the
+   * given number of bytes.
+   */
+  static std::size_t maxCompressedLength(const std::size_t length) {
+    return length + length / 255 + 16;
+  }
+
+  /**
+   * Compresses bytes.
+   *
+   * @param input     Bytes to compress.
+   * @param length    Number of bytes; at most MAX_INPUT_LENGTH.
+   * @param output    Buffer for the compressed bytes.
+   * @param capacity  Size of the output buffer.
+   * @return  Number of compressed bytes, or 0 if they do not fit into
+   *          <capacity> bytes.
+   */
+  static std::size_t compress(const void* input, const std::size_t length,
+                              void* output, const std::size_t capacity);
+
+  /**
+   * Decompresses bytes produced by compress().
+   *
+   * @param input         Compressed bytes.
+   * @param length        Number of compressed bytes.
+   * @param output        Buffer for the original bytes.
+   * @param output_length Number of original bytes.
+   * @return  False if the input is corrupted or does not decompress to
+   *          exactly <output_length> bytes.
+   */
+  static bool decompress(const void* input, const std::size_t length,
+                         void* output, const std::size_t output_length);
+
+  /**
+   * Decompresses the first bytes of the output of compress() only, reading
+   * no more input than they take.
+   *
+   * @param input         Compressed bytes, or a prefix of them.
+   * @param length        Number of compressed bytes available.
+   * @param output        Buffer for the first original bytes.
+   * @param prefix_length Number of original bytes to decompress.
+   * @return  False if the input is corrupted or ends first.
+   */
+  static bool decompressPrefix(const void* input, const std::size_t length,
+                               void* output, const std::size_t prefix_length);
+
+ private:
+  LzCodec();
+};
+
+}
@@ -1,16 +1,49 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <set>
+#include <mutex>
 #include <stdlib.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 //#include <stdio.h>
 #include <cstring>
 #include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
 #include "page.h"
+#include "btree.h"
 #include "buffer.h"
+#include "external_sort.h"
 #include "file_iterator.h"
+#include "file_scan.h"
+#include "hash_join.h"
+#include "hash_index.h"
+#include "heap_file.h"
+#include "log_manager.h"
+#include "checkpointer.h"
+#include "recovery.h"
+#include "parallel_scan.h"
+#include "victim_cache.h"
 #include "page_iterator.h"
+#include "page_guard.h"
+#include "crc32c.h"
+#include "lz_codec.h"
+#include "exceptions/bad_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/invalid_record_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
+#include "exceptions/page_checksum_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
 
 #define PRINT_ERROR(str) \
@@ -38,6 +71,40 @@ void test5();
 void test6();
 void test7();
 void test_unPinPage();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
+void test33();
+void test34();
+void test35();
+void test36();
+void test37();
+void test38();
+void test39();
+void test40();
+void test41();
 void testBufMgr();
 
 int main()
@@ -77,11 +144,12 @@ int main()
          iter != new_file.end();
          ++iter) {
       // Iterate through all records on the page.
-      for (PageIterator page_iter = (*iter).begin();
-           page_iter != (*iter).end();
+      Page curr_page = *iter;
+      for (PageIterator page_iter = curr_page.begin();
+           page_iter != curr_page.end();
            ++page_iter) {
         std::cout << "Found record: " << *page_iter
-            << " on page " << (*iter).page_number() << "\n";
+            << " on page " << curr_page.page_number() << "\n";
       }
     }
 
@@ -150,6 +218,40 @@ void testBufMgr()
 	test6();
     test7();
     test_unPinPage();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+	test31();
+	test32();
+	test33();
+	test34();
+	test35();
+	test36();
+	test37();
+	test38();
+	test39();
+	test40();
+	test41();
 
 	//Close files before deleting them
    // printf("~file\n");
@@ -447,3 +549,2426 @@ void test_unPinPage() {
 
     std::cout << "Test for unPinPage passed\n";
 }
+
+void test8()
+{
+	// Pages read through a ring strategy must not push the pages read
+	// normally out of the buffer pool.
+	BufMgr* scanMgr = new BufMgr(20);
+	BufferAccessStrategy strategy(BufferAccessStrategy::BULKREAD, 2);
+
+	for (i = 1; i <= 10; i++) {
+		scanMgr->readPage(file1ptr, i, page);
+		scanMgr->unPinPage(file1ptr, i, false);
+	}
+	for (i = 11; i <= num; i++) {
+		scanMgr->readPage(file1ptr, i, page, &strategy);
+		scanMgr->unPinPage(file1ptr, i, false);
+	}
+
+	const int diskreads = scanMgr->getBufStats().diskreads;
+	for (i = 1; i <= 10; i++) {
+		scanMgr->readPage(file1ptr, i, page);
+		scanMgr->unPinPage(file1ptr, i, false);
+	}
+	if (scanMgr->getBufStats().diskreads != diskreads)
+	{
+		PRINT_ERROR("ERROR :: Scan through a ring strategy evicted pages outside of its ring.");
+	}
+
+	// allocating a page is not an access, only reading one is
+	const int accesses = scanMgr->getBufStats().accesses;
+	PageId allocated;
+	scanMgr->allocPage(file1ptr, allocated, page, &strategy);
+	scanMgr->unPinPage(file1ptr, allocated, false);
+	if (scanMgr->getBufStats().accesses != accesses)
+	{
+		PRINT_ERROR("ERROR :: Allocating a page counted as a buffer pool access.");
+	}
+	scanMgr->disposePage(file1ptr, allocated);
+	delete scanMgr;
+
+	std::cout << "Test 8 passed" << "\n";
+}
+
+void test9()
+{
+	// With the admission filter on, pages read only once must go through the
+	// probationary window instead of pushing out pages read over and over.
+	// The sketch is approximate, so a collision may still cost a hot page
+	// or two; the plain clock would lose all ten.
+	BufMgr* lfuMgr = new BufMgr(20);
+	lfuMgr->setAdmissionFilter(true);
+
+	for (int round = 0; round < 4; round++) {
+		for (i = 1; i <= 10; i++) {
+			lfuMgr->readPage(file1ptr, i, page);
+			lfuMgr->unPinPage(file1ptr, i, false);
+		}
+	}
+	for (i = 11; i <= num; i++) {
+		lfuMgr->readPage(file1ptr, i, page);
+		lfuMgr->unPinPage(file1ptr, i, false);
+	}
+
+	const int diskreads = lfuMgr->getBufStats().diskreads;
+	for (i = 1; i <= 10; i++) {
+		lfuMgr->readPage(file1ptr, i, page);
+		lfuMgr->unPinPage(file1ptr, i, false);
+	}
+	if (lfuMgr->getBufStats().diskreads - diskreads > 2 || lfuMgr->getBufStats().rejected == 0)
+	{
+		PRINT_ERROR("ERROR :: Admission filter let pages read once evict frequently read pages.");
+	}
+	delete lfuMgr;
+
+	std::cout << "Test 9 passed" << "\n";
+}
+
+void pinLoop()
+{
+	Page* hotPage;
+	for (int j = 0; j < 10000; j++) {
+		bufMgr->readPage(file1ptr, 1, hotPage);
+		bufMgr->unPinPage(file1ptr, 1, false);
+	}
+}
+
+void test10()
+{
+	// Concurrent pins and unpins of one page must leave its pin count at zero.
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+		threads.push_back(std::thread(pinLoop));
+	for (int t = 0; t < 4; t++)
+		threads[t].join();
+
+	try
+	{
+		bufMgr->unPinPage(file1ptr, 1, false);
+		PRINT_ERROR("ERROR :: Concurrent pins and unpins left the page pinned.");
+	}
+	catch(PageNotPinnedException& e)
+	{
+	}
+	bufMgr->flushFile(file1ptr);
+
+	std::cout << "Test 10 passed" << "\n";
+}
+
+void test11()
+{
+	// Frames emptied by flushFile() must be reused before any resident page
+	// is evicted.
+	BufMgr* freeMgr = new BufMgr(20);
+
+	for (i = 1; i <= 10; i++) {
+		freeMgr->readPage(file1ptr, i, page);
+		freeMgr->unPinPage(file1ptr, i, false);
+	}
+	for (i = 1; i <= 10; i++) {
+		freeMgr->readPage(file2ptr, i, page);
+		freeMgr->unPinPage(file2ptr, i, false);
+	}
+	freeMgr->flushFile(file2ptr);
+	for (i = 11; i <= 20; i++) {
+		freeMgr->readPage(file2ptr, i, page);
+		freeMgr->unPinPage(file2ptr, i, false);
+	}
+
+	const int diskreads = freeMgr->getBufStats().diskreads;
+	for (i = 1; i <= 10; i++) {
+		freeMgr->readPage(file1ptr, i, page);
+		freeMgr->unPinPage(file1ptr, i, false);
+	}
+	if (freeMgr->getBufStats().diskreads != diskreads)
+	{
+		PRINT_ERROR("ERROR :: Pages were evicted while flushed frames were free.");
+	}
+	delete freeMgr;
+
+	std::cout << "Test 11 passed" << "\n";
+}
+
+void test12()
+{
+	// invalidateFile() drops the pages of one file without writing them and
+	// leaves the pages of other files resident.
+	BufMgr* dropMgr = new BufMgr(20);
+
+	for (i = 1; i <= 5; i++) {
+		dropMgr->readPage(file1ptr, i, page);
+		dropMgr->unPinPage(file1ptr, i, false);
+		dropMgr->readPage(file2ptr, i, page);
+		dropMgr->unPinPage(file2ptr, i, true);
+	}
+	dropMgr->invalidateFile(file2ptr);
+	if (dropMgr->getBufStats().diskwrites != 0)
+	{
+		PRINT_ERROR("ERROR :: invalidateFile() wrote back dirty pages.");
+	}
+
+	const int diskreads = dropMgr->getBufStats().diskreads;
+	dropMgr->readPage(file1ptr, 1, page);
+	dropMgr->unPinPage(file1ptr, 1, false);
+	if (dropMgr->getBufStats().diskreads != diskreads)
+	{
+		PRINT_ERROR("ERROR :: invalidateFile() dropped pages of another file.");
+	}
+	dropMgr->readPage(file2ptr, 1, page);
+	dropMgr->unPinPage(file2ptr, 1, false);
+	if (dropMgr->getBufStats().diskreads != diskreads + 1)
+	{
+		PRINT_ERROR("ERROR :: invalidateFile() left a page of the file resident.");
+	}
+	delete dropMgr;
+
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	// Copies of a File share its id, a moved-from File refers to no file, and
+	// the pages of a copy are the pages of the original in the buffer pool.
+	File copy = *file1ptr;
+	if (copy.id() != file1ptr->id() || copy.filename() != file1ptr->filename())
+	{
+		PRINT_ERROR("ERROR :: Copy of a File has a different id.");
+	}
+
+	bufMgr->readPage(file1ptr, 1, page);
+	Page* copyPage;
+	bufMgr->readPage(&copy, 1, copyPage);
+	if (copyPage != page)
+	{
+		PRINT_ERROR("ERROR :: Copy of a File reads a different frame.");
+	}
+	bufMgr->unPinPage(&copy, 1, false);
+	bufMgr->unPinPage(file1ptr, 1, false);
+
+	File moved(std::move(copy));
+	if (moved.id() != file1ptr->id() || copy.id() != FileRegistry::INVALID_ID)
+	{
+		PRINT_ERROR("ERROR :: Moving a File did not transfer its id.");
+	}
+	bufMgr->flushFile(file1ptr);
+
+	std::cout << "Test 13 passed" << "\n";
+}
+
+void test14()
+{
+	// Writes are synced by commit() only in mode COMMIT, and by a flusher
+	// thread in mode BATCHED.  Reading past the end of a file fails.
+	PageId pageno;
+	const std::uint64_t before = file1ptr->syncCount();
+	bufMgr->allocPage(file1ptr, pageno, page);
+	bufMgr->unPinPage(file1ptr, pageno, true);
+	bufMgr->flushFile(file1ptr);
+	file1ptr->commit();
+	if (file1ptr->durability() != GroupSync::NONE || file1ptr->syncCount() != before)
+	{
+		PRINT_ERROR("ERROR :: Commit synced a file in durability mode NONE.");
+	}
+
+	file1ptr->setDurability(GroupSync::COMMIT);
+	const std::uint64_t committed = file1ptr->syncCount();
+	bufMgr->readPage(file1ptr, pageno, page);
+	bufMgr->unPinPage(file1ptr, pageno, true);
+	bufMgr->flushFile(file1ptr);
+	if (file1ptr->syncCount() != committed)
+	{
+		PRINT_ERROR("ERROR :: Write synced a file in durability mode COMMIT.");
+	}
+	file1ptr->commit();
+	file1ptr->commit();
+	if (file1ptr->syncCount() != committed + 1)
+	{
+		PRINT_ERROR("ERROR :: Commit did not sync exactly the unsynced writes.");
+	}
+
+	// the flusher of mode BATCHED syncs in the background, once a batch is
+	// full or a write is as old as the interval
+	file1ptr->setDurability(GroupSync::BATCHED, Page::SIZE, 60000);
+	const std::uint64_t batched = file1ptr->syncCount();
+	bufMgr->readPage(file1ptr, pageno, page);
+	bufMgr->unPinPage(file1ptr, pageno, true);
+	bufMgr->flushFile(file1ptr);
+	for (int wait = 0; wait < 500 && file1ptr->syncCount() <= batched; wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	if (file1ptr->syncCount() <= batched)
+	{
+		PRINT_ERROR("ERROR :: A full batch of writes was not synced.");
+	}
+
+	file1ptr->setDurability(GroupSync::BATCHED, 1 << 30, 20);
+	const std::uint64_t timed = file1ptr->syncCount();
+	bufMgr->readPage(file1ptr, pageno, page);
+	bufMgr->unPinPage(file1ptr, pageno, true);
+	bufMgr->flushFile(file1ptr);
+	for (int wait = 0; wait < 500 && file1ptr->syncCount() <= timed; wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	if (file1ptr->syncCount() <= timed)
+	{
+		PRINT_ERROR("ERROR :: A batched write was not synced after the interval.");
+	}
+	file1ptr->setDurability(GroupSync::NONE);
+
+	// a page cut off the end of the file cannot be read
+	const std::string shortName = "test.short";
+	try
+	{
+		File::remove(shortName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		File shortFile = File::create(shortName);
+		const std::vector<Page> pages = shortFile.allocatePages(2);
+		if (::truncate(shortName.c_str(), static_cast<off_t>(pages[1].page_number()) * Page::SIZE) != 0)
+		{
+			PRINT_ERROR("ERROR :: Could not truncate a file.");
+		}
+		try
+		{
+			shortFile.readPage(pages[1].page_number());
+			PRINT_ERROR("ERROR :: A page past the end of the file was read.");
+		}
+		catch(FileIOException)
+		{
+		}
+	}
+	File::remove(shortName);
+
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	// Runs of pages come out with consecutive numbers at the end of the used
+	// list, and the list stays in order when its last page is deleted.
+	file5ptr->setExtentSize(4);
+	if (file5ptr->extentSize() != 4)
+	{
+		PRINT_ERROR("ERROR :: Extent size was not stored in the file header.");
+	}
+	std::vector<Page> run = file5ptr->allocatePages(6);
+	file5ptr->deletePage(run.back().page_number());
+	std::vector<Page> next = file5ptr->allocatePages(2);
+	for (int i = 1; i < 6; i++)
+	{
+		if (run[i].page_number() != run[0].page_number() + i)
+		{
+			PRINT_ERROR("ERROR :: Pages of a run are not consecutive.");
+		}
+	}
+	if (next[0].page_number() != run[5].page_number() + 1 ||
+			next[1].page_number() != next[0].page_number() + 1)
+	{
+		PRINT_ERROR("ERROR :: Run was not allocated at the end of the file.");
+	}
+
+	std::vector<PageId> used;
+	for (FileIterator iter = file5ptr->begin(); iter != file5ptr->end(); ++iter)
+	{
+		used.push_back((*iter).page_number());
+	}
+	const PageId expected[] = {run[0].page_number(), run[1].page_number(), run[2].page_number(),
+		run[3].page_number(), run[4].page_number(), next[0].page_number(), next[1].page_number()};
+	if (used.size() < 7 || !std::equal(expected, expected + 7, used.end() - 7))
+	{
+		PRINT_ERROR("ERROR :: Used list does not end with the allocated runs.");
+	}
+	file5ptr->setExtentSize(File::DEFAULT_EXTENT_PAGES);
+
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	// Compaction numbers the used pages from 1 without gaps, keeps their
+	// order, and keeps a cached page in its frame under its new number.
+	file4ptr->setPunchHoles(true);
+	PageId pagenums[5];
+	for (int i = 0; i < 5; i++)
+	{
+		bufMgr->allocPage(file4ptr, pagenums[i], page);
+		sprintf((char*)tmpbuf, "compact %d", i);
+		page->insertRecord(tmpbuf);
+		bufMgr->unPinPage(file4ptr, pagenums[i], true);
+	}
+	bufMgr->disposePage(file4ptr, pagenums[0]);
+	bufMgr->disposePage(file4ptr, pagenums[2]);
+	Page* cached;
+	bufMgr->readPage(file4ptr, pagenums[4], cached);
+	cached->insertRecord("moved");
+	bufMgr->unPinPage(file4ptr, pagenums[4], true);
+
+	bufMgr->compactFile(file4ptr);
+	file4ptr->setPunchHoles(false);
+	if (File::exists("test.4.compact"))
+	{
+		PRINT_ERROR("ERROR :: Compaction left its new file behind.");
+	}
+
+	PageId expected = 1;
+	PageId moved = Page::INVALID_NUMBER;
+	std::vector<std::string> order;
+	for (FileIterator iter = file4ptr->begin(); iter != file4ptr->end(); ++iter)
+	{
+		Page filePage = *iter;
+		if (filePage.page_number() != expected++)
+		{
+			PRINT_ERROR("ERROR :: Compacted file has a gap in its page numbers.");
+		}
+		PageIterator record = filePage.begin();
+		if (record != filePage.end() && (*record).compare(0, 8, "compact ") == 0)
+		{
+			order.push_back(*record);
+			if (*record == "compact 4")
+			{
+				moved = filePage.page_number();
+			}
+		}
+	}
+	if (order.size() < 3 || order[order.size() - 3] != "compact 1" ||
+			order[order.size() - 2] != "compact 3" || order.back() != "compact 4")
+	{
+		PRINT_ERROR("ERROR :: Compaction changed the order of the used pages.");
+	}
+
+	bufMgr->readPage(file4ptr, moved, page);
+	if (page != cached || page->page_number() != moved)
+	{
+		PRINT_ERROR("ERROR :: Cached page was not renumbered in its frame.");
+	}
+	PageIterator record = page->begin();
+	if (*++record != "moved")
+	{
+		PRINT_ERROR("ERROR :: Dirty cached page was lost by compaction.");
+	}
+	bufMgr->unPinPage(file4ptr, moved, false);
+
+	std::cout << "Test 16 passed" << "\n";
+}
+
+void test17()
+{
+	// A block scan hands out the pages of the file iterator, in its order.
+	std::vector<Page> expected;
+	for (FileIterator iter = file1ptr->begin(); iter != file1ptr->end(); ++iter)
+	{
+		expected.push_back(*iter);
+	}
+
+	FileScan scan(file1ptr, 3 * Page::SIZE);
+	std::size_t scanned = 0;
+	while (Page* scanPage = scan.next())
+	{
+		if (scanned >= expected.size() || scanPage->page_number() != expected[scanned].page_number()
+				|| scanPage->getFreeSpace() != expected[scanned].getFreeSpace())
+		{
+			PRINT_ERROR("ERROR :: Block scan returned a different page.");
+		}
+		PageIterator record = scanPage->begin();
+		PageIterator expectedRecord = expected[scanned].begin();
+		if ((record == scanPage->end()) != (expectedRecord == expected[scanned].end())
+				|| (record != scanPage->end() && *record != *expectedRecord))
+		{
+			PRINT_ERROR("ERROR :: Block scan returned different records.");
+		}
+		scanned++;
+	}
+	if (scanned != expected.size() || scan.blocksRead() < scanned / 3)
+	{
+		PRINT_ERROR("ERROR :: Block scan missed pages.");
+	}
+
+	// pages cut off the end of the file are not scanned as empty pages
+	const std::string shortName = "test.shortscan";
+	try
+	{
+		File::remove(shortName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		File shortFile = File::create(shortName);
+		const std::vector<Page> pages = shortFile.allocatePages(4);
+		if (::truncate(shortName.c_str(), static_cast<off_t>(pages[2].page_number()) * Page::SIZE) != 0)
+		{
+			PRINT_ERROR("ERROR :: Could not truncate a file.");
+		}
+		try
+		{
+			FileScan shortScan(&shortFile, 16 * Page::SIZE);
+			while (shortScan.next() != NULL)
+			{
+			}
+			PRINT_ERROR("ERROR :: Pages past the end of the file were scanned.");
+		}
+		catch(FileIOException)
+		{
+		}
+	}
+	File::remove(shortName);
+
+	std::cout << "Test 17 passed" << "\n";
+}
+
+void test18()
+{
+	// A parallel scan visits every record of the file exactly once, however
+	// the ranges end up spread over the workers.
+	bufMgr->flushFile(file1ptr);
+	std::map<std::string, int> expected;
+	std::uint64_t matching = 0;
+	for (FileIterator iter = file1ptr->begin(); iter != file1ptr->end(); ++iter)
+	{
+		Page filePage = *iter;
+		for (PageIterator record = filePage.begin(); record != filePage.end(); ++record)
+		{
+			expected[*record]++;
+			matching += (*record).compare(0, 6, "test.1") == 0;
+		}
+	}
+	// a record only in the buffer pool, which the scan writes out first
+	// without evicting the page, even though a reader has it pinned
+	PageId dirtyPageNo;
+	bufMgr->allocPage(file1ptr, dirtyPageNo, page);
+	page->insertRecord("test.1 dirty");
+	bufMgr->unPinPage(file1ptr, dirtyPageNo, true);
+	expected["test.1 dirty"]++;
+	matching++;
+
+	ParallelScan scan(bufMgr, file1ptr, 3, 2);
+	std::map<std::string, int> visited;
+	std::mutex visitedMutex;
+	{
+		ReadPageGuard reader = bufMgr->readPageShared(file1ptr, dirtyPageNo);
+		scan.forEachRecord([&visited, &visitedMutex](const std::string& record) {
+			std::lock_guard<std::mutex> lock(visitedMutex);
+			visited[record]++;
+		});
+	}
+	if (visited != expected)
+	{
+		PRINT_ERROR("ERROR :: Parallel scan did not visit every record once.");
+	}
+	if (scan.countIf([](const std::string& record) { return record.compare(0, 6, "test.1") == 0; }) != matching)
+	{
+		PRINT_ERROR("ERROR :: Parallel scan counted the wrong number of records.");
+	}
+
+	std::cout << "Test 18 passed" << "\n";
+}
+
+void test19()
+{
+	// Records of a heap file can be read back, changed and erased, and the
+	// room left by erased records is found again, also after reopening.
+	const std::string filename = "test.heap";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		File heap = File::create(filename);
+		const std::string filler(100, 'h');
+		std::vector<RecordId> rids;
+		PageId pages;
+		{
+			HeapFile heapFile(bufMgr, &heap);
+			for (int i = 0; i < 2000; i++)
+			{
+				sprintf((char*)tmpbuf, "%04d", i);
+				rids.push_back(heapFile.insert(tmpbuf + filler));
+			}
+			pages = heapFile.dataPages();
+			for (int i = 0; i < 2000; i += 2)
+			{
+				heapFile.erase(rids[i]);
+			}
+			heapFile.update(rids[1], "updated");
+			if (heapFile.get(rids[1]) != "updated" || heapFile.get(rids[3]) != "0003" + filler)
+			{
+				PRINT_ERROR("ERROR :: Heap file returned the wrong record.");
+			}
+			try
+			{
+				heapFile.get(rids[0]);
+				PRINT_ERROR("ERROR :: Erased record of a heap file was returned.");
+			}
+			catch(InvalidRecordException)
+			{
+			}
+		}
+
+		{
+			HeapFile reopened(bufMgr, &heap);
+			for (int i = 0; i < 900; i++)
+			{
+				reopened.insert(filler);
+			}
+			if (reopened.dataPages() != pages)
+			{
+				PRINT_ERROR("ERROR :: Heap file did not reuse the room of erased records.");
+			}
+		}
+		bufMgr->invalidateFile(&heap);
+	}
+	File::remove(filename);
+
+	std::cout << "Test 19 passed" << "\n";
+}
+
+void test20()
+{
+	// A B+tree index finds every key inserted by concurrent threads, in key
+	// order, also after erasing some of them, after reopening and after a
+	// bulk load.
+	const std::string filename = "test.btree";
+	const std::string stringFilename = "test.btree2";
+	for (const std::string& name : {filename, stringFilename})
+	{
+		try
+		{
+			File::remove(name);
+		}
+		catch(FileNotFoundException)
+		{
+		}
+	}
+	{
+		File indexFile = File::create(filename);
+		const int keys = 20000;
+		const int writers = 4;
+		{
+			BTreeIndex index(bufMgr, &indexFile, BTreeIndex::INTEGER_KEY);
+			std::atomic<bool> writing(true);
+			std::atomic<bool> failed(false);
+			std::vector<std::thread> threads;
+			for (int t = 0; t < writers; t++)
+			{
+				threads.push_back(std::thread([&index, &failed, t, keys, writers]() {
+					for (int k = t; k < keys; k += writers)
+					{
+						const int key = k * 7919 % keys;
+						if (!index.insert(key - keys / 2, {static_cast<PageId>(key + 1), 1}))
+							failed = true;
+					}
+				}));
+			}
+			threads.push_back(std::thread([&index, &writing, &failed, keys]() {
+				// Keys found while the tree splits map to their own record.
+				for (int key = 0; writing; key = (key + 101) % keys)
+				{
+					RecordId found;
+					if (index.lookup(key - keys / 2, found) && found.page_number != static_cast<PageId>(key + 1))
+						failed = true;
+				}
+			}));
+			for (int t = 0; t < writers; t++)
+				threads[t].join();
+			writing = false;
+			threads.back().join();
+			if (failed)
+			{
+				PRINT_ERROR("ERROR :: Concurrent B+tree inserts or lookups failed.");
+			}
+
+			std::int64_t previous = -keys;
+			int count = 0;
+			index.scan(-keys / 2, keys / 2, [&previous, &count](std::int64_t key, const RecordId& rid) {
+				if (key <= previous || rid.page_number != key + keys / 2 + 1)
+					previous = keys;
+				else
+					previous = key;
+				count++;
+				return true;
+			});
+			if (count != keys || previous != keys / 2 - 1 || index.height() < 2)
+			{
+				PRINT_ERROR("ERROR :: B+tree scan did not return the keys in order.");
+			}
+
+			if (!index.insert(7, {1, 2}) || !index.insert(7, {1, 3}) || index.insert(7, {1, 3}))
+			{
+				PRINT_ERROR("ERROR :: B+tree did not keep duplicate keys apart.");
+			}
+			if (index.scan(7, 7, [](std::int64_t, const RecordId&) { return true; }) != 3 ||
+					index.scan(-10, 10, [](std::int64_t, const RecordId&) { return true; }) != 23)
+			{
+				PRINT_ERROR("ERROR :: B+tree range scan returned the wrong entries.");
+			}
+			for (int key = 0; key < keys; key += 2)
+			{
+				if (!index.erase(key - keys / 2, {static_cast<PageId>(key + 1), 1}))
+				{
+					PRINT_ERROR("ERROR :: B+tree did not erase a key it holds.");
+				}
+			}
+		}
+
+		{
+			BTreeIndex reopened(bufMgr, &indexFile, BTreeIndex::INTEGER_KEY);
+			RecordId found;
+			if (reopened.lookup(-keys / 2, found) || !reopened.lookup(1 - keys / 2, found) || found.page_number != 2)
+			{
+				PRINT_ERROR("ERROR :: Reopened B+tree returned the wrong keys.");
+			}
+		}
+		try
+		{
+			BTreeIndex wrongKeys(bufMgr, &indexFile, BTreeIndex::STRING_KEY);
+			PRINT_ERROR("ERROR :: B+tree opened with the wrong key type.");
+		}
+		catch(BadIndexInfoException)
+		{
+		}
+		bufMgr->invalidateFile(&indexFile);
+	}
+
+	{
+		File indexFile = File::create(stringFilename);
+		{
+			BTreeIndex index(bufMgr, &indexFile, BTreeIndex::STRING_KEY, 12);
+			std::vector<std::pair<std::string, RecordId> > entries;
+			for (int i = 0; i < 5000; i++)
+			{
+				sprintf((char*)tmpbuf, "key%05d", i);
+				entries.push_back(std::make_pair(std::string(tmpbuf), RecordId{static_cast<PageId>(i + 1), 0}));
+			}
+			index.bulkLoad(entries);
+			index.insert("key01000a", {9999, 0});
+
+			RecordId found;
+			if (!index.lookup("key04321", found) || found.page_number != 4322 || index.lookup("key", found))
+			{
+				PRINT_ERROR("ERROR :: Bulk loaded B+tree returned the wrong keys.");
+			}
+			std::string last;
+			if (index.scan("key01000", "key01999", [&last](const std::string& key, const RecordId&) {
+						last = key;
+						return true;
+					}) != 1001 || last != "key01999")
+			{
+				PRINT_ERROR("ERROR :: Bulk loaded B+tree range scan returned the wrong entries.");
+			}
+			try
+			{
+				index.insert("a key longer than twelve bytes", {1, 0});
+				PRINT_ERROR("ERROR :: B+tree accepted a key longer than its key size.");
+			}
+			catch(BadIndexInfoException)
+			{
+			}
+		}
+		bufMgr->invalidateFile(&indexFile);
+	}
+	File::remove(filename);
+	File::remove(stringFilename);
+
+	std::cout << "Test 20 passed" << "\n";
+}
+
+void test21()
+{
+	// A hash index finds every key it holds and no other, while its buckets
+	// split and its directory grows past one page, and after reopening.
+	const std::string filename = "test.hash";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		File indexFile = File::create(filename);
+		const int keys = 10000;
+		{
+			HashIndex index(bufMgr, &indexFile, HashIndex::INTEGER_KEY);
+			for (int i = 0; i < keys; i++)
+			{
+				const int key = i * 7919 % keys;
+				if (!index.insert(key - keys / 2, {static_cast<PageId>(key + 1), 1}))
+				{
+					PRINT_ERROR("ERROR :: Hash index refused a new key.");
+				}
+			}
+			if (index.insert(0, {1, 1}) || index.buckets() < 2)
+			{
+				PRINT_ERROR("ERROR :: Hash index accepted a key twice.");
+			}
+			for (int key = 0; key < keys; key += 2)
+			{
+				if (!index.erase(key - keys / 2))
+				{
+					PRINT_ERROR("ERROR :: Hash index did not erase a key it holds.");
+				}
+			}
+		}
+
+		{
+			HashIndex reopened(bufMgr, &indexFile, HashIndex::INTEGER_KEY);
+			for (int key = 0; key < keys; key++)
+			{
+				RecordId found;
+				const bool present = reopened.lookup(key - keys / 2, found);
+				if (present != (key % 2 == 1) || (present && found.page_number != static_cast<PageId>(key + 1)))
+				{
+					PRINT_ERROR("ERROR :: Reopened hash index returned the wrong keys.");
+				}
+			}
+		}
+		try
+		{
+			HashIndex wrongKeys(bufMgr, &indexFile, HashIndex::STRING_KEY);
+			PRINT_ERROR("ERROR :: Hash index opened with the wrong key type.");
+		}
+		catch(BadIndexInfoException)
+		{
+		}
+		bufMgr->invalidateFile(&indexFile);
+	}
+	File::remove(filename);
+
+	{
+		// Long keys fill buckets quickly, so the directory needs several pages.
+		File indexFile = File::create(filename);
+		{
+			HashIndex index(bufMgr, &indexFile, HashIndex::STRING_KEY, 200);
+			for (int i = 0; i < 30000; i++)
+			{
+				sprintf((char*)tmpbuf, "key%d", i);
+				index.insert(tmpbuf, {static_cast<PageId>(i + 1), 0});
+			}
+			if (index.globalDepth() <= 10)
+			{
+				PRINT_ERROR("ERROR :: Hash index directory did not grow.");
+			}
+			for (int i = 0; i < 30000; i++)
+			{
+				RecordId found;
+				sprintf((char*)tmpbuf, "key%d", i);
+				if (!index.lookup(tmpbuf, found) || found.page_number != static_cast<PageId>(i + 1))
+				{
+					PRINT_ERROR("ERROR :: Hash index lost a key while splitting.");
+				}
+			}
+			RecordId found;
+			if (index.lookup("key30000", found))
+			{
+				PRINT_ERROR("ERROR :: Hash index found a key it does not hold.");
+			}
+		}
+		bufMgr->invalidateFile(&indexFile);
+	}
+	File::remove(filename);
+
+	std::cout << "Test 21 passed" << "\n";
+}
+
+void test22()
+{
+	// An external sort returns every record once and in order, whether the
+	// records fit into its budget or need runs and several merges.
+	const std::string filename = "test.sort";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		File inputFile = File::create(filename);
+		const int records = 30000;
+		std::multiset<std::string> expected;
+		PageId pageNo;
+		Page* page = NULL;
+		for (int i = 0; i < records; i++)
+		{
+			sprintf((char*)tmpbuf, "%d.%.*s", i * 7919 % records, i % 23, "abcdefghijklmnopqrstuvw");
+			if (page == NULL || !page->hasSpaceForRecord(tmpbuf))
+			{
+				if (page != NULL)
+					bufMgr->unPinPage(&inputFile, pageNo, true);
+				bufMgr->allocPage(&inputFile, pageNo, page);
+			}
+			page->insertRecord(tmpbuf);
+			expected.insert(tmpbuf);
+		}
+		// the pages stay dirty in the buffer pool; the sort writes them out
+		bufMgr->unPinPage(&inputFile, pageNo, true);
+
+		std::vector<std::string> sorted;
+		ExternalSort::RecordCallback collect = [&sorted](const std::string& record) {
+			sorted.push_back(record);
+		};
+
+		// a reader holding a page of the input does not stop the sort
+		ExternalSort small(bufMgr, 16, 2);
+		{
+			ReadPageGuard reader = bufMgr->readPageShared(&inputFile, pageNo);
+			small.sort(&inputFile, collect);
+		}
+		if (small.runs() < 8 || small.merges() < 2 || small.pagesWritten() == 0)
+		{
+			PRINT_ERROR("ERROR :: External sort did not spill to runs and merge them.");
+		}
+		if (!std::equal(sorted.begin(), sorted.end(), expected.begin()) || sorted.size() != expected.size())
+		{
+			PRINT_ERROR("ERROR :: External sort returned the wrong records.");
+		}
+		if (File::exists(filename + ".sort.0"))
+		{
+			PRINT_ERROR("ERROR :: External sort left a temporary file behind.");
+		}
+
+		// Descending by the number before the dot, in memory.
+		sorted.clear();
+		ExternalSort large(bufMgr, num - 10, 1, [](const char* a, std::size_t, const char* b, std::size_t) {
+			return atoi(a) > atoi(b);
+		});
+		large.sort(&inputFile, collect);
+		if (large.runs() != 0 || sorted.size() != expected.size())
+		{
+			PRINT_ERROR("ERROR :: External sort of a small input did not run in memory.");
+		}
+		for (std::size_t i = 1; i < sorted.size(); i++)
+		{
+			if (atoi(sorted[i - 1].c_str()) < atoi(sorted[i].c_str()))
+			{
+				PRINT_ERROR("ERROR :: External sort ignored the record order.");
+			}
+		}
+		bufMgr->invalidateFile(&inputFile);
+	}
+	File::remove(filename);
+
+	std::cout << "Test 22 passed" << "\n";
+}
+
+/**
+ * Fills a heap file with records of <payload> bytes whose first 8 bytes are
+ * the key key(i).  Its pages stay dirty in the buffer pool.
+ */
+template <class Key>
+void fillHeapFile(File& file, const int records, const std::size_t payload, Key key)
+{
+	{
+		HeapFile heap(bufMgr, &file);
+		std::string record(payload, 'x');
+		for (int i = 0; i < records; i++)
+		{
+			const std::int64_t k = key(i);
+			record.replace(0, sizeof(k), reinterpret_cast<const char*>(&k), sizeof(k));
+			heap.insert(record);
+		}
+	}
+}
+
+void test23()
+{
+	// A hash join finds every pair of records with equal keys, whether the
+	// build side fits into its budget, has to be partitioned, or holds a
+	// single key and has to be joined in chunks.
+	const std::string leftName = "test.join.left";
+	const std::string rightName = "test.join.right";
+	try
+	{
+		File::remove(leftName);
+		File::remove(rightName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		File leftFile = File::create(leftName);
+		File rightFile = File::create(rightName);
+		fillHeapFile(leftFile, 3000, 40, [](int i) { return i % 1000; });
+		fillHeapFile(rightFile, 20000, 24, [](int i) { return i % 1500; });
+		const HashJoin::Input left = {&leftFile, 0, sizeof(std::int64_t), HeapFile::isDataPage};
+		const HashJoin::Input right = {&rightFile, 0, sizeof(std::int64_t), HeapFile::isDataPage};
+
+		// Each of the keys 0..999 is 3 times on the left and 13 or 14 times on
+		// the right.
+		std::size_t expected = 0;
+		for (int k = 0; k < 1000; k++)
+			expected += 3 * (20000 / 1500 + (k < 20000 % 1500 ? 1 : 0));
+		std::size_t matches = 0;
+		HashJoin::MatchCallback count = [&matches](const std::string& l, const std::string& r) {
+			if (l.size() != 40 || r.size() != 24 || l.compare(0, 8, r, 0, 8) != 0)
+			{
+				PRINT_ERROR("ERROR :: Hash join paired records with different keys.");
+			}
+			matches++;
+		};
+
+		HashJoin large(bufMgr, num - 10);
+		large.join(left, right, count);
+		if (matches != expected || large.partitions() != 0 || large.buildChunks() != 1)
+		{
+			PRINT_ERROR("ERROR :: Hash join in memory returned the wrong pairs.");
+		}
+
+		matches = 0;
+		HashJoin small(bufMgr, 8);
+		small.join(left, right, count);
+		if (matches != expected || small.partitions() == 0 || small.pagesWritten() == 0)
+		{
+			PRINT_ERROR("ERROR :: Partitioned hash join returned the wrong pairs.");
+		}
+		if (File::exists(leftName + ".join.0"))
+		{
+			PRINT_ERROR("ERROR :: Hash join left a temporary file behind.");
+		}
+		bufMgr->invalidateFile(&leftFile);
+		bufMgr->invalidateFile(&rightFile);
+	}
+	File::remove(leftName);
+	File::remove(rightName);
+
+	{
+		// Every left record has key 7, as do 10 of the right ones; the partition
+		// of key 7 does not fit into the budget.
+		File leftFile = File::create(leftName);
+		File rightFile = File::create(rightName);
+		fillHeapFile(leftFile, 600, 200, [](int) { return 7; });
+		fillHeapFile(rightFile, 700, 200, [](int i) { return i < 10 ? 7 : i + 1000; });
+		const HashJoin::Input left = {&leftFile, 0, sizeof(std::int64_t), HeapFile::isDataPage};
+		const HashJoin::Input right = {&rightFile, 0, sizeof(std::int64_t), HeapFile::isDataPage};
+		std::size_t matches = 0;
+		HashJoin skewed(bufMgr, 8);
+		skewed.join(left, right, [&matches](const std::string&, const std::string&) { matches++; });
+		if (matches != 600 * 10 || skewed.buildChunks() < 2)
+		{
+			PRINT_ERROR("ERROR :: Hash join of a single key returned the wrong pairs.");
+		}
+		bufMgr->invalidateFile(&leftFile);
+		bufMgr->invalidateFile(&rightFile);
+	}
+	File::remove(leftName);
+	File::remove(rightName);
+
+	std::cout << "Test 23 passed" << "\n";
+}
+
+void test24()
+{
+	// Page updates are logged with their LSN in the page header; a commit
+	// makes the log durable, and so does writing back a page whose records
+	// are not durable yet.  Reopening the log finds its end again, cutting
+	// off a torn record.
+	const std::string logName = "test.wal";
+	const std::string dbName = "test.wal.db";
+	std::remove(logName.c_str());
+	try
+	{
+		File::remove(dbName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+
+	Lsn end;
+	TxnId lastTxn;
+	{
+		LogManager log(logName);
+		if (log.nextLsn() != LogManager::FIRST_LSN || log.flushedLsn() != LogManager::FIRST_LSN)
+		{
+			PRINT_ERROR("ERROR :: A new log is not empty.");
+		}
+		bufMgr->setLogManager(&log);
+		File walFile = File::create(dbName);
+
+		const TxnId first = log.begin();
+		PageId pageNo;
+		bufMgr->allocPage(&walFile, pageNo, page);
+		Page before = *page;
+		page->insertRecord("logged record");
+		const Lsn update = log.logUpdate(first, &walFile, before, page);
+		if (update < LogManager::FIRST_LSN || page->lsn() != update || log.flushedLsn() > update)
+		{
+			PRINT_ERROR("ERROR :: An update was not logged, or made durable before its commit.");
+		}
+		before = *page;
+		if (log.logUpdate(first, &walFile, before, page) != update)
+		{
+			PRINT_ERROR("ERROR :: An update that changes nothing was logged.");
+		}
+		bufMgr->unPinPage(&walFile, pageNo, true);
+		const Lsn commit = log.commit(first);
+		if (commit <= update || log.flushedLsn() <= commit)
+		{
+			PRINT_ERROR("ERROR :: A commit did not make the log durable.");
+		}
+
+		// an update that is not committed reaches the log before its page
+		// reaches the file
+		lastTxn = log.begin();
+		bufMgr->readPage(&walFile, pageNo, page);
+		before = *page;
+		page->insertRecord("uncommitted record");
+		const Lsn uncommitted = log.logUpdate(lastTxn, &walFile, before, page);
+		bufMgr->unPinPage(&walFile, pageNo, true);
+		if (log.flushedLsn() > uncommitted)
+		{
+			PRINT_ERROR("ERROR :: An uncommitted update was made durable early.");
+		}
+		bufMgr->flushFile(&walFile);
+		if (log.flushedLsn() <= uncommitted || walFile.readPage(pageNo).lsn() != uncommitted)
+		{
+			PRINT_ERROR("ERROR :: A page was written back before its log records.");
+		}
+		bufMgr->setLogManager(NULL);
+		end = log.nextLsn();
+	}
+	File::remove(dbName);
+
+	{
+		std::ofstream torn(logName.c_str(), std::ios::binary | std::ios::app);
+		torn << "half of a record";
+	}
+	{
+		LogManager log(logName);
+		if (log.nextLsn() != end || log.begin() <= lastTxn)
+		{
+			PRINT_ERROR("ERROR :: A reopened log did not continue where it ended.");
+		}
+	}
+	std::remove(logName.c_str());
+
+	std::cout << "Test 24 passed" << "\n";
+}
+
+void test25()
+{
+	// After a crash, recovery repeats the committed updates that never
+	// reached the file and rolls back the uncommitted ones that did,
+	// reading the log from the last checkpoint on.  Recovering again
+	// changes nothing.
+	const std::string logName = "test.recovery.wal";
+	const std::string dbName = "test.recovery.db";
+	const int pages = 10;
+	std::remove(logName.c_str());
+	try
+	{
+		File::remove(dbName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+
+	PageId pageNos[pages];
+	RecordId one[pages], two[pages], three[pages + 1], four;
+	{
+		LogManager log(logName);
+		bufMgr->setLogManager(&log);
+		File walFile = File::create(dbName);
+		for (int i = 0; i < pages; i++)
+		{
+			bufMgr->allocPage(&walFile, pageNos[i], page);
+			bufMgr->unPinPage(&walFile, pageNos[i], true);
+		}
+		bufMgr->flushFile(&walFile);
+
+		// inserts a record into a page as part of a transaction
+		auto insert = [&](const TxnId txn, const PageId pageNo, const std::string& record)
+		{
+			bufMgr->readPage(&walFile, pageNo, page);
+			const Page before = *page;
+			const RecordId rid = page->insertRecord(record);
+			log.logUpdate(txn, &walFile, before, page);
+			bufMgr->unPinPage(&walFile, pageNo, true);
+			return rid;
+		};
+
+		const TxnId t1 = log.begin();
+		for (int i = 0; i < pages; i++)
+			one[i] = insert(t1, pageNos[i], "one");
+		log.commit(t1);
+		bufMgr->flushFile(&walFile);
+		Checkpointer checkpointer(bufMgr, &log, 0);
+		checkpointer.checkpoint();
+
+		const TxnId t2 = log.begin();
+		for (int i = 0; i < pages / 2; i++)
+			two[i] = insert(t2, pageNos[i], "two");
+		log.commit(t2);
+		const TxnId t3 = log.begin();
+		for (int i = pages / 2; i < pages; i++)
+			three[i] = insert(t3, pageNos[i], "three");
+		three[pages] = insert(t3, pageNos[0], "three");
+		bufMgr->flushFile(&walFile);
+		const TxnId t4 = log.begin();
+		four = insert(t4, pageNos[1], "four");
+		log.commit(t4);
+
+		// crash: the pool loses the last committed update, while the
+		// uncommitted ones are already in the file
+		bufMgr->invalidateFile(&walFile);
+		bufMgr->setLogManager(NULL);
+	}
+
+	{
+		LogManager log(logName);
+		Recovery recovery(bufMgr, &log, 4);
+		recovery.recover();
+		bufMgr->setLogManager(NULL);
+		if (recovery.analyzedRecords() != 15 || recovery.dirtyPages() != pages)
+		{
+			PRINT_ERROR("ERROR :: Recovery did not start at the checkpoint.");
+		}
+		if (recovery.redoneRecords() != 1 || recovery.losers() != 1 || recovery.undoneRecords() != pages / 2 + 1)
+		{
+			PRINT_ERROR("ERROR :: Recovery repeated or undid the wrong updates.");
+		}
+	}
+
+	{
+		File walFile = File::open(dbName);
+		for (int i = 0; i < pages; i++)
+		{
+			const Page recovered = walFile.readPage(pageNos[i]);
+			if (recovered.getRecord(one[i]) != "one" || (i < pages / 2 && recovered.getRecord(two[i]) != "two"))
+			{
+				PRINT_ERROR("ERROR :: Recovery lost a committed update.");
+			}
+			const RecordId rid = i < pages / 2 ? three[pages] : three[i];
+			if (i == 0 || i >= pages / 2)
+			{
+				try
+				{
+					recovered.getRecord(rid);
+					PRINT_ERROR("ERROR :: Recovery kept an uncommitted update.");
+				}
+				catch(InvalidRecordException)
+				{
+				}
+			}
+		}
+		if (walFile.readPage(pageNos[1]).getRecord(four) != "four")
+		{
+			PRINT_ERROR("ERROR :: Recovery did not repeat the last committed update.");
+		}
+	}
+
+	{
+		LogManager log(logName);
+		Recovery recovery(bufMgr, &log, 1);
+		recovery.recover();
+		bufMgr->setLogManager(NULL);
+		if (recovery.redoneRecords() != 0 || recovery.losers() != 0)
+		{
+			PRINT_ERROR("ERROR :: Recovering again changed the files.");
+		}
+	}
+	File::remove(dbName);
+	std::remove(logName.c_str());
+
+	std::cout << "Test 25 passed" << "\n";
+}
+
+void test26()
+{
+	// A checkpoint writes the dirty pages back but keeps them in the pool,
+	// skips a pinned page without failing, and leaves only that page for
+	// recovery to start from.
+	const std::string logName = "test.checkpoint.wal";
+	const std::string dbName = "test.checkpoint.db";
+	const int pages = 20;
+	std::remove(logName.c_str());
+	try
+	{
+		File::remove(dbName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+
+	{
+		LogManager log(logName);
+		bufMgr->setLogManager(&log);
+		File ckptFile = File::create(dbName);
+		PageId pageNos[pages];
+		RecordId rids[pages];
+		const TxnId txn = log.begin();
+		for (int i = 0; i < pages; i++)
+		{
+			bufMgr->allocPage(&ckptFile, pageNos[i], page);
+			const Page before = *page;
+			rids[i] = page->insertRecord("checkpointed");
+			log.logUpdate(txn, &ckptFile, before, page);
+			bufMgr->unPinPage(&ckptFile, pageNos[i], true);
+		}
+		log.commit(txn);
+
+		Page* pinned;
+		bufMgr->readPage(&ckptFile, pageNos[0], pinned);
+		const int diskwrites = bufMgr->getBufStats().diskwrites;
+		Checkpointer checkpointer(bufMgr, &log, 0, 1000);
+		checkpointer.checkpoint();
+		if (checkpointer.pagesWritten() != pages - 1 || bufMgr->getBufStats().diskwrites - diskwrites != pages - 1)
+		{
+			PRINT_ERROR("ERROR :: Checkpoint did not write the unpinned dirty pages.");
+		}
+		if (ckptFile.readPage(pageNos[pages - 1]).getRecord(rids[pages - 1]) != "checkpointed")
+		{
+			PRINT_ERROR("ERROR :: Checkpoint wrote a stale page.");
+		}
+
+		std::vector<LogManager::DirtyPage> dirty;
+		bufMgr->dirtyPageTable(dirty);
+		if (dirty.size() != 1 || dirty[0].page_number != pageNos[0])
+		{
+			PRINT_ERROR("ERROR :: Checkpoint left pages dirty.");
+		}
+
+		const int diskreads = bufMgr->getBufStats().diskreads;
+		for (int i = 1; i < pages; i++)
+		{
+			bufMgr->readPage(&ckptFile, pageNos[i], page);
+			bufMgr->unPinPage(&ckptFile, pageNos[i], false);
+		}
+		if (bufMgr->getBufStats().diskreads != diskreads)
+		{
+			PRINT_ERROR("ERROR :: Checkpoint evicted the pages it wrote.");
+		}
+
+		// frames reserved as work space of an operator belong to no file
+		std::vector<Page*> reserved;
+		bufMgr->reserveFrames(4, reserved);
+		bufMgr->unPinPage(&ckptFile, pageNos[0], false);
+		checkpointer.checkpoint();
+		bufMgr->releaseFrames(reserved);
+		if (checkpointer.pagesWritten() != pages)
+		{
+			PRINT_ERROR("ERROR :: Checkpoint did not write the unpinned page.");
+		}
+		bufMgr->flushFile(&ckptFile);
+		bufMgr->setLogManager(NULL);
+	}
+	File::remove(dbName);
+	std::remove(logName.c_str());
+
+	std::cout << "Test 26 passed" << "\n";
+}
+
+void test27()
+{
+	// Page guards: readers share a page while a writer waits for them,
+	// a write guard dirties its page, guards move, every guard unpins, and
+	// a checkpoint writes a page held only by read guards.
+	const std::string dbName = "test.guard.db";
+	try
+	{
+		File::remove(dbName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+
+	{
+		File guardFile = File::create(dbName);
+		PageId pageNo;
+		RecordId rid;
+		{
+			WritePageGuard guard = bufMgr->allocPageExclusive(&guardFile, pageNo);
+			rid = guard->insertRecord("guarded");
+		}
+
+		std::vector<ReadPageGuard> readers;
+		readers.push_back(bufMgr->readPageShared(&guardFile, pageNo));
+		readers.push_back(bufMgr->readPageShared(&guardFile, pageNo));
+		if (readers[0]->getRecord(rid) != "guarded" || readers[1].page() != readers[0].page())
+		{
+			PRINT_ERROR("ERROR :: Read guards do not share the page.");
+		}
+
+		// the page, dirty from the allocation, is held by read guards only
+		std::function<void(std::uint32_t)> noPace = [](std::uint32_t) {};
+		if (bufMgr->cleanPages(noPace) != 1)
+		{
+			PRINT_ERROR("ERROR :: Page held by read guards was not written.");
+		}
+
+		std::atomic<bool> written(false);
+		std::thread writer([&]()
+		{
+			WritePageGuard guard = bufMgr->readPageExclusive(&guardFile, pageNo);
+			guard->updateRecord(rid, "written");
+			written = true;
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		if (written)
+		{
+			PRINT_ERROR("ERROR :: Write guard did not wait for the readers.");
+		}
+		ReadPageGuard moved(std::move(readers[0]));
+		if (moved.pageNumber() != pageNo || readers[0].held())
+		{
+			PRINT_ERROR("ERROR :: Read guard did not move.");
+		}
+		readers.clear();
+		moved = ReadPageGuard();
+		if (moved.held())
+		{
+			PRINT_ERROR("ERROR :: Moved-to guard still holds the page.");
+		}
+		writer.join();
+		if (!written || bufMgr->readPageShared(&guardFile, pageNo)->getRecord(rid) != "written")
+		{
+			PRINT_ERROR("ERROR :: Write guard did not get the page.");
+		}
+
+		// the write guard dirtied the page, and no pin is left behind
+		const int diskwrites = bufMgr->getBufStats().diskwrites;
+		try
+		{
+			bufMgr->flushFile(&guardFile);
+		}
+		catch(PagePinnedException)
+		{
+			PRINT_ERROR("ERROR :: Page guard left the page pinned.");
+		}
+		if (bufMgr->getBufStats().diskwrites - diskwrites != 1
+				|| guardFile.readPage(pageNo).getRecord(rid) != "written")
+		{
+			PRINT_ERROR("ERROR :: Write guard did not dirty the page.");
+		}
+	}
+	File::remove(dbName);
+
+	std::cout << "Test 27 passed" << "\n";
+}
+
+void test28()
+{
+	// Optimistic reads validate until a write guard or an eviction changes
+	// the frame, and a reader racing a writer never accepts a torn page.
+	const std::string dbName = "test.optimistic.db";
+	try
+	{
+		File::remove(dbName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+
+	{
+		File optFile = File::create(dbName);
+		PageId pageNo;
+		RecordId rid;
+		{
+			WritePageGuard guard = bufMgr->allocPageExclusive(&optFile, pageNo);
+			rid = guard->insertRecord(std::string(200, 'a'));
+		}
+
+		PageVersion version;
+		if (bufMgr->validatePage(version))
+		{
+			PRINT_ERROR("ERROR :: Read that never started was valid.");
+		}
+		const int diskreads = bufMgr->getBufStats().diskreads;
+		const Page* optPage = bufMgr->readPageOptimistic(&optFile, pageNo, version);
+		const PageVersion first = version;
+		if (optPage->getRecord(rid) != std::string(200, 'a') || !bufMgr->validatePage(version))
+		{
+			PRINT_ERROR("ERROR :: Optimistic read of an unchanged page failed.");
+		}
+		bufMgr->readPageOptimistic(&optFile, pageNo, version);
+		if (version.frame != first.frame || version.version != first.version
+				|| bufMgr->getBufStats().diskreads != diskreads)
+		{
+			PRINT_ERROR("ERROR :: Optimistic read did not find the page in its frame.");
+		}
+
+		{
+			WritePageGuard guard = bufMgr->readPageExclusive(&optFile, pageNo);
+			if (bufMgr->validatePage(version))
+			{
+				PRINT_ERROR("ERROR :: Optimistic read valid while a write guard is held.");
+			}
+			guard->updateRecord(rid, std::string(200, 'b'));
+		}
+		if (bufMgr->validatePage(version))
+		{
+			PRINT_ERROR("ERROR :: Optimistic read valid after a write.");
+		}
+		optPage = bufMgr->readPageOptimistic(&optFile, pageNo, version);
+		if (optPage->getRecord(rid) != std::string(200, 'b') || !bufMgr->validatePage(version))
+		{
+			PRINT_ERROR("ERROR :: Optimistic read did not see the write.");
+		}
+
+		bufMgr->flushFile(&optFile);
+		if (bufMgr->validatePage(version))
+		{
+			PRINT_ERROR("ERROR :: Optimistic read valid after the page was evicted.");
+		}
+		optPage = bufMgr->readPageOptimistic(&optFile, pageNo, version);
+		if (optPage->getRecord(rid) != std::string(200, 'b') || !bufMgr->validatePage(version))
+		{
+			PRINT_ERROR("ERROR :: Optimistic read did not read the page back.");
+		}
+
+		Page* rawPage;
+		bufMgr->readPage(&optFile, pageNo, rawPage);
+		rawPage->updateRecord(rid, std::string(200, 'b'));
+		bufMgr->unPinPage(&optFile, pageNo, true);
+		if (bufMgr->validatePage(version))
+		{
+			PRINT_ERROR("ERROR :: Optimistic read valid after a write through a raw pin.");
+		}
+		// unpinning a page that is not pinned changes nothing
+		bufMgr->readPageOptimistic(&optFile, pageNo, version);
+		try
+		{
+			bufMgr->unPinPage(&optFile, pageNo, true);
+			PRINT_ERROR("ERROR :: Page is already unpinned. unPinPage should throw PageNotPinnedException.");
+		}
+		catch(const PageNotPinnedException&)
+		{
+		}
+		if (!bufMgr->validatePage(version))
+		{
+			PRINT_ERROR("ERROR :: Optimistic read failed by an unpin of a page that is not pinned.");
+		}
+
+		// the writer flips the whole record; an accepted read sees one value
+		std::atomic<bool> stop(false);
+		std::thread writer([&]()
+		{
+			for (int n = 0; n < 2000; n++)
+			{
+				WritePageGuard guard = bufMgr->readPageExclusive(&optFile, pageNo);
+				guard->updateRecord(rid, std::string(200, n % 2 == 0 ? 'c' : 'd'));
+			}
+			stop = true;
+		});
+		int torn = 0;
+		while (!stop)
+		{
+			PageVersion read;
+			const Page copy = *bufMgr->readPageOptimistic(&optFile, pageNo, read);
+			if (bufMgr->validatePage(read))
+			{
+				const std::string record = copy.getRecord(rid);
+				if (record != std::string(200, record[0]))
+				{
+					torn++;
+				}
+			}
+		}
+		writer.join();
+		if (torn != 0)
+		{
+			PRINT_ERROR("ERROR :: Optimistic read accepted a torn page.");
+		}
+		bufMgr->flushFile(&optFile);
+	}
+	File::remove(dbName);
+
+	std::cout << "Test 28 passed" << "\n";
+}
+
+void test29()
+{
+	// A page corrupted on disk fails its checksum, whether the buffer pool
+	// verifies it while reading or lazily on first access, and no pin is
+	// left behind; intact pages read as before.
+	const char* check = "123456789";
+	if (Crc32c::compute(check, 9) != 0xe3069283 || Crc32c::extendSoftware(0, check, 9) != 0xe3069283)
+	{
+		PRINT_ERROR("ERROR :: CRC-32C of the check string is wrong.");
+	}
+
+	const std::string dbName = "test.checksum.db";
+	try
+	{
+		File::remove(dbName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+
+	{
+		File sumFile = File::create(dbName);
+		PageId pageNos[2];
+		RecordId rids[2];
+		for (int i = 0; i < 2; i++)
+		{
+			bufMgr->allocPage(&sumFile, pageNos[i], page);
+			rids[i] = page->insertRecord(i == 0 ? "intact record" : "corrupted record");
+			bufMgr->unPinPage(&sumFile, pageNos[i], true);
+		}
+		bufMgr->flushFile(&sumFile);
+
+		// flip a byte of the second record on disk
+		{
+			std::fstream raw(dbName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+			std::string bytes((std::istreambuf_iterator<char>(raw)), std::istreambuf_iterator<char>());
+			const std::size_t at = bytes.find("corrupted record");
+			raw.seekp(at);
+			raw.put('C');
+		}
+
+		for (int lazy = 0; lazy < 2; lazy++)
+		{
+			bufMgr->setLazyChecksums(lazy != 0);
+			for (int attempt = 0; attempt < 2; attempt++)
+			{
+				try
+				{
+					bufMgr->readPage(&sumFile, pageNos[1], page);
+					PRINT_ERROR("ERROR :: Corrupted page was handed out.");
+				}
+				catch(PageChecksumException e)
+				{
+					if (e.page_number() != pageNos[1])
+					{
+						PRINT_ERROR("ERROR :: Checksum failure names the wrong page.");
+					}
+				}
+			}
+			bufMgr->readPage(&sumFile, pageNos[0], page);
+			if (page->getRecord(rids[0]) != "intact record")
+			{
+				PRINT_ERROR("ERROR :: Intact page did not read back.");
+			}
+			bufMgr->unPinPage(&sumFile, pageNos[0], false);
+			try
+			{
+				bufMgr->invalidateFile(&sumFile);
+			}
+			catch(PagePinnedException)
+			{
+				PRINT_ERROR("ERROR :: Checksum failure left the page pinned.");
+			}
+		}
+		bufMgr->setLazyChecksums(false);
+
+		try
+		{
+			sumFile.readPage(pageNos[1]);
+			PRINT_ERROR("ERROR :: File read a corrupted page.");
+		}
+		catch(PageChecksumException)
+		{
+		}
+		if (sumFile.readPageUnverified(pageNos[1]).checksumValid())
+		{
+			PRINT_ERROR("ERROR :: Corrupted page matches its checksum.");
+		}
+
+		// a zeroed checksum only passes on a page that is all zeros
+		{
+			std::fstream raw(dbName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+			raw.seekp(static_cast<std::streamoff>(pageNos[0]) * Page::SIZE + offsetof(PageHeader, checksum));
+			const std::uint32_t zero = 0;
+			raw.write(reinterpret_cast<const char*>(&zero), sizeof(zero));
+		}
+		try
+		{
+			sumFile.readPage(pageNos[0]);
+			PRINT_ERROR("ERROR :: File read a page with a zeroed checksum.");
+		}
+		catch(PageChecksumException)
+		{
+		}
+	}
+	File::remove(dbName);
+
+	std::cout << "Test 29 passed" << "\n";
+}
+
+void test30()
+{
+	// Pages of a compressed file read back through File, FileScan and the
+	// buffer pool, also after growing out of their slots, reopening and
+	// compaction, and take less room than uncompressed ones.
+	std::string text;
+	for (int i = 0; text.size() < Page::SIZE; i++)
+	{
+		text += "row " + std::to_string(i % 40) + " of a text-heavy table, ";
+	}
+	text.resize(Page::SIZE);
+	std::vector<char> packed(LzCodec::maxCompressedLength(text.size()));
+	std::string unpacked(text.size(), '\0');
+	const std::size_t packedLength = LzCodec::compress(text.data(), text.size(), &packed[0], packed.size());
+	if (packedLength == 0 || packedLength > text.size() / 3
+			|| !LzCodec::decompress(&packed[0], packedLength, &unpacked[0], unpacked.size()) || unpacked != text)
+	{
+		PRINT_ERROR("ERROR :: Text did not compress and decompress.");
+	}
+	if (LzCodec::decompress(&packed[0], packedLength - 1, &unpacked[0], unpacked.size()))
+	{
+		PRINT_ERROR("ERROR :: Truncated input decompressed.");
+	}
+	std::string prefix(100, '\0');
+	if (!LzCodec::decompressPrefix(&packed[0], packedLength, &prefix[0], prefix.size())
+			|| prefix != text.substr(0, prefix.size()))
+	{
+		PRINT_ERROR("ERROR :: Prefix did not decompress.");
+	}
+
+	const std::string dbName = "test.compressed.db";
+	try
+	{
+		File::remove(dbName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+
+	// enough pages for the page map to grow
+	const int pages = 300;
+	std::string noise;
+	for (unsigned int x = 1; noise.size() < 3000; )
+	{
+		x = x * 1103515245 + 12345;
+		noise += static_cast<char>(x >> 16);
+	}
+	std::vector<PageId> pageNos;
+	std::vector<RecordId> rids;
+	RecordId noiseRid;
+	RecordId pooledRid;
+	{
+		File zipFile = File::create(dbName, true);
+		if (!zipFile.compressed())
+		{
+			PRINT_ERROR("ERROR :: File is not compressed.");
+		}
+		for (int i = 0; i < pages; i++)
+		{
+			Page newPage = zipFile.allocatePage();
+			rids.push_back(newPage.insertRecord(text.substr(0, 2000) + std::to_string(i)));
+			zipFile.writePage(newPage);
+			pageNos.push_back(newPage.page_number());
+		}
+		// an incompressible record moves the page to a bigger slot
+		Page grown = zipFile.readPage(pageNos[5]);
+		noiseRid = grown.insertRecord(noise);
+		zipFile.writePage(grown);
+
+		bufMgr->readPage(&zipFile, pageNos[7], page);
+		pooledRid = page->insertRecord("through the pool");
+		bufMgr->unPinPage(&zipFile, pageNos[7], true);
+		bufMgr->flushFile(&zipFile);
+	}
+
+	{
+		File zipFile = File::open(dbName);
+		if (!zipFile.compressed())
+		{
+			PRINT_ERROR("ERROR :: Reopened file is not compressed.");
+		}
+		for (int i = 0; i < pages; i++)
+		{
+			if (zipFile.readPage(pageNos[i]).getRecord(rids[i]) != text.substr(0, 2000) + std::to_string(i))
+			{
+				PRINT_ERROR("ERROR :: Compressed page did not read back.");
+			}
+		}
+		if (zipFile.readPage(pageNos[5]).getRecord(noiseRid) != noise
+				|| zipFile.readPage(pageNos[7]).getRecord(pooledRid) != "through the pool")
+		{
+			PRINT_ERROR("ERROR :: Rewritten page did not read back.");
+		}
+		FileScan scan(&zipFile, 16 * Page::SIZE);
+		int scanned = 0;
+		while (Page* scanPage = scan.next())
+		{
+			if (scanPage->page_number() != pageNos[scanned]
+					|| scanPage->getRecord(rids[scanned]) != text.substr(0, 2000) + std::to_string(scanned))
+			{
+				PRINT_ERROR("ERROR :: Block scan of compressed file returned a different page.");
+			}
+			scanned++;
+		}
+		if (scanned != pages)
+		{
+			PRINT_ERROR("ERROR :: Block scan of compressed file missed pages.");
+		}
+
+		std::ifstream raw(dbName.c_str(), std::ios::binary | std::ios::ate);
+		if (static_cast<std::size_t>(raw.tellg()) > pages * Page::SIZE / 3)
+		{
+			PRINT_ERROR("ERROR :: Compressed file is not smaller.");
+		}
+
+		bufMgr->disposePage(&zipFile, pageNos[0]);
+		bufMgr->compactFile(&zipFile);
+		if (File::exists(dbName + ".compact"))
+		{
+			PRINT_ERROR("ERROR :: Compaction left its new file behind.");
+		}
+	}
+
+	{
+		File zipFile = File::open(dbName);
+		int read = 0;
+		for (FileIterator iter = zipFile.begin(); iter != zipFile.end(); ++iter)
+		{
+			Page filePage = *iter;
+			read++;
+			// record ids carry the page number, which compaction changed
+			const RecordId moved = {static_cast<PageId>(read), rids[read].slot_number};
+			if (filePage.page_number() != static_cast<PageId>(read)
+					|| filePage.getRecord(moved) != text.substr(0, 2000) + std::to_string(read))
+			{
+				PRINT_ERROR("ERROR :: Compacted compressed file lost a page.");
+			}
+		}
+		const RecordId movedNoise = {pageNos[4], noiseRid.slot_number};
+		if (read != pages - 1 || zipFile.readPage(pageNos[4]).getRecord(movedNoise) != noise)
+		{
+			PRINT_ERROR("ERROR :: Compacted compressed file has the wrong pages.");
+		}
+	}
+	File::remove(dbName);
+
+	std::cout << "Test 30 passed" << "\n";
+}
+
+void test31()
+{
+	// Pages the clock evicts come back from the victim cache without a disk
+	// read, with the changes made to them, until their file is flushed.
+	const std::string dbName = "test.victim.db";
+	try
+	{
+		File::remove(dbName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+
+	const int pages = 60;
+	{
+		File victimFile = File::create(dbName);
+		BufMgr* victimMgr = new BufMgr(10);
+		victimMgr->setVictimCache(64 * 1024);
+
+		std::vector<PageId> pageNos;
+		std::vector<RecordId> rids;
+		for (int i = 0; i < pages; i++)
+		{
+			Page newPage = victimFile.allocatePage();
+			rids.push_back(newPage.insertRecord("victim page " + std::to_string(i)));
+			victimFile.writePage(newPage);
+			pageNos.push_back(newPage.page_number());
+		}
+
+		for (int i = 0; i < pages; i++)
+		{
+			victimMgr->readPage(&victimFile, pageNos[i], page);
+			victimMgr->unPinPage(&victimFile, pageNos[i], false);
+		}
+		const int diskreads = victimMgr->getBufStats().diskreads;
+		for (int i = 0; i < pages; i++)
+		{
+			victimMgr->readPage(&victimFile, pageNos[i], page);
+			if (page->getRecord(rids[i]) != "victim page " + std::to_string(i))
+			{
+				PRINT_ERROR("ERROR :: Page from the victim cache has the wrong record.");
+			}
+			victimMgr->unPinPage(&victimFile, pageNos[i], false);
+		}
+		if (victimMgr->getBufStats().diskreads != diskreads || victimMgr->getBufStats().victimHits < pages - 10
+				|| victimMgr->getBufStats().victimCompressionRatio() < 4)
+		{
+			PRINT_ERROR("ERROR :: Evicted pages were read from disk again.");
+		}
+
+		// a dirty page is kept as it was changed
+		victimMgr->readPage(&victimFile, pageNos[0], page);
+		const RecordId changedRid = page->insertRecord("changed");
+		victimMgr->unPinPage(&victimFile, pageNos[0], true);
+		for (int i = 1; i <= 20; i++)
+		{
+			victimMgr->readPage(&victimFile, pageNos[i], page);
+			victimMgr->unPinPage(&victimFile, pageNos[i], false);
+		}
+		victimMgr->readPage(&victimFile, pageNos[0], page);
+		if (page->getRecord(changedRid) != "changed")
+		{
+			PRINT_ERROR("ERROR :: Dirty page lost its change in the victim cache.");
+		}
+		victimMgr->unPinPage(&victimFile, pageNos[0], false);
+
+		// after a flush the file may change on disk, so its pages are read again
+		victimMgr->flushFile(&victimFile);
+		const int misses = victimMgr->getBufStats().victimMisses;
+		victimMgr->readPage(&victimFile, pageNos[30], page);
+		victimMgr->unPinPage(&victimFile, pageNos[30], false);
+		if (victimMgr->getBufStats().victimMisses != misses + 1
+				|| victimFile.readPage(pageNos[0]).getRecord(changedRid) != "changed")
+		{
+			PRINT_ERROR("ERROR :: Flushed file kept pages in the victim cache.");
+		}
+		victimMgr->flushFile(&victimFile);
+		delete victimMgr;
+
+		// a page is compressed after its reservation, so a copy filled late
+		// never replaces the one reserved after it, and a reserved page is
+		// not found before it is filled
+		VictimCache cache(64 * 1024);
+		Page older = victimFile.readPage(pageNos[1]);
+		Page newer = victimFile.readPage(pageNos[1]);
+		const RecordId newerRid = newer.insertRecord("newer");
+		const std::uint64_t olderTicket = cache.reserve(victimFile.id(), pageNos[1]);
+		const std::uint64_t newerTicket = cache.reserve(victimFile.id(), pageNos[1]);
+		cache.fill(newerTicket, victimFile.id(), pageNos[1], newer);
+		cache.fill(olderTicket, victimFile.id(), pageNos[1], older);
+		Page taken;
+		if (!cache.take(victimFile.id(), pageNos[1], taken) || taken.getRecord(newerRid) != "newer")
+		{
+			PRINT_ERROR("ERROR :: Victim cache kept a page filled after a newer reservation.");
+		}
+		cache.reserve(victimFile.id(), pageNos[1]);
+		if (cache.take(victimFile.id(), pageNos[1], taken) || cache.pages() != 0)
+		{
+			PRINT_ERROR("ERROR :: Victim cache returned a page before it was filled.");
+		}
+	}
+	File::remove(dbName);
+
+	std::cout << "Test 31 passed" << "\n";
+}
+
+void test32()
+{
+	// A record close to a page in size goes to a new page when the pages of
+	// the top free-space category are too full for it, instead of trying
+	// them over and over.
+	const std::string filename = "test.heap.large";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		File heap = File::create(filename);
+		{
+			HeapFile heapFile(bufMgr, &heap);
+			const RecordId small = heapFile.insert("small");
+			const std::string large(Page::DATA_SIZE - 2 * sizeof(PageSlot), 'l');
+			const RecordId largeRid = heapFile.insert(large);
+			if (largeRid.page_number == small.page_number || heapFile.dataPages() != 2
+					|| heapFile.get(largeRid) != large || heapFile.get(small) != "small")
+			{
+				PRINT_ERROR("ERROR :: Near page-size record was not inserted into a new page.");
+			}
+		}
+		bufMgr->invalidateFile(&heap);
+	}
+	File::remove(filename);
+
+	std::cout << "Test 32 passed" << "\n";
+}
+
+void test33()
+{
+	// A frame that leaves a ring through the free list and comes back keeps a
+	// single slot, so the ring still covers as many frames as it is long.
+	// Allocating a page reads nothing from disk.
+	BufMgr* ringMgr = new BufMgr(64);
+	BufferAccessStrategy strategy(BufferAccessStrategy::BULKREAD, 8);
+	for (i = 1; i <= 8; i++) {
+		ringMgr->readPage(file1ptr, i, page, &strategy);
+		ringMgr->unPinPage(file1ptr, i, false);
+	}
+	ringMgr->flushFile(file1ptr);
+	// a page read normally takes one of the flushed frames, so that the
+	// scan gets the others back in a different order
+	ringMgr->readPage(file2ptr, 1, page);
+	for (i = 9; i <= 24; i++) {
+		ringMgr->readPage(file1ptr, i, page, &strategy);
+		ringMgr->unPinPage(file1ptr, i, false);
+	}
+
+	int diskreads = ringMgr->getBufStats().diskreads;
+	for (i = 17; i <= 24; i++) {
+		ringMgr->readPage(file1ptr, i, page);
+		ringMgr->unPinPage(file1ptr, i, false);
+	}
+	if (ringMgr->getBufStats().diskreads != diskreads)
+	{
+		PRINT_ERROR("ERROR :: Ring strategy held the same frame twice.");
+	}
+	ringMgr->unPinPage(file2ptr, 1, false);
+
+	PageId pageNo;
+	diskreads = ringMgr->getBufStats().diskreads;
+	ringMgr->allocPage(file5ptr, pageNo, page);
+	ringMgr->unPinPage(file5ptr, pageNo, false);
+	if (ringMgr->getBufStats().diskreads != diskreads)
+	{
+		PRINT_ERROR("ERROR :: Page allocation was counted as a disk read.");
+	}
+	delete ringMgr;
+
+	std::cout << "Test 33 passed" << "\n";
+}
+
+void test34()
+{
+	// A page the admission filter rejects is read into the probationary
+	// window and leaves the clock's victim alone, even when the window page
+	// it replaces was referenced again.
+	BufMgr* lfuMgr = new BufMgr(num);
+	lfuMgr->setAdmissionFilter(true);
+	for (int round = 0; round < 5; round++) {
+		for (i = 1; i <= num; i++) {
+			lfuMgr->readPage(file1ptr, i, page);
+			lfuMgr->unPinPage(file1ptr, i, false);
+		}
+	}
+	for (i = 1; i <= 50; i++) {
+		for (int round = 0; round < 2; round++) {
+			lfuMgr->readPage(file2ptr, i, page);
+			lfuMgr->unPinPage(file2ptr, i, false);
+		}
+	}
+
+	// the window takes one frame from the clock to fill up; the sketch is
+	// approximate, so a collision may cost another page or two
+	const int diskreads = lfuMgr->getBufStats().diskreads;
+	for (i = 1; i <= num; i++) {
+		lfuMgr->readPage(file1ptr, i, page);
+		lfuMgr->unPinPage(file1ptr, i, false);
+	}
+	if (lfuMgr->getBufStats().diskreads - diskreads > 3)
+	{
+		PRINT_ERROR("ERROR :: Pages rejected by the admission filter evicted frequently read pages.");
+	}
+	delete lfuMgr;
+
+	std::cout << "Test 34 passed" << "\n";
+}
+
+void test35()
+{
+	// A victim whose log records are not durable is evicted only after the
+	// log was flushed up to its LSN.
+	const std::string logName = "test.evict.wal";
+	const std::string dbName = "test.evict.db";
+	std::remove(logName.c_str());
+	try
+	{
+		File::remove(dbName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		LogManager log(logName);
+		BufMgr* walMgr = new BufMgr(4);
+		walMgr->setLogManager(&log);
+		File walFile = File::create(dbName);
+
+		const TxnId txn = log.begin();
+		PageId pageNo;
+		walMgr->allocPage(&walFile, pageNo, page);
+		const Page before = *page;
+		page->insertRecord("evicted record");
+		const Lsn update = log.logUpdate(txn, &walFile, before, page);
+		walMgr->unPinPage(&walFile, pageNo, true);
+
+		for (i = 1; i <= 8; i++) {
+			walMgr->readPage(file1ptr, i, page);
+			walMgr->unPinPage(file1ptr, i, false);
+		}
+		if (log.flushedLsn() <= update || walFile.readPage(pageNo).lsn() != update)
+		{
+			PRINT_ERROR("ERROR :: A victim was written back before its log records.");
+		}
+		walMgr->setLogManager(NULL);
+		delete walMgr;
+	}
+	File::remove(dbName);
+	std::remove(logName.c_str());
+
+	std::cout << "Test 35 passed" << "\n";
+}
+
+void test36()
+{
+	// Threads that miss on the same page wait for one read of it and pin
+	// the same frame. A read that fails leaves no frame behind.
+	BufMgr* missMgr = new BufMgr(4);
+	std::vector<Page*> pages(8);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; t++)
+		threads.push_back(std::thread([missMgr, &pages, t]() {
+			missMgr->readPage(file1ptr, 3, pages[t]);
+		}));
+	for (int t = 0; t < 8; t++)
+		threads[t].join();
+	if (missMgr->getBufStats().diskreads != 1 || std::count(pages.begin(), pages.end(), pages[0]) != 8)
+	{
+		PRINT_ERROR("ERROR :: Concurrent misses on one page read it more than once.");
+	}
+	for (int t = 0; t < 8; t++)
+		missMgr->unPinPage(file1ptr, 3, false);
+
+	std::atomic<int> failed(0);
+	threads.clear();
+	for (int t = 0; t < 8; t++)
+		threads.push_back(std::thread([missMgr, &failed]() {
+			Page* missing;
+			try
+			{
+				missMgr->readPage(file1ptr, num + 100, missing);
+			}
+			catch(InvalidPageException e)
+			{
+				failed++;
+			}
+		}));
+	for (int t = 0; t < 8; t++)
+		threads[t].join();
+	if (failed != 8)
+	{
+		PRINT_ERROR("ERROR :: A reader of a page that does not exist did not fail.");
+	}
+	for (i = 1; i <= 4; i++)
+		missMgr->readPage(file2ptr, i, page);
+	for (i = 1; i <= 4; i++)
+		missMgr->unPinPage(file2ptr, i, false);
+	delete missMgr;
+
+	std::cout << "Test 36 passed" << "\n";
+}
+
+void test37()
+{
+	// Closing the last File of a file writes back and drops its pages, so a
+	// file that gets the same id next does not find them.
+	const std::string firstName = "test.reuse.1";
+	const std::string secondName = "test.reuse.2";
+	try
+	{
+		File::remove(firstName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	try
+	{
+		File::remove(secondName);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	PageId pageNo;
+	RecordId rid;
+	FileId firstId;
+	{
+		File first = File::create(firstName);
+		firstId = first.id();
+		bufMgr->allocPage(&first, pageNo, page);
+		rid = page->insertRecord("first file");
+		bufMgr->unPinPage(&first, pageNo, true);
+	}
+	{
+		File second = File::create(secondName);
+		Page secondPage = second.allocatePage();
+		secondPage.insertRecord("second file");
+		second.writePage(secondPage);
+		if (second.id() != firstId)
+		{
+			PRINT_ERROR("ERROR :: The id of a closed file was not reused.");
+		}
+
+		bufMgr->readPage(&second, secondPage.page_number(), page);
+		if (page->getRecord(rid) != "second file")
+		{
+			PRINT_ERROR("ERROR :: A page of a closed file was found under the id of another file.");
+		}
+		bufMgr->unPinPage(&second, secondPage.page_number(), false);
+		bufMgr->flushFile(&second);
+	}
+	{
+		File first = File::open(firstName);
+		if (first.readPage(pageNo).getRecord(rid) != "first file")
+		{
+			PRINT_ERROR("ERROR :: A dirty page was not written back when its file was closed.");
+		}
+	}
+
+	// threads opening the same file at once share one id
+	std::vector<FileId> ids(8);
+	std::atomic<int> opened(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; t++)
+		threads.push_back(std::thread([&firstName, &ids, &opened, t]() {
+			File file = File::open(firstName);
+			ids[t] = file.id();
+			opened++;
+			while (opened < 8)
+				std::this_thread::yield();
+		}));
+	for (int t = 0; t < 8; t++)
+		threads[t].join();
+	if (std::count(ids.begin(), ids.end(), ids[0]) != 8)
+	{
+		PRINT_ERROR("ERROR :: A file opened by several threads at once got several ids.");
+	}
+	File::remove(firstName);
+	File::remove(secondName);
+
+	std::cout << "Test 37 passed" << "\n";
+}
+
+void test38()
+{
+	// A file that is not a database file, or one of another format version,
+	// is not opened.
+	const std::string filename = "test.badfile";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		std::ofstream out(filename.c_str(), std::ios::binary);
+		out << std::string(Page::SIZE, 'x');
+	}
+	try
+	{
+		File file = File::open(filename);
+		PRINT_ERROR("ERROR :: A file that is not a database file was opened.");
+	}
+	catch(BadFileException)
+	{
+	}
+	File::remove(filename);
+
+	{
+		File file = File::create(filename);
+	}
+	{
+		std::fstream raw(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		const std::uint32_t version = FileHeader::VERSION + 1;
+		raw.seekp(offsetof(FileHeader, version));
+		raw.write(reinterpret_cast<const char*>(&version), sizeof(version));
+	}
+	try
+	{
+		File file = File::open(filename);
+		PRINT_ERROR("ERROR :: A file of another format version was opened.");
+	}
+	catch(BadFileException)
+	{
+	}
+	if (File::isOpen(filename))
+	{
+		PRINT_ERROR("ERROR :: A file that failed to open stayed registered.");
+	}
+	File::remove(filename);
+
+	std::cout << "Test 38 passed" << "\n";
+}
+
+void test39()
+{
+	// Sorting a heap file returns its records and none of its free-space-map
+	// pages, whether it sorts in memory or through runs.
+	const std::string filename = "test.heapsort";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		File heapFile = File::create(filename);
+		const int records = 3000;
+		fillHeapFile(heapFile, records, 100, [](int i) { return (i * 7919) % 3000; });
+
+		for (int budget = 0; budget < 2; budget++)
+		{
+			std::size_t sorted = 0;
+			std::int64_t last = -1;
+			ExternalSort sort(bufMgr, budget == 0 ? num - 10 : 8, 2, [](const char* a, std::size_t, const char* b, std::size_t) {
+				return *reinterpret_cast<const std::int64_t*>(a) < *reinterpret_cast<const std::int64_t*>(b);
+			});
+			sort.sort(&heapFile, [&sorted, &last](const std::string& record) {
+				const std::int64_t key = *reinterpret_cast<const std::int64_t*>(record.data());
+				if (record.size() != 100 || key < last)
+				{
+					PRINT_ERROR("ERROR :: Sort of a heap file returned a record out of order or not from a data page.");
+				}
+				last = key;
+				sorted++;
+			}, HeapFile::isDataPage);
+			if (sorted != static_cast<std::size_t>(records) || (budget == 1) != (sort.runs() > 0))
+			{
+				PRINT_ERROR("ERROR :: Sort of a heap file returned the wrong number of records.");
+			}
+		}
+		bufMgr->flushFile(&heapFile);
+	}
+	File::remove(filename);
+
+	std::cout << "Test 39 passed" << "\n";
+}
+
+void test40()
+{
+	// A process killed while it allocates and deletes pages leaves a file
+	// whose used and free lists hold every page exactly once, once it is
+	// opened again.
+	const std::string filename = "test.crash";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		File crashFile = File::create(filename);
+		crashFile.allocatePages(8);
+	}
+
+	for (int round = 0; round < 40; round++)
+	{
+		const pid_t child = fork();
+		if (child == 0)
+		{
+			try
+			{
+				File crashFile = File::open(filename);
+				std::vector<PageId> used;
+				for (FileIterator iter = crashFile.begin(); iter != crashFile.end(); ++iter)
+					used.push_back((*iter).page_number());
+				unsigned int seed = round;
+				for (;;)
+				{
+					if (used.size() < 4 || (used.size() < 40 && rand_r(&seed) % 2 == 0))
+					{
+						used.push_back(crashFile.allocatePage().page_number());
+					}
+					else
+					{
+						const std::size_t victim = rand_r(&seed) % used.size();
+						crashFile.deletePage(used[victim]);
+						used.erase(used.begin() + victim);
+					}
+				}
+			}
+			catch(...)
+			{
+			}
+			_exit(1);
+		}
+		usleep(500 + (round * 379) % 3000);
+		kill(child, SIGKILL);
+		int status;
+		waitpid(child, &status, 0);
+		if (!WIFSIGNALED(status))
+		{
+			PRINT_ERROR("ERROR :: Process changing pages failed before it was killed.");
+		}
+
+		// the used list is in order and holds exactly the pages that read as
+		// used; deleting them all and allocating as many pages again reuses
+		// every page, so the free list holds all of the others
+		File crashFile = File::open(filename);
+		const PageId pages = crashFile.pageCount();
+		std::vector<PageId> used;
+		for (FileIterator iter = crashFile.begin(); iter != crashFile.end(); ++iter)
+		{
+			const PageId pageNo = (*iter).page_number();
+			if (pageNo >= pages || (!used.empty() && pageNo <= used.back()))
+			{
+				PRINT_ERROR("ERROR :: Used list of a crashed file is out of order.");
+			}
+			used.push_back(pageNo);
+		}
+		std::size_t readable = 0;
+		for (PageId pageNo = 1; pageNo < pages; pageNo++)
+		{
+			try
+			{
+				crashFile.readPage(pageNo);
+				readable++;
+			}
+			catch(const InvalidPageException&)
+			{
+			}
+		}
+		if (readable != used.size())
+		{
+			PRINT_ERROR("ERROR :: Used list of a crashed file lost pages.");
+		}
+		for (std::size_t i = 0; i < used.size(); i++)
+			crashFile.deletePage(used[i]);
+		for (PageId i = 1; i < pages; i++)
+			crashFile.allocatePage();
+		if (crashFile.pageCount() != pages)
+		{
+			PRINT_ERROR("ERROR :: Free list of a crashed file lost pages.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 40 passed" << "\n";
+}
+
+void test41()
+{
+	// Deleting a buffer pool whose dirty pages cannot all be written back
+	// does not throw, and writes back the pages that can be written.
+	const std::string filename = "test.closing";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException)
+	{
+	}
+	{
+		File closingFile = File::create(filename);
+		const std::vector<Page> pages = closingFile.allocatePages(3);
+		BufMgr* closingMgr = new BufMgr(4);
+		for (std::size_t i = 0; i < pages.size(); i++)
+		{
+			closingMgr->readPage(&closingFile, pages[i].page_number(), page);
+			page->insertRecord("closing");
+			closingMgr->unPinPage(&closingFile, pages[i].page_number(), true);
+		}
+		// the first page is deleted behind the buffer pool's back, so its
+		// write back fails
+		closingFile.deletePage(pages[0].page_number());
+		delete closingMgr;
+
+		for (std::size_t i = 1; i < pages.size(); i++)
+		{
+			Page written = closingFile.readPage(pages[i].page_number());
+			if (written.begin() == written.end() || *written.begin() != "closing")
+			{
+				PRINT_ERROR("ERROR :: Page was not written back after another page failed.");
+			}
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 41 passed" << "\n";
+}
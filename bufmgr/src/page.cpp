@@ -7,6 +7,8 @@
 
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include "crc32c.h"
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
 #include "exceptions/invalid_slot_exception.h"
@@ -16,6 +18,8 @@
 
 namespace badgerdb {
 
+const PageId Page::INVALID_NUMBER;
+
 Page::Page() {
   initialize();
 }
@@ -27,9 +31,32 @@ void Page::initialize() {
   header_.num_free_slots = 0;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
+  header_.checksum = 0;
+  header_.reserved = 0;
+  header_.lsn = 0;
   data_.assign(DATA_SIZE, char());
 }
 
+bool Page::checksumValid() const {
+  if (header_.checksum != 0) {
+    return header_.checksum == computeChecksum(header_, &data_[0]);
+  }
+  // only a page that was never written, all zeros, has no checksum; a zeroed
+  // or torn header in front of data is not one
+  static const PageHeader zeros = PageHeader();
+  return std::memcmp(&header_, &zeros, sizeof(header_)) == 0 &&
+      data_.find_first_not_of('\0') == std::string::npos;
+}
+
+std::uint32_t Page::computeChecksum(const PageHeader& header,
+                                    const char* data) {
+  PageHeader unsummed = header;
+  unsummed.checksum = 0;
+  const std::uint32_t crc = Crc32c::extend(
+      Crc32c::compute(&unsummed, sizeof(unsummed)), data, DATA_SIZE);
+  return crc != 0 ? crc : 1;
+}
+
 RecordId Page::insertRecord(const std::string& record_data) {
   if (!hasSpaceForRecord(record_data)) {
     throw InsufficientSpaceException(
@@ -46,6 +73,27 @@ std::string Page::getRecord(const RecordId& record_id) const {
   return data_.substr(slot.item_offset, slot.item_length);
 }
 
+bool Page::getRecordBytes(const SlotId slot_number, const char*& record_data,
+                          std::size_t& length) const {
+  const PageSlot& slot = getSlot(slot_number);
+  if (!slot.used) {
+    return false;
+  }
+  record_data = &data_[slot.item_offset];
+  length = slot.item_length;
+  return true;
+}
+
+void Page::copyTo(char* image) const {
+  std::memcpy(image, &header_, sizeof(header_));
+  std::memcpy(image + sizeof(header_), data_.data(), DATA_SIZE);
+}
+
+void Page::copyFrom(const char* image) {
+  std::memcpy(&header_, image, sizeof(header_));
+  std::memcpy(&data_[0], image + sizeof(header_), DATA_SIZE);
+}
+
 void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
   validateRecordId(record_id);
@@ -57,6 +57,27 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * CRC-32C of the page as written to disk, computed with this field set to
+   * 0; 0 only in a page that was never written, which is all zeros, e.g.
+   * past the end of the file.  In memory it is the checksum of the page as last
+   * read and is not kept up to date.
+   */
+  std::uint32_t checksum;
+
+  /**
+   * Unused and 0.  Keeps the header free of padding bytes, whose contents
+   * the checksum would otherwise depend on.
+   */
+  std::uint32_t reserved;
+
+  /**
+   * Log sequence number of the last logged update of the page; 0 if it has
+   * never been logged.  The buffer manager makes the log durable up to here
+   * before it writes the page back.
+   */
+  Lsn lsn;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -199,6 +220,78 @@ class Page {
    */
   PageId next_page_number() const { return header_.next_page_number; }
 
+  /**
+   * Returns the log sequence number of the last logged update of this page.
+   *
+   * @return  LSN of the page, or 0 if it has never been logged.
+   */
+  Lsn lsn() const { return header_.lsn; }
+
+  /**
+   * Sets the log sequence number of the last logged update of this page.
+   *
+   * @param new_lsn   LSN of the update.
+   */
+  void set_lsn(const Lsn new_lsn) { header_.lsn = new_lsn; }
+
+  /**
+   * Returns whether the page is in use or is a free page.
+   *
+   * @return  True if page is in use; false if page is free.
+   */
+  bool isUsed() const { return page_number() != INVALID_NUMBER; }
+
+  /**
+   * Returns the data bytes of the page, DATA_SIZE of them, for structures
+   * that lay out the page themselves instead of storing records in it.
+   *
+   * @return  Pointer to the data of the page.
+   */
+  char* data() { return &data_[0]; }
+
+  /**
+   * Returns the number of slots of the page, used or not.  Records have
+   * slot numbers 1 to this.
+   *
+   * @return  Number of slots.
+   */
+  SlotId slotCount() const { return header_.num_slots; }
+
+  /**
+   * Finds the bytes of the record in the given slot without copying them.
+   * They stay valid until the page changes.
+   *
+   * @param slot_number   Number of the slot, 1 to slotCount().
+   * @param record_data   Set to the first byte of the record.
+   * @param length        Set to the length of the record.
+   * @return  False if the slot is not in use.
+   */
+  bool getRecordBytes(const SlotId slot_number, const char*& record_data,
+                      std::size_t& length) const;
+
+  /**
+   * Copies the page as it is laid out on disk, header then data, into
+   * <image>, e.g. to compress or log it.
+   *
+   * @param image   SIZE bytes to copy the page to.
+   */
+  void copyTo(char* image) const;
+
+  /**
+   * Replaces the page with one laid out as on disk.
+   *
+   * @param image   SIZE bytes of the page, header then data.
+   */
+  void copyFrom(const char* image);
+
+  /**
+   * Returns true if the page matches the checksum it was read with, or is
+   * all zeros, as a page that was never written reads.
+   *
+   * @return  Whether the page is intact.
+   */
+  bool checksumValid() const;
+
   /**
    * Returns an iterator at the first record in the page.
    *
@@ -238,6 +331,17 @@ class Page {
     header_.next_page_number = new_next_page_number;
   }
 
+  /**
+   * Returns the checksum of the given page image, never 0.
+   *
+   * @param header  Header of the page; its checksum field is left out.
+   * @param data    DATA_SIZE bytes of data of the page.
+   * @return  CRC-32C of the page with a checksum field of 0, or 1 if that
+   *          is 0.
+   */
+  static std::uint32_t computeChecksum(const PageHeader& header,
+                                       const char* data);
+
   /**
    * Deletes the record with the given ID.  Page is compacted upon delete to
    * ensure that data of all records is contiguous.  Slot array is compacted if
@@ -313,13 +417,6 @@ class Page {
    */
   void validateRecordId(const RecordId& record_id) const;
 
-  /**
-   * Returns whether the page is in use or is a free page.
-   *
-   * @return  True if page is in use; false if page is free.
-   */
-  bool isUsed() const { return page_number() != INVALID_NUMBER; }
-
   /**
    * Header metadata.
    */
@@ -342,5 +439,7 @@ static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(sizeof(PageHeader) == 32,
+              "Page header must not have padding bytes.");
 
 }
@@ -0,0 +1,57 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_guard.h"
+
+namespace badgerdb {
+
+PageGuard::PageGuard(const bool exclusive)
+    : page_(NULL),
+      buf_mgr_(NULL),
+      frame_(0),
+      exclusive_(exclusive) {
+}
+
+PageGuard::PageGuard(BufMgr* buf_mgr, const FrameId frame, Page* page,
+                     const bool exclusive)
+    : page_(page),
+      buf_mgr_(buf_mgr),
+      frame_(frame),
+      exclusive_(exclusive) {
+}
+
+PageGuard::PageGuard(PageGuard&& other)
+    : page_(other.page_),
+      buf_mgr_(other.buf_mgr_),
+      frame_(other.frame_),
+      exclusive_(other.exclusive_) {
+  other.page_ = NULL;
+}
+
+PageGuard::~PageGuard() {
+  release();
+}
+
+void PageGuard::release() {
+  if (page_ != NULL) {
+    page_ = NULL;
+    buf_mgr_->releaseGuard(frame_, exclusive_);
+  }
+}
+
+void PageGuard::moveFrom(PageGuard& other) {
+  if (&other == this) {
+    return;
+  }
+  release();
+  page_ = other.page_;
+  buf_mgr_ = other.buf_mgr_;
+  frame_ = other.frame_;
+  other.page_ = NULL;
+}
+
+}
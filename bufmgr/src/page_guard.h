@@ -0,0 +1,169 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <utility>
+#include "buffer.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Pin and latch of a page in the buffer pool, released together.
+ *
+ * A guard is returned by BufMgr::readPageShared(), BufMgr::readPageExclusive()
+ * or BufMgr::allocPageExclusive() with the page pinned and the latch of its
+ * frame held, and drops both when it is destroyed or released.  Guards move
+ * but do not copy, so a pin always has exactly one owner.  A guard that was
+ * moved from, released or default-constructed holds nothing.
+ *
+ * Frame latches only exclude other guards: pages pinned through the raw
+ * Page pointers of BufMgr::readPage() are not latched.
+ */
+class PageGuard {
+ public:
+  /**
+   * Releases the page.
+   */
+  ~PageGuard();
+
+  /**
+   * Unlatches and unpins the page now; the guard holds nothing afterwards.
+   */
+  void release();
+
+  /**
+   * Returns true if the guard holds a page.
+   */
+  bool held() const { return page_ != NULL; }
+
+  /**
+   * Returns the number of the page, or Page::INVALID_NUMBER if the guard
+   * holds nothing.
+   */
+  PageId pageNumber() const {
+    return page_ != NULL ? page_->page_number() : Page::INVALID_NUMBER;
+  }
+
+ protected:
+  /**
+   * Constructs a guard that holds nothing.
+   */
+  explicit PageGuard(const bool exclusive);
+
+  /**
+   * Constructs a guard of a frame that BufMgr has pinned and latched.
+   */
+  PageGuard(BufMgr* buf_mgr, const FrameId frame, Page* page,
+            const bool exclusive);
+
+  /**
+   * Takes over the page of another guard.
+   */
+  PageGuard(PageGuard&& other);
+
+  /**
+   * Releases the page held, then takes over the page of another guard.
+   */
+  void moveFrom(PageGuard& other);
+
+  /**
+   * Page held, or NULL.
+   */
+  Page* page_;
+
+ private:
+  PageGuard(const PageGuard&);
+  PageGuard& operator=(const PageGuard&);
+
+  BufMgr* buf_mgr_;
+  FrameId frame_;
+
+  /**
+   * True if the frame latch is held in exclusive mode; the page is then
+   * marked dirty when it is released.
+   */
+  bool exclusive_;
+};
+
+/**
+ * @brief Page pinned with its frame latch held in shared mode.
+ *
+ * Any number of read guards of a page may be held at once; none of them
+ * while a write guard of the page is held.
+ */
+class ReadPageGuard : public PageGuard {
+ public:
+  /**
+   * Constructs a guard that holds nothing.
+   */
+  ReadPageGuard() : PageGuard(false) {}
+
+  /**
+   * Takes over the page of another guard.
+   */
+  ReadPageGuard(ReadPageGuard&& other) : PageGuard(std::move(other)) {}
+
+  /**
+   * Releases the page held, then takes over the page of another guard.
+   */
+  ReadPageGuard& operator=(ReadPageGuard&& other) {
+    moveFrom(other);
+    return *this;
+  }
+
+  const Page* page() const { return page_; }
+  const Page* operator->() const { return page_; }
+  const Page& operator*() const { return *page_; }
+
+ private:
+  friend class BufMgr;
+
+  ReadPageGuard(BufMgr* buf_mgr, const FrameId frame, Page* page)
+      : PageGuard(buf_mgr, frame, page, false) {}
+};
+
+/**
+ * @brief Page pinned with its frame latch held in exclusive mode.
+ *
+ * The page is marked dirty when the guard is released, whether or not it
+ * was changed.
+ */
+class WritePageGuard : public PageGuard {
+ public:
+  /**
+   * Constructs a guard that holds nothing.
+   */
+  WritePageGuard() : PageGuard(true) {}
+
+  /**
+   * Takes over the page of another guard.
+   */
+  WritePageGuard(WritePageGuard&& other) : PageGuard(std::move(other)) {}
+
+  /**
+   * Releases the page held, then takes over the page of another guard.
+   */
+  WritePageGuard& operator=(WritePageGuard&& other) {
+    moveFrom(other);
+    return *this;
+  }
+
+  Page* page() const { return page_; }
+  Page* operator->() const { return page_; }
+  Page& operator*() const { return *page_; }
+
+ private:
+  friend class BufMgr;
+
+  WritePageGuard(BufMgr* buf_mgr, const FrameId frame, Page* page)
+      : PageGuard(buf_mgr, frame, page, true) {}
+};
+
+}
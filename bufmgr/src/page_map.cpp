@@ -0,0 +1,108 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_map.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+const std::size_t PageMap::ALIGNMENT;
+
+PageMap::PageMap(const std::uint64_t offset, const std::vector<Slot>& slots)
+    : offset_(offset),
+      slots_(slots),
+      end_(align(offset + slots.size() * sizeof(Slot))) {
+  // new slots go after everything the map points to; space written but
+  // never recorded, e.g. before a crash, is reused
+  for (std::size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].offset != 0) {
+      end_ = std::max(end_, slots_[i].offset + slots_[i].capacity);
+    }
+  }
+}
+
+PageMap::Slot PageMap::find(const PageId page_number) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (page_number < slots_.size()) {
+    return slots_[page_number];
+  }
+  return Slot();
+}
+
+void PageMap::find(const PageId first_page_number, const PageId count,
+                   Slot* slots) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (PageId i = 0; i < count; ++i) {
+    const PageId page_number = first_page_number + i;
+    slots[i] = page_number < slots_.size() ? slots_[page_number] : Slot();
+  }
+}
+
+PageMap::Slot PageMap::place(const PageId page_number,
+                             const std::size_t length) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  const Slot& slot = slots_[page_number];
+  if (slot.offset != 0 && length <= slot.capacity) {
+    return slot;
+  }
+  Slot fresh = Slot();
+  fresh.offset = end_;
+  fresh.capacity = static_cast<std::uint32_t>(align(length));
+  end_ += fresh.capacity;
+  return fresh;
+}
+
+void PageMap::record(const PageId page_number, const Slot& slot,
+                     const Writer& write) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (slots_[page_number] == slot) {
+    return;
+  }
+  // under the mutex, so that reserve() cannot copy the map in between
+  write(offset_ + page_number * sizeof(Slot),
+        reinterpret_cast<const char*>(&slot), sizeof(Slot));
+  slots_[page_number] = slot;
+}
+
+PageId PageMap::reserve(const PageId pages, const Writer& write) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (pages <= slots_.size()) {
+    return slots_.size();
+  }
+  const PageId capacity =
+      std::max(pages, static_cast<PageId>(2 * slots_.size()));
+  std::vector<Slot> slots(slots_);
+  slots.resize(capacity, Slot());
+  const std::uint64_t offset = end_;
+  write(offset, reinterpret_cast<const char*>(&slots[0]),
+        capacity * sizeof(Slot));
+  slots_.swap(slots);
+  offset_ = offset;
+  end_ = align(offset + capacity * sizeof(Slot));
+  return capacity;
+}
+
+void PageMap::reset(const std::uint64_t offset, const std::vector<Slot>& slots,
+                    const std::uint64_t end) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  offset_ = offset;
+  slots_ = slots;
+  end_ = end;
+}
+
+std::uint64_t PageMap::offset() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return offset_;
+}
+
+std::uint64_t PageMap::end() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return end_;
+}
+
+}
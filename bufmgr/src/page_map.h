@@ -0,0 +1,195 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <sys/types.h>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Where each page of a compressed file is stored.
+ *
+ * Compressed pages differ in size, so they do not sit at fixed positions.
+ * Each page has a slot, a run of bytes somewhere after the file header, and
+ * the map holds the slot of every page, indexed by page number.  The map is
+ * kept in memory and written through to an array of slots in the file, whose
+ * offset the file header records.
+ *
+ * A page is rewritten in its slot if it still fits; otherwise it gets a new
+ * slot at the end of the file and the old one stays unused until the file is
+ * compacted.  A page is written to its new slot before the map points to it,
+ * so a crash in between leaves the old copy in place.  When the map runs out
+ * of room it is copied to the end of the file with twice the room.
+ *
+ * One map is shared by all File objects of an open file, through the
+ * FileRegistry.  All methods may be called from several threads.
+ */
+class PageMap {
+ public:
+  /**
+   * Multiple that the offset and capacity of every slot, and the offset of
+   * the map, are rounded up to.  The spare bytes let a page grow a little
+   * without moving.
+   */
+  static const std::size_t ALIGNMENT = 512;
+
+  /**
+   * @brief Place of one page in the file, as stored in the map on disk.
+   */
+  struct Slot {
+    /**
+     * Offset of the stored page in the file; 0 if it was never written.
+     */
+    std::uint64_t offset;
+
+    /**
+     * Number of bytes reserved for the page at <offset>.
+     */
+    std::uint32_t capacity;
+
+    /**
+     * Unused and 0.
+     */
+    std::uint32_t reserved;
+
+    bool operator==(const Slot& rhs) const {
+      return offset == rhs.offset && capacity == rhs.capacity;
+    }
+  };
+
+  /**
+   * Writes bytes at an offset of the file.
+   */
+  typedef std::function<void(off_t, const char*, std::size_t)> Writer;
+
+  /**
+   * Returns the given number of bytes rounded up to ALIGNMENT.
+   */
+  static std::uint64_t align(const std::uint64_t bytes) {
+    return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+
+  /**
+   * Constructs the map of a file as it is stored on disk.
+   *
+   * @param offset  Offset of the map in the file.
+   * @param slots   Slot of every page the map has room for, indexed by page
+   *                number.
+   */
+  PageMap(const std::uint64_t offset, const std::vector<Slot>& slots);
+
+  /**
+   * Returns the slot of a page; one with offset 0 if the page was never
+   * written or the map has no room for it.
+   *
+   * @param page_number Number of the page.
+   */
+  Slot find(const PageId page_number) const;
+
+  /**
+   * Returns the slots of consecutive pages, like find().
+   *
+   * @param first_page_number Number of the first page.
+   * @param count             Number of pages.
+   * @param slots             Array of at least <count> slots to fill.
+   */
+  void find(const PageId first_page_number, const PageId count,
+            Slot* slots) const;
+
+  /**
+   * Returns where to write a page: its own slot if the given number of bytes
+   * fit, otherwise a new slot at the end of the file.  The page keeps its
+   * old slot until record() is called with the new one.
+   *
+   * @param page_number Number of the page; the map must have room for it.
+   * @param length      Number of bytes to store.
+   * @return  Slot to write the bytes to.
+   */
+  Slot place(const PageId page_number, const std::size_t length);
+
+  /**
+   * Makes the given slot, returned by place() and written, the slot of the
+   * page, and writes the change to the map on disk.
+   *
+   * @param page_number Number of the page.
+   * @param slot        New slot of the page.
+   * @param write       Writes to the file.
+   */
+  void record(const PageId page_number, const Slot& slot,
+              const Writer& write);
+
+  /**
+   * Makes room in the map for the given number of pages.  If it has to
+   * grow, the map is copied to the end of the file with room for at least
+   * twice as many pages as before; the file header must then be updated
+   * with offset().
+   *
+   * @param pages   Number of pages to make room for.
+   * @param write   Writes to the file.
+   * @return  Number of pages the map has room for.
+   */
+  PageId reserve(const PageId pages, const Writer& write);
+
+  /**
+   * Replaces the map by one rewritten elsewhere in the file, e.g. by
+   * compaction.
+   *
+   * @param offset  Offset of the new map in the file.
+   * @param slots   Slot of every page the new map has room for.
+   * @param end     End of the last slot or map in the file.
+   */
+  void reset(const std::uint64_t offset, const std::vector<Slot>& slots,
+             const std::uint64_t end);
+
+  /**
+   * Returns the offset of the map in the file.
+   */
+  std::uint64_t offset() const;
+
+  /**
+   * Returns the end of the last slot or map in the file, where new slots
+   * go.
+   */
+  std::uint64_t end() const;
+
+ private:
+  PageMap(const PageMap&);
+  PageMap& operator=(const PageMap&);
+
+  /**
+   * Protects all members below.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Offset of the map in the file.
+   */
+  std::uint64_t offset_;
+
+  /**
+   * Slot of every page the map has room for, as on disk.
+   */
+  std::vector<Slot> slots_;
+
+  /**
+   * End of the last slot or map in the file.
+   */
+  std::uint64_t end_;
+};
+
+static_assert(sizeof(PageMap::Slot) == 16,
+              "Slots must not contain padding.");
+
+}
@@ -0,0 +1,147 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "parallel_scan.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include "page_iterator.h"
+
+namespace badgerdb {
+
+const PageId ParallelScan::DEFAULT_RANGE_PAGES;
+
+ParallelScan::ParallelScan(BufMgr* buf_mgr, File* file,
+                           const unsigned int threads,
+                           const PageId range_pages)
+    : buf_mgr_(buf_mgr),
+      file_(file),
+      threads_(std::max(threads, 1u)),
+      range_pages_(std::max<PageId>(range_pages, 1)),
+      num_pages_(0),
+      queues_(threads_),
+      failed_(false),
+      steals_(0) {
+}
+
+void ParallelScan::forEachRecord(const RecordCallback& callback) {
+  run([&callback](unsigned int, Page& page) {
+    for (PageIterator iter = page.begin(); iter != page.end(); ++iter) {
+      callback(*iter);
+    }
+  });
+}
+
+std::uint64_t ParallelScan::countIf(const RecordPredicate& predicate) {
+  std::vector<Counter, CacheAlignedAllocator<Counter> > counters(threads_);
+  run([&predicate, &counters](unsigned int worker, Page& page) {
+    for (PageIterator iter = page.begin(); iter != page.end(); ++iter) {
+      if (predicate(*iter)) {
+        ++counters[worker].count;
+      }
+    }
+  });
+
+  std::uint64_t count = 0;
+  for (const Counter& counter : counters) {
+    count += counter.count;
+  }
+  return count;
+}
+
+void ParallelScan::run(const PageVisitor& visit) {
+  // Pages changed in the pool are read from the file below.
+  if (buf_mgr_ != NULL) {
+    buf_mgr_->cleanFile(file_);
+  }
+  // Page 0 holds the file header, so the ranges start at page 1.
+  num_pages_ = file_->pageCount();
+  const PageId ranges = (num_pages_ - 1 + range_pages_ - 1) / range_pages_;
+  for (unsigned int i = 0; i < threads_; ++i) {
+    queues_[i].next = static_cast<std::uint64_t>(ranges) * i / threads_;
+    queues_[i].end = static_cast<std::uint64_t>(ranges) * (i + 1) / threads_;
+  }
+  failed_ = false;
+  steals_ = 0;
+
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  std::vector<std::thread> workers;
+  for (unsigned int i = 0; i < threads_; ++i) {
+    workers.push_back(std::thread([this, i, &visit, &error, &error_mutex]() {
+      try {
+        work(i, visit);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        failed_ = true;
+      }
+    }));
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void ParallelScan::work(const unsigned int worker, const PageVisitor& visit) {
+  std::vector<Page> pages(range_pages_);
+  PageId range;
+  while (!failed_ && takeRange(worker, range)) {
+    const PageId first = 1 + range * range_pages_;
+    const PageId count = std::min(range_pages_, num_pages_ - first);
+    file_->readPages(first, count, &pages[0]);
+    for (PageId i = 0; i < count; ++i) {
+      // Free pages have no page number.
+      if (pages[i].page_number() != Page::INVALID_NUMBER) {
+        visit(worker, pages[i]);
+      }
+    }
+  }
+}
+
+bool ParallelScan::takeRange(const unsigned int worker, PageId& range) {
+  WorkQueue& own = queues_[worker];
+  {
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.next < own.end) {
+      range = own.next++;
+      return true;
+    }
+  }
+
+  // Steal the back half of the ranges of the next worker that has any; the
+  // first of them is taken right away, the rest go to our own queue.
+  for (unsigned int i = 1; i < threads_; ++i) {
+    WorkQueue& victim = queues_[(worker + i) % threads_];
+    PageId first;
+    PageId end;
+    {
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (victim.next >= victim.end) {
+        continue;
+      }
+      first = victim.next + (victim.end - victim.next) / 2;
+      end = victim.end;
+      victim.end = first;
+    }
+    ++steals_;
+    range = first;
+    std::lock_guard<std::mutex> lock(own.mutex);
+    own.next = first + 1;
+    own.end = end;
+    return true;
+  }
+  return false;
+}
+
+}
@@ -0,0 +1,197 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "cache_aligned_allocator.h"
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Scan of all records of a file by several threads.
+ *
+ * The pages of the file are cut into ranges of consecutive pages, and every
+ * worker thread starts with an equal share of the ranges.  A worker reads
+ * one range at a time with File::readPages() and visits the records of its
+ * used pages with a PageIterator.  A worker that runs out of ranges steals
+ * half of the ranges another worker has left, so that pages that are slow
+ * to process do not hold up the scan.
+ *
+ * Records are visited in no particular order.  The scan reads the file
+ * directly, after writing out the pages of the file that are dirty in the
+ * buffer pool it is given; the file must not be modified during the scan.
+ */
+class ParallelScan {
+ public:
+  /**
+   * Function called for each record.  It is called from several threads at
+   * once.
+   */
+  typedef std::function<void(const std::string&)> RecordCallback;
+
+  /**
+   * Function deciding whether a record matches.  It is called from several
+   * threads at once.
+   */
+  typedef std::function<bool(const std::string&)> RecordPredicate;
+
+  /**
+   * Number of pages in a range if none is given.
+   */
+  static const PageId DEFAULT_RANGE_PAGES = 64;
+
+  /**
+   * Prepares a scan of the file.
+   *
+   * @param buf_mgr     Buffer manager the file is read through, whose dirty
+   *                    pages of the file each scan writes out first; NULL if
+   *                    the file is not read through one.
+   * @param file        File to scan.
+   * @param threads     Number of worker threads; at least one.
+   * @param range_pages Number of pages in a range; at least one.
+   */
+  ParallelScan(BufMgr* buf_mgr, File* file, const unsigned int threads,
+               const PageId range_pages = DEFAULT_RANGE_PAGES);
+
+  /**
+   * Calls the callback for every record of every used page in the file.
+   *
+   * @param callback  Function to call.
+   * @throws  FileIOException  If the file cannot be read.  Exceptions thrown
+   *                           by the callback are passed on as well.
+   */
+  void forEachRecord(const RecordCallback& callback);
+
+  /**
+   * Counts the records of the file that match the predicate.
+   *
+   * @param predicate Function deciding whether a record matches.
+   * @return  Number of matching records.
+   * @throws  FileIOException  If the file cannot be read.  Exceptions thrown
+   *                           by the predicate are passed on as well.
+   */
+  std::uint64_t countIf(const RecordPredicate& predicate);
+
+  /**
+   * Returns the number of times a worker stole ranges during the last scan.
+   */
+  std::uint64_t steals() const { return steals_; }
+
+ private:
+  /**
+   * @brief Ranges not yet taken by a worker, [next, end).
+   */
+  struct alignas(CACHE_LINE_SIZE) WorkQueue {
+    /**
+     * Protects next and end.  The owner takes ranges from the front, thieves
+     * from the back.
+     */
+    std::mutex mutex;
+
+    /**
+     * Index of the next range to take.
+     */
+    PageId next;
+
+    /**
+     * Index after the last range.
+     */
+    PageId end;
+  };
+
+  /**
+   * @brief Record count of a worker, on a cache line of its own.
+   */
+  struct alignas(CACHE_LINE_SIZE) Counter {
+    /**
+     * Records counted.
+     */
+    std::uint64_t count;
+  };
+
+  /**
+   * Function visiting a used page; gets the worker number and the page.
+   */
+  typedef std::function<void(unsigned int, Page&)> PageVisitor;
+
+  /**
+   * Runs the workers over the whole file.
+   *
+   * @param visit   Function called for every used page.
+   */
+  void run(const PageVisitor& visit);
+
+  /**
+   * Body of a worker thread: takes ranges until there are none left.
+   *
+   * @param worker  Worker number.
+   * @param visit   Function called for every used page.
+   */
+  void work(const unsigned int worker, const PageVisitor& visit);
+
+  /**
+   * Takes the next range of a worker, stealing ranges from another worker
+   * if it has none left.
+   *
+   * @param worker  Worker number.
+   * @param range   Index of the range taken is returned via this reference.
+   * @return  False if no ranges are left anywhere.
+   */
+  bool takeRange(const unsigned int worker, PageId& range);
+
+  /**
+   * Buffer manager the file is read through, or NULL.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * File being scanned.
+   */
+  File* file_;
+
+  /**
+   * Number of worker threads.
+   */
+  unsigned int threads_;
+
+  /**
+   * Number of pages in a range.
+   */
+  PageId range_pages_;
+
+  /**
+   * Number of pages in the file when the scan started.
+   */
+  PageId num_pages_;
+
+  /**
+   * One queue of ranges per worker.
+   */
+  std::vector<WorkQueue, CacheAlignedAllocator<WorkQueue> > queues_;
+
+  /**
+   * Set when a worker failed, so that the others stop.
+   */
+  std::atomic<bool> failed_;
+
+  /**
+   * Number of steals during the current scan.
+   */
+  std::atomic<std::uint64_t> steals_;
+};
+
+}
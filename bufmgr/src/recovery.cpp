@@ -0,0 +1,344 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "recovery.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <utility>
+
+#include "exceptions/file_io_exception.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+const std::size_t Recovery::REDO_BATCH;
+const std::size_t Recovery::QUEUED_BATCHES;
+
+Recovery::Recovery(BufMgr* buf_mgr, LogManager* log,
+                   const unsigned int threads)
+    : buf_mgr_(buf_mgr),
+      log_(log),
+      threads_(std::max(threads, 1u)),
+      failed_(false),
+      redo_lsn_(0),
+      analyzed_records_(0),
+      redone_records_(0),
+      skipped_records_(0),
+      undone_records_(0) {
+}
+
+void Recovery::recover() {
+  buf_mgr_->setLogManager(log_);
+  analyze();
+  redo();
+  undo();
+
+  // Make the compensation records durable, then write back what recovery
+  // changed; this also drops the frames that refer to files_.
+  log_->flush(log_->nextLsn() - 1);
+  for (std::map<std::string, File>::iterator it = files_.begin();
+       it != files_.end(); ++it) {
+    buf_mgr_->flushFile(&it->second);
+  }
+  files_.clear();
+}
+
+void Recovery::analyze() {
+  Lsn start = LogManager::FIRST_LSN;
+  Lsn checkpoint = log_->checkpointLsn();
+  LogManager::LogRecord record;
+  if (checkpoint != 0) {
+    if (log_->read(checkpoint, record) &&
+        record.type == LogManager::CHECKPOINT) {
+      start = std::max(record.checkpoint_start, LogManager::FIRST_LSN);
+    } else {
+      checkpoint = 0;
+    }
+  }
+
+  LogManager::Reader reader(*log_, start);
+  while (reader.next(record)) {
+    analyzed_records_++;
+    switch (record.type) {
+      case LogManager::UPDATE:
+      case LogManager::COMPENSATION:
+        // The first record of a page since the checkpoint started is the
+        // oldest that may be missing from it, unless the checkpoint knows
+        // an older one.
+        dirty_pages_.insert(std::make_pair(
+            PageKey(record.filename, record.page_number), record.lsn));
+        losers_[record.txn] = record.lsn;
+        break;
+      case LogManager::COMMIT:
+      case LogManager::ABORT:
+        losers_.erase(record.txn);
+        break;
+      case LogManager::CHECKPOINT:
+        if (record.lsn != checkpoint) {
+          break;
+        }
+        // The checkpoint knows the transactions exactly as of its record;
+        // what was read before it is replaced.
+        losers_.clear();
+        losers_.insert(record.transactions.begin(), record.transactions.end());
+        for (std::size_t i = 0; i < record.dirty_pages.size(); i++) {
+          const LogManager::DirtyPage& page = record.dirty_pages[i];
+          const Lsn rec_lsn = std::max(page.rec_lsn, LogManager::FIRST_LSN);
+          std::pair<std::map<PageKey, Lsn>::iterator, bool> inserted =
+              dirty_pages_.insert(std::make_pair(
+                  PageKey(page.filename, page.page_number), rec_lsn));
+          if (!inserted.second && rec_lsn < inserted.first->second) {
+            inserted.first->second = rec_lsn;
+          }
+        }
+        break;
+    }
+  }
+
+  for (std::map<PageKey, Lsn>::const_iterator it = dirty_pages_.begin();
+       it != dirty_pages_.end(); ++it) {
+    if (redo_lsn_ == 0 || it->second < redo_lsn_) {
+      redo_lsn_ = it->second;
+    }
+    fileOf(it->first.first, true /* open */);
+  }
+}
+
+void Recovery::redo() {
+  if (dirty_pages_.empty()) {
+    return;
+  }
+
+  failed_ = false;
+  std::vector<RedoQueue> queues(threads_);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  std::vector<std::thread> workers;
+  for (unsigned int i = 0; i < threads_; ++i) {
+    RedoQueue* queue = &queues[i];
+    queue->done = false;
+    workers.push_back(std::thread([this, queue, &error, &error_mutex]() {
+      try {
+        redoWorker(queue);
+      } catch (...) {
+        {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+        failed_ = true;
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->cv.notify_all();
+      }
+    }));
+  }
+  std::thread prefetcher(&Recovery::prefetch, this);
+
+  // Hand the records of each page to its worker in log order.
+  std::vector<std::vector<LogManager::LogRecord> > pending(threads_);
+  std::function<void(const std::size_t)> hand = [&](const std::size_t worker) {
+    RedoQueue& queue = queues[worker];
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    queue.cv.wait(lock, [this, &queue]() {
+      return queue.batches.size() < QUEUED_BATCHES || failed_;
+    });
+    queue.batches.push_back(std::vector<LogManager::LogRecord>());
+    queue.batches.back().swap(pending[worker]);
+    queue.cv.notify_all();
+  };
+  LogManager::Reader reader(*log_, redo_lsn_);
+  LogManager::LogRecord record;
+  while (!failed_ && reader.next(record)) {
+    if (record.type != LogManager::UPDATE &&
+        record.type != LogManager::COMPENSATION) {
+      continue;
+    }
+    std::map<PageKey, Lsn>::const_iterator page =
+        dirty_pages_.find(PageKey(record.filename, record.page_number));
+    if (page == dirty_pages_.end() || record.lsn < page->second) {
+      continue;
+    }
+    const std::size_t worker = workerOf(record.filename, record.page_number);
+    pending[worker].push_back(std::move(record));
+    if (pending[worker].size() == REDO_BATCH) {
+      hand(worker);
+    }
+  }
+  for (unsigned int i = 0; i < threads_; ++i) {
+    if (!pending[i].empty() && !failed_) {
+      hand(i);
+    }
+    std::lock_guard<std::mutex> lock(queues[i].mutex);
+    queues[i].done = true;
+    queues[i].cv.notify_all();
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  prefetcher.join();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void Recovery::redoWorker(RedoQueue* queue) {
+  for (;;) {
+    std::vector<LogManager::LogRecord> batch;
+    {
+      std::unique_lock<std::mutex> lock(queue->mutex);
+      queue->cv.wait(lock, [queue]() {
+        return !queue->batches.empty() || queue->done;
+      });
+      if (queue->batches.empty()) {
+        return;
+      }
+      batch.swap(queue->batches.front());
+      queue->batches.pop_front();
+      queue->cv.notify_all();
+    }
+    for (std::size_t i = 0; i < batch.size() && !failed_; i++) {
+      redoRecord(batch[i]);
+    }
+  }
+}
+
+void Recovery::redoRecord(const LogManager::LogRecord& record) {
+  File* file = fileOf(record.filename, false /* open */);
+  if (file == NULL) {
+    skipped_records_++;
+    return;
+  }
+  Page* page;
+  try {
+    buf_mgr_->readPage(file, record.page_number, page);
+  } catch (const InvalidPageException&) {
+    // The page has been deleted since.
+    skipped_records_++;
+    return;
+  }
+  if (page->lsn() < record.lsn) {
+    LogManager::apply(record, false /* undo */, page);
+    page->set_lsn(record.lsn);
+    buf_mgr_->unPinPage(file, record.page_number, true);
+    redone_records_++;
+  } else {
+    buf_mgr_->unPinPage(file, record.page_number, false);
+    skipped_records_++;
+  }
+}
+
+void Recovery::prefetch() {
+  // Only a hint: the workers read whatever is not here yet themselves.
+  const std::size_t limit = buf_mgr_->frameCount() / 2;
+  std::size_t count = 0;
+  for (std::map<PageKey, Lsn>::const_iterator it = dirty_pages_.begin();
+       it != dirty_pages_.end() && count < limit && !failed_; ++it) {
+    File* file = fileOf(it->first.first, false /* open */);
+    if (file == NULL) {
+      continue;
+    }
+    try {
+      Page* page;
+      buf_mgr_->readPage(file, it->first.second, page);
+      buf_mgr_->unPinPage(file, it->first.second, false);
+      count++;
+    } catch (const InvalidPageException&) {
+    } catch (...) {
+      return;
+    }
+  }
+}
+
+void Recovery::undo() {
+  // Undo continues each loser's chain of records, as if the loser had
+  // logged the compensation records itself.
+  std::priority_queue<std::pair<Lsn, TxnId> > next;
+  {
+    std::lock_guard<std::mutex> lock(log_->mutex_);
+    for (std::map<TxnId, Lsn>::const_iterator it = losers_.begin();
+         it != losers_.end(); ++it) {
+      log_->last_lsn_[it->first] = it->second;
+    }
+  }
+  for (std::map<TxnId, Lsn>::const_iterator it = losers_.begin();
+       it != losers_.end(); ++it) {
+    if (it->second == 0) {
+      log_->logAbort(it->first);
+    } else {
+      next.push(std::make_pair(it->second, it->first));
+    }
+  }
+
+  // Newest record first across all losers, so that each page goes back
+  // through its states in reverse.
+  LogManager::LogRecord record;
+  while (!next.empty()) {
+    const Lsn lsn = next.top().first;
+    const TxnId txn = next.top().second;
+    next.pop();
+    if (!log_->read(lsn, record) || record.txn != txn) {
+      throw FileIOException(log_->filename(), "read log", EIO);
+    }
+    Lsn undo_next = record.prev_lsn;
+    if (record.type == LogManager::UPDATE) {
+      undoRecord(record);
+      undone_records_++;
+    } else if (record.type == LogManager::COMPENSATION) {
+      undo_next = record.undo_next_lsn;
+    }
+    if (undo_next == 0) {
+      log_->logAbort(txn);
+    } else {
+      next.push(std::make_pair(undo_next, txn));
+    }
+  }
+}
+
+void Recovery::undoRecord(const LogManager::LogRecord& record) {
+  File* file = fileOf(record.filename, true /* open */);
+  if (file == NULL) {
+    return;
+  }
+  Page* page;
+  try {
+    buf_mgr_->readPage(file, record.page_number, page);
+  } catch (const InvalidPageException&) {
+    return;
+  }
+  const Page before = *page;
+  LogManager::apply(record, true /* undo */, page);
+  log_->logCompensation(record.txn, file, before, page, record.prev_lsn);
+  buf_mgr_->unPinPage(file, record.page_number, true);
+}
+
+File* Recovery::fileOf(const std::string& filename, const bool open) {
+  std::map<std::string, File>::iterator it = files_.find(filename);
+  if (it != files_.end()) {
+    return &it->second;
+  }
+  if (!open || !File::exists(filename)) {
+    return NULL;
+  }
+  return &files_.insert(std::make_pair(filename, File::open(filename)))
+              .first->second;
+}
+
+std::size_t Recovery::workerOf(const std::string& filename,
+                               const PageId page_number) const {
+  const std::uint64_t hash = std::hash<std::string>()(filename) ^
+                             (page_number * 0x9e3779b97f4a7c15ULL);
+  return (hash ^ (hash >> 32)) % threads_;
+}
+
+}
@@ -0,0 +1,222 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "buffer.h"
+#include "file.h"
+#include "log_manager.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Brings the files of a write-ahead log back to a consistent state
+ *        after a crash, in the three passes of ARIES.
+ *
+ * Analysis reads the log from the last checkpoint on, and finds the pages
+ * that may have been dirty at the crash, each with the LSN from which on
+ * its updates may be missing on disk, and the transactions that neither
+ * committed nor were rolled back (the losers).
+ *
+ * Redo reads the log from the oldest of those LSNs on and repeats every
+ * update and compensation record of a dirty page whose LSN is newer than
+ * that of the page, through the buffer pool.  The records are partitioned
+ * by page across worker threads, so that the updates of one page are
+ * repeated in log order by one thread while different pages are repeated in
+ * parallel.  Meanwhile another thread reads the dirty pages into the buffer
+ * pool in file and page order, as far as half of the pool allows, so that
+ * the workers mostly find their pages there.
+ *
+ * Undo rolls back the losers, newest update first, logging a compensation
+ * record for each undone update and an abort record at the end of each
+ * transaction; a crash during undo therefore never undoes an update twice.
+ *
+ * Finally the log is flushed and the pages changed by recovery are written
+ * back, so that the next crash starts from a clean state.
+ *
+ * Updates are physical: a record holds the bytes of a page before and after
+ * the change.  Undoing a loser restores its bytes, so two transactions must
+ * not have changed the same bytes at once; that is up to the caller.  The
+ * structure of the files themselves (allocated and deleted pages) is not
+ * logged: records of pages that no longer exist are skipped.
+ */
+class Recovery {
+ public:
+  /**
+   * Records handed to a redo worker at a time.
+   */
+  static const std::size_t REDO_BATCH = 64;
+
+  /**
+   * Batches a redo worker may have queued before the log reader waits.
+   */
+  static const std::size_t QUEUED_BATCHES = 16;
+
+  /**
+   * Prepares recovery of the files of a log.
+   *
+   * @param buf_mgr   Buffer manager to repeat updates through; it is set to
+   *                  enforce the log.  No pages of the files may be pinned.
+   * @param log       Write-ahead log, opened after the crash.
+   * @param threads   Number of redo worker threads; at least one.
+   */
+  Recovery(BufMgr* buf_mgr, LogManager* log, const unsigned int threads);
+
+  /**
+   * Runs analysis, redo and undo.
+   *
+   * @throws  FileIOException  If a file or the log cannot be read or
+   *                           written.
+   */
+  void recover();
+
+  /**
+   * Returns the LSN redo started at; 0 if there was nothing to redo.
+   */
+  Lsn redoLsn() const { return redo_lsn_; }
+
+  /**
+   * Returns the number of records analysis read.
+   */
+  std::uint64_t analyzedRecords() const { return analyzed_records_; }
+
+  /**
+   * Returns the number of pages analysis found possibly dirty.
+   */
+  std::size_t dirtyPages() const { return dirty_pages_.size(); }
+
+  /**
+   * Returns the number of records redo repeated.
+   */
+  std::uint64_t redoneRecords() const { return redone_records_; }
+
+  /**
+   * Returns the number of records redo skipped because their pages already
+   * held them or no longer exist.
+   */
+  std::uint64_t skippedRecords() const { return skipped_records_; }
+
+  /**
+   * Returns the number of transactions rolled back.
+   */
+  std::size_t losers() const { return losers_.size(); }
+
+  /**
+   * Returns the number of updates undone.
+   */
+  std::uint64_t undoneRecords() const { return undone_records_; }
+
+ private:
+  Recovery(const Recovery&);
+  Recovery& operator=(const Recovery&);
+
+  /**
+   * A page of a file.
+   */
+  typedef std::pair<std::string, PageId> PageKey;
+
+  /**
+   * Records waiting for a redo worker.
+   */
+  struct RedoQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::vector<LogManager::LogRecord> > batches;
+    bool done;
+  };
+
+  /**
+   * Finds the dirty pages, the losers and the LSN to redo from.
+   */
+  void analyze();
+
+  /**
+   * Repeats the updates of the dirty pages.
+   */
+  void redo();
+
+  /**
+   * Rolls back the losers.
+   */
+  void undo();
+
+  /**
+   * Reads the dirty pages into the buffer pool in page order.
+   */
+  void prefetch();
+
+  /**
+   * Repeats the records queued for a redo worker.
+   */
+  void redoWorker(RedoQueue* queue);
+
+  /**
+   * Repeats one record if its page does not hold it yet.
+   */
+  void redoRecord(const LogManager::LogRecord& record);
+
+  /**
+   * Undoes one update of a loser.
+   */
+  void undoRecord(const LogManager::LogRecord& record);
+
+  /**
+   * Returns the open file with the given name, opening it if <open> is set;
+   * NULL if it does not exist.
+   */
+  File* fileOf(const std::string& filename, const bool open);
+
+  /**
+   * Returns the redo worker of a page.
+   */
+  std::size_t workerOf(const std::string& filename,
+                       const PageId page_number) const;
+
+  BufMgr* buf_mgr_;
+  LogManager* log_;
+  unsigned int threads_;
+
+  /**
+   * Files of the log's pages, opened while recovery runs.
+   */
+  std::map<std::string, File> files_;
+
+  /**
+   * Pages possibly dirty at the crash, in file and page order, with the LSN
+   * from which on their updates may be missing.
+   */
+  std::map<PageKey, Lsn> dirty_pages_;
+
+  /**
+   * Transactions to roll back, with the LSN of their last record.
+   */
+  std::map<TxnId, Lsn> losers_;
+
+  /**
+   * Set when a redo worker fails.
+   */
+  std::atomic<bool> failed_;
+
+  Lsn redo_lsn_;
+  std::uint64_t analyzed_records_;
+  std::atomic<std::uint64_t> redone_records_;
+  std::atomic<std::uint64_t> skipped_records_;
+  std::uint64_t undone_records_;
+};
+
+}
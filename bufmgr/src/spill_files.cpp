@@ -0,0 +1,102 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "spill_files.h"
+
+namespace badgerdb {
+
+SpillFiles::Writer::Writer(const std::string& filename,
+                           const std::vector<Page*>& frames)
+    : filename_(filename),
+      file_(File::create(filename)),
+      frames_(frames),
+      current_(0),
+      pages_(0) {
+  *frames_[0] = Page();
+}
+
+void SpillFiles::Writer::add(const char* data, const std::size_t length) {
+  Page* page = frames_[current_];
+  scratch_.assign(data, length);
+  if (!page->hasSpaceForRecord(scratch_)) {
+    if (++current_ == frames_.size()) {
+      flush(current_);
+    }
+    page = frames_[current_];
+    *page = Page();
+  }
+  page->insertRecord(scratch_);
+}
+
+SpillFiles::Spill SpillFiles::Writer::finish() {
+  flush(frames_[current_]->slotCount() > 0 ? current_ + 1 : current_);
+  const Spill spill = {filename_, pages_};
+  return spill;
+}
+
+void SpillFiles::Writer::flush(const std::size_t count) {
+  file_.appendPages(count, &frames_[0]);
+  pages_ += count;
+  current_ = 0;
+}
+
+void SpillFiles::collect(Page* const* pages, const PageId count,
+                         const PageFilter& filter,
+                         std::vector<Record>& records) {
+  for (PageId i = 0; i < count; ++i) {
+    const Page* page = pages[i];
+    if (!page->isUsed() || (filter && !filter(page->page_number()))) {
+      continue;
+    }
+    Record record;
+    for (SlotId slot_number = 1; slot_number <= page->slotCount();
+         ++slot_number) {
+      if (page->getRecordBytes(slot_number, record.data, record.length)) {
+        records.push_back(record);
+      }
+    }
+  }
+}
+
+SpillFiles::SpillFiles()
+    : count_(0) {
+}
+
+void SpillFiles::reset(const std::string& prefix) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  prefix_ = prefix;
+  count_ = 0;
+}
+
+std::string SpillFiles::next() {
+  std::string name;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    name = filename(count_++);
+  }
+  // Left over by an operator that did not finish.
+  if (File::exists(name)) {
+    File::remove(name);
+  }
+  return name;
+}
+
+void SpillFiles::removeAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (std::uint32_t i = 0; i < count_; ++i) {
+    const std::string name = filename(i);
+    if (File::exists(name) && !File::isOpen(name)) {
+      File::remove(name);
+    }
+  }
+}
+
+std::string SpillFiles::filename(const std::uint32_t number) const {
+  return prefix_ + std::to_string(number);
+}
+
+}
@@ -0,0 +1,148 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Temporary files an operator spills records to, such as the runs of
+ *        ExternalSort and the partitions of HashJoin.
+ *
+ * The files of one operator are named after a prefix and numbered in the
+ * order they are created, so that those left over by an operator that did
+ * not finish are removed when the names come round again, and all of them
+ * can be removed after a failure.  Records are written through frames the
+ * operator owns and read back a block of pages at a time.
+ */
+class SpillFiles {
+ public:
+  /**
+   * Returns true if the page with the given number holds records to read.
+   */
+  typedef std::function<bool(const PageId page_number)> PageFilter;
+
+  /**
+   * A record inside a frame.
+   */
+  struct Record {
+    const char* data;
+    std::size_t length;
+  };
+
+  /**
+   * A file records were spilled to.
+   */
+  struct Spill {
+    std::string filename;
+    PageId pages;
+  };
+
+  /**
+   * Writes records to a new spill file, through frames of the caller.
+   */
+  class Writer {
+   public:
+    /**
+     * Creates the file.
+     *
+     * @param filename  Name of the file.
+     * @param frames    Frames to write from.
+     */
+    Writer(const std::string& filename, const std::vector<Page*>& frames);
+
+    /**
+     * Appends a record.
+     */
+    void add(const char* data, const std::size_t length);
+
+    /**
+     * Writes the frames not written yet and returns the spill.
+     */
+    Spill finish();
+
+   private:
+    /**
+     * Appends the filled frames to the file.
+     */
+    void flush(const std::size_t count);
+
+    std::string filename_;
+    File file_;
+    std::vector<Page*> frames_;
+    std::size_t current_;
+    PageId pages_;
+    std::string scratch_;
+  };
+
+  /**
+   * Appends the records of the used pages among the given ones that the
+   * filter accepts.
+   *
+   * @param pages   Pages to collect the records of.
+   * @param count   Number of pages.
+   * @param filter  Pages to collect; every used one if empty.
+   * @param records Receives the records, which point into the pages.
+   */
+  static void collect(Page* const* pages, const PageId count,
+                      const PageFilter& filter, std::vector<Record>& records);
+
+  SpillFiles();
+
+  /**
+   * Starts naming files after a new prefix, from number 0.
+   */
+  void reset(const std::string& prefix);
+
+  /**
+   * Returns the name of a new file, removing a file of that name left over
+   * by an earlier run.  May be called from several threads at once.
+   */
+  std::string next();
+
+  /**
+   * Removes the files named since the last reset() that exist and are not
+   * open.
+   */
+  void removeAll();
+
+ private:
+  SpillFiles(const SpillFiles&);
+  SpillFiles& operator=(const SpillFiles&);
+
+  /**
+   * Returns the name of the file with the given number.
+   */
+  std::string filename(const std::uint32_t number) const;
+
+  /**
+   * Prefix of the names.
+   */
+  std::string prefix_;
+
+  /**
+   * Number of files named so far.
+   */
+  std::uint32_t count_;
+
+  /**
+   * Protects count_.
+   */
+  std::mutex mutex_;
+};
+
+}
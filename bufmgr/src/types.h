@@ -6,8 +6,16 @@
  */
 #pragma once
 //#include <cstdint>
+#include <cstddef>
 namespace badgerdb {
 
+/**
+ * @brief Size of a processor cache line.  Data updated by different threads is
+ * aligned to it, so that an update by one thread does not invalidate the
+ * cache line of its neighbours.
+ */
+const std::size_t CACHE_LINE_SIZE = 64;
+
 /**
  * @brief Identifier for a page in a file.
  */
@@ -23,6 +31,21 @@ typedef std::uint16_t SlotId;
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Identifier for an open file, handed out by FileRegistry.
+ */
+typedef std::uint32_t FileId;
+
+/**
+ * @brief Log sequence number: the offset of a record in the write-ahead log.
+ */
+typedef std::uint64_t Lsn;
+
+/**
+ * @brief Identifier for a transaction, handed out by LogManager.
+ */
+typedef std::uint64_t TxnId;
+
 /**
  * @brief Identifier for a record in a page.
  */
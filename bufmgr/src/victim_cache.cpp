@@ -0,0 +1,148 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "victim_cache.h"
+
+#include <cstring>
+
+#include "lz_codec.h"
+
+namespace badgerdb {
+
+VictimCache::VictimCache(const std::size_t capacity)
+    : capacity_(capacity),
+      last_ticket_(0),
+      size_(0) {
+}
+
+std::size_t VictimCache::put(const FileId file, const PageId page_number,
+                             const Page& page) {
+  return fill(reserve(file, page_number), file, page_number, page);
+}
+
+std::uint64_t VictimCache::reserve(const FileId file,
+                                   const PageId page_number) {
+  const std::uint64_t key = keyOf(file, page_number);
+  std::lock_guard<std::mutex> lock(mutex_);
+  eraseKey(key);
+  entries_.push_front(Entry());
+  entries_.front().key = key;
+  entries_.front().ticket = ++last_ticket_;
+  entries_.front().pending = true;
+  index_[key] = entries_.begin();
+  return last_ticket_;
+}
+
+std::size_t VictimCache::fill(const std::uint64_t ticket, const FileId file,
+                              const PageId page_number, const Page& page) {
+  char buffer[Page::SIZE];
+  page.copyTo(buffer);
+  // At most one byte short of a page, so that Page::SIZE bytes mark a page
+  // kept as it is.
+  char packed[Page::SIZE - 1];
+  const std::size_t length =
+      LzCodec::compress(buffer, Page::SIZE, packed, sizeof(packed));
+  const std::size_t stored = length > 0 ? length : Page::SIZE;
+
+  const std::uint64_t key = keyOf(file, page_number);
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::map<std::uint64_t, EntryList::iterator>::iterator position =
+      index_.find(key);
+  if (position == index_.end() || position->second->ticket != ticket) {
+    return stored;
+  }
+  drop(position);
+  while (size_ + stored > capacity_ && !entries_.empty()) {
+    drop(index_.find(entries_.back().key));
+  }
+  if (stored > capacity_) {
+    return stored;
+  }
+
+  entries_.push_front(Entry());
+  entries_.front().key = key;
+  entries_.front().ticket = ticket;
+  entries_.front().pending = false;
+  entries_.front().bytes.assign(length > 0 ? packed : buffer, stored);
+  index_[key] = entries_.begin();
+  size_ += stored;
+  return stored;
+}
+
+bool VictimCache::take(const FileId file, const PageId page_number,
+                       Page& page) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::map<std::uint64_t, EntryList::iterator>::iterator position =
+      index_.find(keyOf(file, page_number));
+  if (position == index_.end()) {
+    return false;
+  }
+  // a page still being compressed is read from its file, and the copy in
+  // the making is not stored
+  if (position->second->pending) {
+    drop(position);
+    return false;
+  }
+  const std::string& bytes = position->second->bytes;
+  char buffer[Page::SIZE];
+  bool valid = true;
+  if (bytes.size() == Page::SIZE) {
+    std::memcpy(buffer, bytes.data(), Page::SIZE);
+  } else {
+    valid = LzCodec::decompress(bytes.data(), bytes.size(), buffer,
+                                Page::SIZE);
+  }
+  // a page found goes back into a frame, one that fails to decompress is
+  // read from its file instead
+  drop(position);
+  if (!valid) {
+    return false;
+  }
+  page.copyFrom(buffer);
+  return true;
+}
+
+void VictimCache::erase(const FileId file, const PageId page_number) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  eraseKey(keyOf(file, page_number));
+}
+
+void VictimCache::eraseFile(const FileId file) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::uint64_t, EntryList::iterator>::iterator position =
+      index_.lower_bound(keyOf(file, 0));
+  while (position != index_.end() && (position->first >> 32) == file) {
+    drop(position++);
+  }
+}
+
+std::size_t VictimCache::pages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.size();
+}
+
+std::size_t VictimCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+void VictimCache::eraseKey(const std::uint64_t key) {
+  const std::map<std::uint64_t, EntryList::iterator>::iterator position =
+      index_.find(key);
+  if (position != index_.end()) {
+    drop(position);
+  }
+}
+
+void VictimCache::drop(
+    const std::map<std::uint64_t, EntryList::iterator>::iterator& position) {
+  size_ -= position->second->bytes.size();
+  entries_.erase(position->second);
+  index_.erase(position);
+}
+
+}
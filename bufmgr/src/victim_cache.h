@@ -0,0 +1,214 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Second tier of the buffer pool: pages evicted from it, kept
+ *        compressed in memory.
+ *
+ * BufMgr puts the pages the clock evicts into the cache, compressed with
+ * LzCodec, and looks a page up there before reading it from its file.  A
+ * page found is taken out again, since it goes back into a frame.  For
+ * compressible pages the cache holds several times as many pages as frames
+ * of the same memory would.
+ *
+ * The cache holds at most its capacity in compressed bytes; the pages put
+ * longest ago make room for new ones.  Pages are looked up through a map
+ * ordered by file and page number, so the pages of one file are dropped
+ * without visiting the others.
+ *
+ * The cache is thread-safe.  Compressing a page takes much longer than the
+ * rest of a put, so it can be split in two: reserve() claims the place of
+ * the page and returns a ticket, and fill() compresses the page without any
+ * lock and stores it only if the ticket is still good, i.e. the page was
+ * not reserved again, taken or dropped in between.  BufMgr reserves while
+ * it holds its mapping latch and fills after releasing it.  A page reserved
+ * but not filled yet is not found by take().
+ */
+class VictimCache {
+ public:
+  /**
+   * Constructs an empty cache.
+   *
+   * @param capacity  Number of compressed bytes the cache may hold.
+   */
+  explicit VictimCache(const std::size_t capacity);
+
+  /**
+   * Puts a page into the cache, in place of any copy it holds already.
+   * Pages put longest ago are dropped until the page fits.
+   *
+   * @param file        Id of the file of the page.
+   * @param page_number Number of the page.
+   * @param page        The page.
+   * @return  Number of bytes the page takes compressed; Page::SIZE if it
+   *          does not compress.
+   */
+  std::size_t put(const FileId file, const PageId page_number,
+                  const Page& page);
+
+  /**
+   * Claims the place of a page in the cache, dropping any copy it holds
+   * already, for fill() to store the page in.
+   *
+   * @param file        Id of the file of the page.
+   * @param page_number Number of the page.
+   * @return  Ticket to hand to fill().
+   */
+  std::uint64_t reserve(const FileId file, const PageId page_number);
+
+  /**
+   * Compresses a page reserved with reserve() and stores it, unless the page
+   * was reserved again, taken or dropped since.  Pages put longest ago are
+   * dropped until the page fits.
+   *
+   * @param ticket      Ticket returned by reserve().
+   * @param file        Id of the file of the page.
+   * @param page_number Number of the page.
+   * @param page        The page.
+   * @return  Number of bytes the page takes compressed; Page::SIZE if it
+   *          does not compress.
+   */
+  std::size_t fill(const std::uint64_t ticket, const FileId file,
+                   const PageId page_number, const Page& page);
+
+  /**
+   * Takes a page out of the cache.
+   *
+   * @param file        Id of the file of the page.
+   * @param page_number Number of the page.
+   * @param page        Set to the page if the cache holds it.
+   * @return  True if the cache held the page.
+   */
+  bool take(const FileId file, const PageId page_number, Page& page);
+
+  /**
+   * Drops a page from the cache if it holds it.
+   *
+   * @param file        Id of the file of the page.
+   * @param page_number Number of the page.
+   */
+  void erase(const FileId file, const PageId page_number);
+
+  /**
+   * Drops all pages of a file from the cache.
+   *
+   * @param file  Id of the file.
+   */
+  void eraseFile(const FileId file);
+
+  /**
+   * Returns the number of pages in the cache, counting reserved ones.
+   */
+  std::size_t pages() const;
+
+  /**
+   * Returns the number of compressed bytes in the cache.
+   */
+  std::size_t size() const;
+
+  /**
+   * Returns the number of compressed bytes the cache may hold.
+   */
+  std::size_t capacity() const { return capacity_; }
+
+ private:
+  VictimCache(const VictimCache&);
+  VictimCache& operator=(const VictimCache&);
+
+  /**
+   * @brief A page in the cache.
+   */
+  struct Entry {
+    /**
+     * Key of the page in index_.
+     */
+    std::uint64_t key;
+
+    /**
+     * Ticket of the reservation the page was stored for.
+     */
+    std::uint64_t ticket;
+
+    /**
+     * Whether the page was reserved but not stored yet.
+     */
+    bool pending;
+
+    /**
+     * The page compressed, or the page itself if it is Page::SIZE bytes.
+     */
+    std::string bytes;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  /**
+   * Key of a page in index_, ordered by file, then page number.
+   */
+  static std::uint64_t keyOf(const FileId file, const PageId page_number) {
+    return (static_cast<std::uint64_t>(file) << 32) | page_number;
+  }
+
+  /**
+   * Drops the page with the given key if the cache holds it.
+   */
+  void eraseKey(const std::uint64_t key);
+
+  /**
+   * Drops a page from the cache.
+   *
+   * @param position  Position of the page in index_.
+   */
+  void drop(const std::map<std::uint64_t, EntryList::iterator>::iterator&
+                position);
+
+  /**
+   * Number of compressed bytes the cache may hold.
+   */
+  const std::size_t capacity_;
+
+  /**
+   * Protects the members below.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Ticket of the last reservation.
+   */
+  std::uint64_t last_ticket_;
+
+  /**
+   * Number of compressed bytes in the cache.
+   */
+  std::size_t size_;
+
+  /**
+   * Pages in the cache, the one put most recently first.
+   */
+  EntryList entries_;
+
+  /**
+   * Position in entries_ of every page in the cache, by key.
+   */
+  std::map<std::uint64_t, EntryList::iterator> index_;
+};
+
+}